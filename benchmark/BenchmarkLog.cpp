@@ -0,0 +1,399 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#include "BenchmarkLog.h"
+#include <ompl/util/Console.h>
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+
+namespace
+{
+    const std::string SHARD_RUNS = "shard.runs STRING";
+
+    // The runs of one planner configuration in a log
+    struct PlannerLog
+    {
+        std::string                                     name;
+        std::vector<std::string>                        common;
+        std::vector<std::map<std::string, std::string>> runs;
+        std::vector<std::string>                        progressProperties;
+        std::vector<std::string>                        progress;
+        unsigned int                                    config{0};
+        unsigned int                                    firstRun{0};
+    };
+
+    struct ExperimentLog
+    {
+        // the lines before and after the experiment properties, up to the planners
+        std::vector<std::string>           header;
+        std::map<std::string, std::string> parameters;
+        std::vector<std::string>           info;
+        double                             duration{0.0};
+        std::vector<PlannerLog>            planners;
+    };
+
+    const char *DURATION = " seconds spent to collect the data";
+
+    bool endsWith(const std::string &s, const std::string &suffix)
+    {
+        return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    // Read a line "<count><suffix>"
+    bool readCount(std::istream &in, const std::string &suffix, std::size_t &count)
+    {
+        std::string line;
+        if (!std::getline(in, line) || !endsWith(line, suffix))
+            return false;
+        std::istringstream s(line.substr(0, line.size() - suffix.size()));
+        return static_cast<bool>(s >> count);
+    }
+
+    bool readLines(std::istream &in, std::size_t count, std::vector<std::string> &lines)
+    {
+        lines.resize(count);
+        for (auto &line : lines)
+            if (!std::getline(in, line))
+                return false;
+        return true;
+    }
+
+    bool readPlanner(std::istream &in, PlannerLog &planner)
+    {
+        std::size_t count;
+        std::vector<std::string> properties, lines;
+        if (!std::getline(in, planner.name) ||
+            !readCount(in, " common properties", count) || !readLines(in, count, planner.common) ||
+            !readCount(in, " properties for each run", count) || !readLines(in, count, properties) ||
+            !readCount(in, " runs", count) || !readLines(in, count, lines))
+            return false;
+
+        // every value is followed by "; "; missing values are empty
+        for (const auto &line : lines)
+        {
+            std::map<std::string, std::string> run;
+            std::size_t begin = 0;
+            for (const auto &property : properties)
+            {
+                std::size_t end = line.find("; ", begin);
+                if (end == std::string::npos)
+                    return false;
+                if (end > begin)
+                    run[property] = line.substr(begin, end - begin);
+                begin = end + 2;
+            }
+            planner.runs.push_back(run);
+        }
+
+        std::string line;
+        if (!std::getline(in, line))
+            return false;
+        if (line != ".")
+        {
+            std::istringstream s(line);
+            if (!(s >> count) || !endsWith(line, " progress properties for each run") ||
+                !readLines(in, count, planner.progressProperties) ||
+                !readCount(in, " runs", count) || !readLines(in, count, planner.progress) ||
+                !std::getline(in, line) || line != ".")
+                return false;
+        }
+        return true;
+    }
+
+    bool readLog(const std::string &filename, ExperimentLog &log)
+    {
+        std::ifstream in(filename.c_str());
+        std::string line;
+        std::size_t count;
+        if (!in.good() || !readLines(in, 2, log.header) || !readCount(in, " experiment properties", count))
+            return false;
+        for (std::size_t i = 0 ; i < count ; ++i)
+        {
+            if (!std::getline(in, line))
+                return false;
+            std::size_t eq = line.find(" = ");
+            if (eq == std::string::npos)
+                return false;
+            log.parameters[line.substr(0, eq)] = line.substr(eq + 3);
+        }
+
+        // the setup and CPU information are free text between "<<<|" and "|>>>"
+        while (std::getline(in, line))
+        {
+            if (line == "<<<|")
+            {
+                log.info.push_back(line);
+                while (std::getline(in, line) && line != "|>>>")
+                    log.info.push_back(line);
+                log.info.push_back("|>>>");
+                continue;
+            }
+            if (endsWith(line, " planners"))
+            {
+                std::istringstream s(line);
+                if (!(s >> count))
+                    return false;
+                break;
+            }
+            if (endsWith(line, DURATION))
+            {
+                log.duration = std::stod(line);
+                log.info.push_back(DURATION);
+            }
+            else
+                log.info.push_back(line);
+        }
+        if (!in.good())
+            return false;
+
+        log.planners.resize(count);
+        for (auto &planner : log.planners)
+            if (!readPlanner(in, planner))
+                return false;
+
+        // the planner configuration and first run of every planner
+        auto it = log.parameters.find(SHARD_RUNS);
+        if (it == log.parameters.end())
+            return false;
+        std::istringstream s(it->second);
+        for (auto &planner : log.planners)
+        {
+            char colon;
+            if (!(s >> planner.config >> colon >> planner.firstRun) || colon != ':')
+                return false;
+        }
+        return true;
+    }
+
+    void writePlanner(std::ostream &out, const std::vector<const PlannerLog*> &chunks)
+    {
+        const PlannerLog &first = *chunks.front();
+        out << first.name << std::endl;
+        out << first.common.size() << " common properties" << std::endl;
+        for (const auto &line : first.common)
+            out << line << std::endl;
+
+        // the properties of a run are sorted by name, as in Benchmark::saveResultsToStream()
+        std::set<std::string> properties;
+        std::size_t runs = 0;
+        for (const auto *chunk : chunks)
+        {
+            for (const auto &run : chunk->runs)
+                for (const auto &property : run)
+                    properties.insert(property.first);
+            runs += chunk->runs.size();
+        }
+        out << properties.size() << " properties for each run" << std::endl;
+        for (const auto &property : properties)
+            out << property << std::endl;
+        out << runs << " runs" << std::endl;
+        for (const auto *chunk : chunks)
+            for (const auto &run : chunk->runs)
+            {
+                for (const auto &property : properties)
+                {
+                    auto it = run.find(property);
+                    if (it != run.end())
+                        out << it->second;
+                    out << "; ";
+                }
+                out << std::endl;
+            }
+
+        std::size_t progress = 0;
+        const PlannerLog *names = nullptr;
+        for (const auto *chunk : chunks)
+            if (!chunk->progress.empty())
+            {
+                progress += chunk->progress.size();
+                names = chunk;
+            }
+        if (names != nullptr)
+        {
+            out << names->progressProperties.size() << " progress properties for each run" << std::endl;
+            for (const auto &name : names->progressProperties)
+                out << name << std::endl;
+            out << progress << " runs" << std::endl;
+            for (const auto *chunk : chunks)
+                for (const auto &line : chunk->progress)
+                    out << line << std::endl;
+        }
+        out << '.' << std::endl;
+    }
+}
+
+namespace
+{
+    // "OMPLAPP RUNS <configs> <runCount> <signature>"
+    std::string journalHeader(std::size_t configs, unsigned int runCount, const std::string &signature)
+    {
+        return "OMPLAPP RUNS " + std::to_string(configs) + " " + std::to_string(runCount) + " " + signature;
+    }
+
+    // tabs and line breaks separate the fields of the journal
+    std::string journalField(const std::string &s)
+    {
+        std::string result(s);
+        std::replace(result.begin(), result.end(), '\t', ' ');
+        std::replace(result.begin(), result.end(), '\n', ' ');
+        return result;
+    }
+
+    std::string journalProperties(const RunJournal::Properties &properties)
+    {
+        std::string result;
+        for (const auto &property : properties)
+            result += "\t" + journalField(property.first) + "=" + journalField(property.second);
+        return result;
+    }
+
+    void readProperties(std::istream &in, RunJournal::Properties &properties)
+    {
+        std::string field;
+        while (std::getline(in, field, '\t'))
+        {
+            std::size_t eq = field.find('=');
+            if (eq != std::string::npos)
+                properties[field.substr(0, eq)] = field.substr(eq + 1);
+        }
+    }
+}
+
+RunJournal::RunJournal(const std::string &filename, std::size_t configs, unsigned int runCount,
+                       const std::string &signature, bool append)
+    : out_(filename.c_str(), append ? std::ios::app : std::ios::trunc)
+{
+    if (!append)
+        write(journalHeader(configs, runCount, signature));
+    if (!out_.good())
+        OMPL_ERROR("Unable to write benchmark journal '%s'", filename.c_str());
+}
+
+void RunJournal::addPlanner(std::size_t config, const Planner &planner)
+{
+    write("P " + std::to_string(config) + "\t" + journalField(planner.name) + journalProperties(planner.common));
+}
+
+void RunJournal::addRun(std::size_t config, unsigned int run, const Properties &properties)
+{
+    write("R " + std::to_string(config) + " " + std::to_string(run) + journalProperties(properties));
+}
+
+void RunJournal::write(const std::string &line)
+{
+    std::lock_guard<std::mutex> _(lock_);
+    out_ << line << std::endl;
+}
+
+RunJournal::ReadStatus RunJournal::read(const std::string &filename, std::size_t configs, unsigned int runCount,
+                                        const std::string &signature, Contents &contents)
+{
+    std::ifstream in(filename.c_str());
+    std::string line;
+    if (!std::getline(in, line))
+        return READ_MISSING;
+    if (line != journalHeader(configs, runCount, signature))
+        return READ_MISMATCH;
+    // the last line is incomplete if it has no line break
+    while (std::getline(in, line) && !in.eof())
+    {
+        std::istringstream s(line);
+        std::string type;
+        std::size_t config;
+        if (!(s >> type >> config) || config >= configs)
+            continue;
+        if (type == "P")
+        {
+            Planner &planner = contents.planners[config];
+            s.ignore(1);
+            std::getline(s, planner.name, '\t');
+            readProperties(s, planner.common);
+        }
+        else if (type == "R")
+        {
+            unsigned int run;
+            if (!(s >> run) || run >= runCount)
+                continue;
+            Properties &properties = contents.runs[std::make_pair(config, run)];
+            properties.clear();
+            s.ignore(1);
+            readProperties(s, properties);
+        }
+    }
+    return READ_OK;
+}
+
+std::string shardLogName(const std::string &log, unsigned int index, unsigned int count)
+{
+    return log + ".shard-" + std::to_string(index + 1) + "-of-" + std::to_string(count);
+}
+
+bool mergeBenchmarkLogs(const std::vector<std::string> &logs, const std::string &output)
+{
+    std::vector<ExperimentLog> experiments(logs.size());
+    double duration = 0.0;
+    for (std::size_t i = 0 ; i < logs.size() ; ++i)
+    {
+        if (!readLog(logs[i], experiments[i]))
+        {
+            OMPL_ERROR("Unable to read shard log '%s'", logs[i].c_str());
+            return false;
+        }
+        duration += experiments[i].duration;
+    }
+    if (experiments.empty())
+        return false;
+
+    // order the planners by configuration and first run; runs of one configuration are merged
+    std::vector<const PlannerLog*> planners;
+    for (const auto &experiment : experiments)
+        for (const auto &planner : experiment.planners)
+            planners.push_back(&planner);
+    std::stable_sort(planners.begin(), planners.end(), [](const PlannerLog *a, const PlannerLog *b)
+        {
+            return a->config != b->config ? a->config < b->config : a->firstRun < b->firstRun;
+        });
+    std::vector<std::vector<const PlannerLog*>> merged;
+    for (std::size_t i = 0 ; i < planners.size() ; ++i)
+    {
+        if (i == 0 || planners[i]->config != planners[i - 1]->config)
+            merged.emplace_back();
+        merged.back().push_back(planners[i]);
+    }
+
+    std::ofstream out(output.c_str());
+    if (!out.good())
+    {
+        OMPL_ERROR("Unable to write merged log '%s'", output.c_str());
+        return false;
+    }
+    const ExperimentLog &first = experiments.front();
+    for (const auto &line : first.header)
+        out << line << std::endl;
+    std::map<std::string, std::string> parameters(first.parameters);
+    parameters.erase(SHARD_RUNS);
+    out << parameters.size() << " experiment properties" << std::endl;
+    for (const auto &parameter : parameters)
+        out << parameter.first << " = " << parameter.second << std::endl;
+    for (const auto &line : first.info)
+        if (line == DURATION)
+            out << duration << DURATION << std::endl;
+        else
+            out << line << std::endl;
+    out << merged.size() << " planners" << std::endl;
+    for (const auto &chunks : merged)
+        writePlanner(out, chunks);
+
+    OMPL_INFORM("Merged %lu shard logs into '%s'", logs.size(), output.c_str());
+    return out.good();
+}
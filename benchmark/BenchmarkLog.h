@@ -0,0 +1,105 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_BENCHMARK_BENCHMARK_LOG_
+#define OMPLAPP_BENCHMARK_BENCHMARK_LOG_
+
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Benchmarks can be split in shards ("ompl_benchmark problem.cfg --shard i/N")
+// that run on different machines. Every shard writes a regular benchmark log
+// (see ompl::tools::Benchmark::saveResultsToFile()) with its share of the
+// runs, plus the experiment property
+//
+//     shard.runs STRING = config:run config:run ...
+//
+// that lists, for every planner in the log, the index of its planner
+// configuration in the .cfg file and the index of its first run.
+
+// The name of the log of shard index (counting from 0) of count shards, for
+// a benchmark that would write its results to log
+std::string shardLogName(const std::string &log, unsigned int index, unsigned int count);
+
+// Merge the shard logs in logs into one log, as if all runs had been done
+// by one benchmark, and write it to output. The runs of every planner
+// configuration are in the order of their run index. The duration is the
+// sum of the durations of the shards; the other properties of the
+// experiment (such as the seed and the start time) are those of the first
+// log. Return false if a log cannot be read or written.
+bool mergeBenchmarkLogs(const std::vector<std::string> &logs, const std::string &output);
+
+// An append-only record of the completed runs of a benchmark, so that a
+// benchmark that was interrupted can be resumed without repeating them
+// (benchmark.checkpoint and "ompl_benchmark problem.cfg --resume"). Every
+// run is written, and flushed, as soon as it is done; a line that was cut
+// off by a crash is ignored when the journal is read. Runs are identified
+// by the index of their planner configuration and their run index.
+class RunJournal
+{
+public:
+    using Properties = std::map<std::string, std::string>;
+
+    // The planner name and common properties of a configuration
+    struct Planner
+    {
+        std::string name;
+        Properties  common;
+    };
+
+    // The runs read from a journal
+    struct Contents
+    {
+        std::map<std::size_t, Planner>                             planners;
+        std::map<std::pair<std::size_t, unsigned int>, Properties> runs;
+    };
+
+    // The result of reading a journal
+    enum ReadStatus
+    {
+        READ_OK,
+        READ_MISSING,
+        READ_MISMATCH
+    };
+
+    // Open filename for appending; the journal is started over if append
+    // is false. configs, runCount and signature, a hash of the planner
+    // configurations and problem and benchmark options, identify the
+    // benchmark.
+    RunJournal(const std::string &filename, std::size_t configs, unsigned int runCount,
+               const std::string &signature, bool append);
+
+    bool isOpen() const
+    {
+        return out_.good();
+    }
+
+    void addPlanner(std::size_t config, const Planner &planner);
+    void addRun(std::size_t config, unsigned int run, const Properties &properties);
+
+    // Read the journal filename of a benchmark with configs configurations,
+    // runCount runs and the given signature. Return READ_MISSING if it does
+    // not exist or is empty and READ_MISMATCH if it belongs to another
+    // benchmark; contents is only filled in if READ_OK is returned.
+    static ReadStatus read(const std::string &filename, std::size_t configs, unsigned int runCount,
+                           const std::string &signature, Contents &contents);
+
+private:
+    void write(const std::string &line);
+
+    std::ofstream out_;
+    std::mutex    lock_;
+};
+
+#endif
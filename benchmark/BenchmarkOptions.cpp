@@ -41,8 +41,87 @@
 #include <boost/program_options/variables_map.hpp>
 #include <boost/algorithm/string/case_conv.hpp>
 #include <boost/filesystem/operations.hpp>
+#include <boost/algorithm/string/trim.hpp>
 #include <iostream>
 #include <fstream>
+#include <sstream>
+
+namespace
+{
+    // The values of a parameter sweep: "{a, b, c}" lists the values and
+    // "[first:step:last]" is a range of numbers. Return false if val is a
+    // single value.
+    bool sweepValues(const std::string &val, std::vector<std::string> &values)
+    {
+        std::string v = boost::trim_copy(val);
+        values.clear();
+        if (v.size() >= 2 && v.front() == '{' && v.back() == '}')
+        {
+            std::istringstream s(v.substr(1, v.size() - 2));
+            std::string item;
+            while (std::getline(s, item, ','))
+                values.push_back(boost::trim_copy(item));
+            return true;
+        }
+        if (v.size() >= 2 && v.front() == '[' && v.back() == ']')
+        {
+            double range[3];
+            char sep[2];
+            std::istringstream s(v.substr(1, v.size() - 2));
+            if (!(s >> range[0] >> sep[0] >> range[1] >> sep[1] >> range[2]) || sep[0] != ':' || sep[1] != ':' ||
+                range[1] == 0.0 || (range[2] - range[0]) / range[1] < 0.0)
+            {
+                OMPL_WARN("Unable to parse range '%s'; expected [first:step:last]", v.c_str());
+                return false;
+            }
+            // allow for rounding errors at the last value
+            const double tolerance = 1e-9 * std::abs(range[1]);
+            for (unsigned int k = 0 ; range[1] > 0.0 ? range[0] + k * range[1] <= range[2] + tolerance
+                                                      : range[0] + k * range[1] >= range[2] - tolerance ; ++k)
+            {
+                std::ostringstream value;
+                value << range[0] + k * range[1];
+                values.push_back(value.str());
+            }
+            return true;
+        }
+        return false;
+    }
+
+    // Append one configuration for every combination of the values of the
+    // sweeps in option to expanded. The name of every combination is the
+    // name of the planner followed by the swept values.
+    void expandSweeps(const std::string &planner, const BenchmarkOptions::AllOptions &option,
+                      std::vector<BenchmarkOptions::AllOptions> &expanded)
+    {
+        std::vector<std::pair<BenchmarkOptions::AllOptions, std::string>> result(1, std::make_pair(option, std::string()));
+        std::vector<std::string> values;
+        // the planner options first, then the context options
+        for (int context = 0 ; context < 2 ; ++context)
+            for (const auto &param : context == 0 ? option.p : option.c)
+            {
+                if (param.first == "name" || !sweepValues(param.second, values))
+                    continue;
+                std::vector<std::pair<BenchmarkOptions::AllOptions, std::string>> next;
+                for (const auto &r : result)
+                    for (const auto &value : values)
+                    {
+                        next.push_back(r);
+                        (context == 0 ? next.back().first.p : next.back().first.c)[param.first] = value;
+                        next.back().second += "_" + param.first + "=" + value;
+                    }
+                result.swap(next);
+            }
+
+        auto name = option.p.find("name");
+        for (auto &r : result)
+        {
+            if (!r.second.empty())
+                r.first.p["name"] = (name != option.p.end() ? name->second : planner) + r.second;
+            expanded.push_back(r.first);
+        }
+    }
+}
 
 bool BenchmarkOptions::readOptions(const char *filename)
 {
@@ -72,6 +151,8 @@ bool BenchmarkOptions::readOptions(const char *filename)
     ("problem.robot", boost::program_options::value<std::string>(), "CAD file describing the robot")
     ("problem.objective", boost::program_options::value<std::string>(), "Optimization objective")
     ("problem.objective.threshold", boost::program_options::value<std::string>(), "Threshold to achieve optimization objective")
+    ("problem.clearance_cache", boost::program_options::value<std::string>(), "Number of states whose validity and clearance the FCL checker remembers (default 65536 with the max_min_clearance objective, 0 otherwise)")
+    ("problem.motion_validator", boost::program_options::value<std::string>(), "Motion validator: discrete (default) or conservative_advancement (FCL checker only)")
     ("problem.control", boost::program_options::value<std::string>(), "Type of control-based system")
     ("problem.start.x", boost::program_options::value<std::string>(), "Start position: x value")
     ("problem.start.y", boost::program_options::value<std::string>(), "Start position: y value")
@@ -89,6 +170,7 @@ bool BenchmarkOptions::readOptions(const char *filename)
     ("problem.goal.theta", boost::program_options::value<std::string>(), "Goal position: theta value")
     ("problem.threshold", boost::program_options::value<std::string>()->default_value("1e-6"), "Threshold to reach goal position")
     ("problem.solution_length", boost::program_options::value<std::string>(), "Maximum desired solution length")
+    ("problem.motion_primitives", boost::program_options::value<std::string>(), "Kinematic car: plan with motion primitives at this many steering angles (default 0, no primitives)")
     ("problem.volume.min.x", boost::program_options::value<std::string>(), "Min X for bounding volume")
     ("problem.volume.min.y", boost::program_options::value<std::string>(), "Min Y for bounding volume")
     ("problem.volume.min.z", boost::program_options::value<std::string>(), "Min Z for bounding volume")
@@ -100,7 +182,21 @@ bool BenchmarkOptions::readOptions(const char *filename)
     ("benchmark.mem_limit", boost::program_options::value<std::string>(), "Memory limit for each run of a planner")
     ("benchmark.run_count", boost::program_options::value<std::string>(), "Number of times to run each planner")
     ("benchmark.output", boost::program_options::value<std::string>(), "Location where to save the results")
-    ("benchmark.save_paths", boost::program_options::value<std::string>(), "Save none (default), all paths, shortest path per planner");
+    ("benchmark.save_paths", boost::program_options::value<std::string>(), "Save none (default), all paths, shortest path per planner")
+    ("benchmark.path_format", boost::program_options::value<std::string>(), "Format of saved paths: text (default, .path files) or binary (.bpath files)")
+    ("benchmark.parallel_jobs", boost::program_options::value<std::string>(), "Number of planner runs to execute concurrently (default 1)")
+    ("benchmark.checker_stats", boost::program_options::value<std::string>(), "Record collision checker counters and timers for every run (true/false, default false)")
+    ("benchmark.parallel_simplification", boost::program_options::value<std::string>(), "Shortcut a copy of every solution path for up to this many seconds with the motion checks spread over all cores, and record the time and length (default 0, off)")
+    ("benchmark.trace", boost::program_options::value<std::string>(), "Record a timeline of mesh loading, collision model building, setup, solving and a sample of the collision checks, and write it as a Chrome trace (true for a file next to the log, or a file name; default off)")
+    ("benchmark.trace_sample_rate", boost::program_options::value<std::string>(), "Fraction of the collision checks recorded in the timeline (default 0.001)")
+    ("benchmark.trace_buffer", boost::program_options::value<std::string>(), "Number of timeline spans kept per thread; older spans are dropped (default 262144)")
+    ("benchmark.checkpoint", boost::program_options::value<std::string>(), "Record every completed run in a journal next to the log, so that the benchmark can be resumed with --resume (true/false, default false)")
+    ("benchmark.adaptive", boost::program_options::value<std::string>(), "Run every planner until the 95% confidence intervals of its median time and success rate are narrow enough; run_count is the maximum (true/false, default false)")
+    ("benchmark.min_runs", boost::program_options::value<std::string>(), "Adaptive run count: number of runs before the intervals are checked (default 10)")
+    ("benchmark.run_batch", boost::program_options::value<std::string>(), "Adaptive run count: number of runs between checks (default 10)")
+    ("benchmark.time_ci_width", boost::program_options::value<std::string>(), "Adaptive run count: target width of the interval of the median time, relative to the median (default 0.2)")
+    ("benchmark.success_ci_width", boost::program_options::value<std::string>(), "Adaptive run count: target width of the interval of the success rate (default 0.2)")
+    ("benchmark.seed", boost::program_options::value<std::string>(), "Random seed (default: random). When the benchmark is sharded, shard i uses seed + i (default seed 1)");
 
     boost::program_options::variables_map vm;
     boost::program_options::parsed_options po = boost::program_options::parse_config_file(cfg, desc, true);
@@ -206,6 +302,17 @@ bool BenchmarkOptions::readOptions(const char *filename)
                 }
     }
 
+    // expand parameter sweeps in one planner configuration per combination of values
+    for (auto & planner : planners_)
+    {
+        std::vector<AllOptions> expanded;
+        for (auto & option : planner.second)
+            expandSweeps(planner.first, option, expanded);
+        if (expanded.size() > planner.second.size())
+            OMPL_INFORM("Expanded %lu configurations of %s into %lu", planner.second.size(), planner.first.c_str(), expanded.size());
+        planner.second.swap(expanded);
+    }
+
     boost::filesystem::path path(filename);
     path_ = boost::filesystem::absolute(path);
     outfile_ = path_.filename();
@@ -215,6 +322,14 @@ bool BenchmarkOptions::readOptions(const char *filename)
     return true;
 }
 
+boost::filesystem::path BenchmarkOptions::logFile() const
+{
+    auto it = declared_options_.find("benchmark.output");
+    if (it != declared_options_.end() && !it->second.empty())
+        return (path_ / it->second) / outfile_;
+    return path_ / outfile_;
+}
+
 bool BenchmarkOptions::isSE2Problem() const
 {
     return declared_options_.find("problem.start.x") != declared_options_.end() &&  declared_options_.find("problem.start.y") != declared_options_.end() &&
@@ -70,6 +70,9 @@ struct BenchmarkOptions
     boost::filesystem::path                         outfile_;
 
     bool readOptions(const char *filename);
+
+    // the file to which benchmark results are written (outfile_ in the output directory, if any)
+    boost::filesystem::path logFile(void) const;
     bool isSE2Problem(void) const;
     bool isSE3Problem(void) const;
 };
@@ -172,9 +172,9 @@ void SE2Benchmark::configure()
     setup_se2_->setStartAndGoalStates(start, goal, t);
     setBounds(setup_se2_->getStateSpace());
     setup_se2_->setOptimizationObjective(getOptimizationObjective(setup_se2_->getSpaceInformation()));
-    setup_se2_->setup();
+    setupApp(*setup_se2_);
     setup_se2_->print();
-    benchmark_ = std::make_shared<ompl::tools::Benchmark>(*setup_se2_, bo_.declared_options_["problem.name"]);
+    benchmark_ = std::make_shared<MergingBenchmark>(*setup_se2_, bo_.declared_options_["problem.name"]);
 }
 
 void SE3Benchmark::configure()
@@ -192,9 +192,9 @@ void SE3Benchmark::configure()
     setup_se3_->setStartAndGoalStates(start, goal, t);
     setBounds(setup_se3_->getStateSpace());
     setup_se3_->setOptimizationObjective(getOptimizationObjective(setup_se3_->getSpaceInformation()));
-    setup_se3_->setup();
+    setupApp(*setup_se3_);
     setup_se3_->print();
-    benchmark_ = std::make_shared<ompl::tools::Benchmark>(*setup_se3_, bo_.declared_options_["problem.name"]);
+    benchmark_ = std::make_shared<MergingBenchmark>(*setup_se3_, bo_.declared_options_["problem.name"]);
 }
 
 void KinematicCarBenchmark::configure()
@@ -213,9 +213,12 @@ void KinematicCarBenchmark::configure()
     setup_kinematicCar_->setStartAndGoalStates(start, goal, t);
     setBounds(setup_kinematicCar_->getStateSpace());
     setup_kinematicCar_->setOptimizationObjective(getOptimizationObjective(setup_kinematicCar_->getSpaceInformation()));
-    setup_kinematicCar_->setup();
+    auto primitives = bo_.declared_options_.find("problem.motion_primitives");
+    if (primitives != bo_.declared_options_.end() && std::stoul(primitives->second) > 0)
+        setup_kinematicCar_->setDefaultMotionPrimitives(std::stoul(primitives->second));
+    setupApp(*setup_kinematicCar_);
     setup_kinematicCar_->print();
-    benchmark_ = std::make_shared<ompl::tools::Benchmark>(*setup_kinematicCar_, bo_.declared_options_["problem.name"]);
+    benchmark_ = std::make_shared<MergingBenchmark>(*setup_kinematicCar_, bo_.declared_options_["problem.name"]);
 }
 
 void DynamicCarBenchmark::configure()
@@ -236,9 +239,9 @@ void DynamicCarBenchmark::configure()
         setup_dynamicCar_->getFullStateFromGeometricComponent(goal), t);
     setBounds(setup_dynamicCar_->getGeometricComponentStateSpace());
     setup_dynamicCar_->setOptimizationObjective(getOptimizationObjective(setup_dynamicCar_->getSpaceInformation()));
-    setup_dynamicCar_->setup();
+    setupApp(*setup_dynamicCar_);
     setup_dynamicCar_->print();
-    benchmark_ = std::make_shared<ompl::tools::Benchmark>(*setup_dynamicCar_, bo_.declared_options_["problem.name"]);
+    benchmark_ = std::make_shared<MergingBenchmark>(*setup_dynamicCar_, bo_.declared_options_["problem.name"]);
 }
 
 void BlimpBenchmark::configure()
@@ -258,9 +261,9 @@ void BlimpBenchmark::configure()
         setup_blimp_->getFullStateFromGeometricComponent(goal), t);
     setBounds(setup_blimp_->getGeometricComponentStateSpace());
     setup_blimp_->setOptimizationObjective(getOptimizationObjective(setup_blimp_->getSpaceInformation()));
-    setup_blimp_->setup();
+    setupApp(*setup_blimp_);
     setup_blimp_->print();
-    benchmark_ = std::make_shared<ompl::tools::Benchmark>(*setup_blimp_, bo_.declared_options_["problem.name"]);
+    benchmark_ = std::make_shared<MergingBenchmark>(*setup_blimp_, bo_.declared_options_["problem.name"]);
 }
 void QuadrotorBenchmark::configure()
 {
@@ -279,7 +282,36 @@ void QuadrotorBenchmark::configure()
         setup_quadrotor_->getFullStateFromGeometricComponent(goal), t);
     setBounds(setup_quadrotor_->getGeometricComponentStateSpace());
     setup_quadrotor_->setOptimizationObjective(getOptimizationObjective(setup_quadrotor_->getSpaceInformation()));
-    setup_quadrotor_->setup();
+    setupApp(*setup_quadrotor_);
     setup_quadrotor_->print();
-    benchmark_ = std::make_shared<ompl::tools::Benchmark>(*setup_quadrotor_, bo_.declared_options_["problem.name"]);
+    benchmark_ = std::make_shared<MergingBenchmark>(*setup_quadrotor_, bo_.declared_options_["problem.name"]);
+}
+
+std::shared_ptr<CFGBenchmark> allocBenchmark(const BenchmarkOptions &bo)
+{
+    std::shared_ptr<CFGBenchmark> b;
+    auto controlType = bo.declared_options_.find("problem.control");
+    if (bo.isSE2Problem())
+    {
+        if (controlType == bo.declared_options_.end())
+            b = std::make_shared<SE2Benchmark>(bo);
+        else if (controlType->second == "kinematic_car")
+            b = std::make_shared<KinematicCarBenchmark>(bo);
+        else if (controlType->second == "dynamic_car")
+            b = std::make_shared<DynamicCarBenchmark>(bo);
+        else
+            b = std::make_shared<SE2Benchmark>(bo);
+    }
+    else if (bo.isSE3Problem())
+    {
+        if (controlType == bo.declared_options_.end())
+            b = std::make_shared<SE3Benchmark>(bo);
+        else if (controlType->second == "blimp")
+            b = std::make_shared<BlimpBenchmark>(bo);
+        else if (controlType->second == "quadrotor")
+            b = std::make_shared<QuadrotorBenchmark>(bo);
+        else
+            b = std::make_shared<SE3Benchmark>(bo);
+    }
+    return b;
 }
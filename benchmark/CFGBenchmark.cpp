@@ -85,13 +85,52 @@
 #include <ompl/base/samplers/MaximizeClearanceValidStateSampler.h>
 #include <ompl/base/samplers/BridgeTestValidStateSampler.h>
 
+#include <omplapp/geometry/detail/CheckerStatistics.h>
+#include <omplapp/geometry/detail/FCLContinuousMotionValidator.h>
+
+#include <ompl/util/Time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
 #include <fstream>
+#include <limits>
+#include <set>
+#include <thread>
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
 
 void CFGBenchmark::setMeshes(ompl::app::RigidBodyGeometry& app)
 {
+    geometry_ = &app;
+    ompl::time::point start = ompl::time::now();
     app.setMeshPath({bo_.path_, OMPLAPP_RESOURCE_DIR});
+    // the benchmark never renders the meshes
+    app.setHeadlessMeshImport(true);
     app.setRobotMesh(bo_.declared_options_["problem.robot"]);
     app.setEnvironmentMesh(bo_.declared_options_["problem.world"]);
+    meshImportTime_ = ompl::time::seconds(ompl::time::now() - start);
+    meshImportMemory_ = peakMemory();
+}
+
+double CFGBenchmark::peakMemory()
+{
+#ifdef _WIN32
+    return 0.0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0.0;
+#ifdef __APPLE__
+    // bytes on OS X, kilobytes elsewhere
+    return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+    return usage.ru_maxrss / 1024.0;
+#endif
+#endif
 }
 
 ompl::base::PlannerPtr CFGBenchmark::allocPlanner(const ompl::base::SpaceInformationPtr &si, const std::string &name, const BenchmarkOptions::AllOptions &opt)
@@ -213,6 +252,13 @@ ompl::base::ValidStateSamplerPtr CFGBenchmark::allocValidStateSampler(const ompl
         vss = std::make_shared<ompl::base::MaximizeClearanceValidStateSampler>(si);
     else if (type == "bridge_test")
         vss = std::make_shared<ompl::base::BridgeTestValidStateSampler>(si);
+    else if (type == "reservoir")
+    {
+        if (reservoir_)
+            vss = std::make_shared<ompl::app::ReservoirValidStateSampler>(si, reservoir_);
+        else
+            std::cerr << "The reservoir sampler is not available for this problem" << std::endl;
+    }
     else
         std::cerr << "Unknown sampler type: " << type << std::endl;
     if (vss)
@@ -220,6 +266,102 @@ ompl::base::ValidStateSamplerPtr CFGBenchmark::allocValidStateSampler(const ompl
     return vss;
 }
 
+bool CFGBenchmark::reservoirOptions(std::size_t &size, double &nearObstacleDistance) const
+{
+    // the reservoir belongs to the app, so the settings of the first planner that uses it apply
+    for (const auto &planner : bo_.planners_)
+        for (const auto &options : planner.second)
+        {
+            auto sampler = options.c.find("sampler");
+            if (sampler == options.c.end() || sampler->second != "reservoir")
+                continue;
+            auto it = options.c.find("reservoir_size");
+            size = it != options.c.end() ? std::stoul(it->second) : 1000;
+            it = options.c.find("reservoir_near_obstacle");
+            nearObstacleDistance = it != options.c.end() ? std::stod(it->second) : 0.0;
+            return size > 0;
+        }
+    return false;
+}
+
+std::size_t CFGBenchmark::clearanceCacheSize(void)
+{
+    if (bo_.declared_options_.find("problem.clearance_cache") == bo_.declared_options_.end())
+    {
+        auto objective = bo_.declared_options_.find("problem.objective");
+        return objective != bo_.declared_options_.end() &&
+            objective->second.substr(0,17) == std::string("max_min_clearance") ? 1u << 16 : 0;
+    }
+    const std::string &size = bo_.declared_options_["problem.clearance_cache"];
+    try
+    {
+        return std::stoul(size);
+    }
+    catch(std::invalid_argument &)
+    {
+        OMPL_WARN("Unable to parse clearance cache size: %s", size.c_str());
+        return 0;
+    }
+}
+
+bool CFGBenchmark::conservativeAdvancement(void)
+{
+    auto it = bo_.declared_options_.find("problem.motion_validator");
+    if (it == bo_.declared_options_.end() || it->second == "discrete")
+        return false;
+    if (it->second == "conservative_advancement")
+        return true;
+    OMPL_WARN("Unknown motion validator: %s", it->second.c_str());
+    return false;
+}
+
+void CFGBenchmark::enableTrace(void)
+{
+    auto trace = bo_.declared_options_.find("benchmark.trace");
+    if (trace == bo_.declared_options_.end() || trace->second == "false" || trace->second == "0")
+        return;
+    double sampleRate = 0.001;
+    std::size_t buffer = 1u << 18;
+    try
+    {
+        auto it = bo_.declared_options_.find("benchmark.trace_sample_rate");
+        if (it != bo_.declared_options_.end())
+            sampleRate = std::stod(it->second);
+        it = bo_.declared_options_.find("benchmark.trace_buffer");
+        if (it != bo_.declared_options_.end())
+            buffer = std::stoul(it->second);
+    }
+    catch(std::invalid_argument &)
+    {
+        OMPL_WARN("Unable to parse trace parameters, using the defaults");
+    }
+    ompl::app::Trace::enable(buffer, sampleRate);
+}
+
+std::string CFGBenchmark::traceFile(const std::string &log) const
+{
+    const std::string &trace = bo_.declared_options_.at("benchmark.trace");
+    if (trace == "true" || trace == "1")
+        return boost::filesystem::path(log).replace_extension(".trace.json").string();
+    return trace;
+}
+
+double CFGBenchmark::parallelSimplificationTime(void)
+{
+    if (bo_.declared_options_.find("benchmark.parallel_simplification") == bo_.declared_options_.end())
+        return 0.0;
+    const std::string &time = bo_.declared_options_["benchmark.parallel_simplification"];
+    try
+    {
+        return std::stod(time);
+    }
+    catch(std::invalid_argument &)
+    {
+        OMPL_WARN("Unable to parse parallel simplification time: %s", time.c_str());
+        return 0.0;
+    }
+}
+
 ompl::base::OptimizationObjectivePtr CFGBenchmark::getOptimizationObjective(const ompl::base::SpaceInformationPtr &si)
 {
     ompl::base::OptimizationObjectivePtr opt;
@@ -268,23 +410,139 @@ void CFGBenchmark::setupBenchmark()
         {
             preSwitchEvent(planner);
         });
+    ompl::tools::Benchmark::PostSetupEvent postRun;
     if (bo_.declared_options_.find("benchmark.save_paths") != bo_.declared_options_.end())
     {
         std::string savePathArg = bo_.declared_options_["benchmark.save_paths"];
+        PathWriter::Format format = PathWriter::TEXT;
+        if (bo_.declared_options_.find("benchmark.path_format") != bo_.declared_options_.end())
+        {
+            const std::string &formatArg = bo_.declared_options_["benchmark.path_format"];
+            if (formatArg == "binary")
+                format = PathWriter::BINARY;
+            else if (formatArg != "text")
+                OMPL_WARN("Unknown path format '%s', saving paths as text", formatArg.c_str());
+        }
+        pathWriter_ = std::make_shared<PathWriter>(format);
         if (savePathArg.substr(0,3) == std::string("all")) // starts with "all"
-            benchmark_->setPostRunEvent(
-                [this](const ompl::base::PlannerPtr &planner, ompl::tools::Benchmark::RunProperties &properties)
+            postRun = [this](const ompl::base::PlannerPtr &planner, ompl::tools::Benchmark::RunProperties &properties)
                 {
                     saveAllPaths(planner, properties);
-                });
+                };
         else if (savePathArg.substr(0,8) == std::string("shortest")
             || savePathArg.substr(0,4) == std::string("best")) // starts with "shortest" or "best"
-            benchmark_->setPostRunEvent(
-                [this](const ompl::base::PlannerPtr &planner, ompl::tools::Benchmark::RunProperties &properties)
+            postRun = [this](const ompl::base::PlannerPtr &planner, ompl::tools::Benchmark::RunProperties &properties)
                 {
                     saveBestPath(planner, properties);
-                });
+                };
+    }
+    // where the time before the planner runs goes
+    benchmark_->addExperimentParameter("mesh import time", "REAL", std::to_string(meshImportTime_));
+    benchmark_->addExperimentParameter("mesh import peak memory", "REAL", std::to_string(meshImportMemory_));
+    benchmark_->addExperimentParameter("setup time", "REAL", std::to_string(appSetupTime_));
+    benchmark_->addExperimentParameter("collision model build time", "REAL", std::to_string(collisionModelTime_));
+    benchmark_->addExperimentParameter("collision model peak memory", "REAL", std::to_string(collisionModelMemory_));
+    if (reservoir_)
+        benchmark_->addExperimentParameter("reservoir fill time", "REAL", std::to_string(reservoirFillTime_));
+
+    // the planner is set up before the statistics of a run are collected
+    ompl::tools::Benchmark::PreSetupEvent preRun = [this](const ompl::base::PlannerPtr &planner)
+        {
+            ompl::time::point start = ompl::time::now();
+            if (!planner->isSetup())
+            {
+                ompl::app::ScopedTrace trace("planner setup", "planner");
+                planner->setup();
+            }
+            plannerSetupTime_ = ompl::time::seconds(ompl::time::now() - start);
+            if (reservoir_)
+                reservoirMisses_ = reservoir_->getMisses();
+        };
+    postRun = [this, postRun](const ompl::base::PlannerPtr &planner, ompl::tools::Benchmark::RunProperties &properties)
+        {
+            properties["planner setup time REAL"] = std::to_string(plannerSetupTime_);
+            properties["solve time REAL"] = std::to_string(ompl::time::seconds(ompl::time::now() - solveStart_));
+            properties["peak memory REAL"] = std::to_string(peakMemory());
+            if (ompl::app::Trace::isEnabled())
+                ompl::app::Trace::record(ompl::app::Trace::intern(planner->getName()), "planner",
+                                         traceSolveStart_, ompl::app::Trace::Clock::now());
+            // samples that the reservoir could not serve
+            if (reservoir_)
+                properties["reservoir misses INTEGER"] = std::to_string(reservoir_->getMisses() - reservoirMisses_);
+            if (postRun)
+                postRun(planner, properties);
+        };
+    if (pathSimplifier_)
+    {
+        // a copy is shortcut, so that the saved paths and the statistics of the planner are unchanged
+        postRun = [this, postRun](const ompl::base::PlannerPtr &planner, ompl::tools::Benchmark::RunProperties &properties)
+            {
+                if (postRun)
+                    postRun(planner, properties);
+                const ompl::base::ProblemDefinitionPtr &pdef = planner->getProblemDefinition();
+                auto path = pdef->hasSolution() ?
+                    std::dynamic_pointer_cast<ompl::geometric::PathGeometric>(pdef->getSolutionPath()) : nullptr;
+                if (!path)
+                    return;
+                ompl::geometric::PathGeometric shortcut(*path);
+                ompl::time::point start = ompl::time::now();
+                pathSimplifier_->shortcutPath(shortcut, parallelSimplifyTime_);
+                properties["parallel simplification time REAL"] = std::to_string(ompl::time::seconds(ompl::time::now() - start));
+                properties["parallel simplified length REAL"] = std::to_string(shortcut.length());
+            };
+    }
+    if (bo_.declared_options_.find("benchmark.checker_stats") != bo_.declared_options_.end() &&
+        (bo_.declared_options_["benchmark.checker_stats"] == "true" || bo_.declared_options_["benchmark.checker_stats"] == "1"))
+    {
+        // the collision checker counters and timers of each run are stored with the run
+        ompl::app::CheckerStatistics *stats = geometry_ ? geometry_->getCheckerStatistics() : nullptr;
+        if (stats)
+        {
+            preRun = [stats, preRun](const ompl::base::PlannerPtr &planner)
+                {
+                    preRun(planner);
+                    stats->clear();
+                    stats->setEnabled(true);
+                };
+            postRun = [stats, postRun](const ompl::base::PlannerPtr &planner, ompl::tools::Benchmark::RunProperties &properties)
+                {
+                    stats->setEnabled(false);
+                    stats->getProperties(properties);
+                    if (postRun)
+                        postRun(planner, properties);
+                };
+        }
+        else
+            OMPL_WARN("The collision checker does not collect statistics");
     }
+    benchmark_->setPreRunEvent(
+        [this, preRun](const ompl::base::PlannerPtr &planner)
+        {
+            preRun(planner);
+            solveStart_ = ompl::time::now();
+            traceSolveStart_ = ompl::app::Trace::Clock::now();
+        });
+    if (journal_)
+    {
+        // record every run as soon as it is done, with the runs of the other jobs
+        std::shared_ptr<RunJournal> journal = journal_;
+        postRun = [this, journal, postRun](const ompl::base::PlannerPtr &planner, ompl::tools::Benchmark::RunProperties &properties)
+            {
+                if (postRun)
+                    postRun(planner, properties);
+                const ompl::tools::Benchmark::Status &status = benchmark_->getStatus();
+                if (status.activeRun == 0)
+                {
+                    RunJournal::Planner p;
+                    p.name = planner->getName();
+                    planner->params().getParams(p.common);
+                    journal->addPlanner(journalConfig_, p);
+                }
+                journal->addRun(journalConfig_, status.activeRun + runOffset_, properties);
+            };
+    }
+    if (postRun)
+        benchmark_->setPostRunEvent(postRun);
 }
 
 void CFGBenchmark::preSwitchEvent(const ompl::base::PlannerPtr &planner)
@@ -299,6 +557,10 @@ void CFGBenchmark::preSwitchEvent(const ompl::base::PlannerPtr &planner)
     else
         planner->getSpaceInformation()->clearValidStateSamplerAllocator();
     planner->getSpaceInformation()->params().setParams(activeParams_, true);
+    auto ccd = std::dynamic_pointer_cast<ompl::app::FCLContinuousMotionValidator>(
+        planner->getSpaceInformation()->getMotionValidator());
+    if (ccd)
+        ccd->params().setParams(activeParams_, true);
 
     ompl::base::OptimizationObjectivePtr opt = planner->getProblemDefinition()->getOptimizationObjective();
     if (opt)
@@ -327,26 +589,9 @@ void CFGBenchmark::saveAllPaths(const ompl::base::PlannerPtr &planner, ompl::too
     {
         const ompl::tools::Benchmark::Status& status = benchmark_->getStatus();
         std::string fname = benchmark_->getExperimentName() + std::string("_")
-            + status.activePlanner + std::string("_") + std::to_string(status.activeRun)
-            + std::string(".path");
-        std::ofstream pathfile(fname.c_str());
-        ompl::base::PathPtr path = pdef->getSolutionPath();
-        auto* geoPath = dynamic_cast<ompl::geometric::PathGeometric*>(path.get());
-        if (geoPath != nullptr)
-        {
-            geoPath->interpolate();
-            geoPath->printAsMatrix(pathfile);
-        }
-        else {
-            auto* controlPath = dynamic_cast<ompl::control::PathControl*>(path.get());
-            if (controlPath != nullptr)
-            {
-                controlPath->interpolate();
-                controlPath->printAsMatrix(pathfile);
-            }
-            else
-                pdef->getSolutionPath()->print(pathfile);
-        }
+            + status.activePlanner + std::string("_") + std::to_string(status.activeRun + runOffset_);
+        // the path is no longer changed by the planner, so it can be written in the background
+        pathWriter_->write(pdef->getSolutionPath(), fname);
     }
 }
 void CFGBenchmark::saveBestPath(const ompl::base::PlannerPtr &planner, ompl::tools::Benchmark::RunProperties& /*run*/)
@@ -361,32 +606,14 @@ void CFGBenchmark::saveBestPath(const ompl::base::PlannerPtr &planner, ompl::too
         if (!bestPath_ || opt->isCostBetterThan(cost, bestPath_->cost(opt)))
         {
             bestPath_ = path;
-            bestPathIndex_ = status.activeRun;
+            bestPathIndex_ = status.activeRun + runOffset_;
         }
     }
     if (status.activeRun == benchmark_->getRecordedExperimentData().runCount - 1 && bestPath_)
     {
         std::string fname = benchmark_->getExperimentName() + std::string("_")
-                          + status.activePlanner + std::string("_") + std::to_string(bestPathIndex_)
-                          + std::string(".path");
-        std::ofstream pathfile(fname.c_str());
-
-        auto* geoPath = dynamic_cast<ompl::geometric::PathGeometric*>(bestPath_.get());
-        if (geoPath != nullptr)
-        {
-            geoPath->interpolate();
-            geoPath->printAsMatrix(pathfile);
-        }
-        else {
-            auto* controlPath = dynamic_cast<ompl::control::PathControl*>(bestPath_.get());
-            if (controlPath != nullptr)
-            {
-                controlPath->interpolate();
-                controlPath->printAsMatrix(pathfile);
-            }
-            else
-                bestPath_->print(pathfile);
-        }
+                          + status.activePlanner + std::string("_") + std::to_string(bestPathIndex_);
+        pathWriter_->write(bestPath_, fname);
     }
 }
 
@@ -425,9 +652,445 @@ void CFGBenchmark::runBenchmark()
     req.timeBetweenUpdates = .5;
     req.displayProgress = true;
     req.saveConsoleOutput = false;
-    benchmark_->benchmark(req);
-    if (!bo_.declared_options_["benchmark.output"].empty())
-        benchmark_->saveResultsToFile(((bo_.path_ / bo_.declared_options_["benchmark.output"]) / bo_.outfile_).string().c_str());
+
+    unsigned int jobs = 1;
+    if (bo_.declared_options_.find("benchmark.parallel_jobs") != bo_.declared_options_.end())
+    {
+        try
+        {
+            jobs = std::max(1ul, std::stoul(bo_.declared_options_["benchmark.parallel_jobs"]));
+        }
+        catch(std::invalid_argument &)
+        {
+            std::cerr << "Unable to parse number of parallel jobs" << std::endl;
+        }
+    }
+    std::string log = bo_.logFile().string();
+    if (shardCount_ > 1)
+        log = shardLogName(log, shardIndex_, shardCount_);
+    auto checkpoint = bo_.declared_options_.find("benchmark.checkpoint");
+    bool journal = resume_ || (checkpoint != bo_.declared_options_.end() &&
+        (checkpoint->second == "true" || checkpoint->second == "1"));
+
+    auto adaptive = bo_.declared_options_.find("benchmark.adaptive");
+    adaptive_.enabled = adaptive != bo_.declared_options_.end() && (adaptive->second == "true" || adaptive->second == "1");
+    if (adaptive_.enabled)
+    {
+        try
+        {
+            auto it = bo_.declared_options_.find("benchmark.min_runs");
+            if (it != bo_.declared_options_.end())
+                adaptive_.minRuns = std::max(2ul, std::stoul(it->second));
+            it = bo_.declared_options_.find("benchmark.run_batch");
+            if (it != bo_.declared_options_.end())
+                adaptive_.batch = std::max(1ul, std::stoul(it->second));
+            it = bo_.declared_options_.find("benchmark.time_ci_width");
+            if (it != bo_.declared_options_.end())
+                adaptive_.timeWidth = std::stod(it->second);
+            it = bo_.declared_options_.find("benchmark.success_ci_width");
+            if (it != bo_.declared_options_.end())
+                adaptive_.successWidth = std::stod(it->second);
+        }
+        catch(std::invalid_argument &)
+        {
+            std::cerr << "Unable to parse adaptive run count parameters" << std::endl;
+        }
+        if (resume_)
+            OMPL_WARN("Runs are recorded, but the adaptive run count does not resume from the journal");
+        resume_ = false;
+        if (shardCount_ > 1)
+            OMPL_WARN("The run count of every planner is chosen for the runs of this shard only");
+    }
+
+    if (shardCount_ > 1 || jobs > 1 || journal || adaptive_.enabled)
+    {
+        std::vector<Job> work = shardCount_ > 1 ? shardJobs(req, jobs) : parallelJobs(req, jobs);
+        if (journal && !resumeJobs(req, work, log + ".runs"))
+            return;
+        runJobs(req, jobs, work);
+    }
+    else
+        benchmark_->benchmark(req);
+    if (pathWriter_)
+        pathWriter_->flush();
+    benchmark_->saveResultsToFile(log.c_str());
+    if (ompl::app::Trace::isEnabled())
+    {
+        ompl::app::Trace::disable();
+        const std::string file = traceFile(log);
+        if (ompl::app::Trace::write(file))
+            OMPL_INFORM("Timeline written to %s", file.c_str());
+        else
+            OMPL_ERROR("Unable to write the timeline to %s", file.c_str());
+    }
+}
+
+bool CFGBenchmark::saveBestPaths() const
+{
+    auto it = bo_.declared_options_.find("benchmark.save_paths");
+    return it != bo_.declared_options_.end() &&
+        (it->second.substr(0,8) == std::string("shortest") || it->second.substr(0,4) == std::string("best"));
+}
+
+std::vector<CFGBenchmark::Job> CFGBenchmark::parallelJobs(const ompl::tools::Benchmark::Request &req, unsigned int jobs) const
+{
+    // One job per planner configuration and share of the runs. The best path
+    // can only be selected among all runs of a planner if they are done by
+    // one job.
+    std::size_t configs = 0;
+    for (auto & planner : bo_.planners_)
+        configs += planner.second.size();
+    unsigned int shares = saveBestPaths() || adaptive_.enabled || configs == 0 ? 1 :
+        std::max(1u, std::min(req.runCount, (unsigned int)((jobs + configs - 1) / configs)));
+
+    std::vector<Job> work;
+    std::size_t config = 0;
+    for (auto & planner : bo_.planners_)
+        for (auto & option : planner.second)
+        {
+            for (unsigned int s = 0 ; s < shares ; ++s)
+            {
+                unsigned int first = req.runCount * s / shares, last = req.runCount * (s + 1) / shares;
+                if (last > first)
+                    work.push_back(Job{planner.first, option, config, first, last - first});
+            }
+            ++config;
+        }
+    return work;
+}
+
+std::vector<CFGBenchmark::Job> CFGBenchmark::shardJobs(const ompl::tools::Benchmark::Request &req, unsigned int jobs) const
+{
+    // The runs of all planner configurations, in the order of the sequential
+    // benchmark, are split in contiguous ranges. Every shard does the runs of
+    // its range, split further over the jobs of the shard.
+    std::size_t configs = 0;
+    for (auto & planner : bo_.planners_)
+        configs += planner.second.size();
+    const std::size_t total = configs * req.runCount;
+    const std::size_t begin = total * shardIndex_ / shardCount_, end = total * (shardIndex_ + 1) / shardCount_;
+    if (saveBestPaths())
+        OMPL_WARN("The best path of a planner is selected among the runs of this shard only");
+
+    std::vector<Job> work;
+    std::size_t config = 0;
+    for (auto & planner : bo_.planners_)
+        for (auto & option : planner.second)
+        {
+            const std::size_t offset = config * req.runCount;
+            if (begin < offset + req.runCount && end > offset)
+            {
+                unsigned int first = std::max(begin, offset) - offset, last = std::min(end, offset + req.runCount) - offset;
+                unsigned int shares = saveBestPaths() || adaptive_.enabled ? 1 : std::max(1u, std::min(last - first, jobs));
+                for (unsigned int s = 0 ; s < shares ; ++s)
+                {
+                    unsigned int f = first + (last - first) * s / shares, l = first + (last - first) * (s + 1) / shares;
+                    if (l > f)
+                        work.push_back(Job{planner.first, option, config, f, l - f});
+                }
+            }
+            ++config;
+        }
+    std::cout << "Shard " << shardIndex_ + 1 << " of " << shardCount_ << ": runs " << begin << " to " << end
+              << " of " << total << std::endl;
+    return work;
+}
+
+namespace
+{
+    // 64-bit FNV-1a hash of a string, chained onto hash
+    std::uint64_t hashString(std::uint64_t hash, const std::string &s)
+    {
+        for (unsigned char c : s)
+        {
+            hash ^= c;
+            hash *= 1099511628211ULL;
+        }
+        // terminate every string so that ("ab", "c") and ("a", "bc") differ
+        hash ^= 0xff;
+        return hash * 1099511628211ULL;
+    }
+
+    // A hash of everything that changes the outcome of the runs: the expanded
+    // planner configurations and the problem and benchmark options, except
+    // the benchmark options that only change where and how the results are
+    // written or how many runs execute at once
+    std::string journalSignature(const BenchmarkOptions &bo)
+    {
+        static const std::set<std::string> ignored = {
+            "benchmark.output", "benchmark.save_paths", "benchmark.path_format", "benchmark.parallel_jobs",
+            "benchmark.trace", "benchmark.trace_sample_rate", "benchmark.trace_buffer", "benchmark.checkpoint"};
+        std::uint64_t hash = 14695981039346656037ULL;
+        for (const auto &planner : bo.planners_)
+        {
+            hash = hashString(hash, planner.first);
+            for (const auto &config : planner.second)
+            {
+                for (const auto &option : config.c)
+                    hash = hashString(hashString(hash, option.first), option.second);
+                hash = hashString(hash, "|");
+                for (const auto &option : config.p)
+                    hash = hashString(hashString(hash, option.first), option.second);
+                hash = hashString(hash, ";");
+            }
+        }
+        for (const auto &option : bo.declared_options_)
+            if ((option.first.compare(0, 8, "problem.") == 0 || option.first.compare(0, 10, "benchmark.") == 0)
+                && ignored.count(option.first) == 0)
+                hash = hashString(hashString(hash, option.first), option.second);
+        char buffer[17];
+        std::snprintf(buffer, sizeof(buffer), "%016llx", (unsigned long long)hash);
+        return buffer;
+    }
+}
+
+bool CFGBenchmark::resumeJobs(const ompl::tools::Benchmark::Request &req, std::vector<Job> &work,
+                              const std::string &journal)
+{
+    std::size_t configs = 0;
+    for (auto & planner : bo_.planners_)
+        configs += planner.second.size();
+    const std::string signature = journalSignature(bo_);
+    restored_ = RunJournal::Contents();
+    RunJournal::ReadStatus status = resume_ ? RunJournal::read(journal, configs, req.runCount, signature, restored_)
+                                            : RunJournal::READ_MISSING;
+    if (status == RunJournal::READ_MISMATCH)
+    {
+        // keep the journal: the runs in it may still be wanted with the
+        // configuration they were recorded with
+        OMPL_ERROR("The benchmark journal '%s' was recorded with different planners or problem and benchmark "
+                   "options; refusing to resume. Restore the configuration, or remove the journal to start over",
+                   journal.c_str());
+        return false;
+    }
+    if (resume_ && status == RunJournal::READ_MISSING)
+        OMPL_WARN("No journal of completed runs in '%s', starting the benchmark over", journal.c_str());
+    journal_ = std::make_shared<RunJournal>(journal, configs, req.runCount, signature, status == RunJournal::READ_OK);
+
+    // split the jobs in ranges of runs that are done and runs that are not
+    std::vector<Job> result;
+    std::size_t done = 0;
+    for (const auto &job : work)
+        for (unsigned int run = job.firstRun ; run < job.firstRun + job.runCount ; )
+        {
+            const bool d = restored_.runs.count(std::make_pair(job.config, run)) > 0;
+            unsigned int end = run + 1;
+            while (end < job.firstRun + job.runCount && (restored_.runs.count(std::make_pair(job.config, end)) > 0) == d)
+                ++end;
+            Job part(job);
+            part.firstRun = run;
+            part.runCount = end - run;
+            part.done = d;
+            result.push_back(part);
+            if (d)
+                done += end - run;
+            run = end;
+        }
+    if (done > 0)
+        OMPL_INFORM("Resuming the benchmark: %lu runs are already done", done);
+    work = std::move(result);
+    return true;
+}
+
+namespace
+{
+    // The widths of the 95% confidence intervals of the median solve time
+    // (relative to the median) and of the success rate of runs
+    void confidenceWidths(const std::vector<ompl::tools::Benchmark::RunProperties> &runs, double &timeWidth, double &successWidth)
+    {
+        const double z = 1.96;
+        std::vector<double> times;
+        unsigned int solved = 0;
+        for (const auto &run : runs)
+        {
+            auto time = run.find("time REAL");
+            auto success = run.find("solved BOOLEAN");
+            if (time != run.end())
+                times.push_back(std::stod(time->second));
+            if (success != run.end() && success->second == "1")
+                ++solved;
+        }
+        timeWidth = successWidth = std::numeric_limits<double>::infinity();
+        const std::size_t n = times.size();
+        if (n < 2)
+            return;
+
+        // distribution-free interval of the median, between two order statistics
+        std::sort(times.begin(), times.end());
+        const double median = n % 2 == 1 ? times[n / 2] : 0.5 * (times[n / 2 - 1] + times[n / 2]);
+        const double spread = z * std::sqrt((double)n) / 2.0;
+        const auto lo = (std::size_t)std::max(0.0, std::floor(n / 2.0 - spread));
+        const auto hi = (std::size_t)std::min((double)n - 1, std::ceil(n / 2.0 + spread));
+        timeWidth = median > 0.0 ? (times[hi] - times[lo]) / median : 0.0;
+
+        // Wilson score interval of the success rate
+        const double p = (double)solved / runs.size(), m = runs.size();
+        successWidth = 2.0 * z * std::sqrt(p * (1.0 - p) / m + z * z / (4.0 * m * m)) / (1.0 + z * z / m);
+    }
+}
+
+ompl::tools::Benchmark::CompleteExperiment CFGBenchmark::runAdaptive(const ompl::tools::Benchmark::Request &req)
+{
+    // the first batch has the minimum number of runs; then batches are added
+    // until both intervals are narrow enough or req.runCount runs are done
+    ompl::tools::Benchmark::CompleteExperiment result;
+    const unsigned int offset = runOffset_;
+    unsigned int done = 0;
+    double timeWidth = 0.0, successWidth = 0.0;
+    bool converged = false;
+    while (done < req.runCount && !converged)
+    {
+        ompl::tools::Benchmark::Request r(req);
+        r.runCount = std::min(done == 0 ? adaptive_.minRuns : adaptive_.batch, req.runCount - done);
+        runOffset_ = offset + done;
+        benchmark_->benchmark(r);
+        const ompl::tools::Benchmark::CompleteExperiment &e = benchmark_->getRecordedExperimentData();
+        if (e.planners.empty())
+            break;
+        if (done == 0)
+            result = e;
+        else
+        {
+            ompl::tools::Benchmark::PlannerExperiment &p = result.planners.front();
+            p.runs.insert(p.runs.end(), e.planners.front().runs.begin(), e.planners.front().runs.end());
+            p.runsProgressData.insert(p.runsProgressData.end(), e.planners.front().runsProgressData.begin(),
+                                      e.planners.front().runsProgressData.end());
+            result.totalDuration += e.totalDuration;
+        }
+        done += r.runCount;
+        confidenceWidths(result.planners.front().runs, timeWidth, successWidth);
+        converged = timeWidth <= adaptive_.timeWidth && successWidth <= adaptive_.successWidth;
+    }
+    runOffset_ = offset;
+    if (!result.planners.empty())
+    {
+        // the stopping reason is stored with the planner
+        ompl::tools::Benchmark::PlannerExperiment &p = result.planners.front();
+        p.common["adaptive stop"] = converged ? "converged" : "max runs";
+        p.common["adaptive runs"] = std::to_string(done);
+        p.common["adaptive time ci width"] = std::to_string(timeWidth);
+        p.common["adaptive success ci width"] = std::to_string(successWidth);
+        std::cout << p.name << ": " << done << " runs, " << (converged ? "converged" : "maximum number of runs reached") << std::endl;
+    }
+    return result;
+}
+
+ompl::tools::Benchmark::PlannerExperiment CFGBenchmark::restoredRuns(const Job &job) const
+{
+    ompl::tools::Benchmark::PlannerExperiment p;
+    auto it = restored_.planners.find(job.config);
+    if (it != restored_.planners.end())
+    {
+        p.name = it->second.name;
+        p.common = it->second.common;
+    }
     else
-            benchmark_->saveResultsToFile((bo_.path_ / bo_.outfile_).string().c_str());
+        p.name = job.planner;
+    for (unsigned int run = job.firstRun ; run < job.firstRun + job.runCount ; ++run)
+        p.runs.push_back(restored_.runs.at(std::make_pair(job.config, run)));
+    return p;
+}
+
+void CFGBenchmark::runJobs(const ompl::tools::Benchmark::Request &req, unsigned int jobs, const std::vector<Job> &work)
+{
+    // Every job gets its own benchmark instance (and therefore its own
+    // SimpleSetup); the meshes themselves are shared by all of them. Note
+    // that memory usage is measured for the whole process, so the reported
+    // memory of concurrent runs includes that of the other jobs.
+    std::cout << "Running " << work.size() << " benchmark jobs on " << jobs << " threads" << std::endl;
+    std::vector<ompl::tools::Benchmark::CompleteExperiment> results(work.size());
+    std::atomic<std::size_t> next(0);
+    ompl::time::point start = ompl::time::now();
+    auto worker = [&]()
+        {
+            for (std::size_t k = next++ ; k < work.size() ; k = next++)
+            {
+                if (work[k].done)
+                    continue;
+                try
+                {
+                    BenchmarkOptions bo(bo_);
+                    bo.planners_.clear();
+                    bo.planners_[work[k].planner].push_back(work[k].options);
+                    std::shared_ptr<CFGBenchmark> b = allocBenchmark(bo);
+                    if (!b)
+                        continue;
+                    // the completed runs are recorded in the journal of this benchmark
+                    b->journal_ = journal_;
+                    b->journalConfig_ = work[k].config;
+                    b->setup();
+                    if (!b->isValid())
+                        continue;
+                    b->runOffset_ = work[k].firstRun;
+                    // all jobs share one path writer
+                    b->pathWriter_ = pathWriter_;
+                    ompl::tools::Benchmark::Request r(req);
+                    r.runCount = work[k].runCount;
+                    r.displayProgress = false;
+                    if (adaptive_.enabled)
+                    {
+                        b->adaptive_ = adaptive_;
+                        results[k] = b->runAdaptive(r);
+                    }
+                    else
+                    {
+                        b->benchmark_->benchmark(r);
+                        results[k] = b->benchmark_->getRecordedExperimentData();
+                    }
+                }
+                catch (std::exception &e)
+                {
+                    OMPL_ERROR("Benchmark job for %s failed: %s", work[k].planner.c_str(), e.what());
+                }
+            }
+        };
+    std::vector<std::thread> threads;
+    for (unsigned int t = 0 ; t < std::min<std::size_t>(jobs, work.size()) ; ++t)
+        threads.emplace_back(worker);
+    for (auto & thread : threads)
+        thread.join();
+
+    // merge the runs of all jobs, in the order the sequential benchmark would have produced them
+    ompl::tools::Benchmark::CompleteExperiment exp(benchmark_->getRecordedExperimentData());
+    exp.planners.clear();
+    bool first = true;
+    std::size_t lastConfig = 0;
+    std::string shardRuns;
+    for (std::size_t k = 0 ; k < work.size() ; ++k)
+    {
+        ompl::tools::Benchmark::PlannerExperiment p;
+        if (work[k].done)
+            p = restoredRuns(work[k]);
+        else if (results[k].planners.empty())
+            continue;
+        else
+        {
+            if (first)
+            {
+                ompl::tools::Benchmark::CompleteExperiment meta(results[k]);
+                meta.planners.clear();
+                exp = meta;
+                first = false;
+            }
+            p = results[k].planners.front();
+        }
+        if (exp.planners.empty() || work[k].config != lastConfig)
+        {
+            exp.planners.push_back(p);
+            lastConfig = work[k].config;
+            shardRuns += (shardRuns.empty() ? "" : " ") + std::to_string(work[k].config) + ":" + std::to_string(work[k].firstRun);
+        }
+        else
+        {
+            ompl::tools::Benchmark::PlannerExperiment &merged = exp.planners.back();
+            merged.runs.insert(merged.runs.end(), p.runs.begin(), p.runs.end());
+            merged.runsProgressData.insert(merged.runsProgressData.end(), p.runsProgressData.begin(), p.runsProgressData.end());
+        }
+    }
+    exp.runCount = req.runCount;
+    exp.startTime = start;
+    exp.totalDuration = ompl::time::seconds(ompl::time::now() - start);
+    if (shardCount_ > 1)
+        exp.parameters["shard.runs STRING"] = shardRuns;
+    benchmark_->setRecordedExperimentData(std::move(exp));
 }
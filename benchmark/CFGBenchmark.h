@@ -37,7 +37,29 @@
 #include <ompl/control/planners/syclop/Decomposition.h>
 #include <ompl/tools/benchmark/Benchmark.h>
 #include <omplapp/geometry/RigidBodyGeometry.h>
+#include <omplapp/geometry/detail/LazyStateValidityChecker.h>
+#include <omplapp/geometry/detail/Trace.h>
+#include <omplapp/apps/detail/ParallelPathSimplifier.h>
+#include <omplapp/apps/detail/ValidStateReservoir.h>
+#include <ompl/util/Time.h>
+#include <utility>
 #include "BenchmarkOptions.h"
+#include "BenchmarkLog.h"
+#include "PathWriter.h"
+
+// A Benchmark whose recorded experiment can be replaced, so that the runs of
+// other Benchmark instances (parallel jobs, adaptive batches, and runs
+// restored from a journal) are saved as one experiment
+class MergingBenchmark : public ompl::tools::Benchmark
+{
+public:
+    using ompl::tools::Benchmark::Benchmark;
+
+    void setRecordedExperimentData(ompl::tools::Benchmark::CompleteExperiment exp)
+    {
+        exp_ = std::move(exp);
+    }
+};
 
 class CFGBenchmark
 {
@@ -60,9 +82,93 @@ public:
 
     void setup(void);
 
+    // Start recording a timeline of the benchmark if benchmark.trace is
+    // set, with the sample rate of the collision checks
+    // (benchmark.trace_sample_rate) and the number of spans kept per
+    // thread (benchmark.trace_buffer). Enabling the trace drops the spans
+    // recorded before, so only the driver calls this, once, before setup();
+    // the benchmark instances of parallel jobs do not.
+    void enableTrace(void);
+
+    // Only do the runs of shard index (counting from 0) of count shards, and
+    // write them to the log of the shard (see BenchmarkLog.h). The runs of
+    // all planner configurations are split in count contiguous ranges.
+    void setShard(unsigned int index, unsigned int count)
+    {
+        shardIndex_ = index;
+        shardCount_ = count;
+    }
+
+    // Skip the runs in the journal of the benchmark (see RunJournal), and
+    // record the remaining runs in it
+    void setResume(bool resume)
+    {
+        resume_ = resume;
+    }
+
 protected:
     void setMeshes(ompl::app::RigidBodyGeometry& app);
 
+    // Call app.setup() and build the collision checker, and record how long
+    // both take (the checker is otherwise built during the first run). If a
+    // planner uses the reservoir sampler, the reservoir is filled before the
+    // first run. If solutions are shortcut in parallel after every run, the
+    // simplifier is allocated here.
+    template<typename App>
+    void setupApp(App &app)
+    {
+        std::size_t reservoirSize;
+        double reservoirDistance;
+        if (reservoirOptions(reservoirSize, reservoirDistance))
+            app.setValidStateReservoir(reservoirSize, reservoirDistance);
+        app.setClearanceCacheSize(clearanceCacheSize());
+        app.setConservativeAdvancement(conservativeAdvancement());
+        ompl::time::point start = ompl::time::now();
+        app.setup();
+        appSetupTime_ = ompl::time::seconds(ompl::time::now() - start);
+        start = ompl::time::now();
+        ompl::app::LazyStateValidityChecker::resolve(app.getSpaceInformation()->getStateValidityChecker());
+        collisionModelTime_ = ompl::time::seconds(ompl::time::now() - start);
+        collisionModelMemory_ = peakMemory();
+        reservoir_ = app.getValidStateReservoir();
+        if (reservoir_)
+        {
+            start = ompl::time::now();
+            reservoir_->waitFor(reservoir_->capacity());
+            reservoirFillTime_ = ompl::time::seconds(ompl::time::now() - start);
+        }
+        parallelSimplifyTime_ = parallelSimplificationTime();
+        if (parallelSimplifyTime_ > 0.0)
+            pathSimplifier_ = app.allocParallelPathSimplifier();
+    }
+
+    // The size of the reservoir of valid states and the distance of its
+    // states to obstacles (problem.reservoir_size and
+    // problem.reservoir_near_obstacle), if a planner uses the reservoir
+    // sampler (sampler = reservoir)
+    bool reservoirOptions(std::size_t &size, double &nearObstacleDistance) const;
+
+    // The number of states in the clearance cache of the FCL checker
+    // (problem.clearance_cache); by default, the cache is only enabled for
+    // the max_min_clearance objective
+    std::size_t clearanceCacheSize(void);
+
+    // Whether motions are checked by conservative advancement
+    // (problem.motion_validator = conservative_advancement) instead of at
+    // discrete states
+    bool conservativeAdvancement(void);
+
+    // The file the timeline is written to: the value of benchmark.trace,
+    // or the log file with the extension .trace.json if it is true
+    std::string traceFile(const std::string &log) const;
+
+    // The time limit for shortcutting the solution of every run in parallel
+    // (benchmark.parallel_simplification), zero if solutions are not shortcut
+    double parallelSimplificationTime(void);
+
+    // The peak resident memory of the process so far, in MB
+    static double peakMemory(void);
+
     virtual void configure(void) = 0;
 
     ompl::base::OptimizationObjectivePtr getOptimizationObjective(const ompl::base::SpaceInformationPtr &si);
@@ -78,16 +184,99 @@ protected:
     std::map<ompl::base::Planner*, BenchmarkOptions::ContextOpt> pcontext_;
     BenchmarkOptions::ContextOpt                                 activeParams_;
     ompl::base::Cost                                             defaultCostThreshold_;
-    std::shared_ptr<ompl::tools::Benchmark>                      benchmark_;
+    std::shared_ptr<MergingBenchmark>                            benchmark_;
+
+    // Writes the saved paths in the background (if paths are saved)
+    std::shared_ptr<PathWriter>                                  pathWriter_;
 
     // When the best path is saved, we keep it here
     ompl::base::PathPtr                                          bestPath_;
     unsigned int                                                 bestPathIndex_;
 
+    // Index of the first run of this benchmark, when it runs a share of the runs of another one
+    unsigned int                                                 runOffset_{0};
+
+    // The geometry passed to setMeshes()
+    ompl::app::RigidBodyGeometry                                *geometry_{nullptr};
+
+    // Durations (in seconds) and peak memory (in MB) of the stages before the
+    // runs, stored as experiment properties
+    double                                                       meshImportTime_{0.0};
+    double                                                       meshImportMemory_{0.0};
+    double                                                       appSetupTime_{0.0};
+    double                                                       collisionModelTime_{0.0};
+    double                                                       collisionModelMemory_{0.0};
+
+    // The reservoir of valid states of the app, if a planner uses it, and
+    // the time it took to fill it
+    ompl::app::ValidStateReservoirPtr                            reservoir_;
+    double                                                       reservoirFillTime_{0.0};
+    std::size_t                                                  reservoirMisses_{0};
+
+    // Shortcuts a copy of the solution of every run (see ompl::app::ParallelPathSimplifier)
+    std::shared_ptr<ompl::app::ParallelPathSimplifier>          pathSimplifier_;
+    double                                                       parallelSimplifyTime_{0.0};
+
+    // The duration of the setup of the planner for the current run, and the start of its solve
+    double                                                       plannerSetupTime_{0.0};
+    ompl::time::point                                            solveStart_;
+    ompl::app::Trace::Clock::time_point                          traceSolveStart_;
+
+    // The shard of the runs done by this benchmark
+    unsigned int                                                 shardIndex_{0};
+    unsigned int                                                 shardCount_{1};
+
+    // The journal of completed runs, if runs are recorded, and the planner
+    // configuration of this benchmark in it
+    std::shared_ptr<RunJournal>                                  journal_;
+    std::size_t                                                  journalConfig_{0};
+    bool                                                         resume_{false};
+    RunJournal::Contents                                         restored_;
+
 private:
 
+    // The parameters of the adaptive run count (benchmark.adaptive)
+    struct AdaptiveRuns
+    {
+        bool         enabled{false};
+        unsigned int minRuns{10};
+        unsigned int batch{10};
+        double       timeWidth{0.2};
+        double       successWidth{0.2};
+    };
+    AdaptiveRuns                                                 adaptive_;
+
+    // A share of the runs of one planner configuration
+    struct Job
+    {
+        std::string                  planner;
+        BenchmarkOptions::AllOptions options;
+        std::size_t                  config;
+        unsigned int                 firstRun;
+        unsigned int                 runCount;
+        // whether the runs are already in the journal
+        bool                         done{false};
+    };
+
+    // Whether only the best path of every planner is saved
+    bool saveBestPaths(void) const;
+    // Run the planner in batches until the confidence intervals of its
+    // median solve time and success rate are narrow enough, or req.runCount
+    // runs are done
+    ompl::tools::Benchmark::CompleteExperiment runAdaptive(const ompl::tools::Benchmark::Request &req);
+    std::vector<Job> parallelJobs(const ompl::tools::Benchmark::Request &req, unsigned int jobs) const;
+    std::vector<Job> shardJobs(const ompl::tools::Benchmark::Request &req, unsigned int jobs) const;
+    // Replace work by the ranges of its runs that are done and not done
+    // according to the journal, and open the journal for recording. Return
+    // false if the journal belongs to a different configuration.
+    bool resumeJobs(const ompl::tools::Benchmark::Request &req, std::vector<Job> &work, const std::string &journal);
+    ompl::tools::Benchmark::PlannerExperiment restoredRuns(const Job &job) const;
+    void runJobs(const ompl::tools::Benchmark::Request &req, unsigned int jobs, const std::vector<Job> &work);
     ompl::base::PlannerPtr allocPlanner(const ompl::base::SpaceInformationPtr &si, const std::string &name, const BenchmarkOptions::AllOptions &opt);
     ompl::base::ValidStateSamplerPtr allocValidStateSampler(const ompl::base::SpaceInformation *si, const std::string &type);
     void setupBenchmark(void);
     void preSwitchEvent(const ompl::base::PlannerPtr &planner);
 };
+
+// Allocate the benchmark that matches the problem type in the options (defined in BenchmarkTypes.cpp)
+std::shared_ptr<CFGBenchmark> allocBenchmark(const BenchmarkOptions &bo);
@@ -0,0 +1,375 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+// Measures the throughput and latency of the collision checkers on the
+// robot/environment pairs of the problems in resources/2D and resources/3D,
+// independently of any planner. Usage:
+//
+//     ompl_collision_benchmark [-n queries] [-s seed] [-r rounds] [-o prefix] [problem.cfg ...]
+//
+// Without problem files, all problems in the resource directory are used.
+// Every checker is built and measured in each of the rounds. With -o, the
+// results of every problem are also written to the benchmark log
+// "<prefix><problem>.log", which ompl_benchmark_statistics.py reads like
+// the logs of ompl_benchmark: the experiment is "collision <problem>",
+// every checker and query is a planner ("FCL isValid", "FCL build", ...),
+// and every round is a run. The time of a query run is the mean time of
+// one query.
+
+#include "BenchmarkOptions.h"
+#include <omplapp/apps/SE2RigidBodyPlanning.h>
+#include <omplapp/apps/SE3RigidBodyPlanning.h>
+#include <omplapp/config.h>
+#include <omplapp/geometry/detail/FCLConservativeAdvancementMotionValidator.h>
+#include <omplapp/geometry/detail/FCLContinuousMotionValidator.h>
+#include <ompl/geometric/planners/rrt/RRTConnect.h>
+#include <ompl/tools/benchmark/MachineSpecs.h>
+#include <ompl/config.h>
+#include <ompl/util/Time.h>
+
+#include <boost/filesystem/operations.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    struct Options
+    {
+        unsigned int queries{10000};
+        unsigned int seed{1};
+        unsigned int rounds{1};
+        std::string  log;
+    };
+
+    using Run = std::map<std::string, std::string>;
+
+    // query times are microseconds; write them in seconds without losing digits
+    std::string real(double value)
+    {
+        std::ostringstream s;
+        s.precision(std::numeric_limits<double>::digits10);
+        s << value;
+        return s.str();
+    }
+
+    // the runs of the checkers on one problem, in the terms of a benchmark log
+    struct Experiment
+    {
+        std::string                                            problem;
+        // "<checker> <query>" and its runs, in the order of the first run
+        std::vector<std::pair<std::string, std::vector<Run>>>  planners;
+
+        void add(const char *checker, const char *query, Run run)
+        {
+            const std::string name = std::string(checker) + " " + query;
+            auto it = std::find_if(planners.begin(), planners.end(),
+                [&name](const std::pair<std::string, std::vector<Run>> &p) { return p.first == name; });
+            if (it == planners.end())
+                it = planners.emplace(planners.end(), name, std::vector<Run>());
+            it->second.push_back(std::move(run));
+        }
+    };
+
+    // write experiment to filename in the format of ompl::tools::Benchmark::saveResultsToFile()
+    bool writeLog(const Experiment &experiment, const Options &opt, ompl::time::point start, double duration,
+                  const std::string &filename)
+    {
+        std::ofstream out(filename.c_str());
+        out << "OMPL version " << OMPL_VERSION << std::endl;
+        out << "Experiment collision " << experiment.problem << std::endl;
+        out << "1 experiment properties" << std::endl;
+        out << "queries INTEGER = " << opt.queries << std::endl;
+        out << "Running on " << ompl::machine::getHostname() << std::endl;
+        out << "Starting at " << ompl::time::as_string(start) << std::endl;
+        out << "<<<|" << std::endl << "ompl_collision_benchmark" << std::endl << "|>>>" << std::endl;
+        out << "<<<|" << std::endl << ompl::machine::getCPUInfo() << "|>>>" << std::endl;
+        out << opt.seed << " is the random seed" << std::endl;
+        out << "0 seconds per run" << std::endl;
+        out << "0 MB per run" << std::endl;
+        out << opt.rounds << " runs per planner" << std::endl;
+        out << duration << " seconds spent to collect the data" << std::endl;
+        out << experiment.planners.size() << " planners" << std::endl;
+        for (const auto &planner : experiment.planners)
+        {
+            out << planner.first << std::endl;
+            out << "0 common properties" << std::endl;
+            // the properties of a run are sorted by name, as in Benchmark::saveResultsToStream()
+            std::set<std::string> properties;
+            for (const auto &run : planner.second)
+                for (const auto &property : run)
+                    properties.insert(property.first);
+            out << properties.size() << " properties for each run" << std::endl;
+            for (const auto &property : properties)
+                out << property << std::endl;
+            out << planner.second.size() << " runs" << std::endl;
+            for (const auto &run : planner.second)
+            {
+                for (const auto &property : properties)
+                {
+                    auto it = run.find(property);
+                    if (it != run.end())
+                        out << it->second;
+                    out << "; ";
+                }
+                out << std::endl;
+            }
+            out << '.' << std::endl;
+        }
+        return out.good();
+    }
+
+    // queries/sec and latency percentiles of a sequence of timed queries, and how many returned true
+    void report(Experiment &experiment, const char *checker, const char *query, std::vector<double> &latencies,
+                double total, unsigned int positive)
+    {
+        std::sort(latencies.begin(), latencies.end());
+        auto percentile = [&latencies](double p)
+        {
+            return latencies.empty() ? 0.0 : latencies[std::min(latencies.size() - 1, (std::size_t)(p * latencies.size()))];
+        };
+        std::printf("%-24s %-6s %-16s %12.0f %10.2f %10.2f %8u\n", experiment.problem.c_str(), checker, query,
+                    total > 0.0 ? latencies.size() / total : 0.0, percentile(0.5) * 1e6, percentile(0.99) * 1e6, positive);
+        experiment.add(checker, query, {
+            { "time REAL", real(latencies.empty() ? 0.0 : total / latencies.size()) },
+            { "p50 time REAL", real(percentile(0.5)) },
+            { "p99 time REAL", real(percentile(0.99)) },
+            { "positive INTEGER", std::to_string(positive) } });
+    }
+
+    // time query(i) for every i in [0, count)
+    template<typename F>
+    void measure(Experiment &experiment, const char *checker, const char *query, std::size_t count, const F &run)
+    {
+        std::vector<double> latencies(count);
+        unsigned int positive = 0;
+        ompl::time::point start = ompl::time::now();
+        for (std::size_t i = 0 ; i < count ; ++i)
+        {
+            ompl::time::point t = ompl::time::now();
+            positive += run(i) ? 1 : 0;
+            latencies[i] = ompl::time::seconds(ompl::time::now() - t);
+        }
+        double total = ompl::time::seconds(ompl::time::now() - start);
+        report(experiment, checker, query, latencies, total, positive);
+    }
+
+    // fill state with a uniformly random pose within the bounds of the state space
+    void randomPose(std::mt19937 &gen, const ompl::base::StateSpacePtr &space, ompl::base::State *state)
+    {
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        if (auto se2 = dynamic_cast<ompl::base::SE2StateSpace*>(space.get()))
+        {
+            const ompl::base::RealVectorBounds &b = se2->getBounds();
+            auto *s = state->as<ompl::base::SE2StateSpace::StateType>();
+            s->setXY(b.low[0] + unit(gen) * (b.high[0] - b.low[0]), b.low[1] + unit(gen) * (b.high[1] - b.low[1]));
+            s->setYaw((2.0 * unit(gen) - 1.0) * M_PI);
+        }
+        else
+        {
+            auto *se3 = space->as<ompl::base::SE3StateSpace>();
+            const ompl::base::RealVectorBounds &b = se3->getBounds();
+            auto *s = state->as<ompl::base::SE3StateSpace::StateType>();
+            s->setXYZ(b.low[0] + unit(gen) * (b.high[0] - b.low[0]), b.low[1] + unit(gen) * (b.high[1] - b.low[1]),
+                      b.low[2] + unit(gen) * (b.high[2] - b.low[2]));
+            // uniform random rotation (K. Shoemake, Graphics Gems III)
+            double x0 = unit(gen), r1 = sqrt(1.0 - x0), r2 = sqrt(x0);
+            double t1 = 2.0 * M_PI * unit(gen), t2 = 2.0 * M_PI * unit(gen);
+            ompl::base::SO3StateSpace::StateType &q = s->rotation();
+            q.x = sin(t1) * r1;
+            q.y = cos(t1) * r1;
+            q.z = sin(t2) * r2;
+            q.w = cos(t2) * r2;
+        }
+    }
+
+    template<typename App>
+    void benchmarkChecker(BenchmarkOptions &bo, Experiment &experiment, ompl::app::CollisionChecker type,
+                          const char *checker, const Options &opt)
+    {
+        App setup;
+        setup.setMeshPath({bo.path_, OMPLAPP_RESOURCE_DIR});
+        setup.setHeadlessMeshImport(true);
+        setup.setStateValidityCheckerType(type);
+        // build the collision models in setup(), so that their build time can be measured
+        setup.setLazyStateValidityChecker(false);
+        if (!setup.setRobotMesh(bo.declared_options_["problem.robot"]) ||
+            !setup.setEnvironmentMesh(bo.declared_options_["problem.world"]))
+        {
+            std::cerr << "Unable to load the meshes of " << experiment.problem << std::endl;
+            return;
+        }
+        try
+        {
+            ompl::base::RealVectorBounds bounds(setup.getMotionModel() == ompl::app::Motion_2D ? 2 : 3);
+            const char *axis[] = { "x", "y", "z" };
+            for (std::size_t k = 0 ; k < bounds.low.size() ; ++k)
+            {
+                bounds.setLow(k, std::stod(bo.declared_options_.at(std::string("problem.volume.min.") + axis[k])));
+                bounds.setHigh(k, std::stod(bo.declared_options_.at(std::string("problem.volume.max.") + axis[k])));
+            }
+            if (setup.getMotionModel() == ompl::app::Motion_2D)
+                setup.getStateSpace()->template as<ompl::base::SE2StateSpace>()->setBounds(bounds);
+            else
+                setup.getStateSpace()->template as<ompl::base::SE3StateSpace>()->setBounds(bounds);
+        }
+        catch (std::exception &)
+        {
+            // without a volume, the bounds are inferred from the environment
+        }
+
+        // no planning happens here, but setup() needs a planner when there is no goal
+        setup.setPlanner(std::make_shared<ompl::geometric::RRTConnect>(setup.getSpaceInformation()));
+
+        // building the state validity checker builds the bounding volume hierarchies
+        ompl::machine::MemUsage_t memory = ompl::machine::getProcessMemoryUsage();
+        ompl::time::point start = ompl::time::now();
+        setup.setup();
+        double buildTime = ompl::time::seconds(ompl::time::now() - start);
+        ompl::machine::MemUsage_t after = ompl::machine::getProcessMemoryUsage();
+        memory = after > memory ? after - memory : 0;
+        std::printf("%-24s %-6s %-16s %10.2f ms %10.1f MB\n", experiment.problem.c_str(), checker, "build", buildTime * 1e3,
+                    memory / (1024.0 * 1024.0));
+        experiment.add(checker, "build", {
+            { "time REAL", real(buildTime) },
+            { "memory REAL", real(memory / (1024.0 * 1024.0)) } });
+
+        const ompl::base::SpaceInformationPtr &si = setup.getSpaceInformation();
+        const ompl::base::StateValidityCheckerPtr &svc = si->getStateValidityChecker();
+        const ompl::base::StateSpacePtr &space = si->getStateSpace();
+
+        // the same poses for every checker
+        std::mt19937 gen(opt.seed);
+        std::vector<ompl::base::State*> states(opt.queries), targets(opt.queries);
+        for (unsigned int i = 0 ; i < opt.queries ; ++i)
+        {
+            states[i] = si->allocState();
+            randomPose(gen, space, states[i]);
+        }
+        // short motions: five percent of the way to the next random pose
+        for (unsigned int i = 0 ; i < opt.queries ; ++i)
+        {
+            targets[i] = si->allocState();
+            space->interpolate(states[i], states[(i + 1) % opt.queries], 0.05, targets[i]);
+        }
+
+        measure(experiment, checker, "isValid", states.size(), [&](std::size_t i) { return svc->isValid(states[i]); });
+        measure(experiment, checker, "clearance", states.size(), [&](std::size_t i) { return svc->clearance(states[i]) > 0.0; });
+        measure(experiment, checker, "checkMotion", states.size(),
+                [&](std::size_t i) { return si->checkMotion(states[i], targets[i]); });
+        if (type == ompl::app::FCL)
+        {
+            ompl::app::FCLContinuousMotionValidator ccd(si, setup.getMotionModel());
+            measure(experiment, checker, "checkMotion(ccd)", states.size(),
+                    [&](std::size_t i) { return ccd.checkMotion(states[i], targets[i]); });
+            ompl::base::MotionValidatorPtr ca;
+            if (setup.getMotionModel() == ompl::app::Motion_2D)
+                ca = std::make_shared<ompl::app::FCLConservativeAdvancementMotionValidator<ompl::app::Motion_2D>>(si);
+            else
+                ca = std::make_shared<ompl::app::FCLConservativeAdvancementMotionValidator<ompl::app::Motion_3D>>(si);
+            measure(experiment, checker, "checkMotion(ca)", states.size(),
+                    [&](std::size_t i) { return ca->checkMotion(states[i], targets[i]); });
+        }
+
+        for (unsigned int i = 0 ; i < opt.queries ; ++i)
+        {
+            si->freeState(states[i]);
+            si->freeState(targets[i]);
+        }
+    }
+
+    void benchmarkProblem(const std::string &filename, std::set<std::string> &done, const Options &opt)
+    {
+        BenchmarkOptions bo;
+        if (!bo.readOptions(filename.c_str()) || (!bo.isSE2Problem() && !bo.isSE3Problem()))
+            return;
+        // several problems use the same meshes
+        std::string pair = bo.declared_options_["problem.robot"] + "|" + bo.declared_options_["problem.world"];
+        if (!done.insert((bo.path_ / pair).string()).second)
+            return;
+
+        Experiment experiment;
+        experiment.problem = boost::filesystem::path(filename).stem().string();
+        std::vector<std::pair<ompl::app::CollisionChecker, const char*>> checkers;
+#if OMPL_HAS_PQP
+        checkers.emplace_back(ompl::app::PQP, "PQP");
+#endif
+        checkers.emplace_back(ompl::app::FCL, "FCL");
+        checkers.emplace_back(ompl::app::SDF, "SDF");
+        if (bo.isSE2Problem())
+            checkers.emplace_back(ompl::app::POLYGON, "POLY");
+        ompl::time::point start = ompl::time::now();
+        for (unsigned int round = 0 ; round < opt.rounds ; ++round)
+            for (auto &checker : checkers)
+            {
+                if (bo.isSE2Problem())
+                    benchmarkChecker<ompl::app::SE2RigidBodyPlanning>(bo, experiment, checker.first, checker.second, opt);
+                else
+                    benchmarkChecker<ompl::app::SE3RigidBodyPlanning>(bo, experiment, checker.first, checker.second, opt);
+            }
+        if (!opt.log.empty())
+        {
+            const std::string filename = opt.log + experiment.problem + ".log";
+            if (!writeLog(experiment, opt, start, ompl::time::seconds(ompl::time::now() - start), filename))
+                std::cerr << "Unable to write " << filename << std::endl;
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    std::vector<std::string> problems;
+    for (int i = 1 ; i < argc ; ++i)
+    {
+        std::string arg(argv[i]);
+        if ((arg == "-n" || arg == "-s" || arg == "-r") && i + 1 < argc)
+            (arg == "-n" ? opt.queries : arg == "-s" ? opt.seed : opt.rounds) = std::stoul(argv[++i]);
+        else if (arg == "-o" && i + 1 < argc)
+            opt.log = argv[++i];
+        else if (arg[0] == '-')
+        {
+            std::cerr << "Usage:\n\t " << argv[0] << " [-n queries] [-s seed] [-r rounds] [-o prefix] [problem.cfg ...]" << std::endl;
+            return 1;
+        }
+        else
+            problems.push_back(arg);
+    }
+    if (problems.empty())
+        for (const char *dir : { "/2D", "/3D" })
+        {
+            std::vector<std::string> files;
+            for (auto &entry : boost::filesystem::directory_iterator(std::string(OMPLAPP_RESOURCE_DIR) + dir))
+                if (entry.path().extension() == ".cfg")
+                    files.push_back(entry.path().string());
+            std::sort(files.begin(), files.end());
+            problems.insert(problems.end(), files.begin(), files.end());
+        }
+    opt.queries = std::max(1u, opt.queries);
+    opt.rounds = std::max(1u, opt.rounds);
+
+    ompl::msg::setLogLevel(ompl::msg::LOG_WARN);
+    std::printf("%-24s %-6s %-16s %12s %10s %10s %8s\n", "problem", "check", "query", "queries/s", "p50 (us)", "p99 (us)", "true");
+    std::set<std::string> done;
+    for (auto &problem : problems)
+        benchmarkProblem(problem, done, opt);
+
+    return 0;
+}
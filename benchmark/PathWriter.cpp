@@ -0,0 +1,155 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#include "PathWriter.h"
+#include "omplapp/apps/detail/appUtil.h"
+#include <ompl/geometric/PathGeometric.h>
+#include <ompl/control/PathControl.h>
+#include <ompl/control/SpaceInformation.h>
+#include <ompl/util/Console.h>
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+    const char PATH_MAGIC[8] = { 'O', 'A', 'P', 'P', 'P', 'A', 'T', 'H' };
+    const std::uint32_t PATH_VERSION = 1;
+
+    void writeMatrix(std::ostream &out, const std::vector<double> &values, std::uint32_t columns)
+    {
+        const std::uint32_t rows = columns > 0 ? values.size() / columns : 0;
+        out.write(PATH_MAGIC, sizeof(PATH_MAGIC));
+        out.write(reinterpret_cast<const char*>(&PATH_VERSION), sizeof(PATH_VERSION));
+        out.write(reinterpret_cast<const char*>(&rows), sizeof(rows));
+        out.write(reinterpret_cast<const char*>(&columns), sizeof(columns));
+        out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(double));
+    }
+}
+
+PathWriter::PathWriter(Format format) : format_(format)
+{
+    thread_ = std::thread([this] { run(); });
+}
+
+PathWriter::~PathWriter()
+{
+    {
+        std::lock_guard<std::mutex> slock(lock_);
+        done_ = true;
+    }
+    changed_.notify_all();
+    thread_.join();
+}
+
+void PathWriter::write(const ompl::base::PathPtr &path, const std::string &basename)
+{
+    {
+        std::lock_guard<std::mutex> slock(lock_);
+        queue_.emplace_back(path, basename);
+    }
+    changed_.notify_all();
+}
+
+void PathWriter::flush()
+{
+    std::unique_lock<std::mutex> slock(lock_);
+    changed_.wait(slock, [this] { return queue_.empty() && !busy_; });
+}
+
+void PathWriter::run()
+{
+    std::unique_lock<std::mutex> slock(lock_);
+    while (true)
+    {
+        changed_.wait(slock, [this] { return done_ || !queue_.empty(); });
+        if (queue_.empty())
+            return;
+        std::pair<ompl::base::PathPtr, std::string> job = std::move(queue_.front());
+        queue_.pop_front();
+        busy_ = true;
+        slock.unlock();
+        save(job.first, job.second);
+        job.first.reset();
+        slock.lock();
+        busy_ = false;
+        changed_.notify_all();
+    }
+}
+
+void PathWriter::save(const ompl::base::PathPtr &path, const std::string &basename) const
+{
+    const std::string fname = basename + (format_ == BINARY ? ".bpath" : ".path");
+    std::ofstream pathfile(fname.c_str(), format_ == BINARY ? std::ios::binary : std::ios::out);
+    if (!pathfile)
+    {
+        OMPL_ERROR("Unable to write path to '%s'", fname.c_str());
+        return;
+    }
+
+    auto* geoPath = dynamic_cast<ompl::geometric::PathGeometric*>(path.get());
+    auto* controlPath = dynamic_cast<ompl::control::PathControl*>(path.get());
+    if (geoPath != nullptr)
+        geoPath->interpolate();
+    else if (controlPath != nullptr)
+        controlPath->interpolate();
+
+    if (format_ == BINARY && (geoPath != nullptr || controlPath != nullptr))
+        writeBinary(*path, pathfile);
+    else if (geoPath != nullptr)
+        geoPath->printAsMatrix(pathfile);
+    else if (controlPath != nullptr)
+        controlPath->printAsMatrix(pathfile);
+    else
+        path->print(pathfile);
+}
+
+void PathWriter::writeBinary(const ompl::base::Path &path, std::ostream &out)
+{
+    const ompl::base::StateSpacePtr &space = path.getSpaceInformation()->getStateSpace();
+    const std::size_t dim = space->getValueLocations().size();
+
+    if (const auto* geoPath = dynamic_cast<const ompl::geometric::PathGeometric*>(&path))
+    {
+        const std::vector<ompl::base::State*> &states = geoPath->getStates();
+        std::vector<double> values(states.size() * dim);
+        ompl::app::copyStatesToReals(*space, states, values.data());
+        writeMatrix(out, values, dim);
+        return;
+    }
+
+    // the same columns as control::PathControl::printAsMatrix(): the state,
+    // and the control and duration that lead to it (zero for the first state)
+    const auto &controlPath = dynamic_cast<const ompl::control::PathControl&>(path);
+    const ompl::control::ControlSpace *cspace =
+        static_cast<const ompl::control::SpaceInformation*>(path.getSpaceInformation().get())->getControlSpace().get();
+    const std::vector<ompl::base::State*> &states = controlPath.getStates();
+    const std::vector<ompl::control::Control*> &controls = controlPath.getControls();
+    const std::vector<double> &durations = controlPath.getControlDurations();
+    unsigned int n = 0;
+    if (!controls.empty())
+        while (cspace->getValueAddressAtIndex(controls[0], n) != nullptr)
+            ++n;
+    // convert all states at once, then spread their rows out to make room
+    // for the controls, from the last row backwards
+    const std::size_t cols = dim + n + 1;
+    std::vector<double> values(states.size() * cols);
+    ompl::app::copyStatesToReals(*space, states, values.data());
+    for (std::size_t i = states.size() ; i-- > 0 ; )
+    {
+        double *row = values.data() + i * cols;
+        std::copy_backward(values.data() + i * dim, values.data() + (i + 1) * dim, row + dim);
+        for (unsigned int j = 0 ; j < n ; ++j)
+            row[dim + j] = i > 0 ? *cspace->getValueAddressAtIndex(controls[i - 1], j) : 0.;
+        row[dim + n] = i > 0 ? durations[i - 1] : 0.;
+    }
+    writeMatrix(out, values, cols);
+}
@@ -0,0 +1,76 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_BENCHMARK_PATH_WRITER_
+#define OMPLAPP_BENCHMARK_PATH_WRITER_
+
+#include <ompl/base/Path.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+
+// Writes solution paths to files on a background thread, so that
+// interpolating and writing paths does not add to the time between runs of
+// a benchmark. Geometric and control paths are interpolated and written as
+// a matrix with one row per state, like printAsMatrix(). In the TEXT format
+// this is exactly the output of printAsMatrix() in a ".path" file; the
+// BINARY format writes the same matrix to a ".bpath" file as
+//
+//     char[8]  "OAPPPATH"
+//     uint32   format version (1)
+//     uint32   number of rows
+//     uint32   number of columns
+//     double   rows * columns values, row by row
+//
+// with all numbers in the byte order of the machine. Paths are interpolated
+// with the space information they were computed with, concurrently with
+// the planner runs that use it.
+class PathWriter
+{
+public:
+    enum Format { TEXT, BINARY };
+
+    explicit PathWriter(Format format = TEXT);
+
+    // writes the queued paths before returning
+    ~PathWriter();
+
+    // Queue path to be written to basename followed by the extension of the format
+    void write(const ompl::base::PathPtr &path, const std::string &basename);
+
+    // Wait until all queued paths are written
+    void flush();
+
+    Format getFormat() const
+    {
+        return format_;
+    }
+
+    // Write path as a binary matrix (see above)
+    static void writeBinary(const ompl::base::Path &path, std::ostream &out);
+
+private:
+    void run();
+    void save(const ompl::base::PathPtr &path, const std::string &basename) const;
+
+    Format                                                  format_;
+    std::deque<std::pair<ompl::base::PathPtr, std::string>> queue_;
+    std::mutex                                              lock_;
+    std::condition_variable                                 changed_;
+    bool                                                    busy_{false};
+    bool                                                    done_{false};
+    std::thread                                             thread_;
+};
+
+#endif
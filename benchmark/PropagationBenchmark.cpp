@@ -0,0 +1,212 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+// Measures the throughput of the state propagators of the control-based
+// apps for each PropagationMethod, the number of heap allocations per
+// propagation, and the largest distance to the result of the default ODE
+// propagator. The BATCH rows use propagateBatch() on batches of the given
+// size. Usage:
+//
+//     ompl_propagation_benchmark [-n propagations] [-b batch] [-d duration] [-s seed]
+
+#include <omplapp/apps/BlimpPlanning.h>
+#include <omplapp/apps/DynamicCarPlanning.h>
+#include <omplapp/apps/KinematicCarPlanning.h>
+#include <omplapp/apps/QuadrotorPlanning.h>
+#include <ompl/util/RandomNumbers.h>
+#include <ompl/util/Time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // every heap allocation made by the benchmark goes through operator new below
+    std::atomic<unsigned long> allocations{0};
+
+    struct Options
+    {
+        unsigned int propagations{100000};
+        unsigned int batch{64};
+        double duration{.1};
+        unsigned int seed{1};
+    };
+
+    const char* methodName(ompl::app::PropagationMethod method)
+    {
+        switch (method)
+        {
+            case ompl::app::PropagationMethod::ODE:
+                return "ODE";
+            case ompl::app::PropagationMethod::ANALYTIC:
+                return "ANALYTIC";
+            case ompl::app::PropagationMethod::FIXED_SIZE:
+                return "FIXED_SIZE";
+            case ompl::app::PropagationMethod::ADAPTIVE:
+                return "ADAPTIVE";
+            default:
+                return "LIE_GROUP";
+        }
+    }
+
+    template<typename App>
+    void benchmarkApp(const std::vector<ompl::app::PropagationMethod> &methods, const Options &opt)
+    {
+        App app;
+        const ompl::control::SpaceInformationPtr &si = app.getSpaceInformation();
+        const ompl::base::StateSpacePtr &space = si->getStateSpace();
+
+        // no environment is loaded, so the bounds of the pose are set here
+        ompl::base::RealVectorBounds bounds(app.getMotionModel() == ompl::app::Motion_2D ? 2 : 3);
+        bounds.setLow(-10.);
+        bounds.setHigh(10.);
+        if (app.getMotionModel() == ompl::app::Motion_2D)
+            app.getGeometricComponentStateSpace()->template as<ompl::base::SE2StateSpace>()->setBounds(bounds);
+        else
+            app.getGeometricComponentStateSpace()->template as<ompl::base::SE3StateSpace>()->setBounds(bounds);
+        space->setup();
+
+        // the same states and controls for every method
+        ompl::RNG::setSeed(opt.seed);
+        ompl::base::StateSamplerPtr sampler = si->allocStateSampler();
+        ompl::control::ControlSamplerPtr csampler = si->allocControlSampler();
+        std::vector<ompl::base::State*> states(opt.propagations), reference(opt.propagations);
+        std::vector<ompl::control::Control*> controls(opt.propagations);
+        for (unsigned int i = 0 ; i < opt.propagations ; ++i)
+        {
+            states[i] = si->allocState();
+            reference[i] = si->allocState();
+            controls[i] = si->allocControl();
+            sampler->sampleUniform(states[i]);
+            csampler->sample(controls[i]);
+        }
+        ompl::base::State *result = si->allocState();
+
+        for (auto method : methods)
+        {
+            app.setPropagationMethod(method);
+            const ompl::control::StatePropagatorPtr &propagator = si->getStatePropagator();
+            unsigned long allocated = allocations.load();
+            ompl::time::point start = ompl::time::now();
+            for (unsigned int i = 0 ; i < opt.propagations ; ++i)
+                propagator->propagate(states[i], controls[i], opt.duration,
+                    method == ompl::app::PropagationMethod::ODE ? reference[i] : result);
+            double total = ompl::time::seconds(ompl::time::now() - start);
+            allocated = allocations.load() - allocated;
+
+            // difference with the ODE results; the propagator is not timed here
+            double error = 0.;
+            if (method != ompl::app::PropagationMethod::ODE)
+                for (unsigned int i = 0 ; i < opt.propagations ; ++i)
+                {
+                    propagator->propagate(states[i], controls[i], opt.duration, result);
+                    error = std::max(error, space->distance(result, reference[i]));
+                }
+
+            std::printf("%-16s %-10s %14.0f %14.2f %12.3g\n", app.getName().c_str(), methodName(method),
+                        total > 0. ? opt.propagations / total : 0., (double)allocated / opt.propagations, error);
+        }
+
+        // the same propagations in batches
+        std::vector<double> durations(opt.propagations, opt.duration);
+        std::vector<ompl::base::State*> results(opt.propagations);
+        for (auto &r : results)
+            r = si->allocState();
+        unsigned long allocated = allocations.load();
+        ompl::time::point start = ompl::time::now();
+        for (unsigned int i = 0 ; i < opt.propagations ; i += opt.batch)
+        {
+            unsigned int end = std::min(opt.propagations, i + opt.batch);
+            app.propagateBatch(std::vector<const ompl::base::State*>(states.begin() + i, states.begin() + end),
+                std::vector<const ompl::control::Control*>(controls.begin() + i, controls.begin() + end),
+                std::vector<double>(durations.begin() + i, durations.begin() + end),
+                std::vector<ompl::base::State*>(results.begin() + i, results.begin() + end));
+        }
+        double total = ompl::time::seconds(ompl::time::now() - start);
+        allocated = allocations.load() - allocated;
+        double error = 0.;
+        for (unsigned int i = 0 ; i < opt.propagations ; ++i)
+        {
+            error = std::max(error, space->distance(results[i], reference[i]));
+            si->freeState(results[i]);
+        }
+        std::printf("%-16s %-10s %14.0f %14.2f %12.3g\n", app.getName().c_str(), "BATCH",
+                    total > 0. ? opt.propagations / total : 0., (double)allocated / opt.propagations, error);
+
+        si->freeState(result);
+        for (unsigned int i = 0 ; i < opt.propagations ; ++i)
+        {
+            si->freeState(states[i]);
+            si->freeState(reference[i]);
+            si->freeControl(controls[i]);
+        }
+    }
+}
+
+void* operator new(std::size_t size)
+{
+    ++allocations;
+    if (void *p = std::malloc(size == 0 ? 1 : size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+int main(int argc, char **argv)
+{
+    Options opt;
+    for (int i = 1 ; i < argc ; ++i)
+    {
+        std::string arg(argv[i]);
+        if (arg == "-n" && i + 1 < argc)
+            opt.propagations = std::stoul(argv[++i]);
+        else if (arg == "-b" && i + 1 < argc)
+            opt.batch = std::stoul(argv[++i]);
+        else if (arg == "-d" && i + 1 < argc)
+            opt.duration = std::stod(argv[++i]);
+        else if (arg == "-s" && i + 1 < argc)
+            opt.seed = std::stoul(argv[++i]);
+        else
+        {
+            std::cerr << "Usage:\n\t " << argv[0] << " [-n propagations] [-b batch] [-d duration] [-s seed]" << std::endl;
+            return 1;
+        }
+    }
+    opt.propagations = std::max(1u, opt.propagations);
+    opt.batch = std::max(1u, opt.batch);
+
+    using ompl::app::PropagationMethod;
+    ompl::msg::setLogLevel(ompl::msg::LOG_WARN);
+    std::printf("%-16s %-10s %14s %14s %12s\n", "app", "method", "propagations/s", "allocs/prop", "max error");
+    benchmarkApp<ompl::app::KinematicCarPlanning>(
+        { PropagationMethod::ODE, PropagationMethod::FIXED_SIZE, PropagationMethod::ANALYTIC }, opt);
+    benchmarkApp<ompl::app::DynamicCarPlanning>(
+        { PropagationMethod::ODE, PropagationMethod::FIXED_SIZE, PropagationMethod::ANALYTIC }, opt);
+    benchmarkApp<ompl::app::BlimpPlanning>({ PropagationMethod::ODE, PropagationMethod::FIXED_SIZE }, opt);
+    benchmarkApp<ompl::app::QuadrotorPlanning>({ PropagationMethod::ODE, PropagationMethod::FIXED_SIZE,
+        PropagationMethod::ADAPTIVE, PropagationMethod::LIE_GROUP }, opt);
+
+    return 0;
+}
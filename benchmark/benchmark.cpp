@@ -35,46 +35,74 @@
 /* Author: Ioan Sucan, Mark Moll */
 
 #include "BenchmarkTypes.h"
+#include "BenchmarkLog.h"
+#include <ompl/util/RandomNumbers.h>
+#include <cstdio>
 #include <iostream>
 
 int main(int argc, char **argv)
 {
-    if (argc < 2)
+    // ompl_benchmark problem.cfg [--shard i/N | --merge N] [--resume]
+    unsigned int shard = 0, shards = 1, merge = 0;
+    bool resume = false;
+    bool usage = argc < 2;
+    for (int i = 2 ; i < argc && !usage ; ++i)
     {
-        std::cerr << "Usage:\n\t " << argv[0] << " problem.cfg" << std::endl;
+        std::string mode(argv[i]);
+        if (mode == "--resume")
+            resume = true;
+        else if (mode == "--shard" && i + 1 < argc)
+            usage = std::sscanf(argv[++i], "%u/%u", &shard, &shards) != 2 || shard < 1 || shard > shards;
+        else if (mode == "--merge" && i + 1 < argc)
+            usage = std::sscanf(argv[++i], "%u", &merge) != 1 || merge < 1;
+        else
+            usage = true;
+    }
+    if (usage)
+    {
+        std::cerr << "Usage:\n\t " << argv[0] << " problem.cfg [--shard i/N | --merge N] [--resume]\n\n"
+                  << "With --shard, only the i-th of N shares of the runs is done and written to a shard log.\n"
+                  << "With --merge, the logs of N shards are merged into the log of the benchmark.\n"
+                  << "With --resume, the runs recorded in the journal of an interrupted benchmark are not repeated;\n"
+                  << "the journal is only used if the planners and problem and benchmark options are unchanged." << std::endl;
         return 1;
     }
 
     BenchmarkOptions bo;
     if (bo.readOptions(argv[1]))
     {
-        std::shared_ptr<CFGBenchmark> b;
-        auto controlType = bo.declared_options_.find("problem.control");
-        if (bo.isSE2Problem())
+        if (merge > 0)
         {
-            if (controlType == bo.declared_options_.end())
-                b = std::make_shared<SE2Benchmark>(bo);
-            else if (controlType->second == "kinematic_car")
-                b = std::make_shared<KinematicCarBenchmark>(bo);
-            else if (controlType->second == "dynamic_car")
-                b = std::make_shared<DynamicCarBenchmark>(bo);
-            else
-                b = std::make_shared<SE2Benchmark>(bo);
+            std::vector<std::string> logs;
+            for (unsigned int i = 0 ; i < merge ; ++i)
+                logs.push_back(shardLogName(bo.logFile().string(), i, merge));
+            return mergeBenchmarkLogs(logs, bo.logFile().string()) ? 0 : 1;
         }
-        else if (bo.isSE3Problem())
+
+        // the seed has to be set before any random number generator is created
+        auto seed = bo.declared_options_.find("benchmark.seed");
+        if (seed != bo.declared_options_.end() || shards > 1)
         {
-            if (controlType == bo.declared_options_.end())
-                b = std::make_shared<SE3Benchmark>(bo);
-            else if (controlType->second == "blimp")
-                b = std::make_shared<BlimpBenchmark>(bo);
-            else if (controlType->second == "quadrotor")
-                b = std::make_shared<QuadrotorBenchmark>(bo);
-            else
-                b = std::make_shared<SE3Benchmark>(bo);
+            try
+            {
+                unsigned long base = seed != bo.declared_options_.end() ? std::stoul(seed->second) : 1;
+                ompl::RNG::setSeed(base + (shards > 1 ? shard - 1 : 0));
+            }
+            catch(std::invalid_argument &)
+            {
+                std::cerr << "Unable to parse random seed" << std::endl;
+            }
         }
 
+        std::shared_ptr<CFGBenchmark> b = allocBenchmark(bo);
+
         if (b)
         {
+            if (shards > 1)
+                b->setShard(shard - 1, shards);
+            b->setResume(resume);
+            // the timeline starts before the meshes are loaded
+            b->enableTrace();
             b->setup();
             b->runBenchmark();
         }
@@ -0,0 +1,42 @@
+#!/usr/bin/env python
+
+######################################################################
+# Rice University Software Distribution License
+#
+# Copyright (c) 2010, Rice University
+# All Rights Reserved.
+#
+# For a full description see the file named LICENSE.
+#
+######################################################################
+
+"""Read the paths saved by ompl_benchmark, in the text (.path) or binary
+(.bpath) format, and print them as text. Can also be imported; readPath()
+returns a path as a list of rows."""
+
+import struct
+import sys
+
+PATH_MAGIC = b'OAPPPATH'
+PATH_VERSION = 1
+
+def readPath(fname):
+    """Return the path in fname as a list of rows, one row per state."""
+    with open(fname, 'rb') as f:
+        data = f.read()
+    if not data.startswith(PATH_MAGIC):
+        return [[float(x) for x in line.split()] for line in data.decode().splitlines() if line.strip()]
+    header = struct.calcsize('=8s3I')
+    magic, version, rows, columns = struct.unpack_from('=8s3I', data)
+    if version != PATH_VERSION:
+        raise ValueError('%s has unsupported path format version %d' % (fname, version))
+    values = struct.unpack_from('=%dd' % (rows * columns), data, header)
+    return [list(values[i * columns:(i + 1) * columns]) for i in range(rows)]
+
+if __name__ == '__main__':
+    if len(sys.argv) < 2:
+        print('Usage: %s file.bpath [...]' % sys.argv[0])
+        sys.exit(1)
+    for fname in sys.argv[1:]:
+        for row in readPath(fname):
+            print(' '.join(repr(x) for x in row))
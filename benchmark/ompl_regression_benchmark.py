@@ -0,0 +1,205 @@
+#!/usr/bin/env python
+
+######################################################################
+# Rice University Software Distribution License
+#
+# Copyright (c) 2010, Rice University
+# All Rights Reserved.
+#
+# For a full description see the file named LICENSE.
+#
+######################################################################
+
+"""Run the performance regression suite and compare it with a baseline.
+
+The suite is the fixed, seeded set of problems in benchmark/regression: every
+.cfg file is benchmarked with ompl_benchmark, and the collision checkers are
+measured on the same problems with ompl_collision_benchmark. All logs are
+read into one database with ompl_benchmark_statistics.py, so the results can
+also be inspected with Planner Arena. To keep the results of a build as the
+baseline, copy the database:
+
+    ompl_regression_benchmark.py -o baseline.db
+
+Later builds are compared with it:
+
+    ompl_regression_benchmark.py -o results.db -b baseline.db
+
+For every experiment (a problem, or "collision <problem>") and planner (a
+planner configuration, or a checker and query such as "FCL isValid"), the
+time and memory of the runs are compared with a one-sided Mann-Whitney U
+test. A combination is reported if it is significantly slower or uses
+significantly more memory than in the baseline, and its median grew by more
+than the minimum change. The exit status is 1 if anything was reported.
+Both databases must come from the same suite on the same machine."""
+
+import argparse
+import math
+import os
+import shutil
+import sqlite3
+import subprocess
+import sys
+from glob import glob
+from os.path import abspath, basename, dirname, exists, join
+
+METRICS = ['time', 'memory']
+
+def importStatistics(dirs):
+    """Import readBenchmarkLog from ompl_benchmark_statistics.py, looking in
+    dirs if it is not on the Python path."""
+    for d in dirs:
+        if d and exists(join(d, 'ompl_benchmark_statistics.py')):
+            sys.path.insert(0, d)
+            break
+    from ompl_benchmark_statistics import readBenchmarkLog
+    return readBenchmarkLog
+
+def runSuite(args):
+    """Run all benchmarks of the suite in the work directory and return the
+    logs they wrote."""
+    if not exists(args.workdir):
+        os.makedirs(args.workdir)
+    problems = sorted(glob(join(args.suite, '*.cfg')))
+    if not problems:
+        raise RuntimeError('No .cfg files in ' + args.suite)
+    logs = []
+    for cfg in problems:
+        # ompl_benchmark writes its log next to the .cfg file
+        local = join(args.workdir, basename(cfg))
+        shutil.copyfile(cfg, local)
+        log = local[:-len('.cfg')] + '.log'
+        if exists(log):
+            os.remove(log)
+        print('Benchmarking ' + basename(cfg))
+        subprocess.check_call([join(args.bindir, 'ompl_benchmark'), local])
+        logs.append(log)
+
+    prefix = join(args.workdir, 'collision_')
+    for log in glob(prefix + '*.log'):
+        os.remove(log)
+    print('Benchmarking the collision checkers')
+    subprocess.check_call([join(args.bindir, 'ompl_collision_benchmark'),
+                           '-n', str(args.queries), '-s', '1', '-r', str(args.rounds), '-o', prefix] + problems)
+    logs += sorted(glob(prefix + '*.log'))
+    return logs
+
+def readSamples(db):
+    """Return a dictionary from (experiment, planner, metric) to the values
+    of the metric in all runs."""
+    conn = sqlite3.connect(db)
+    c = conn.cursor()
+    columns = [row[1] for row in c.execute('PRAGMA table_info(runs)')]
+    samples = {}
+    for metric in METRICS:
+        if metric not in columns:
+            continue
+        c.execute('SELECT experiments.name, plannerConfigs.name, runs.%s FROM runs '
+                  'INNER JOIN experiments ON runs.experimentid = experiments.id '
+                  'INNER JOIN plannerConfigs ON runs.plannerid = plannerConfigs.id' % metric)
+        for experiment, planner, value in c.fetchall():
+            if value is not None:
+                samples.setdefault((experiment, planner, metric), []).append(float(value))
+    conn.close()
+    return samples
+
+def median(values):
+    v = sorted(values)
+    n = len(v)
+    return v[n // 2] if n % 2 == 1 else 0.5 * (v[n // 2 - 1] + v[n // 2])
+
+def mannWhitneyGreater(x, y):
+    """The p-value of a one-sided Mann-Whitney U test of the hypothesis that
+    the values in x tend to be greater than those in y, with the normal
+    approximation and a correction for ties."""
+    n1, n2 = len(x), len(y)
+    values = sorted([(v, 0) for v in x] + [(v, 1) for v in y])
+    n = n1 + n2
+    # average ranks of tied values
+    ranks = [0.0] * n
+    ties = 0.0
+    i = 0
+    while i < n:
+        j = i
+        while j + 1 < n and values[j + 1][0] == values[i][0]:
+            j += 1
+        for k in range(i, j + 1):
+            ranks[k] = 0.5 * (i + j) + 1.0
+        t = j - i + 1
+        ties += t * t * t - t
+        i = j + 1
+    u = sum(r for r, (_, group) in zip(ranks, values) if group == 0) - n1 * (n1 + 1) / 2.0
+    variance = n1 * n2 / 12.0 * ((n + 1) - ties / (n * (n - 1)))
+    if variance <= 0.0:
+        return 1.0
+    # continuity correction
+    z = (u - n1 * n2 / 2.0 - 0.5) / math.sqrt(variance)
+    return 0.5 * math.erfc(z / math.sqrt(2.0))
+
+def compare(results, baseline, alpha, minChange):
+    """Return the regressions of results with respect to baseline as a list
+    of (experiment, planner, metric, baseline median, median, p-value)."""
+    current = readSamples(results)
+    previous = readSamples(baseline)
+    regressions = []
+    for key in sorted(current):
+        if key not in previous:
+            continue
+        x, y = current[key], previous[key]
+        if len(x) < 2 or len(y) < 2:
+            continue
+        before, after = median(y), median(x)
+        if after <= before * (1.0 + minChange):
+            continue
+        p = mannWhitneyGreater(x, y)
+        if p < alpha:
+            regressions.append(key + (before, after, p))
+    missing = sorted(set(k[:2] for k in previous) - set(k[:2] for k in current))
+    for experiment, planner in missing:
+        print('Not in the results: %s / %s' % (experiment, planner))
+    return regressions
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('-o', '--output', default='regression.db',
+                        help='database of the results (default: regression.db in the work directory)')
+    parser.add_argument('-b', '--baseline', help='database of the baseline results to compare with')
+    parser.add_argument('--no-run', action='store_true',
+                        help='compare the existing output database instead of running the suite')
+    parser.add_argument('--bindir', default=dirname(abspath(__file__)),
+                        help='directory of ompl_benchmark and ompl_collision_benchmark')
+    parser.add_argument('--suite', default=join(dirname(abspath(__file__)), 'regression'),
+                        help='directory of the .cfg files of the suite')
+    parser.add_argument('--workdir', default='regression', help='directory for the logs')
+    parser.add_argument('--statistics', help='directory of ompl_benchmark_statistics.py')
+    parser.add_argument('--queries', type=int, default=2000, help='queries per collision benchmark round')
+    parser.add_argument('--rounds', type=int, default=10, help='rounds of the collision benchmarks')
+    parser.add_argument('--alpha', type=float, default=0.01, help='significance level of the tests')
+    parser.add_argument('--min-change', type=float, default=0.05,
+                        help='smallest relative change of the median that is reported')
+    args = parser.parse_args()
+
+    output = args.output if dirname(args.output) else join(args.workdir, args.output)
+    if not args.no_run:
+        readBenchmarkLog = importStatistics([args.statistics, args.bindir,
+                                             join(dirname(dirname(abspath(__file__))), 'ompl', 'scripts')])
+        logs = runSuite(args)
+        # readBenchmarkLog adds to an existing database
+        if exists(output):
+            os.remove(output)
+        readBenchmarkLog(output, logs, False)
+        print('Stored the results in ' + output)
+
+    if args.baseline:
+        regressions = compare(output, args.baseline, args.alpha, args.min_change)
+        for experiment, planner, metric, before, after, p in regressions:
+            print('%s / %s: %s %g -> %g (%+.1f%%, p = %.2g)' %
+                  (experiment, planner, metric, before, after,
+                   100.0 * (after - before) / before if before > 0 else float('inf'), p))
+        if regressions:
+            print('%d significant regressions' % len(regressions))
+            sys.exit(1)
+        print('No significant regressions')
+
+if __name__ == '__main__':
+    main()
@@ -13,12 +13,18 @@
 #include "OpenDEWorld.inc"
 #include "OMPLEnvironment.inc"
 #include "OMPLSetup.inc"
+#include "OpenDEEnvironmentPool.inc"
 
 #include "displayOpenDE.h"
 #include "omplapp/config.h"
 
 #include <drawstuff/drawstuff.h>
+#include <ompl/control/planners/kpiece/KPIECE1.h>
+#include <ompl/tools/multiplan/ParallelPlan.h>
 
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <thread>
 
 #ifdef dDOUBLE
@@ -75,36 +81,21 @@ static void playPath(oc::OpenDESimpleSetup *ss)
     }
 }
 
-int main(int argc, char **argv)
+// Plan, and display the solution until the window is closed. The worlds are
+// destroyed before OpenDE is shut down.
+static void plan(int argc, char **argv, dsFunctions &fn, unsigned int threads)
 {
-    dsFunctions fn;
-    fn.version = DS_VERSION;
-    fn.start = &start;
-    fn.step = &simLoop;
-    fn.command = &command;
-    fn.stop = nullptr;
-
-    auto *textures = (char *)alloca(strlen(OMPLAPP_RESOURCE_DIR) + 10);
-    strcpy(textures, OMPLAPP_RESOURCE_DIR);
-    strcat(textures, "/textures");
-    fn.path_to_textures = textures;
-
-    dInitODE2(0);
-
-    bodies = 0;
-    joints = 0;
-    boxes = 0;
-    spheres = 0;
-    resetSimulation();
-    DISP.addSpace(space, 0.9, 0.9, 0.5);
-    DISP.setGeomColor(avoid_box_geom, 0.9, 0.0, 0.0);
-    DISP.setGeomColor(movable_box_geom[0], 0.1, 0.8, 0.8);
-    DISP.setGeomColor(movable_box_geom[1], 0.1, 0.8, 0.8);
-    DISP.setGeomColor(movable_box_geom[2], 0.1, 0.8, 0.8);
-    DISP.setGeomColor(movable_box_geom[3], 0.1, 0.8, 0.8);
-    DISP.setGeomColor(goal_geom, 0.0, 0.9, 0.1);
-
-    oc::OpenDEEnvironmentPtr ce = std::make_shared<CarEnvironment>();
+    // the world that is displayed, and in which the solution is played
+    auto w = std::make_shared<CarWorld>();
+    DISP.addSpace(w->space, 0.9, 0.9, 0.5);
+    DISP.setGeomColor(w->avoid_box_geom, 0.9, 0.0, 0.0);
+    DISP.setGeomColor(w->movable_box_geom[0], 0.1, 0.8, 0.8);
+    DISP.setGeomColor(w->movable_box_geom[1], 0.1, 0.8, 0.8);
+    DISP.setGeomColor(w->movable_box_geom[2], 0.1, 0.8, 0.8);
+    DISP.setGeomColor(w->movable_box_geom[3], 0.1, 0.8, 0.8);
+    DISP.setGeomColor(w->goal_geom, 0.0, 0.9, 0.1);
+
+    oc::OpenDEEnvironmentPtr ce = std::make_shared<CarEnvironment>(w);
     ob::StateSpacePtr sm = std::make_shared<CarStateSpace>(ce);
 
     oc::ControlSpacePtr cm = std::make_shared<CarControlSpace>(sm);
@@ -120,13 +111,39 @@ int main(int argc, char **argv)
     vb.high[2] = 10;
     ss.setVolumeBounds(vb);
 
+    std::vector<ob::PlannerPtr> planners;
+    if (threads > 1)
+    {
+        auto pool = std::make_shared<OpenDEEnvironmentPool>(
+            [] { return std::make_shared<CarEnvironment>(std::make_shared<CarWorld>()); }, threads);
+        ss.setStatePropagator(std::make_shared<PooledOpenDEStatePropagator>(ss.getSpaceInformation(), pool));
+        ss.setStateValidityChecker(std::make_shared<PooledOpenDEStateValidityChecker>(ss.getSpaceInformation(), pool));
+        for (unsigned int i = 0; i < threads; ++i)
+            planners.push_back(std::make_shared<oc::KPIECE1>(ss.getSpaceInformation()));
+        ss.setPlanner(planners[0]);
+    }
+
     ss.setup();
     ss.print();
     std::shared_ptr<std::thread> th;
 
-    std::cout << "Planning for at most 60 seconds ..." << std::endl;
+    std::cout << "Planning for at most 60 seconds ";
+    if (threads > 1)
+        std::cout << "with " << threads << " planners ";
+    std::cout << "..." << std::endl;
+
+    bool solved;
+    if (threads > 1)
+    {
+        ompl::tools::ParallelPlan pp(ss.getProblemDefinition());
+        for (auto &planner : planners)
+            pp.addPlanner(planner);
+        solved = pp.solve(60, 1, 1, false) == ob::PlannerStatus::EXACT_SOLUTION;
+    }
+    else
+        solved = ss.solve(60);
 
-    if (ss.solve(60))
+    if (solved)
     {
         std::cout << "Solved!" << std::endl;
         ob::ScopedState<oc::OpenDEStateSpace> last(ss.getSpaceInformation());
@@ -134,12 +151,17 @@ int main(int argc, char **argv)
         std::cout << "Reached: " << last->getBodyPosition(0)[0] << " " << last->getBodyPosition(0)[1] << std::endl;
 
         POINTS.clear();
-        ob::PlannerData pd(ss.getSpaceInformation());
-        ss.getPlannerData(pd);
-        for (unsigned int i = 0; i < pd.numVertices(); ++i)
+        if (planners.empty())
+            planners.push_back(ss.getPlanner());
+        for (auto &planner : planners)
         {
-            const double *pos = pd.getVertex(i).getState()->as<oc::OpenDEStateSpace::StateType>()->getBodyPosition(0);
-            POINTS.push_back(std::make_pair(pos[0], pos[1]));
+            ob::PlannerData pd(ss.getSpaceInformation());
+            planner->getPlannerData(pd);
+            for (unsigned int i = 0; i < pd.numVertices(); ++i)
+            {
+                const double *pos = pd.getVertex(i).getState()->as<oc::OpenDEStateSpace::StateType>()->getBodyPosition(0);
+                POINTS.push_back(std::make_pair(pos[0], pos[1]));
+            }
         }
 
         th = std::make_shared<std::thread>([&ss] { return playPath(&ss); });
@@ -152,9 +174,34 @@ int main(int argc, char **argv)
         // th->interrupt();
         th->join();
     }
+}
+
+int main(int argc, char **argv)
+{
+    dsFunctions fn;
+    fn.version = DS_VERSION;
+    fn.start = &start;
+    fn.step = &simLoop;
+    fn.command = &command;
+    fn.stop = nullptr;
+
+    auto *textures = (char *)alloca(strlen(OMPLAPP_RESOURCE_DIR) + 10);
+    strcpy(textures, OMPLAPP_RESOURCE_DIR);
+    strcat(textures, "/textures");
+    fn.path_to_textures = textures;
+
+    // "-threads n" plans with n planners at once, each propagating in its own
+    // copy of the world; this needs OpenDE built with thread support
+    unsigned int threads = 1;
+    for (int i = 1; i + 1 < argc; ++i)
+        if (strcmp(argv[i], "-threads") == 0)
+            threads = std::max(1, atoi(argv[i + 1]));
+
+    dInitODE2(0);
+    dAllocateODEDataForThread(dAllocateMaskAll);
+
+    plan(argc, argv, fn, threads);
 
-    dSpaceDestroy(space);
-    dWorldDestroy(world);
     dCloseODE();
 
     return 0;
@@ -128,6 +128,8 @@ class MainWindow(QtWidgets.QMainWindow):
         self.path = None
         self.isGeometric = True
         self.is3D = True
+        self.solving = False
+        self.stopRequested = False
         self.mainWidget.problemWidget.robotTypeSelect.currentIndexChanged[int].connect(
             self.setRobotType)
         self.mainWidget.solveWidget.solveButton.clicked.connect(self.solve)
@@ -169,7 +171,8 @@ class MainWindow(QtWidgets.QMainWindow):
         if fname and fname != self.environmentFile:
             self.environmentFile = fname
             self.omplSetup.setEnvironmentMesh(self.environmentFile)
-            self.mainWidget.glViewer.setEnvironment(self.omplSetup.renderEnvironment())
+            self.mainWidget.glViewer.setEnvironment(self.omplSetup.renderEnvironment(),
+                self.omplSetup.renderEnvironmentLOD())
             self.resetBounds()
             if self.isGeometric:
                 if self.robotFile:
@@ -234,7 +237,8 @@ class MainWindow(QtWidgets.QMainWindow):
             self.robotFile = join(cfg_dir, config.get("problem", "robot"))
             self.omplSetup.setEnvironmentMesh(self.environmentFile)
             self.omplSetup.setRobotMesh(self.robotFile)
-            self.mainWidget.glViewer.setEnvironment(self.omplSetup.renderEnvironment())
+            self.mainWidget.glViewer.setEnvironment(self.omplSetup.renderEnvironment(),
+                self.omplSetup.renderEnvironmentLOD())
             self.mainWidget.glViewer.setRobot(self.omplSetup.renderRobot())
             self.resetBounds()
             if self.isGeometric:
@@ -559,11 +563,36 @@ class MainWindow(QtWidgets.QMainWindow):
             self.mainWidget.problemWidget.objectiveThreshold.value())
         self.omplSetup.setup()
 
+    def showProgress(self, snapshot):
+        self.mainWidget.glViewer.addProgress(snapshot['vertices'], snapshot['edges'])
+        if snapshot['hasSolution']:
+            OMPL_DEBUG("Best solution cost after %g seconds: %g" % (snapshot['time'], snapshot['bestCost']))
+        # redraw, and handle a click on "Stop"
+        QtWidgets.QApplication.processEvents()
+        return not self.stopRequested
+
     def solve(self):
+        # while solving, the solve button stops the planner
+        if self.solving:
+            self.stopRequested = True
+            return
         self.configureApp()
         OMPL_DEBUG(str(self.omplSetup))
 
-        solved = self.omplSetup.solve(self.timeLimit)
+        # draw the planner data as it grows; the planner data of
+        # multithreaded planners, such as PRM, is only drawn at the end
+        self.mainWidget.glViewer.clearProgress()
+        self.omplSetup.setProgressCallback(self.showProgress, 0.25)
+        self.solving = True
+        self.stopRequested = False
+        self.mainWidget.solveWidget.solveButton.setText('Stop')
+        try:
+            solved = self.omplSetup.solve(self.timeLimit)
+        finally:
+            self.omplSetup.setProgressCallback(None)
+            self.solving = False
+            self.mainWidget.solveWidget.solveButton.setText('Solve')
+            self.mainWidget.glViewer.clearProgress()
 
         # update the planner data to render, if needed
         pd = ob.PlannerData(self.omplSetup.getSpaceInformation())
@@ -739,6 +768,8 @@ class GLViewer(QtOpenGL.QGLWidget):
         self.setFocusPolicy(QtCore.Qt.StrongFocus)
         self.lastPos = QtCore.QPoint()
         self.environment = None
+        self.environmentLOD = None
+        self.moving = False
         self.robot = None
         self.center = [0, 0, 0]
         self.scale = 1
@@ -754,6 +785,9 @@ class GLViewer(QtOpenGL.QGLWidget):
         self.animate = True
         self.drawPlannerData = False
         self.plannerDataList = None
+        # the positions and edges of the planner data reported while solving
+        self.progressVertices = []
+        self.progressEdges = []
         self.bounds_low = None
         self.bounds_high = None
         #self.elevation = 0
@@ -838,6 +872,13 @@ class GLViewer(QtOpenGL.QGLWidget):
         if self.solutionPath is not None:
             self.pathIndex = (self.pathIndex + 1) % len(self.solutionPath)
             self.updateGL()
+    def addProgress(self, vertices, edges):
+        self.progressVertices.extend(vertices)
+        self.progressEdges.extend(edges)
+        self.updateGL()
+    def clearProgress(self):
+        self.progressVertices = []
+        self.progressEdges = []
     def setSolutionPath(self, path):
         self.solutionPath = [self.getTransform(state()) for state in path]
         self.pathIndex = 0
@@ -846,10 +887,14 @@ class GLViewer(QtOpenGL.QGLWidget):
         if self.robot:
             GL.glDeleteLists(self.robot, 1)
         self.robot = robot
-    def setEnvironment(self, environment):
+    def setEnvironment(self, environment, environmentLOD=None):
         if self.environment:
             GL.glDeleteLists(self.environment, 1)
+        if self.environmentLOD:
+            GL.glDeleteLists(self.environmentLOD, 1)
         self.environment = environment
+        # coarser environment that is drawn while the camera moves
+        self.environmentLOD = environmentLOD
     def clear(self, deepClean=False):
         self.solutionPath = None
         self.plannerDataList = None
@@ -912,6 +957,23 @@ class GLViewer(QtOpenGL.QGLWidget):
             GL.glVertex3fv(p[edge[1]])
         GL.glEnd()
 
+    def drawProgress(self):
+        GL.glDisable(GL.GL_LIGHTING)
+        GL.glColor3f(1, 0, 0)
+        GL.glPointSize(3)
+        GL.glBegin(GL.GL_POINTS)
+        for vertex in self.progressVertices:
+            GL.glVertex3fv(vertex)
+        GL.glEnd()
+        # the second entry of the selection also draws the edges
+        if self.drawPlannerData > 1:
+            GL.glBegin(GL.GL_LINES)
+            for edge in self.progressEdges:
+                GL.glVertex3fv(self.progressVertices[edge[0]])
+                GL.glVertex3fv(self.progressVertices[edge[1]])
+            GL.glEnd()
+        GL.glEnable(GL.GL_LIGHTING)
+
     def paintGL(self):
         GL.glClear(GL.GL_COLOR_BUFFER_BIT | GL.GL_DEPTH_BUFFER_BIT)
         GL.glMatrixMode(GL.GL_MODELVIEW)
@@ -957,12 +1019,16 @@ class GLViewer(QtOpenGL.QGLWidget):
             GL.glPopMatrix()
 
         # draw environment
-        if self.environment:
+        if self.moving and self.environmentLOD:
+            GL.glCallList(self.environmentLOD)
+        elif self.environment:
             GL.glCallList(self.environment)
 
         # draw the planner data
         if self.drawPlannerData and self.plannerDataList:
             GL.glCallList(self.drawPlannerData + self.plannerDataList - 1)
+        elif self.drawPlannerData and self.progressVertices:
+            self.drawProgress()
 
         GL.glPopMatrix()
 
@@ -977,6 +1043,11 @@ class GLViewer(QtOpenGL.QGLWidget):
 
     def mousePressEvent(self, event):
         self.lastPos = event.pos()
+        self.moving = True
+
+    def mouseReleaseEvent(self, event):
+        self.moving = False
+        self.updateGL()
 
     def mouseMoveEvent(self, event):
         dx = event.x() - self.lastPos.x()
@@ -35,6 +35,15 @@ class ompl_app_generator_t(code_generator_t):
         .value("CONTROL", ompl::app::AppType::CONTROL)
         .export_values()
         ;""")
+        self.mb.enum('::ompl::app::PropagationMethod').exclude()
+        self.mb.add_registration_code("""bp::enum_< ompl::app::PropagationMethod>("PropagationMethod")
+        .value("ODE", ompl::app::PropagationMethod::ODE)
+        .value("ANALYTIC", ompl::app::PropagationMethod::ANALYTIC)
+        .value("FIXED_SIZE", ompl::app::PropagationMethod::FIXED_SIZE)
+        .value("ADAPTIVE", ompl::app::PropagationMethod::ADAPTIVE)
+        .value("LIE_GROUP", ompl::app::PropagationMethod::LIE_GROUP)
+        .export_values()
+        ;""")
         self.mb.class_('::ompl::app::AppBase< ompl::app::AppType::GEOMETRIC >').rename('AppBaseGeometric')
         self.mb.class_('::ompl::app::AppBase< ompl::app::AppType::CONTROL>').rename('AppBaseControl')
         self.mb.class_('::ompl::app::AppTypeSelector< ompl::app::AppType::GEOMETRIC >').rename('AppTypeGeometric')
@@ -71,12 +80,381 @@ class ompl_app_generator_t(code_generator_t):
         rb.add_registration_code('def("setEnvironmentMesh",&::ompl::app::RigidBodyGeometry::setEnvironmentMesh)')
         rb.member_function('addEnvironmentMesh').exclude()
         rb.add_registration_code('def("addEnvironmentMesh",&::ompl::app::RigidBodyGeometry::addEnvironmentMesh)')
+        rb.member_function('addEnvironmentMeshes').exclude()
+        rb.add_registration_code('def("addEnvironmentMeshes",&::ompl::app::RigidBodyGeometry::addEnvironmentMeshes)')
         rb.member_function('setRobotMesh').exclude()
         rb.add_registration_code('def("setRobotMesh",&::ompl::app::RigidBodyGeometry::setRobotMesh)')
         rb.member_function('addRobotMesh').exclude()
         rb.add_registration_code('def("addRobotMesh",&::ompl::app::RigidBodyGeometry::addRobotMesh)')
         rb.member_function('setStateValidityCheckerType').exclude()
         rb.add_registration_code('def("setStateValidityCheckerType",&::ompl::app::RigidBodyGeometry::setStateValidityCheckerType)')
+        # results are returned through a std::vector<bool> reference
+        rb.member_function('isValidBatch').exclude()
+        # returns a pointer to a class that is not exposed to Python
+        rb.member_function('getCheckerStatistics').exclude()
+        # returns a std::function of a checker that keeps per-sequence state
+        rb.member_function('allocSequenceChecker').exclude()
+        # the valid prefix is returned through a std::vector<State*> reference
+        self.mb.member_functions('propagateWhileValid', allow_empty=True).exclude()
+        # results are returned through a std::vector<double> reference
+        rb.member_function('clearanceBatch').exclude()
+        # the pose arrays are raw pointers; NumPy arrays are passed without
+        # copying through the buffer protocol instead, with the GIL released
+        # while the poses are checked
+        self.mb.member_functions('isValidPoses', allow_empty=True).exclude()
+        self.mb.member_functions('clearancePoses', allow_empty=True).exclude()
+        # whole paths are converted to and from NumPy arrays in one pass
+        # through the buffer protocol instead of the flat arrays
+        self.mb.member_functions('getStateValues', allow_empty=True).exclude()
+        self.mb.member_functions('setStateValues', allow_empty=True).exclude()
+        self.mb.member_functions('getPoses', allow_empty=True).exclude()
+        self.mb.member_functions('setPoses', allow_empty=True).exclude()
+        self.mb.add_declaration_code("""
+namespace
+{
+    // a C-contiguous buffer of a Python object that is released on destruction
+    struct PoseBuffer
+    {
+        PoseBuffer(PyObject *obj, int flags)
+        {
+            if (PyObject_GetBuffer(obj, &view, flags | PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) != 0)
+                bp::throw_error_already_set();
+        }
+        ~PoseBuffer()
+        {
+            PyBuffer_Release(&view);
+        }
+        Py_buffer view;
+    };
+
+    template <typename App, typename Result, typename Check>
+    bp::object checkPoseArray(App &app, bp::object poses, const char *dtype, char format, Check check, unsigned int numThreads)
+    {
+        const std::size_t width = app.getPoseDimension() * app.getRobotCount();
+        PoseBuffer input(poses.ptr(), PyBUF_ND);
+        if (input.view.format == nullptr || std::string(input.view.format) != "d")
+            throw ompl::Exception("Poses must be an array of float64 values");
+        if (input.view.ndim != 2 || static_cast<std::size_t>(input.view.shape[1]) != width)
+            throw ompl::Exception("Poses must be an array with " + std::to_string(width) + " columns");
+        const std::size_t count = input.view.shape[0];
+
+        bp::object result = bp::import("numpy").attr("empty")(count, dtype);
+        PoseBuffer output(result.ptr(), PyBUF_WRITABLE);
+        if (output.view.itemsize != sizeof(Result) || output.view.format == nullptr || output.view.format[0] != format)
+            throw ompl::Exception("Unexpected NumPy result type");
+
+        const double *in = static_cast<const double*>(input.view.buf);
+        Result *out = static_cast<Result*>(output.view.buf);
+        PyThreadState *state = PyEval_SaveThread();
+        try
+        {
+            (app.*check)(in, count, out, numThreads);
+        }
+        catch (...)
+        {
+            PyEval_RestoreThread(state);
+            throw;
+        }
+        PyEval_RestoreThread(state);
+        return result;
+    }
+
+    template <typename App>
+    bp::object isValidPoseArray(App &app, bp::object poses, unsigned int numThreads)
+    {
+        return checkPoseArray<App, bool>(app, poses, "bool", '?', &App::isValidPoses, numThreads);
+    }
+
+    template <typename App>
+    bp::object clearancePoseArray(App &app, bp::object poses, unsigned int numThreads)
+    {
+        return checkPoseArray<App, double>(app, poses, "float64", 'd', &App::clearancePoses, numThreads);
+    }
+
+    // the states of a geometric or control path
+    const std::vector<ompl::base::State*> &pathStates(bp::object path)
+    {
+        bp::extract<ompl::geometric::PathGeometric&> geometric(path);
+        if (geometric.check())
+            return geometric().getStates();
+        return bp::extract<ompl::control::PathControl&>(path)().getStates();
+    }
+
+    // the values of all states of a path as a NumPy array with one row per state
+    template <typename App, typename Convert>
+    bp::object pathArray(const App &app, bp::object path, std::size_t width, Convert convert)
+    {
+        const std::vector<ompl::base::State*> &states = pathStates(path);
+        bp::object result = bp::import("numpy").attr("empty")(bp::make_tuple(states.size(), width), "float64");
+        PoseBuffer output(result.ptr(), PyBUF_WRITABLE);
+        (app.*convert)(states, static_cast<double*>(output.view.buf));
+        return result;
+    }
+
+    // set all states of a path from a NumPy array with one row per state
+    template <typename App, typename Convert>
+    void setPathArray(const App &app, bp::object path, bp::object values, std::size_t width, Convert convert)
+    {
+        const std::vector<ompl::base::State*> &states = pathStates(path);
+        PoseBuffer input(values.ptr(), PyBUF_ND);
+        if (input.view.format == nullptr || std::string(input.view.format) != "d" || input.view.ndim != 2 ||
+            static_cast<std::size_t>(input.view.shape[0]) != states.size() || static_cast<std::size_t>(input.view.shape[1]) != width)
+            throw ompl::Exception("Expected an array of float64 values with " + std::to_string(states.size()) +
+                                  " rows and " + std::to_string(width) + " columns");
+        (app.*convert)(static_cast<const double*>(input.view.buf), states);
+    }
+
+    template <typename App>
+    bp::object getPathStateValues(const App &app, bp::object path)
+    {
+        return pathArray(app, path, app.getStateValueCount(), &App::getStateValues);
+    }
+
+    template <typename App>
+    void setPathStateValues(const App &app, bp::object path, bp::object values)
+    {
+        setPathArray(app, path, values, app.getStateValueCount(), &App::setStateValues);
+    }
+
+    template <typename App>
+    bp::object getPathPoses(const App &app, bp::object path)
+    {
+        return pathArray(app, path, app.getPoseDimension() * app.getRobotCount(), &App::getPoses);
+    }
+
+    template <typename App>
+    void setPathPoses(const App &app, bp::object path, bp::object poses)
+    {
+        setPathArray(app, path, poses, app.getPoseDimension() * app.getRobotCount(), &App::setPoses);
+    }
+}
+""")
+        for cls in ['::ompl::app::AppBase< ompl::app::AppType::GEOMETRIC >', '::ompl::app::AppBase< ompl::app::AppType::CONTROL>']:
+            app = cls[2:]
+            self.mb.class_(cls).add_registration_code(
+            'def("isValidPoses", &isValidPoseArray< %s >, (bp::arg("poses"), bp::arg("numThreads") = 0))' % app)
+            self.mb.class_(cls).add_registration_code(
+            'def("clearancePoses", &clearancePoseArray< %s >, (bp::arg("poses"), bp::arg("numThreads") = 0))' % app)
+            self.mb.class_(cls).add_registration_code(
+            'def("getStateValues", &getPathStateValues< %s >, (bp::arg("path")))' % app)
+            self.mb.class_(cls).add_registration_code(
+            'def("setStateValues", &setPathStateValues< %s >, (bp::arg("path"), bp::arg("values")))' % app)
+            self.mb.class_(cls).add_registration_code(
+            'def("getPoses", &getPathPoses< %s >, (bp::arg("path")))' % app)
+            self.mb.class_(cls).add_registration_code(
+            'def("setPoses", &setPathPoses< %s >, (bp::arg("path"), bp::arg("poses")))' % app)
+        # octrees are octomap objects, which are not exported; point clouds
+        # are passed as NumPy arrays with one row of x, y, z per point
+        self.mb.member_functions('addOctree', allow_empty=True).exclude()
+        self.mb.member_functions('getOctree', allow_empty=True).exclude()
+        self.mb.member_functions('addPointCloud', allow_empty=True).exclude()
+        self.mb.member_functions('updatePointCloud', allow_empty=True).exclude()
+        self.mb.add_declaration_code("""
+namespace
+{
+    std::vector<aiVector3D> pointArray(bp::object points)
+    {
+        PoseBuffer input(points.ptr(), PyBUF_ND);
+        if (input.view.format == nullptr || std::string(input.view.format) != "d" ||
+            input.view.ndim != 2 || input.view.shape[1] != 3)
+            throw ompl::Exception("Points must be an array of float64 values with 3 columns");
+        const double *p = static_cast<const double*>(input.view.buf);
+        std::vector<aiVector3D> result(input.view.shape[0]);
+        for (auto &point : result)
+        {
+            point = aiVector3D(p[0], p[1], p[2]);
+            p += 3;
+        }
+        return result;
+    }
+
+    aiVector3D pointTuple(bp::object point)
+    {
+        return aiVector3D(bp::extract<double>(point[0]), bp::extract<double>(point[1]), bp::extract<double>(point[2]));
+    }
+
+    unsigned int addPointCloudArray(ompl::app::RigidBodyGeometry &geometry, bp::object points, double resolution,
+                                    bp::object origin)
+    {
+#if OMPL_HAS_OCTOMAP
+        return geometry.addPointCloud(pointArray(points), resolution, pointTuple(origin));
+#else
+        throw ompl::Exception("Point clouds require fcl with octomap support");
+#endif
+    }
+
+    void updatePointCloudArray(ompl::app::RigidBodyGeometry &geometry, unsigned int id, bp::object points,
+                               bp::object origin, bool replace)
+    {
+#if OMPL_HAS_OCTOMAP
+        geometry.updatePointCloud(id, pointArray(points), pointTuple(origin), replace);
+#else
+        throw ompl::Exception("Point clouds require fcl with octomap support");
+#endif
+    }
+}
+""")
+        rb.add_registration_code(
+        'def("addPointCloud", &addPointCloudArray, (bp::arg("points"), bp::arg("resolution"), bp::arg("origin") = bp::make_tuple(0., 0., 0.)))')
+        rb.add_registration_code(
+        'def("updatePointCloud", &updatePointCloudArray, (bp::arg("id"), bp::arg("points"), bp::arg("origin"), bp::arg("replace") = false))')
+        # the reservoir of valid states is used from Python through
+        # setValidStateReservoir() and allocReservoirValidStateSampler()
+        self.ompl_ns.class_('ValidStateReservoir').exclude()
+        self.ompl_ns.class_('ReservoirValidStateSampler').exclude()
+        self.mb.member_functions('getValidStateReservoir', allow_empty=True).exclude()
+        self.mb.member_functions('allocReservoirChecker', allow_empty=True).exclude()
+        # motions are cached through setMotionCacheSize()
+        self.ompl_ns.class_('CachedMotionValidator').exclude()
+        self.mb.member_functions('getMotionCache', allow_empty=True).exclude()
+        self.mb.member_functions('setupMotionValidator', allow_empty=True).exclude()
+        # conservative advancement is selected through setConservativeAdvancement()
+        self.ompl_ns.classes(lambda c: c.name.startswith('FCLConservativeAdvancementMotionValidator'), allow_empty=True).exclude()
+        # clearances are cached through setClearanceCacheSize()
+        self.ompl_ns.classes('ClearanceCache', allow_empty=True).exclude()
+        self.ompl_ns.classes(lambda c: c.name.startswith('ShardedLRUCache'), allow_empty=True).exclude()
+        # the timeline is recorded from C++ (see the benchmark.trace option)
+        self.ompl_ns.classes('Trace', allow_empty=True).exclude()
+        self.ompl_ns.classes('ScopedTrace', allow_empty=True).exclude()
+        # nearest neighbor structures are installed through setPoseNearestNeighbors()
+        self.ompl_ns.classes('PoseLayout', allow_empty=True).exclude()
+        self.mb.member_functions('getPoseLayout', allow_empty=True).exclude()
+        self.mb.member_functions('installPoseNearestNeighbors', allow_empty=True).exclude()
+        # vectors of queries and results are not exported
+        self.ompl_ns.class_('PlanningQuery').exclude()
+        self.ompl_ns.class_('PlanningQueryResult').exclude()
+        self.mb.member_functions('solveBatch', allow_empty=True).exclude()
+        # solutions are shortcut in parallel through setParallelSimplification()
+        self.ompl_ns.class_('ParallelPathSimplifier').exclude()
+        self.mb.member_functions('allocParallelPathSimplifier', allow_empty=True).exclude()
+        self.mb.member_functions('parallelSimplifySolution', allow_empty=True).exclude()
+        # motion primitives are built from nested std::vectors, and their
+        # default steps are an initializer list that Py++ cannot reproduce
+        self.ompl_ns.class_('MotionPrimitives').exclude()
+        self.ompl_ns.class_('PrimitiveDirectedControlSampler').exclude()
+        kc = self.ompl_ns.class_('KinematicCarPlanning')
+        kc.member_function('setMotionPrimitives').exclude()
+        kc.member_function('getMotionPrimitives').exclude()
+        kc.member_function('setDefaultMotionPrimitives').exclude()
+        self.mb.add_declaration_code("""
+namespace
+{
+    void setDefaultMotionPrimitives(ompl::app::KinematicCarPlanning &app, unsigned int steeringAngles)
+    {
+        app.setDefaultMotionPrimitives(steeringAngles);
+    }
+}
+""")
+        kc.add_registration_code(
+            'def("setDefaultMotionPrimitives", &setDefaultMotionPrimitives, (bp::arg("steeringAngles") = 5))')
+        # planners that share the space information of an app solve their
+        # problems concurrently with the GIL released; a callback is called
+        # with the GIL held as soon as a planner is done
+        self.mb.add_declaration_code("""
+namespace
+{
+    bp::list solvePlanners(bp::list planners, double solveTime, unsigned int numThreads, bp::object done)
+    {
+        std::vector<ompl::base::PlannerPtr> p;
+        for (bp::ssize_t i = 0 ; i < bp::len(planners) ; ++i)
+            p.push_back(bp::extract<ompl::base::PlannerPtr>(planners[i]));
+        const bool callback = !done.is_none();
+        std::vector<ompl::base::PlannerStatus> status(p.size());
+        PyThreadState *state = PyEval_SaveThread();
+        ompl::app::parallelForEach(p.size(), numThreads, [&](std::size_t i)
+            {
+                try
+                {
+                    if (!p[i]->isSetup())
+                        p[i]->setup();
+                    status[i] = p[i]->solve(solveTime);
+                }
+                catch (std::exception &e)
+                {
+                    OMPL_ERROR("Planner %u failed: %s", (unsigned int)i, e.what());
+                    status[i] = ompl::base::PlannerStatus::CRASH;
+                }
+                if (callback)
+                {
+                    PyGILState_STATE gil = PyGILState_Ensure();
+                    try
+                    {
+                        done(i);
+                    }
+                    catch (bp::error_already_set &)
+                    {
+                        PyErr_Print();
+                    }
+                    PyGILState_Release(gil);
+                }
+            });
+        PyEval_RestoreThread(state);
+        bp::list result;
+        for (const auto &s : status)
+            result.append(s);
+        return result;
+    }
+}
+""")
+        self.mb.add_registration_code(
+            'bp::def("solvePlanners", &solvePlanners, (bp::arg("planners"), bp::arg("solveTime"), '
+            'bp::arg("numThreads") = 0, bp::arg("done") = bp::object()))')
+        # progress snapshots are passed to Python callbacks as dictionaries;
+        # solve() holds the GIL, and the callback is called in its thread
+        self.ompl_ns.class_('SolveProgress').exclude()
+        self.ompl_ns.class_('SolveProgressTracker').exclude()
+        self.mb.member_functions('setProgressCallback', allow_empty=True).exclude()
+        self.mb.member_functions('getRobotPosition', allow_empty=True).exclude()
+        self.mb.add_declaration_code("""
+namespace
+{
+    bool callProgress(bp::object callback, const ompl::app::SolveProgress &progress)
+    {
+        bp::list vertices, edges;
+        for (std::size_t i = 0 ; i + 2 < progress.vertices.size() ; i += 3)
+            vertices.append(bp::make_tuple(progress.vertices[i], progress.vertices[i + 1], progress.vertices[i + 2]));
+        for (std::size_t i = 0 ; i + 1 < progress.edges.size() ; i += 2)
+            edges.append(bp::make_tuple(progress.edges[i], progress.edges[i + 1]));
+        bp::dict snapshot;
+        snapshot["index"] = progress.index;
+        snapshot["time"] = progress.time;
+        snapshot["firstVertex"] = progress.firstVertex;
+        snapshot["vertices"] = vertices;
+        snapshot["edges"] = edges;
+        snapshot["hasSolution"] = progress.hasSolution;
+        snapshot["bestCost"] = progress.bestCost;
+        snapshot["done"] = progress.done;
+        try
+        {
+            bp::object result = callback(snapshot);
+            // callbacks that return nothing keep the planner going
+            return result.is_none() || bp::extract<bool>(result)();
+        }
+        catch (bp::error_already_set &)
+        {
+            PyErr_Print();
+            return false;
+        }
+    }
+
+    template <typename App>
+    void setProgressCallback(App &app, bp::object callback, double period, bool graph)
+    {
+        if (callback.is_none())
+            app.setProgressCallback(ompl::app::SolveProgressCallback(), period, graph);
+        else
+            app.setProgressCallback([callback](const ompl::app::SolveProgress &progress)
+                {
+                    return callProgress(callback, progress);
+                }, period, graph);
+    }
+}
+""")
+        for cls in ['::ompl::app::AppBase< ompl::app::AppType::GEOMETRIC >', '::ompl::app::AppBase< ompl::app::AppType::CONTROL>']:
+            self.mb.class_(cls).add_registration_code(
+            'def("setProgressCallback", &setProgressCallback< %s >, (bp::arg("callback"), bp::arg("period") = 0.5, bp::arg("graph") = true))' % cls[2:])
+        # apps are registered from C++ with a member function template
+        self.ompl_ns.class_('PlanningServer').member_functions('registerApp', allow_empty=True).exclude()
 
 if __name__ == '__main__':
     sys.setrecursionlimit(50000)
@@ -16,7 +16,32 @@
 #include "omplapp/geometry/RigidBodyGeometry.h"
 #include <ompl/geometric/SimpleSetup.h>
 #include <ompl/control/SimpleSetup.h>
+#include <ompl/control/planners/rrt/RRT.h>
+#include <ompl/geometric/planners/rrt/RRT.h>
+#include <ompl/geometric/planners/rrt/RRTConnect.h>
+#include <ompl/geometric/planners/rrt/RRTstar.h>
+#include <ompl/base/spaces/SE2StateSpace.h>
+#include <ompl/base/spaces/SE3StateSpace.h>
+#include <ompl/base/DiscreteMotionValidator.h>
 #include "omplapp/apps/detail/appUtil.h"
+#include "omplapp/apps/detail/RoadmapCache.h"
+#include "omplapp/apps/detail/ParallelPathSimplifier.h"
+#include "omplapp/apps/detail/PoseNearestNeighbors.h"
+#include "omplapp/apps/detail/SolveProgress.h"
+#include "omplapp/apps/detail/ValidStateReservoir.h"
+#include "omplapp/geometry/detail/CachedMotionValidator.h"
+#include "omplapp/geometry/detail/FCLConservativeAdvancementMotionValidator.h"
+#include "omplapp/geometry/detail/ParallelBatch.h"
+#include "omplapp/geometry/detail/Trace.h"
+#include <ompl/tools/config/SelfConfig.h>
+#include <ompl/util/Exception.h>
+#include <ompl/util/Time.h>
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <vector>
 
 namespace ompl
 {
@@ -26,6 +51,46 @@ namespace ompl
         enum class AppType
             { GEOMETRIC, CONTROL };
 
+        /** \brief How a control-based app propagates its dynamics. ODE
+            integrates the equations of motion numerically with
+            control::ODESolver; ANALYTIC uses the solution of the equations
+            for a constant control and writes it directly into the result
+            state; FIXED_SIZE integrates the same equations as ODE, but on a
+            fixed-size state vector that is kept on the stack, so that
+            propagation does not allocate memory. ADAPTIVE uses an
+            error-controlled control::ODEAdaptiveSolver, and LIE_GROUP
+            integrates rotations on SO(3) with the exponential map. All
+            methods of an app integrate the same equations of motion; they
+            only differ in accuracy and cost. Not every app supports every
+            method. */
+        enum class PropagationMethod
+            { ODE, ANALYTIC, FIXED_SIZE, ADAPTIVE, LIE_GROUP };
+
+        /** \brief A start and goal state for AppBase::solveBatch() */
+        struct PlanningQuery
+        {
+            PlanningQuery(const base::ScopedState<> &start, const base::ScopedState<> &goal,
+                          double threshold = std::numeric_limits<double>::epsilon())
+                : start(start), goal(goal), threshold(threshold)
+            {
+            }
+
+            base::ScopedState<> start;
+            base::ScopedState<> goal;
+            /** \brief The distance to the goal state at which it counts as reached */
+            double              threshold;
+        };
+
+        /** \brief The outcome of one query of AppBase::solveBatch() */
+        struct PlanningQueryResult
+        {
+            base::PlannerStatus status{base::PlannerStatus::UNKNOWN};
+            /** \brief The solution path, if one was found */
+            base::PathPtr       path;
+            /** \brief The time spent on the query, in seconds */
+            double              time{0.0};
+        };
+
         template<AppType T>
         struct AppTypeSelector
         {
@@ -50,7 +115,12 @@ namespace ompl
             {
             }
 
-            ~AppBase() override = default;
+            ~AppBase() override
+            {
+                // the reservoir checks states with this geometry
+                if (reservoir_)
+                    reservoir_->stop();
+            }
 
             AppType getAppType()
             {
@@ -97,6 +167,7 @@ namespace ompl
 
             void setup() override
             {
+                ScopedTrace trace("setup", "app");
                 inferEnvironmentBounds();
 
                 if (AppTypeSelector<T>::SimpleSetup::getProblemDefinition()->getStartStateCount() == 0)
@@ -114,35 +185,794 @@ namespace ompl
 
                 AppTypeSelector<T>::SimpleSetup::getStateSpace()->setup();
 
-                if (!AppTypeSelector<T>::SimpleSetup::getStateSpace()->hasDefaultProjection())
+                if (projectionChanged_ || !AppTypeSelector<T>::SimpleSetup::getStateSpace()->hasDefaultProjection())
+                {
+                    const unsigned int robots = projectedRobots_ == 0 ? getRobotCount() : std::min(projectedRobots_, getRobotCount());
                     AppTypeSelector<T>::SimpleSetup::getStateSpace()->
                         registerDefaultProjection(allocGeometricStateProjector(AppTypeSelector<T>::SimpleSetup::getStateSpace(),
                                                                                mtype_, getGeometricComponentStateSpace(),
-                                                                               getGeometricStateExtractor()));
+                                                                               getGeometricStateExtractor(), robots,
+                                                                               adaptiveProjectionCells_ ? 2.0 * getRobotRadius() : 0.0));
+                    projectionChanged_ = false;
+                }
 
                 AppTypeSelector<T>::SimpleSetup::setup();
+                setupMotionValidator();
+                setupNearestNeighbors();
+
+                // the states of a previous reservoir may be invalid in the new setup
+                if (reservoir_)
+                    reservoir_->stop();
+                reservoir_.reset();
+                if (reservoirSize_ > 0)
+                {
+                    reservoir_ = std::make_shared<ValidStateReservoir>(AppTypeSelector<T>::SimpleSetup::si_, reservoirSize_,
+                                                                       allocReservoirChecker(), reservoirDistance_);
+                    reservoir_->start();
+                }
+            }
+
+            base::PlannerStatus solve(double time = 1.0) override
+            {
+                // the snapshots are taken from the termination condition
+                if (progressCallback_)
+                    return solve(base::timedPlannerTerminationCondition(time));
+                ScopedTrace trace("solve", "app");
+                base::PlannerStatus status = AppTypeSelector<T>::SimpleSetup::solve(time);
+                parallelSimplifySolution();
+                return status;
+            }
+
+            base::PlannerStatus solve(const base::PlannerTerminationCondition &ptc) override
+            {
+                ScopedTrace trace("solve", "app");
+                if (!progressCallback_)
+                {
+                    base::PlannerStatus status = AppTypeSelector<T>::SimpleSetup::solve(ptc);
+                    parallelSimplifySolution();
+                    return status;
+                }
+                // the planner is allocated by setup() if there is none
+                if (!AppTypeSelector<T>::SimpleSetup::configured_)
+                    setup();
+                SolveProgressTracker tracker(AppTypeSelector<T>::SimpleSetup::getPlanner(),
+                    AppTypeSelector<T>::SimpleSetup::getProblemDefinition(),
+                    [this](const base::State *state, double *position) { getRobotPosition(state, position); },
+                    progressCallback_, progressPeriod_, progressGraph_);
+                base::PlannerStatus status = AppTypeSelector<T>::SimpleSetup::solve(tracker.wrap(ptc));
+                parallelSimplifySolution();
+                tracker.finish();
+                return status;
+            }
+
+            /** \brief Call \e callback with a snapshot of the planner every
+                \e period seconds while solve() runs, and once more at the
+                end (see SolveProgress). Snapshots only contain what changed
+                since the previous one: the positions of the first robot at
+                the new vertices of the planner data, the new edges, and the
+                cost of the best solution so far, so that clients can render
+                the search as it grows. If the callback returns false, the
+                planner stops as if its time was up, for example once the
+                cost is good enough. If \e graph is false, only the best cost
+                is reported; this is also the case for multithreaded
+                planners, such as PRM, whose planner data cannot be read
+                while they run (see SolveProgressTracker). The callback is
+                called in the thread that calls solve(). An empty callback
+                disables the snapshots. */
+            void setProgressCallback(const SolveProgressCallback &callback, double period = 0.5, bool graph = true)
+            {
+                progressCallback_ = callback;
+                progressPeriod_ = period;
+                progressGraph_ = graph;
+            }
+
+            /** \brief Answer many queries in the environment of this app
+                at once, on \e numThreads threads (zero for one per core).
+                Every query gets its own problem definition and its own
+                planner, allocated with the allocator of
+                setPlannerAllocator(), or the default planner if there is
+                none, and is given \e timeLimit seconds. The planners share
+                the space information of the app, so the collision models,
+                the validity checker, and the motion cache are not copied.
+                The optimization objective of the problem definition of the
+                app applies to all queries. setup() is called first if
+                needed; the bounds of the state space must contain all
+                queries. The result of queries[i] is stored in element i. */
+            std::vector<PlanningQueryResult> solveBatch(const std::vector<PlanningQuery> &queries, double timeLimit,
+                                                        unsigned int numThreads = 0)
+            {
+                if (!AppTypeSelector<T>::SimpleSetup::configured_)
+                    setup();
+                const base::SpaceInformationPtr &si = AppTypeSelector<T>::SimpleSetup::si_;
+                const base::OptimizationObjectivePtr &objective =
+                    AppTypeSelector<T>::SimpleSetup::getProblemDefinition()->getOptimizationObjective();
+                const base::PlannerAllocator &allocPlanner = AppTypeSelector<T>::SimpleSetup::pa_;
+                const PoseLayout layout = poseNearestNeighbors_ ? getPoseLayout() : PoseLayout();
+
+                std::vector<PlanningQueryResult> results(queries.size());
+                // queries take different times, so every thread takes the next query when it is done
+                parallelForEach(queries.size(), numThreads, [&](std::size_t i)
+                    {
+                        ompl::time::point start = ompl::time::now();
+                        try
+                        {
+                            auto pdef = std::make_shared<base::ProblemDefinition>(si);
+                            pdef->setStartAndGoalStates(queries[i].start, queries[i].goal, queries[i].threshold);
+                            pdef->setOptimizationObjective(objective);
+                            base::PlannerPtr planner = allocPlanner ? allocPlanner(si) :
+                                tools::SelfConfig::getDefaultPlanner(pdef->getGoal());
+                            planner->setProblemDefinition(pdef);
+                            planner->setup();
+                            installPoseNearestNeighbors(*planner, layout);
+                            results[i].status = planner->solve(timeLimit);
+                            if (pdef->hasSolution())
+                                results[i].path = pdef->getSolutionPath();
+                        }
+                        catch (std::exception &e)
+                        {
+                            OMPL_ERROR("Query %u failed: %s", (unsigned int)i, e.what());
+                            results[i].status = base::PlannerStatus::CRASH;
+                        }
+                        results[i].time = ompl::time::seconds(ompl::time::now() - start);
+                    });
+                return results;
+            }
+
+            /** \brief Shortcut the solution path for up to \e maxTime
+                seconds at the end of every solve(), with the motion checks
+                spread over \e numThreads threads (zero for one per core; see
+                ParallelPathSimplifier). This is much faster than
+                simplifySolution() for paths with many vertices, such as
+                those of AnytimePathShortening. The time it takes is reported
+                by getLastSimplificationTime(). Zero disables it. Only
+                geometric apps simplify their solutions. */
+            void setParallelSimplification(double maxTime, unsigned int numThreads = 0)
+            {
+                parallelSimplifyTime_ = maxTime;
+                parallelSimplifyThreads_ = numThreads;
+            }
+
+            /** \brief Get the time limit set by setParallelSimplification() */
+            double getParallelSimplificationTime() const
+            {
+                return parallelSimplifyTime_;
+            }
+
+            /** \brief Allocate a simplifier for the paths of this app that
+                checks motions with one checker per thread (see
+                RigidBodyGeometry::allocSequenceChecker()). Must be called
+                after setup(). */
+            std::shared_ptr<ParallelPathSimplifier> allocParallelPathSimplifier(unsigned int numThreads = 0) const
+            {
+                return std::make_shared<ParallelPathSimplifier>(AppTypeSelector<T>::SimpleSetup::si_,
+                    [this] { return allocPropagationChecker(); }, numThreads);
+            }
+
+            /** \brief Remember the outcome of up to \e entries motion checks,
+                so that lazy planners and repeated queries in the same
+                environment do not check the same motions again (see
+                CachedMotionValidator). The cache wraps the motion validator
+                of the space information at the next setup() and is kept
+                across queries; it is cleared when the geometry changes and
+                when obstacles are added, moved, or removed (see
+                RigidBodyGeometry::addObstacle()). Zero disables the
+                cache. */
+            void setMotionCacheSize(std::size_t entries)
+            {
+                motionCacheSize_ = entries;
+            }
+
+            /** \brief Get the maximum number of motions in the cache */
+            std::size_t getMotionCacheSize() const
+            {
+                return motionCacheSize_;
+            }
+
+            /** \brief The motion cache installed by the last setup(), if any */
+            std::shared_ptr<CachedMotionValidator> getMotionCache() const
+            {
+                return std::dynamic_pointer_cast<CachedMotionValidator>(
+                    AppTypeSelector<T>::SimpleSetup::si_->getMotionValidator());
+            }
+
+            /** \brief Forget the motions in the cache */
+            void clearMotionCache()
+            {
+                if (std::shared_ptr<CachedMotionValidator> cache = getMotionCache())
+                    cache->clear();
+            }
+
+            /** \brief Check motions with
+                FCLConservativeAdvancementMotionValidator, which steps along a
+                motion by distances that are provably collision free, instead
+                of at every resolution step (see
+                base::DiscreteMotionValidator). This only has an effect with
+                the FCL collision checker, and takes effect at the next
+                setup(), which then builds the collision checker. The motion
+                cache, if enabled, wraps the selected validator. */
+            void setConservativeAdvancement(bool enable)
+            {
+                conservativeAdvancement_ = enable;
+            }
+
+            /** \brief Return true if motions are checked by conservative advancement, see setConservativeAdvancement() */
+            bool getConservativeAdvancement() const
+            {
+                return conservativeAdvancement_;
+            }
+
+            /** \brief Keep a reservoir of \e size valid states that is
+                filled in the background from the end of setup() on (see
+                ValidStateReservoir). Samplers allocated with
+                allocReservoirValidStateSampler() serve its states, so
+                planners do not wait for invalid samples to be rejected in
+                narrow passages. If \e nearObstacleDistance is positive, only
+                states near obstacles are kept, as with
+                base::GaussianValidStateSampler with that standard deviation.
+                Candidate states are checked with isValidBatch() on \e
+                numThreads threads (zero for one per core). A size of zero
+                disables the reservoir. Takes effect at the next setup(). */
+            void setValidStateReservoir(std::size_t size, double nearObstacleDistance = 0.0, unsigned int numThreads = 0)
+            {
+                reservoirSize_ = size;
+                reservoirDistance_ = nearObstacleDistance;
+                reservoirThreads_ = numThreads;
+            }
+
+            /** \brief The reservoir started by the last setup(), if any */
+            const ValidStateReservoirPtr& getValidStateReservoir() const
+            {
+                return reservoir_;
+            }
+
+            /** \brief Allocate a valid state sampler that serves the states
+                of the reservoir (see setValidStateReservoir()), for use with
+                base::SpaceInformation::setValidStateSamplerAllocator(). The
+                sampler samples uniformly whenever the reservoir is empty. */
+            base::ValidStateSamplerPtr allocReservoirValidStateSampler(const base::SpaceInformation *si) const
+            {
+                return std::make_shared<ReservoirValidStateSampler>(si, reservoir_);
+            }
+
+            /** \brief Configure the default projection of the state space,
+                which projection-based planners such as KPIECE and ProjEST
+                use to estimate coverage. If \e adaptiveCells is true, cells
+                are about as wide as the robot (twice the largest bounding
+                radius of its parts) instead of a twentieth of the bounds of
+                the environment. \e robots is the number of robots whose
+                positions are projected, zero for all of them. By default,
+                only the position of the first robot is projected onto 20
+                cells per axis. Takes effect at the next setup(), replacing
+                the default projection of the state space. */
+            void setProjection(bool adaptiveCells, unsigned int robots = 1)
+            {
+                adaptiveProjectionCells_ = adaptiveCells;
+                projectedRobots_ = robots;
+                projectionChanged_ = true;
+            }
+
+            /** \brief Return true if the projection cells are derived from the size of the robot, see setProjection() */
+            bool getAdaptiveProjectionCells() const
+            {
+                return adaptiveProjectionCells_;
+            }
+
+            /** \brief Get the number of projected robots set by setProjection() */
+            unsigned int getProjectedRobotCount() const
+            {
+                return projectedRobots_;
+            }
+
+            /** \brief If \e enable is true (the default), setup() gives a new
+                planner of type RRT, RRTConnect, RRTstar or control::RRT a
+                PoseNearestNeighbors structure, which indexes the positions
+                of the robot parts with a k-d tree instead of comparing
+                whole states. This only applies to apps that declare the
+                layout of their states (see setStateLayout()), and assumes
+                that the planner compares states with the distance of the
+                state space. The planners of solveBatch() get it too. */
+            void setPoseNearestNeighbors(bool enable)
+            {
+                poseNearestNeighbors_ = enable;
+            }
+
+            /** \brief Get the value set by setPoseNearestNeighbors() */
+            bool getPoseNearestNeighbors() const
+            {
+                return poseNearestNeighbors_;
             }
 
             /** \brief Convenience function for the omplapp GUI. The objective can be one of:
-                "length", "max min clearance", or "mechanical work" */
+                "length", "max min clearance", or "mechanical work". For
+                "max min clearance", the clearance cache of the collision
+                checker is enabled (see setClearanceCacheSize()) unless its
+                size was set already. */
             void setOptimizationObjectiveAndThreshold(const std::string &objective, double threshold)
             {
+                if (objective == "max min clearance" && getClearanceCacheSize() == 0)
+                    setClearanceCacheSize(1u << 16);
                 AppTypeSelector<T>::SimpleSetup::setOptimizationObjective(
                     getOptimizationObjective(this->si_, objective, threshold));
             }
 
-            control::DecompositionPtr allocDecomposition()
+            /** \brief Allocate a grid decomposition for SyclopRRT and
+                SyclopEST. If \e obstacleAware is true, the volumes of the
+                regions are estimates of their free space (see
+                allocObstacleAwareDecomposition()), so that Syclop prefers
+                leads through open regions. */
+            control::DecompositionPtr allocDecomposition(bool obstacleAware = false)
             {
+                if (obstacleAware)
+                    return ompl::app::allocObstacleAwareDecomposition(AppTypeSelector<T>::SimpleSetup::getStateSpace(),
+                        mtype_, getGeometricComponentStateSpace(), getGeometrySpecification());
                 return ompl::app::allocDecomposition(AppTypeSelector<T>::SimpleSetup::getStateSpace(),
                     mtype_, getGeometricComponentStateSpace());
             }
 
+            /** \brief Number of values that describe the pose of one robot
+                in isValidPoses() and clearancePoses(): x, y, yaw for 2D
+                motion models and x, y, z, qx, qy, qz, qw for 3D ones. */
+            unsigned int getPoseDimension() const
+            {
+                return mtype_ == Motion_2D ? 3 : 7;
+            }
+
+            /** \brief Check \e count poses with the batch interface of the
+                checker (see RigidBodyGeometry::isValidBatch()). \e poses
+                holds one row per query with getPoseDimension() values for
+                every robot; the remaining components of the states, such as
+                velocities, are those of getDefaultStartState(). On return,
+                \e valid[i] is true iff the robots do not collide in row i.
+                Must be called after setup(). */
+            void isValidPoses(const double *poses, std::size_t count, bool *valid, unsigned int numThreads = 0)
+            {
+                const auto &si = AppTypeSelector<T>::SimpleSetup::si_;
+                std::vector<base::State*> states = allocPoseStates(poses, count);
+                std::vector<bool> result;
+                try
+                {
+                    isValidBatch(std::vector<const base::State*>(states.begin(), states.end()), result, numThreads);
+                }
+                catch (...)
+                {
+                    si->freeStates(states);
+                    throw;
+                }
+                si->freeStates(states);
+                std::copy(result.begin(), result.end(), valid);
+            }
+
+            /** \brief Same as isValidPoses(), but store the clearance of row i
+                in \e clearance[i] (see RigidBodyGeometry::clearanceBatch()). */
+            void clearancePoses(const double *poses, std::size_t count, double *clearance, unsigned int numThreads = 0)
+            {
+                const auto &si = AppTypeSelector<T>::SimpleSetup::si_;
+                std::vector<base::State*> states = allocPoseStates(poses, count);
+                std::vector<double> result;
+                try
+                {
+                    clearanceBatch(std::vector<const base::State*>(states.begin(), states.end()), result, numThreads);
+                }
+                catch (...)
+                {
+                    si->freeStates(states);
+                    throw;
+                }
+                si->freeStates(states);
+                std::copy(result.begin(), result.end(), clearance);
+            }
+
+            /** \brief Number of values of a full state in getStateValues()
+                and setStateValues(), in the order of
+                base::StateSpace::copyToReals(). Must be called after
+                setup(). */
+            unsigned int getStateValueCount() const
+            {
+                return AppTypeSelector<T>::SimpleSetup::getStateSpace()->getValueLocations().size();
+            }
+
+            /** \brief Store the full \e states, such as the states of a
+                solution path, in \e values, one row of
+                getStateValueCount() values per state. Whole paths are
+                converted in one pass without allocating memory, unlike
+                converting every state through a base::ScopedState;
+                \e values must have room for states.size() rows. Must be
+                called after setup(). */
+            void getStateValues(const std::vector<base::State*> &states, double *values) const
+            {
+                copyStatesToReals(*AppTypeSelector<T>::SimpleSetup::getStateSpace(), states, values);
+            }
+
+            /** \brief The inverse of getStateValues(): set the allocated
+                \e states from the rows of \e values */
+            void setStateValues(const double *values, const std::vector<base::State*> &states) const
+            {
+                copyRealsToStates(*AppTypeSelector<T>::SimpleSetup::getStateSpace(), values, states);
+            }
+
+            /** \brief Store the poses of all robots at \e states in \e poses,
+                one row per state with getPoseDimension() values for every
+                robot, as in isValidPoses(). This replaces a call of
+                getGeometricComponentState() per state and robot; \e poses
+                must have room for states.size() rows. */
+            void getPoses(const std::vector<base::State*> &states, double *poses) const
+            {
+                const unsigned int robots = getRobotCount();
+                for (const base::State *state : states)
+                    for (unsigned int r = 0 ; r < robots ; ++r)
+                    {
+                        const base::State *pose = getGeometricComponentStateInternal(state, r);
+                        if (mtype_ == Motion_2D)
+                        {
+                            const auto *se2 = pose->as<base::SE2StateSpace::StateType>();
+                            *poses++ = se2->getX();
+                            *poses++ = se2->getY();
+                            *poses++ = se2->getYaw();
+                        }
+                        else
+                        {
+                            const auto *se3 = pose->as<base::SE3StateSpace::StateType>();
+                            *poses++ = se3->getX();
+                            *poses++ = se3->getY();
+                            *poses++ = se3->getZ();
+                            *poses++ = se3->rotation().x;
+                            *poses++ = se3->rotation().y;
+                            *poses++ = se3->rotation().z;
+                            *poses++ = se3->rotation().w;
+                        }
+                    }
+            }
+
+            /** \brief The inverse of getPoses(): set the poses of all robots
+                in the allocated \e states from the rows of \e poses. The
+                remaining components of the states, such as velocities, are
+                not changed. This replaces a call of
+                getFullStateFromGeometricComponent() per state. */
+            void setPoses(const double *poses, const std::vector<base::State*> &states) const
+            {
+                const unsigned int robots = getRobotCount();
+                for (base::State *state : states)
+                    for (unsigned int r = 0 ; r < robots ; ++r)
+                    {
+                        // the geometric components are part of the full state
+                        auto *pose = const_cast<base::State*>(getGeometricComponentStateInternal(state, r));
+                        if (mtype_ == Motion_2D)
+                        {
+                            auto *se2 = pose->as<base::SE2StateSpace::StateType>();
+                            se2->setXY(poses[0], poses[1]);
+                            se2->setYaw(poses[2]);
+                            poses += 3;
+                        }
+                        else
+                        {
+                            auto *se3 = pose->as<base::SE3StateSpace::StateType>();
+                            se3->setXYZ(poses[0], poses[1], poses[2]);
+                            se3->rotation().x = poses[3];
+                            se3->rotation().y = poses[4];
+                            se3->rotation().z = poses[5];
+                            se3->rotation().w = poses[6];
+                            poses += 7;
+                        }
+                    }
+            }
+
+            /** \brief Propagate \e state with \e control for up to \e steps
+                propagation steps, like
+                control::SpaceInformation::propagateWhileValid(). Every
+                state is checked as soon as it is produced with a sequence
+                checker (see RigidBodyGeometry::allocSequenceChecker()),
+                and propagation stops at the first invalid state. Returns
+                the number of valid steps; \e result is set to the last
+                valid state. Only available for control-based apps. */
+            unsigned int propagateWhileValid(const base::State * /*state*/, const control::Control * /*control*/,
+                                             int /*steps*/, base::State * /*result*/)
+            {
+                throw Exception("propagateWhileValid() is only available for control-based apps");
+            }
+
+            /** \brief Same as above, but \e result receives the valid prefix
+                of the propagation: result[i] is the state after i + 1
+                steps. If \e alloc is true, \e result is allocated and
+                resized to the number of valid steps; otherwise at most
+                result.size() steps are taken. */
+            unsigned int propagateWhileValid(const base::State * /*state*/, const control::Control * /*control*/,
+                                             int /*steps*/, std::vector<base::State*> & /*result*/, bool /*alloc*/)
+            {
+                throw Exception("propagateWhileValid() is only available for control-based apps");
+            }
+
+            /** \brief Store the roadmap of the current planner (see
+                base::Planner::getPlannerData()) in \e filename, with a key
+                computed from the geometry and the state space, so that
+                later queries in the same environment can start from it
+                with loadRoadmap(). Returns false if the file cannot be
+                written. Only available for geometric apps. */
+            bool saveRoadmap(const std::string &filename) const
+            {
+                base::PlannerData data(AppTypeSelector<T>::SimpleSetup::si_);
+                AppTypeSelector<T>::SimpleSetup::getPlannerData(data);
+                return storeRoadmap(data, getRoadmapKey(), filename);
+            }
+
+            /** \brief Replace the planner by one that starts from the
+                roadmap stored in \e filename by saveRoadmap(). PRM,
+                PRMstar, LazyPRM, and LazyPRMstar continue with the stored
+                roadmap, so a query only has to connect its start and goal
+                states and search the graph; the roadmaps of other planners,
+                such as SPARStwo, are searched with PRM. Returns false, and
+                keeps the planner, if the file cannot be read or was stored
+                for a different geometry or state space. Only available for
+                geometric apps. */
+            bool loadRoadmap(const std::string &filename)
+            {
+                // the key depends on the bounds, which setup() would infer
+                inferEnvironmentBounds();
+                base::PlannerData data(AppTypeSelector<T>::SimpleSetup::si_);
+                if (!ompl::app::loadRoadmap(filename, getRoadmapKey(), data))
+                    return false;
+                const base::PlannerPtr &planner = AppTypeSelector<T>::SimpleSetup::getPlanner();
+                AppTypeSelector<T>::SimpleSetup::setPlanner(allocRoadmapPlanner(data, planner ? planner->getName() : "PRM"));
+                return true;
+            }
+
         protected:
 
+            /** \brief The key stored with roadmaps by saveRoadmap() */
+            std::uint32_t getRoadmapKey() const
+            {
+                return roadmapKey(getGeometryChecksum(), AppTypeSelector<T>::SimpleSetup::getStateSpace());
+            }
+
             virtual const base::State* getGeometricComponentStateInternal(const base::State* state, unsigned int index) const = 0;
 
+            /** \brief Allocate one state per row of \e poses (see
+                isValidPoses()) */
+            std::vector<base::State*> allocPoseStates(const double *poses, std::size_t count) const
+            {
+                const auto &si = AppTypeSelector<T>::SimpleSetup::si_;
+                const base::ScopedState<> start = getDefaultStartState();
+                std::vector<base::State*> states(count);
+                si->allocStates(states);
+                for (base::State *state : states)
+                    si->copyState(state, start.get());
+                setPoses(poses, states);
+                return states;
+            }
+
+            /** \brief Store x, y, z of the first robot at \e state in \e position */
+            void getRobotPosition(const base::State *state, double *position) const
+            {
+                const base::State *pose = getGeometricComponentStateInternal(state, 0);
+                if (mtype_ == Motion_2D)
+                {
+                    const auto *se2 = pose->as<base::SE2StateSpace::StateType>();
+                    position[0] = se2->getX();
+                    position[1] = se2->getY();
+                    position[2] = 0.0;
+                }
+                else
+                {
+                    const auto *se3 = pose->as<base::SE3StateSpace::StateType>();
+                    position[0] = se3->getX();
+                    position[1] = se3->getY();
+                    position[2] = se3->getZ();
+                }
+            }
+
+            /** \brief Shortcut the solution path, see setParallelSimplification() */
+            void parallelSimplifySolution()
+            {
+                if (parallelSimplifyTime_ <= 0.0 || !AppTypeSelector<T>::SimpleSetup::haveSolutionPath())
+                    return;
+                ompl::time::point start = ompl::time::now();
+                geometric::PathGeometric &path = AppTypeSelector<T>::SimpleSetup::getSolutionPath();
+                const double length = path.length();
+                allocParallelPathSimplifier(parallelSimplifyThreads_)->shortcutPath(path, parallelSimplifyTime_);
+                AppTypeSelector<T>::SimpleSetup::simplifyTime_ = ompl::time::seconds(ompl::time::now() - start);
+                OMPL_INFORM("Parallel path simplification took %f seconds and changed the length from %f to %f",
+                            AppTypeSelector<T>::SimpleSetup::simplifyTime_, length, path.length());
+            }
+
+            /** \brief Motions that were valid may now collide, and the other way round */
+            void environmentChanged() override
+            {
+                clearMotionCache();
+            }
+
+            /** \brief Select the motion validator according to
+                setConservativeAdvancement(), and wrap it in a cache, or
+                unwrap it, according to setMotionCacheSize() */
+            void setupMotionValidator()
+            {
+                const auto &si = AppTypeSelector<T>::SimpleSetup::si_;
+                std::shared_ptr<CachedMotionValidator> cache = getMotionCache();
+                // a new geometry comes with a new state validity checker
+                const base::StateValidityCheckerPtr &svc = si->getStateValidityChecker();
+                const bool sameChecker = svc == motionValidatorChecker_.lock();
+                base::MotionValidatorPtr validator = cache ? cache->getMotionValidator() : si->getMotionValidator();
+
+                // the conservative advancement validator queries the FCL checker it was built for
+                const bool conservative = conservativeAdvancement_ && getCollisionCheckerType() == FCL;
+                const bool isConservative =
+                    std::dynamic_pointer_cast<FCLConservativeAdvancementMotionValidator<Motion_2D>>(validator) ||
+                    std::dynamic_pointer_cast<FCLConservativeAdvancementMotionValidator<Motion_3D>>(validator);
+                const bool replace = conservative != isConservative || (conservative && !sameChecker);
+                const bool keepCache = cache && cache->getCapacity() == motionCacheSize_ && sameChecker;
+                if (!replace && (keepCache || (motionCacheSize_ == 0 && !cache)))
+                    return;
+
+                if (replace && conservative)
+                    validator = mtype_ == Motion_2D ?
+                        base::MotionValidatorPtr(std::make_shared<FCLConservativeAdvancementMotionValidator<Motion_2D>>(si.get())) :
+                        base::MotionValidatorPtr(std::make_shared<FCLConservativeAdvancementMotionValidator<Motion_3D>>(si.get()));
+                else if (replace)
+                    validator = std::make_shared<base::DiscreteMotionValidator>(si.get());
+                if (motionCacheSize_ > 0)
+                    validator = std::make_shared<CachedMotionValidator>(si.get(), validator, motionCacheSize_);
+                motionValidatorChecker_ = svc;
+                si->setMotionValidator(validator);
+                // setting the motion validator resets the setup of the space information
+                si->setup();
+            }
+
+            /** \brief The positions of the robot parts for PoseNearestNeighbors.
+                The scale is the smallest weight of a translation in the
+                distance of the state space; the layout has no parts if the
+                app did not declare the layout of its states. */
+            PoseLayout getPoseLayout() const
+            {
+                PoseLayout layout;
+                const base::StateSpacePtr &space = AppTypeSelector<T>::SimpleSetup::getStateSpace();
+                // the translation is the first component of SE(2) and SE(3)
+                const auto translationWeight = [](const base::StateSpacePtr &se)
+                    {
+                        return se->as<base::CompoundStateSpace>()->getSubspaceWeight(0);
+                    };
+                switch (stateLayout_)
+                {
+                    case Layout_RigidBody:
+                        layout.scale = translationWeight(space);
+                        break;
+                    case Layout_FirstComponent:
+                    {
+                        const auto *compound = space->as<base::CompoundStateSpace>();
+                        layout.scale = compound->getSubspaceWeight(0) * translationWeight(compound->getSubspace(0));
+                        break;
+                    }
+                    case Layout_MultiRigidBody:
+                    {
+                        const auto *compound = space->as<base::CompoundStateSpace>();
+                        layout.scale = std::numeric_limits<double>::infinity();
+                        for (unsigned int i = 0 ; i < getRobotCount() ; ++i)
+                            layout.scale = std::min(layout.scale,
+                                compound->getSubspaceWeight(i) * translationWeight(compound->getSubspace(i)));
+                        break;
+                    }
+                    default:
+                        return layout;
+                }
+                layout.extract = getGeometricStateExtractor();
+                layout.mtype = mtype_;
+                layout.parts = getRobotCount();
+                return layout;
+            }
+
+            /** \brief Give \e planner a PoseNearestNeighbors structure for \e
+                layout, if it is one of the supported planners and \e layout
+                has parts. The planner is cleared and set up again. */
+            static void installPoseNearestNeighbors(base::Planner &planner, const PoseLayout &layout)
+            {
+                if (layout.parts == 0)
+                    return;
+                PoseLayout::Scope scope(layout);
+                if (auto *rrt = dynamic_cast<geometric::RRT*>(&planner))
+                    rrt->setNearestNeighbors<PoseNearestNeighbors>();
+                else if (auto *rrtConnect = dynamic_cast<geometric::RRTConnect*>(&planner))
+                    rrtConnect->setNearestNeighbors<PoseNearestNeighbors>();
+                else if (auto *rrtStar = dynamic_cast<geometric::RRTstar*>(&planner))
+                    rrtStar->setNearestNeighbors<PoseNearestNeighbors>();
+                else if (auto *controlRRT = dynamic_cast<control::RRT*>(&planner))
+                    controlRRT->setNearestNeighbors<PoseNearestNeighbors>();
+            }
+
+            /** \brief Install PoseNearestNeighbors in a planner that was not
+                set up by a previous setup(), see setPoseNearestNeighbors() */
+            void setupNearestNeighbors()
+            {
+                const base::PlannerPtr &planner = AppTypeSelector<T>::SimpleSetup::getPlanner();
+                // replacing the structure of a planner would forget its tree
+                if (!poseNearestNeighbors_ || !planner || planner == nearestNeighborsPlanner_.lock())
+                    return;
+                nearestNeighborsPlanner_ = planner;
+                installPoseNearestNeighbors(*planner, getPoseLayout());
+            }
+
+            /** \brief The batch check used to fill the reservoir */
+            ValidStateReservoir::BatchChecker allocReservoirChecker() const
+            {
+                // the batch interface of the geometry only applies if its checker is still the one of the space information
+                const auto &si = AppTypeSelector<T>::SimpleSetup::si_;
+                const unsigned int threads = reservoirThreads_;
+                if (validitySvc_ && si->getStateValidityChecker() == validitySvc_)
+                    return [this, threads](const std::vector<const base::State*> &states, std::vector<bool> &valid)
+                        {
+                            isValidBatch(states, valid, threads);
+                        };
+                // other checkers are not known to be thread safe
+                const base::SpaceInformation *s = si.get();
+                return [s](const std::vector<const base::State*> &states, std::vector<bool> &valid)
+                    {
+                        parallelBatch(states.size(), 1, valid, [s, &states](std::size_t begin, std::size_t end, char *result)
+                            {
+                                for (std::size_t k = begin ; k < end ; ++k)
+                                    result[k] = s->isValid(states[k]) ? 1 : 0;
+                            });
+                    };
+            }
+
+            /** \brief The largest bounding radius of a robot part */
+            double getRobotRadius() const
+            {
+                double radius = 0.0;
+                for (const auto &bounds : robotBounds_)
+                    radius = std::max(radius, bounds.radius);
+                return radius;
+            }
+
+            /** \brief The validity check used by propagateWhileValid() */
+            std::function<bool(const base::State*)> allocPropagationChecker() const
+            {
+                // the checker of the geometry can only be used if it is still the one of the space information
+                const auto &si = AppTypeSelector<T>::SimpleSetup::si_;
+                if (validitySvc_ && si->getStateValidityChecker() == validitySvc_)
+                    return allocSequenceChecker();
+                const base::SpaceInformation *s = si.get();
+                return [s](const base::State *state) { return s->isValid(state); };
+            }
+
             std::string name_;
 
+            /** \brief Whether the projection cells are derived from the size of the robot */
+            bool adaptiveProjectionCells_{false};
+
+            /** \brief Number of robots in the default projection (zero for all) */
+            unsigned int projectedRobots_{1};
+
+            /** \brief Whether setProjection() was called since the last setup() */
+            bool projectionChanged_{false};
+
+            /** \brief The maximum number of motions in the cache, see setMotionCacheSize() */
+            std::size_t motionCacheSize_{0};
+
+            /** \brief Whether setup() selects the conservative advancement validator, see setConservativeAdvancement() */
+            bool conservativeAdvancement_{false};
+
+            /** \brief The state validity checker the motion validator and its cache were set up for */
+            std::weak_ptr<base::StateValidityChecker> motionValidatorChecker_;
+
+            /** \brief The settings of the reservoir, see setValidStateReservoir() */
+            std::size_t reservoirSize_{0};
+            double reservoirDistance_{0.0};
+            unsigned int reservoirThreads_{0};
+
+            /** \brief The reservoir of valid states, if any */
+            ValidStateReservoirPtr reservoir_;
+
+            /** \brief The settings of the simplification after solve(), see setParallelSimplification() */
+            double parallelSimplifyTime_{0.0};
+            unsigned int parallelSimplifyThreads_{0};
+
+            /** \brief Whether setup() installs PoseNearestNeighbors, see setPoseNearestNeighbors() */
+            bool poseNearestNeighbors_{true};
+
+            /** \brief The planner PoseNearestNeighbors were installed in by the last setup() */
+            std::weak_ptr<base::Planner> nearestNeighborsPlanner_;
+
+            /** \brief The settings of the snapshots taken while solving, see setProgressCallback() */
+            SolveProgressCallback progressCallback_;
+            double progressPeriod_{0.5};
+            bool progressGraph_{true};
+
         };
 
         template<>
@@ -151,6 +981,98 @@ namespace ompl
             return AppType::CONTROL;
         }
 
+        /// @cond IGNORE
+        template<>
+        inline void AppBase<AppType::CONTROL>::parallelSimplifySolution()
+        {
+            // the solutions of control-based apps cannot be shortcut
+        }
+
+        template<>
+        inline bool AppBase<AppType::CONTROL>::saveRoadmap(const std::string & /*filename*/) const
+        {
+            throw Exception("saveRoadmap() is only available for geometric apps");
+        }
+
+        template<>
+        inline bool AppBase<AppType::CONTROL>::loadRoadmap(const std::string & /*filename*/)
+        {
+            throw Exception("loadRoadmap() is only available for geometric apps");
+        }
+
+        template<>
+        inline unsigned int AppBase<AppType::CONTROL>::propagateWhileValid(const base::State *state,
+            const control::Control *control, int steps, std::vector<base::State*> &result, bool alloc)
+        {
+            const double stepSize = steps > 0 ? si_->getPropagationStepSize() : -si_->getPropagationStepSize();
+            steps = std::abs(steps);
+            if (alloc)
+            {
+                result.resize(steps);
+                for (auto &r : result)
+                    r = si_->allocState();
+            }
+            else
+                steps = std::min(steps, (int)result.size());
+
+            std::function<bool(const base::State*)> isValid = allocPropagationChecker();
+
+            const control::StatePropagatorPtr &propagator = si_->getStatePropagator();
+            int valid = 0;
+            for (const base::State *from = state; valid < steps; from = result[valid++])
+            {
+                propagator->propagate(from, control, stepSize, result[valid]);
+                if (!isValid(result[valid]))
+                    break;
+            }
+
+            if (alloc)
+            {
+                for (int i = valid; i < steps; ++i)
+                    si_->freeState(result[i]);
+                result.resize(valid);
+            }
+            return valid;
+        }
+
+        template<>
+        inline unsigned int AppBase<AppType::CONTROL>::propagateWhileValid(const base::State *state,
+            const control::Control *control, int steps, base::State *result)
+        {
+            // propagate into two buffers in turn; the last valid state ends up in result
+            std::vector<base::State*> buffer(2);
+            buffer[0] = result;
+            buffer[1] = si_->allocState();
+            const double stepSize = steps > 0 ? si_->getPropagationStepSize() : -si_->getPropagationStepSize();
+            steps = std::abs(steps);
+
+            std::function<bool(const base::State*)> isValid = allocPropagationChecker();
+
+            // if result is state, it has to be kept until the first step turns out valid
+            const base::State *last = state;
+            if (state == result)
+            {
+                si_->copyState(buffer[1], state);
+                last = buffer[1];
+            }
+
+            const control::StatePropagatorPtr &propagator = si_->getStatePropagator();
+            int valid = 0;
+            for (; valid < steps; ++valid)
+            {
+                base::State *next = buffer[valid % 2];
+                propagator->propagate(last, control, stepSize, next);
+                if (!isValid(next))
+                    break;
+                last = next;
+            }
+            if (last != result)
+                si_->copyState(result, last);
+            si_->freeState(buffer[1]);
+            return valid;
+        }
+        /// @endcond
+
     }
 }
 
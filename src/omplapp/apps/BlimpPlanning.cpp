@@ -11,6 +11,8 @@
 /* Author: Mark Moll */
 
 #include "omplapp/apps/BlimpPlanning.h"
+#include "omplapp/apps/detail/FixedSizeODE.h"
+#include <ompl/util/Console.h>
 
 ompl::base::ScopedState<> ompl::app::BlimpPlanning::getDefaultStartState() const
 {
@@ -54,19 +56,17 @@ void ompl::app::BlimpPlanning::postPropagate(const base::State* /*state*/, const
     getStateSpace()->as<base::CompoundStateSpace>()->getSubspace(2)->enforceBounds(s[2]);
 }
 
-void ompl::app::BlimpPlanning::ode(const control::ODESolver::StateType& q, const control::Control *ctrl, control::ODESolver::StateType& qdot)
+template <typename StateVector, typename ControlVector>
+void ompl::app::BlimpPlanning::odeRHS(const StateVector& q, const ControlVector& u, StateVector& qdot) const
 {
-    // Retrieving control inputs
-    const double *u = ctrl->as<control::RealVectorControlSpace::ControlType>()->values;
-
-    // zero out qdot
-    qdot.resize (q.size (), 0);
-
     qdot[0] = q[7];
     qdot[1] = q[8];
     qdot[2] = q[9];
 
     qdot[3] = q[10];
+    qdot[4] = 0.;
+    qdot[5] = 0.;
+    qdot[6] = 0.;
 
     qdot[7] = u[0] * cos(q[3]);
     qdot[8] = u[0] * sin(q[3]);
@@ -74,6 +74,60 @@ void ompl::app::BlimpPlanning::ode(const control::ODESolver::StateType& q, const
     qdot[10] = u[2];
 }
 
+void ompl::app::BlimpPlanning::ode(const control::ODESolver::StateType& q, const control::Control *ctrl, control::ODESolver::StateType& qdot)
+{
+    // Retrieving control inputs
+    const double *u = ctrl->as<control::RealVectorControlSpace::ControlType>()->values;
+
+    // zero out qdot
+    qdot.resize (q.size (), 0);
+
+    odeRHS(q, u, qdot);
+}
+
+void ompl::app::BlimpPlanning::setPropagationMethod(PropagationMethod method)
+{
+    if (method == PropagationMethod::ADAPTIVE || method == PropagationMethod::LIE_GROUP)
+    {
+        OMPL_WARN("%s: propagation method is not supported for the blimp; using ODE integration", name_.c_str());
+        method = PropagationMethod::ODE;
+    }
+    if (method == PropagationMethod::ANALYTIC)
+    {
+        OMPL_WARN("%s: there is no analytic solution for the blimp dynamics; using fixed-size integration", name_.c_str());
+        method = PropagationMethod::FIXED_SIZE;
+    }
+    propagationMethod_ = method;
+    if (method == PropagationMethod::FIXED_SIZE)
+        si_->setStatePropagator(
+            [this](const base::State* state, const control::Control* control, const double duration, base::State* result)
+            {
+                propagateFixedSize(state, control, duration, result);
+                postPropagate(state, control, duration, result);
+            });
+    else
+        si_->setStatePropagator(control::ODESolver::getStatePropagator(odeSolver,
+            [this](const base::State* state, const control::Control* control, const double duration, base::State* result)
+            {
+                postPropagate(state, control, duration, result);
+            }));
+}
+
+void ompl::app::BlimpPlanning::propagateFixedSize(const base::State* state, const control::Control* control, const double duration, base::State* result) const
+{
+    const double *u = control->as<control::RealVectorControlSpace::ControlType>()->values;
+    const base::StateSpace *space = getStateSpace().get();
+    std::array<double, 11> q;
+
+    copyToArray(space, state, q);
+    integrateFixedSize(q, duration, odeSolver->getIntegrationStepSize(),
+        [this, u](const std::array<double, 11>& q, std::array<double, 11>& qdot)
+        {
+            odeRHS(q, u, qdot);
+        });
+    copyFromArray(space, q, result);
+}
+
 ompl::base::StateSpacePtr ompl::app::BlimpPlanning::constructStateSpace()
 {
     auto stateSpace(std::make_shared<base::CompoundStateSpace>());
@@ -102,3 +156,17 @@ void ompl::app::BlimpPlanning::setDefaultBounds()
     getControlSpace()->as<control::RealVectorControlSpace>()->setBounds(controlbounds);
 
 }
+
+void ompl::app::BlimpPlanning::propagateBatch(const std::vector<const base::State*> &states,
+    const std::vector<const control::Control*> &controls, const std::vector<double> &durations,
+    const std::vector<base::State*> &results)
+{
+    propagateBatchFixedSize<11, 3>(getStateSpace().get(), states, controls, durations, results,
+        odeSolver->getIntegrationStepSize(),
+        [this](const StridedVector<double>& q, const StridedVector<const double>& u, StridedVector<double>& qdot)
+        {
+            odeRHS(q, u, qdot);
+        });
+    for (std::size_t i = 0; i < states.size(); ++i)
+        postPropagate(states[i], controls[i], durations[i], results[i]);
+}
@@ -36,7 +36,7 @@ namespace ompl
         class BlimpPlanning : public AppBase<AppType::CONTROL>
         {
         public:
-            BlimpPlanning()
+            explicit BlimpPlanning(PropagationMethod method = PropagationMethod::ODE)
                 : AppBase<AppType::CONTROL>(constructControlSpace(), Motion_3D),
                   odeSolver(std::make_shared<control::ODEBasicSolver<>>(si_, [this](const control::ODESolver::StateType& q, const control::Control *ctrl, control::ODESolver::StateType& qdot)
                       {
@@ -44,13 +44,9 @@ namespace ompl
                       }))
             {
                 name_ = std::string("Blimp");
+                setStateLayout(Layout_FirstComponent);
                 setDefaultBounds();
-
-                si_->setStatePropagator(control::ODESolver::getStatePropagator(odeSolver,
-                    [this](const base::State* state, const control::Control* control, const double duration, base::State* result)
-                    {
-                        postPropagate(state, control, duration, result);
-                    }));
+                setPropagationMethod(method);
             }
             ~BlimpPlanning() override = default;
 
@@ -71,6 +67,27 @@ namespace ompl
 
             virtual void setDefaultBounds();
 
+            /** \brief Select how the state propagator integrates the equations
+                of motion. There is no closed form solution, so
+                PropagationMethod::ANALYTIC is treated as
+                PropagationMethod::FIXED_SIZE. */
+            void setPropagationMethod(PropagationMethod method);
+
+            PropagationMethod getPropagationMethod() const
+            {
+                return propagationMethod_;
+            }
+
+            /** \brief Propagate states[i] with controls[i] for durations[i],
+                for all \e i. The systems are integrated in lockstep, like
+                PropagationMethod::FIXED_SIZE but on a structure-of-arrays
+                layout that the compiler can vectorize, independent of the
+                selected propagation method. results[i] may be the same
+                state as states[i]. */
+            void propagateBatch(const std::vector<const base::State*> &states,
+                                const std::vector<const control::Control*> &controls,
+                                const std::vector<double> &durations, const std::vector<base::State*> &results);
+
         protected:
 
             const base::State* getGeometricComponentStateInternal(const base::State* state, unsigned int /*index*/) const override
@@ -80,6 +97,17 @@ namespace ompl
 
             void postPropagate(const base::State* state, const control::Control* control, double duration, base::State* result);
 
+            /** \brief Integrate the equations of motion with a fixed-size state
+                vector. This evaluates odeRHS(), not the virtual ode(), so a
+                derived class that changes the dynamics should use
+                PropagationMethod::ODE. */
+            void propagateFixedSize(const base::State* state, const control::Control* control, double duration, base::State* result) const;
+
+            /** \brief The right-hand side of the equations of motion for controls
+                \e u, shared by ode(), propagateFixedSize() and propagateBatch() */
+            template <typename StateVector, typename ControlVector>
+            void odeRHS(const StateVector& q, const ControlVector& u, StateVector& qdot) const;
+
             virtual void ode(const control::ODESolver::StateType& q, const control::Control *ctrl, control::ODESolver::StateType& qdot);
 
             static control::ControlSpacePtr constructControlSpace()
@@ -90,6 +118,7 @@ namespace ompl
 
             double timeStep_{1e-2};
             control::ODESolverPtr odeSolver;
+            PropagationMethod propagationMethod_{PropagationMethod::ODE};
         };
 
     }
@@ -11,7 +11,11 @@
 /* Author: Mark Moll */
 
 #include "omplapp/apps/DynamicCarPlanning.h"
+#include "omplapp/apps/detail/FixedSizeODE.h"
+#include <ompl/util/Console.h>
 #include <boost/math/constants/constants.hpp>
+#include <algorithm>
+#include <cmath>
 
 ompl::base::ScopedState<> ompl::app::DynamicCarPlanning::getDefaultStartState() const
 {
@@ -28,6 +32,17 @@ ompl::base::ScopedState<> ompl::app::DynamicCarPlanning::getDefaultStartState()
     return s;
 }
 
+template <typename StateVector, typename ControlVector>
+void ompl::app::DynamicCarPlanning::odeRHS(const StateVector& q, const ControlVector& u, StateVector& qdot) const
+{
+    qdot[0] = q[3] * cos(q[2]);
+    qdot[1] = q[3] * sin(q[2]);
+    qdot[2] = q[3] * mass_ * lengthInv_ * tan(q[4]);
+
+    qdot[3] = u[0];
+    qdot[4] = u[1];
+}
+
 void ompl::app::DynamicCarPlanning::ode(const control::ODESolver::StateType& q, const control::Control *ctrl, control::ODESolver::StateType& qdot)
 {
     // Retrieving control inputs
@@ -36,12 +51,7 @@ void ompl::app::DynamicCarPlanning::ode(const control::ODESolver::StateType& q,
     // zero out qdot
     qdot.resize (q.size (), 0);
 
-    qdot[0] = q[3] * cos(q[2]);
-    qdot[1] = q[3] * sin(q[2]);
-    qdot[2] = q[3] * mass_ * lengthInv_ * tan(q[4]);
-
-    qdot[3] = u[0];
-    qdot[4] = u[1];
+    odeRHS(q, u, qdot);
 }
 
 void ompl::app::DynamicCarPlanning::postPropagate(const base::State* /*state*/, const control::Control* /*control*/, const double /*duration*/, base::State* result)
@@ -68,3 +78,107 @@ void ompl::app::DynamicCarPlanning::setDefaultBounds()
     bounds.high[1] = boost::math::constants::pi<double>() * 2. / 180.;
     getControlSpace()->as<control::RealVectorControlSpace>()->setBounds(bounds);
 }
+
+void ompl::app::DynamicCarPlanning::setPropagationMethod(PropagationMethod method)
+{
+    if (method == PropagationMethod::ADAPTIVE || method == PropagationMethod::LIE_GROUP)
+    {
+        OMPL_WARN("%s: propagation method is not supported for the car; using ODE integration", name_.c_str());
+        method = PropagationMethod::ODE;
+    }
+    propagationMethod_ = method;
+    if (method == PropagationMethod::ANALYTIC)
+        si_->setStatePropagator(
+            [this](const base::State* state, const control::Control* control, const double duration, base::State* result)
+            {
+                propagateAnalytic(state, control, duration, result);
+                postPropagate(state, control, duration, result);
+            });
+    else if (method == PropagationMethod::FIXED_SIZE)
+        si_->setStatePropagator(
+            [this](const base::State* state, const control::Control* control, const double duration, base::State* result)
+            {
+                propagateFixedSize(state, control, duration, result);
+                postPropagate(state, control, duration, result);
+            });
+    else
+        si_->setStatePropagator(control::ODESolver::getStatePropagator(odeSolver,
+            [this](const base::State* state, const control::Control* control, const double duration, base::State* result)
+            {
+                postPropagate(state, control, duration, result);
+            }));
+}
+
+void ompl::app::DynamicCarPlanning::propagateAnalytic(const base::State* state, const control::Control* control, const double duration, base::State* result) const
+{
+    const double *u = control->as<control::RealVectorControlSpace::ControlType>()->values;
+    const auto* s = state->as<base::CompoundStateSpace::StateType>();
+    const auto* pose = s->as<base::SE2StateSpace::StateType>(0);
+    const double *vel = s->as<base::RealVectorStateSpace::StateType>(1)->values;
+    const double v0 = vel[0], phi0 = vel[1];
+    const double k = mass_ * lengthInv_;
+
+    // derivative of the pose at time t, given the heading; the speed and
+    // steering angle at time t are known exactly
+    auto f = [&](double t, double theta, double qdot[3])
+    {
+        const double v = v0 + u[0] * t;
+        qdot[0] = v * cos(theta);
+        qdot[1] = v * sin(theta);
+        qdot[2] = v * k * tan(phi0 + u[1] * t);
+    };
+
+    double q[3] = { pose->getX(), pose->getY(), pose->getYaw() };
+    const double sign = duration < 0. ? -1. : 1.;
+    double t = 0.;
+    while (sign * t < sign * duration)
+    {
+        const double h = sign * std::min(timeStep_, sign * (duration - t));
+        double k1[3], k2[3], k3[3], k4[3];
+        f(t, q[2], k1);
+        f(t + .5 * h, q[2] + .5 * h * k1[2], k2);
+        f(t + .5 * h, q[2] + .5 * h * k2[2], k3);
+        f(t + h, q[2] + h * k3[2], k4);
+        for (int i = 0; i < 3; ++i)
+            q[i] += h / 6. * (k1[i] + 2. * k2[i] + 2. * k3[i] + k4[i]);
+        t += h;
+    }
+
+    // result may be the same state as state, so it is written last
+    auto* r = result->as<base::CompoundStateSpace::StateType>();
+    auto* rpose = r->as<base::SE2StateSpace::StateType>(0);
+    double *rvel = r->as<base::RealVectorStateSpace::StateType>(1)->values;
+    rpose->setXY(q[0], q[1]);
+    rpose->setYaw(q[2]);
+    rvel[0] = v0 + u[0] * duration;
+    rvel[1] = phi0 + u[1] * duration;
+}
+
+void ompl::app::DynamicCarPlanning::propagateFixedSize(const base::State* state, const control::Control* control, const double duration, base::State* result) const
+{
+    const double *u = control->as<control::RealVectorControlSpace::ControlType>()->values;
+    const base::StateSpace *space = getStateSpace().get();
+    std::array<double, 5> q;
+
+    copyToArray(space, state, q);
+    integrateFixedSize(q, duration, odeSolver->getIntegrationStepSize(),
+        [this, u](const std::array<double, 5>& q, std::array<double, 5>& qdot)
+        {
+            odeRHS(q, u, qdot);
+        });
+    copyFromArray(space, q, result);
+}
+
+void ompl::app::DynamicCarPlanning::propagateBatch(const std::vector<const base::State*> &states,
+    const std::vector<const control::Control*> &controls, const std::vector<double> &durations,
+    const std::vector<base::State*> &results)
+{
+    propagateBatchFixedSize<5, 2>(getStateSpace().get(), states, controls, durations, results,
+        odeSolver->getIntegrationStepSize(),
+        [this](const StridedVector<double>& q, const StridedVector<const double>& u, StridedVector<double>& qdot)
+        {
+            odeRHS(q, u, qdot);
+        });
+    for (std::size_t i = 0; i < states.size(); ++i)
+        postPropagate(states[i], controls[i], durations[i], results[i]);
+}
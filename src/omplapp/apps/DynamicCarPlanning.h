@@ -38,11 +38,18 @@ namespace ompl
             the mass of the car, and \f$L\f$ is the distance between the front
             and rear axle of the car. Both \f$m\f$ and \f$L\f$ are set to 1 by
             default.
+
+            With PropagationMethod::ANALYTIC, the speed and steering angle
+            are computed exactly (they change linearly for a constant
+            control), and only the pose, which has no closed form solution,
+            is integrated with fourth-order Runge-Kutta steps directly on the
+            state. PropagationMethod::FIXED_SIZE integrates all equations like
+            PropagationMethod::ODE, but without allocating memory.
         */
         class DynamicCarPlanning : public AppBase<AppType::CONTROL>
         {
         public:
-            DynamicCarPlanning()
+            explicit DynamicCarPlanning(PropagationMethod method = PropagationMethod::ODE)
                 : AppBase<AppType::CONTROL>(constructControlSpace(), Motion_2D),
                   odeSolver(std::make_shared<control::ODEBasicSolver<>>(si_, [this](const control::ODESolver::StateType& q, const control::Control *ctrl, control::ODESolver::StateType& qdot)
                       {
@@ -50,13 +57,9 @@ namespace ompl
                       }))
             {
                 name_ = std::string("Dynamic car");
+                setStateLayout(Layout_FirstComponent);
                 setDefaultBounds();
-
-                si_->setStatePropagator(control::ODESolver::getStatePropagator(odeSolver,
-                    [this](const base::State* state, const control::Control* control, const double duration, base::State* result)
-                    {
-                        postPropagate(state, control, duration, result);
-                    }));
+                setPropagationMethod(method);
             }
             ~DynamicCarPlanning() override = default;
 
@@ -102,6 +105,24 @@ namespace ompl
             }
             virtual void setDefaultBounds();
 
+            /** \brief Select how the state propagator computes the motion of the car */
+            void setPropagationMethod(PropagationMethod method);
+
+            PropagationMethod getPropagationMethod() const
+            {
+                return propagationMethod_;
+            }
+
+            /** \brief Propagate states[i] with controls[i] for durations[i],
+                for all \e i. The systems are integrated in lockstep, like
+                PropagationMethod::FIXED_SIZE but on a structure-of-arrays
+                layout that the compiler can vectorize, independent of the
+                selected propagation method. results[i] may be the same
+                state as states[i]. */
+            void propagateBatch(const std::vector<const base::State*> &states,
+                                const std::vector<const control::Control*> &controls,
+                                const std::vector<double> &durations, const std::vector<base::State*> &results);
+
         protected:
 
             const base::State* getGeometricComponentStateInternal(const base::State* state, unsigned int /*index*/) const override
@@ -113,6 +134,20 @@ namespace ompl
 
             virtual void postPropagate(const base::State* state, const control::Control* control, double duration, base::State* result);
 
+            /** \brief Propagate without converting the state to and from a vector */
+            void propagateAnalytic(const base::State* state, const control::Control* control, double duration, base::State* result) const;
+
+            /** \brief Integrate the equations of motion with a fixed-size state
+                vector. This evaluates odeRHS(), not the virtual ode(), so a
+                derived class that changes the dynamics should use
+                PropagationMethod::ODE. */
+            void propagateFixedSize(const base::State* state, const control::Control* control, double duration, base::State* result) const;
+
+            /** \brief The right-hand side of the equations of motion for controls
+                \e u, shared by ode(), propagateFixedSize() and propagateBatch() */
+            template <typename StateVector, typename ControlVector>
+            void odeRHS(const StateVector& q, const ControlVector& u, StateVector& qdot) const;
+
             static control::ControlSpacePtr constructControlSpace()
             {
                 return std::make_shared<control::RealVectorControlSpace>(constructStateSpace(), 2);
@@ -130,6 +165,7 @@ namespace ompl
             double lengthInv_{1.};
             double mass_{1.};
             control::ODESolverPtr odeSolver;
+            PropagationMethod propagationMethod_{PropagationMethod::ODE};
         };
 
     }
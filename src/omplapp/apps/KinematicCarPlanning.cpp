@@ -11,9 +11,14 @@
 /* Author: Mark Moll */
 
 #include "omplapp/apps/KinematicCarPlanning.h"
+#include "omplapp/apps/detail/FixedSizeODE.h"
+#include "omplapp/geometry/detail/FCLStateValidityChecker.h"
+#include <ompl/util/Console.h>
 #include <boost/math/constants/constants.hpp>
+#include <algorithm>
+#include <cmath>
 
-ompl::app::KinematicCarPlanning::KinematicCarPlanning()
+ompl::app::KinematicCarPlanning::KinematicCarPlanning(PropagationMethod method)
     : AppBase<AppType::CONTROL>(constructControlSpace(), Motion_2D), odeSolver(std::make_shared<control::ODEBasicSolver<>>(si_, [this](const control::ODESolver::StateType& q, const control::Control *ctrl, control::ODESolver::StateType& qdot)
     {
         ode(q, ctrl, qdot);
@@ -21,27 +26,118 @@ ompl::app::KinematicCarPlanning::KinematicCarPlanning()
 {
     name_ = std::string("Kinematic car");
     setDefaultControlBounds();
-
-    si_->setStatePropagator(control::ODESolver::getStatePropagator(odeSolver,
-        [this](const base::State* state, const control::Control* control, const double duration, base::State* result)
-        {
-            postPropagate(state, control, duration, result);
-        }));
+    setPropagationMethod(method);
+    setStateLayout(Layout_RigidBody);
 }
 
-ompl::app::KinematicCarPlanning::KinematicCarPlanning(const control::ControlSpacePtr &controlSpace)
+ompl::app::KinematicCarPlanning::KinematicCarPlanning(const control::ControlSpacePtr &controlSpace, PropagationMethod method)
     : AppBase<AppType::CONTROL>(controlSpace, Motion_2D), odeSolver(std::make_shared<control::ODEBasicSolver<>>(si_, [this](const control::ODESolver::StateType& q, const control::Control *ctrl, control::ODESolver::StateType& qdot)
     {
         ode(q, ctrl, qdot);
     }))
 {
     setDefaultControlBounds();
+    setPropagationMethod(method);
+    setStateLayout(Layout_RigidBody);
+}
+
+void ompl::app::KinematicCarPlanning::setPropagationMethod(PropagationMethod method)
+{
+    if (method == PropagationMethod::ADAPTIVE || method == PropagationMethod::LIE_GROUP)
+    {
+        OMPL_WARN("%s: propagation method is not supported for the car; using ODE integration", name_.c_str());
+        method = PropagationMethod::ODE;
+    }
+    propagationMethod_ = method;
+    if (method == PropagationMethod::ANALYTIC)
+        si_->setStatePropagator(
+            [this](const base::State* state, const control::Control* control, const double duration, base::State* result)
+            {
+                propagateAnalytic(state, control, duration, result);
+                postPropagate(state, control, duration, result);
+            });
+    else if (method == PropagationMethod::FIXED_SIZE)
+        si_->setStatePropagator(
+            [this](const base::State* state, const control::Control* control, const double duration, base::State* result)
+            {
+                propagateFixedSize(state, control, duration, result);
+                postPropagate(state, control, duration, result);
+            });
+    else
+        si_->setStatePropagator(control::ODESolver::getStatePropagator(odeSolver,
+            [this](const base::State* state, const control::Control* control, const double duration, base::State* result)
+            {
+                postPropagate(state, control, duration, result);
+            }));
+}
+
+void ompl::app::KinematicCarPlanning::setup()
+{
+    // planners allocate their directed control sampler during setup
+    if (primitives_)
+    {
+        MotionPrimitivesPtr primitives = primitives_;
+        si_->setDirectedControlSamplerAllocator([primitives](const control::SpaceInformation *si)
+            {
+                return std::make_shared<PrimitiveDirectedControlSampler>(si, primitives);
+            });
+        primitiveSampler_ = true;
+    }
+    else if (primitiveSampler_)
+    {
+        si_->clearDirectedControlSamplerAllocator();
+        primitiveSampler_ = false;
+    }
 
-    si_->setStatePropagator(control::ODESolver::getStatePropagator(odeSolver,
-        [this](const base::State* state, const control::Control* control, const double duration, base::State* result)
+    AppBase<AppType::CONTROL>::setup();
+
+    if (primitives_)
+    {
+        // swept volumes need the FCL checker of the geometry, in double precision
+        const FCLMethodWrapper *wrapper = nullptr;
+        if (validitySvc_ && si_->getStateValidityChecker() == validitySvc_)
+            if (const auto *fcl = dynamic_cast<const FCLStateValidityChecker<Motion_2D>*>(getStateValidityCheckerInstance(true)))
+                if (!fcl->getFCLWrapper()->isSinglePrecision())
+                    wrapper = fcl->getFCLWrapper().get();
+        primitives_->build(wrapper);
+        OMPL_INFORM("%s: planning with %lu motion primitives%s", name_.c_str(), (unsigned long)primitives_->size(),
+            wrapper != nullptr ? " and swept volumes" : "");
+    }
+}
+
+void ompl::app::KinematicCarPlanning::setMotionPrimitives(const std::vector<std::vector<double>> &controls,
+                                                          const std::vector<unsigned int> &steps)
+{
+    if (controls.empty())
+        primitives_.reset();
+    else
+        primitives_ = std::make_shared<MotionPrimitives>(si_, controls, steps);
+}
+
+void ompl::app::KinematicCarPlanning::setDefaultMotionPrimitives(unsigned int steeringAngles,
+                                                                 const std::vector<unsigned int> &steps)
+{
+    const base::RealVectorBounds &bounds = getControlSpace()->as<control::RealVectorControlSpace>()->getBounds();
+    const double speed = std::max(std::abs(bounds.low[0]), std::abs(bounds.high[0]));
+    std::vector<std::vector<double>> controls;
+    std::vector<unsigned int> durations;
+    for (double v : {speed, -speed})
+    {
+        // reversing is only possible if the bounds allow it
+        if (v < bounds.low[0] || v > bounds.high[0])
+            continue;
+        for (unsigned int k = 0 ; k < steeringAngles ; ++k)
         {
-            postPropagate(state, control, duration, result);
-        }));
+            const double steer = steeringAngles > 1 ?
+                bounds.low[1] + (bounds.high[1] - bounds.low[1]) * k / (steeringAngles - 1) : 0.5 * (bounds.low[1] + bounds.high[1]);
+            for (unsigned int n : steps)
+            {
+                controls.push_back({v, steer});
+                durations.push_back(n);
+            }
+        }
+    }
+    setMotionPrimitives(controls, durations);
 }
 
 ompl::base::ScopedState<> ompl::app::KinematicCarPlanning::getDefaultStartState() const
@@ -65,6 +161,14 @@ void ompl::app::KinematicCarPlanning::setDefaultControlBounds()
     getControlSpace()->as<control::RealVectorControlSpace>()->setBounds(cbounds);
 }
 
+template <typename StateVector, typename ControlVector>
+void ompl::app::KinematicCarPlanning::odeRHS(const StateVector& q, const ControlVector& u, StateVector& qdot) const
+{
+    qdot[0] = u[0] * cos(q[2]);
+    qdot[1] = u[0] * sin(q[2]);
+    qdot[2] = u[0] * lengthInv_ * tan(u[1]);
+}
+
 void ompl::app::KinematicCarPlanning::ode(const control::ODESolver::StateType& q, const control::Control *ctrl, control::ODESolver::StateType& qdot)
 {
     const double *u = ctrl->as<control::RealVectorControlSpace::ControlType>()->values;
@@ -72,9 +176,7 @@ void ompl::app::KinematicCarPlanning::ode(const control::ODESolver::StateType& q
     // zero out qdot
     qdot.resize (q.size (), 0);
 
-    qdot[0] = u[0] * cos(q[2]);
-    qdot[1] = u[0] * sin(q[2]);
-    qdot[2] = u[0] * lengthInv_ * tan(u[1]);
+    odeRHS(q, u, qdot);
 }
 
 void ompl::app::KinematicCarPlanning::postPropagate(const base::State* /*state*/, const control::Control* /*control*/, const double /*duration*/, base::State* result)
@@ -86,3 +188,57 @@ void ompl::app::KinematicCarPlanning::postPropagate(const base::State* /*state*/
         ->as<base::SO2StateSpace::StateType>(1);
     SO2->enforceBounds(so2);
 }
+
+void ompl::app::KinematicCarPlanning::propagateAnalytic(const base::State* state, const control::Control* control, const double duration, base::State* result) const
+{
+    const double *u = control->as<control::RealVectorControlSpace::ControlType>()->values;
+    const auto* s = state->as<base::SE2StateSpace::StateType>();
+    const double x = s->getX(), y = s->getY(), theta = s->getYaw();
+
+    // constant velocity and steering angle: the car moves on a circular arc
+    // (result may be the same state as state, so it is written last)
+    const double omega = u[0] * lengthInv_ * tan(u[1]);
+    const double dtheta = omega * duration;
+    auto* r = result->as<base::SE2StateSpace::StateType>();
+    if (std::abs(dtheta) < 1e-9)
+    {
+        // (nearly) straight; the heading halfway along the motion keeps this accurate to second order
+        const double heading = theta + 0.5 * dtheta, dist = u[0] * duration;
+        r->setXY(x + dist * cos(heading), y + dist * sin(heading));
+    }
+    else
+    {
+        const double radius = u[0] / omega;
+        r->setXY(x + radius * (sin(theta + dtheta) - sin(theta)), y - radius * (cos(theta + dtheta) - cos(theta)));
+    }
+    r->setYaw(theta + dtheta);
+}
+
+void ompl::app::KinematicCarPlanning::propagateFixedSize(const base::State* state, const control::Control* control, const double duration, base::State* result) const
+{
+    const double *u = control->as<control::RealVectorControlSpace::ControlType>()->values;
+    const base::StateSpace *space = getStateSpace().get();
+    std::array<double, 3> q;
+
+    copyToArray(space, state, q);
+    integrateFixedSize(q, duration, odeSolver->getIntegrationStepSize(),
+        [this, u](const std::array<double, 3>& q, std::array<double, 3>& qdot)
+        {
+            odeRHS(q, u, qdot);
+        });
+    copyFromArray(space, q, result);
+}
+
+void ompl::app::KinematicCarPlanning::propagateBatch(const std::vector<const base::State*> &states,
+    const std::vector<const control::Control*> &controls, const std::vector<double> &durations,
+    const std::vector<base::State*> &results)
+{
+    propagateBatchFixedSize<3, 2>(getStateSpace().get(), states, controls, durations, results,
+        odeSolver->getIntegrationStepSize(),
+        [this](const StridedVector<double>& q, const StridedVector<const double>& u, StridedVector<double>& qdot)
+        {
+            odeRHS(q, u, qdot);
+        });
+    for (std::size_t i = 0; i < states.size(); ++i)
+        postPropagate(states[i], controls[i], durations[i], results[i]);
+}
@@ -14,6 +14,7 @@
 #define OMPLAPP_KINEMATIC_CAR_PLANNING_
 
 #include "omplapp/apps/AppBase.h"
+#include "omplapp/apps/detail/MotionPrimitives.h"
 #include <ompl/base/spaces/SE2StateSpace.h>
 #include <ompl/control/ODESolver.h>
 #include <ompl/control/spaces/RealVectorControlSpace.h>
@@ -35,12 +36,25 @@ namespace ompl
             velocity and the steering angle, respectively, and \f$L\f$ is the
             distance between the front and rear axle of the car (set to 1 by
             default).
+
+            With PropagationMethod::ANALYTIC, the car moves along the exact
+            circular arc (or straight line) for the constant control, which
+            is both faster and more accurate than integrating the equations.
+            PropagationMethod::FIXED_SIZE integrates the equations like
+            PropagationMethod::ODE, but without allocating memory.
+
+            With a library of motion primitives (see setMotionPrimitives()),
+            planners that extend the tree with a directed control sampler,
+            such as RRT and SST, only use a fixed set of maneuvers, whose
+            motions are computed once and checked with one swept-volume
+            query each.
         */
         class KinematicCarPlanning : public AppBase<AppType::CONTROL>
         {
         public:
-            KinematicCarPlanning();
-            KinematicCarPlanning(const control::ControlSpacePtr &controlSpace);
+            explicit KinematicCarPlanning(PropagationMethod method = PropagationMethod::ODE);
+            KinematicCarPlanning(const control::ControlSpacePtr &controlSpace,
+                                 PropagationMethod method = PropagationMethod::ODE);
             ~KinematicCarPlanning() override = default;
 
             bool isSelfCollisionEnabled() const override
@@ -70,6 +84,52 @@ namespace ompl
             }
             virtual void setDefaultControlBounds();
 
+            /** \brief Select how the state propagator computes the motion of the car */
+            void setPropagationMethod(PropagationMethod method);
+
+            PropagationMethod getPropagationMethod() const
+            {
+                return propagationMethod_;
+            }
+
+            void setup() override;
+
+            /** \brief Plan with a library of motion primitives: primitive \e
+                i applies \e controls[i] (speed and steering angle) for \e
+                steps[i] propagation steps. The motion of every primitive is
+                computed once at setup(), from the identity pose, and the
+                robot along it is merged into a swept volume if the FCL
+                collision checker is used (see MotionPrimitives). Planners
+                that extend with a directed control sampler then extend
+                with the valid primitive that ends closest to the sampled
+                state, checked with one query instead of propagating and
+                checking every step. Takes effect at the next setup(); an
+                empty library goes back to sampling controls. */
+            void setMotionPrimitives(const std::vector<std::vector<double>> &controls, const std::vector<unsigned int> &steps);
+
+            /** \brief Use a library of motion primitives that drives forward
+                and backward at the highest speed of the control bounds,
+                with \e steeringAngles steering angles spread evenly over
+                the bounds, for every number of propagation steps in \e
+                steps (see setMotionPrimitives()) */
+            void setDefaultMotionPrimitives(unsigned int steeringAngles = 5, const std::vector<unsigned int> &steps = {10, 20});
+
+            /** \brief Get the library of motion primitives, if one is used */
+            const MotionPrimitivesPtr& getMotionPrimitives() const
+            {
+                return primitives_;
+            }
+
+            /** \brief Propagate states[i] with controls[i] for durations[i],
+                for all \e i. The systems are integrated in lockstep, like
+                PropagationMethod::FIXED_SIZE but on a structure-of-arrays
+                layout that the compiler can vectorize, independent of the
+                selected propagation method. results[i] may be the same
+                state as states[i]. */
+            void propagateBatch(const std::vector<const base::State*> &states,
+                                const std::vector<const control::Control*> &controls,
+                                const std::vector<double> &durations, const std::vector<base::State*> &results);
+
         protected:
 
             const base::State* getGeometricComponentStateInternal(const base::State* state, unsigned int /*index*/) const override
@@ -81,6 +141,20 @@ namespace ompl
 
             virtual void postPropagate(const base::State* state, const control::Control* control, double duration, base::State* result);
 
+            /** \brief Move the car along the arc determined by \e control for \e duration */
+            void propagateAnalytic(const base::State* state, const control::Control* control, double duration, base::State* result) const;
+
+            /** \brief Integrate the equations of motion with a fixed-size state
+                vector. This evaluates odeRHS(), not the virtual ode(), so a
+                derived class that changes the dynamics should use
+                PropagationMethod::ODE. */
+            void propagateFixedSize(const base::State* state, const control::Control* control, double duration, base::State* result) const;
+
+            /** \brief The right-hand side of the equations of motion for controls
+                \e u, shared by ode(), propagateFixedSize() and propagateBatch() */
+            template <typename StateVector, typename ControlVector>
+            void odeRHS(const StateVector& q, const ControlVector& u, StateVector& qdot) const;
+
             static control::ControlSpacePtr constructControlSpace()
             {
                 return std::make_shared<control::RealVectorControlSpace>(constructStateSpace(), 2);
@@ -93,6 +167,10 @@ namespace ompl
             double timeStep_{1e-2};
             double lengthInv_{1.};
             control::ODESolverPtr odeSolver;
+            PropagationMethod propagationMethod_{PropagationMethod::ODE};
+            MotionPrimitivesPtr primitives_;
+            /** \brief Whether setup() installed the directed control sampler of the primitives */
+            bool primitiveSampler_{false};
         };
     }
 }
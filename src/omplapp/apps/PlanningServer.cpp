@@ -0,0 +1,154 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#include "omplapp/apps/PlanningServer.h"
+#include "omplapp/apps/SE2RigidBodyPlanning.h"
+#include "omplapp/apps/SE3RigidBodyPlanning.h"
+#include "omplapp/apps/KinematicCarPlanning.h"
+#include "omplapp/apps/DynamicCarPlanning.h"
+#include "omplapp/apps/BlimpPlanning.h"
+#include "omplapp/apps/QuadrotorPlanning.h"
+#include <ompl/util/Exception.h>
+#include <algorithm>
+
+ompl::app::PlanningServer::PlanningServer(std::size_t maxApps) : maxApps_(std::max<std::size_t>(1, maxApps))
+{
+    registerApp<SE2RigidBodyPlanning>("SE2RigidBodyPlanning");
+    registerApp<SE3RigidBodyPlanning>("SE3RigidBodyPlanning");
+    registerApp<KinematicCarPlanning>("KinematicCarPlanning");
+    registerApp<DynamicCarPlanning>("DynamicCarPlanning");
+    registerApp<BlimpPlanning>("BlimpPlanning");
+    registerApp<QuadrotorPlanning>("QuadrotorPlanning");
+}
+
+void ompl::app::PlanningServer::registerApp(const std::string &type, Factory factory)
+{
+    std::lock_guard<std::mutex> slock(lock_);
+    factories_[type] = std::move(factory);
+}
+
+bool ompl::app::PlanningServer::isRegistered(const std::string &type) const
+{
+    std::lock_guard<std::mutex> slock(lock_);
+    return factories_.find(type) != factories_.end();
+}
+
+std::shared_ptr<ompl::app::RigidBodyGeometry> ompl::app::PlanningServer::getApp(const std::string &type,
+    const std::string &robot, const std::string &env, CollisionChecker ctype)
+{
+    const Key key(type, robot, env, ctype);
+    Factory factory;
+    std::size_t motionCacheSize;
+    bool headlessMeshImport;
+    {
+        std::lock_guard<std::mutex> slock(lock_);
+        auto range = apps_.equal_range(key);
+        for (auto it = range.first ; it != range.second ; ++it)
+            if (!it->second.busy->load())
+            {
+                std::shared_ptr<RigidBodyGeometry> app = lease(it->second);
+                it->second.reset();
+                it->second.lastUse = ++uses_;
+                OMPL_DEBUG("Reusing %s app for robot '%s' in '%s'", type.c_str(), robot.c_str(), env.c_str());
+                return app;
+            }
+
+        auto f = factories_.find(type);
+        if (f == factories_.end())
+            throw Exception("Unknown app type '" + type + "'");
+        factory = f->second;
+        motionCacheSize = motionCacheSize_;
+        headlessMeshImport = headlessMeshImport_;
+    }
+
+    // loading the meshes can take seconds; other queries go on meanwhile
+    Entry entry = factory(motionCacheSize, headlessMeshImport);
+    entry.app->setStateValidityCheckerType(ctype);
+    if (!entry.app->setRobotMesh(robot))
+        throw Exception("Unable to load robot mesh '" + robot + "'");
+    if (!entry.app->setEnvironmentMesh(env))
+        throw Exception("Unable to load environment mesh '" + env + "'");
+    std::shared_ptr<RigidBodyGeometry> app = lease(entry);
+
+    std::lock_guard<std::mutex> slock(lock_);
+    entry.lastUse = ++uses_;
+    evict(maxApps_ - 1);
+    OMPL_INFORM("Created %s app for robot '%s' in '%s'", type.c_str(), robot.c_str(), env.c_str());
+    apps_.emplace(key, std::move(entry));
+    return app;
+}
+
+std::shared_ptr<ompl::app::RigidBodyGeometry> ompl::app::PlanningServer::lease(const Entry &entry)
+{
+    entry.busy->store(true);
+    std::shared_ptr<RigidBodyGeometry> app = entry.app;
+    std::shared_ptr<std::atomic<bool>> busy = entry.busy;
+    // the lease owns a reference to the app, so an app dropped by evict() stays alive until it is released
+    return std::shared_ptr<RigidBodyGeometry>(app.get(), [app, busy](RigidBodyGeometry *) mutable
+        {
+            busy->store(false);
+            app.reset();
+        });
+}
+
+std::size_t ompl::app::PlanningServer::getAppCount() const
+{
+    std::lock_guard<std::mutex> slock(lock_);
+    return apps_.size();
+}
+
+void ompl::app::PlanningServer::clear()
+{
+    std::lock_guard<std::mutex> slock(lock_);
+    apps_.clear();
+}
+
+void ompl::app::PlanningServer::setMaxApps(std::size_t maxApps)
+{
+    std::lock_guard<std::mutex> slock(lock_);
+    maxApps_ = std::max<std::size_t>(1, maxApps);
+    evict(maxApps_);
+}
+
+void ompl::app::PlanningServer::setMotionCacheSize(std::size_t entries)
+{
+    std::lock_guard<std::mutex> slock(lock_);
+    motionCacheSize_ = entries;
+}
+
+std::size_t ompl::app::PlanningServer::getMotionCacheSize() const
+{
+    std::lock_guard<std::mutex> slock(lock_);
+    return motionCacheSize_;
+}
+
+void ompl::app::PlanningServer::setHeadlessMeshImport(bool headless)
+{
+    std::lock_guard<std::mutex> slock(lock_);
+    headlessMeshImport_ = headless;
+}
+
+bool ompl::app::PlanningServer::getHeadlessMeshImport() const
+{
+    std::lock_guard<std::mutex> slock(lock_);
+    return headlessMeshImport_;
+}
+
+void ompl::app::PlanningServer::evict(std::size_t n)
+{
+    // idle apps are dropped before leased ones
+    while (apps_.size() > n)
+        apps_.erase(std::min_element(apps_.begin(), apps_.end(),
+            [](const std::pair<const Key, Entry> &a, const std::pair<const Key, Entry> &b)
+            {
+                const bool aBusy = a.second.busy->load(), bBusy = b.second.busy->load();
+                return aBusy != bBusy ? bBusy : a.second.lastUse < b.second.lastUse;
+            }));
+}
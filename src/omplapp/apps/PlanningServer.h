@@ -0,0 +1,174 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_PLANNING_SERVER_
+#define OMPLAPP_PLANNING_SERVER_
+
+#include "omplapp/geometry/RigidBodyGeometry.h"
+#include <ompl/base/ProblemDefinition.h>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace ompl
+{
+    namespace app
+    {
+        /** \brief Keeps apps with loaded meshes and collision checkers
+            across planning queries. Loading the meshes and building the
+            collision models of an app can take seconds, so a long-lived
+            service (such as the web application) gets its apps from
+            getApp(), which only creates a new app the first time a
+            combination of app type, robot mesh, environment mesh, and
+            collision checker is requested. A returned app keeps its
+            geometry and validity checker; its start states, goal,
+            optimization objective, and planner data are reset, so every
+            query sets up its own problem.
+
+            The server can be used from several threads. An app returned by
+            getApp() is leased to its caller until the last copy of the
+            returned pointer is released; while it is leased, getApp()
+            creates another app for the same combination instead of handing
+            out the one in use. */
+        class PlanningServer
+        {
+        public:
+
+            /** \brief Constructor. The apps of OMPL.app that plan for a
+                single robot are registered under their class names, such as
+                "SE3RigidBodyPlanning" or "KinematicCarPlanning". At most \e
+                maxApps apps are kept; the least recently used app is
+                dropped when a new one would exceed this limit. */
+            explicit PlanningServer(std::size_t maxApps = 8);
+
+            /** \brief Make the apps of type \e App available as \e type */
+            template<typename App>
+            void registerApp(const std::string &type)
+            {
+                registerApp(type, [](std::size_t motionCacheSize, bool headlessMeshImport)
+                    {
+                        auto app = std::make_shared<App>();
+                        app->setMotionCacheSize(motionCacheSize);
+                        app->setHeadlessMeshImport(headlessMeshImport);
+                        App *a = app.get();
+                        return Entry{app, [a] { resetQuery(*a); }, 0, std::make_shared<std::atomic<bool>>(false)};
+                    });
+            }
+
+            /** \brief Return true if apps of type \e type can be created */
+            bool isRegistered(const std::string &type) const;
+
+            /** \brief Return the app of type \e type with the robot \e robot
+                and the environment \e env loaded and collision checker \e
+                ctype selected, creating it if needed. The problem of a reused
+                app is reset. The app is not returned by another call until
+                the returned pointer and all its copies are released. Meshes
+                are loaded without blocking other calls. Throws an Exception
+                if \e type is unknown or a mesh cannot be loaded. */
+            std::shared_ptr<RigidBodyGeometry> getApp(const std::string &type, const std::string &robot,
+                                                      const std::string &env, CollisionChecker ctype = FCL);
+
+            /** \brief Get the number of apps kept, including leased ones */
+            std::size_t getAppCount() const;
+
+            /** \brief Drop all apps */
+            void clear();
+
+            /** \brief Set the maximum number of apps kept */
+            void setMaxApps(std::size_t maxApps);
+
+            /** \brief Get the maximum number of apps kept */
+            std::size_t getMaxApps() const
+            {
+                return maxApps_;
+            }
+
+            /** \brief Set the number of motions whose validity every new
+                app remembers across queries (see
+                AppBase::setMotionCacheSize()). The default is 65536; zero
+                disables the cache. Apps that were already created keep
+                their cache. */
+            void setMotionCacheSize(std::size_t entries);
+
+            /** \brief Get the number of motions whose validity every new app remembers */
+            std::size_t getMotionCacheSize() const;
+
+            /** \brief Set whether new apps import their meshes for collision
+                checking only (see RigidBodyGeometry::setHeadlessMeshImport()).
+                This is the default, since clients of the server render the
+                mesh files themselves. */
+            void setHeadlessMeshImport(bool headless);
+
+            /** \brief Get the value set by setHeadlessMeshImport() */
+            bool getHeadlessMeshImport() const;
+
+        private:
+
+            /** \brief An app and the function that resets its problem */
+            struct Entry
+            {
+                std::shared_ptr<RigidBodyGeometry> app;
+                std::function<void()>              reset;
+                unsigned long                      lastUse;
+                /** \brief True while the app is leased; shared with the lease */
+                std::shared_ptr<std::atomic<bool>> busy;
+            };
+
+            /** \brief Creates an app with the given motion cache size and mesh import setting */
+            using Factory = std::function<Entry(std::size_t, bool)>;
+
+            using Key = std::tuple<std::string, std::string, std::string, CollisionChecker>;
+
+            void registerApp(const std::string &type, Factory factory);
+
+            /** \brief Mark the app of \e entry as busy and return a pointer
+                to it that marks it as idle again when released */
+            static std::shared_ptr<RigidBodyGeometry> lease(const Entry &entry);
+
+            /** \brief Drop least recently used apps until at most \e n are
+                kept. Dropping a leased app only removes it from the server;
+                it is destroyed when its lease ends. */
+            void evict(std::size_t n);
+
+            /** \brief Forget the query of a SimpleSetup */
+            template<typename Setup>
+            static void resetQuery(Setup &setup)
+            {
+                setup.clear();
+                const base::ProblemDefinitionPtr &pdef = setup.getProblemDefinition();
+                pdef->clearStartStates();
+                pdef->clearGoal();
+                pdef->setOptimizationObjective(base::OptimizationObjectivePtr());
+            }
+
+            std::map<std::string, Factory>                factories_;
+
+            /** \brief Several apps are kept for a key that was used by concurrent queries */
+            std::multimap<Key, Entry>                     apps_;
+
+            std::size_t                                   maxApps_;
+            std::size_t                                   motionCacheSize_{65536};
+            bool                                          headlessMeshImport_{true};
+
+            /** \brief Incremented for every call to getApp() */
+            unsigned long                                 uses_{0};
+
+            mutable std::mutex                            lock_;
+        };
+    }
+}
+
+#endif
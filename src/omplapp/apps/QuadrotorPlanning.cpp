@@ -11,6 +11,10 @@
 /* Author: Mark Moll */
 
 #include "omplapp/apps/QuadrotorPlanning.h"
+#include "omplapp/apps/detail/FixedSizeODE.h"
+#include <ompl/util/Console.h>
+#include <algorithm>
+#include <cmath>
 
 ompl::base::ScopedState<> ompl::app::QuadrotorPlanning::getDefaultStartState() const
 {
@@ -35,35 +39,23 @@ ompl::base::ScopedState<> ompl::app::QuadrotorPlanning::getFullStateFromGeometri
     return s;
 }
 
-void ompl::app::QuadrotorPlanning::ode(const control::ODESolver::StateType& q, const control::Control *ctrl, control::ODESolver::StateType& qdot)
+template <typename StateVector, typename ControlVector>
+void ompl::app::QuadrotorPlanning::odeRHS(const StateVector& q, const ControlVector& u, StateVector& qdot) const
 {
-    const double *u = ctrl->as<control::RealVectorControlSpace::ControlType>()->values;
-
-    // zero out qdot
-    qdot.resize (q.size (), 0);
-
     // derivative of position
     qdot[0] = q[7];
     qdot[1] = q[8];
     qdot[2] = q[9];
 
-    // derivative of orientation
-    // 1. First convert omega to quaternion: qdot = omega * q / 2
-    base::SO3StateSpace::StateType qomega;
-    qomega.w = 0;
-    qomega.x = .5*q[10];
-    qomega.y = .5*q[11];
-    qomega.z = .5*q[12];
-
-    // 2. We include a numerical correction so that dot(q,qdot) = 0. This constraint is
-    // obtained by differentiating q * q_conj = 1
-    double delta = q[3] * qomega.x + q[4] * qomega.y + q[5] * qomega.z;
-
-    // 3. Finally, set the derivative of orientation
-    qdot[3] = qomega.x - delta * q[3];
-    qdot[4] = qomega.y - delta * q[4];
-    qdot[5] = qomega.z - delta * q[5];
-    qdot[6] = qomega.w - delta * q[6];
+    // derivative of orientation: qdot = omega * q / 2, where omega is the
+    // angular velocity in the world frame as a quaternion with zero real part.
+    // This is the rotation that propagateLieGroup() applies exactly; it keeps
+    // dot(q,qdot) = 0, so the quaternion stays unit length up to the
+    // integration error.
+    qdot[3] = .5 * ( q[6]*q[10] + q[11]*q[5] - q[12]*q[4]);
+    qdot[4] = .5 * ( q[6]*q[11] + q[12]*q[3] - q[10]*q[5]);
+    qdot[5] = .5 * ( q[6]*q[12] + q[10]*q[4] - q[11]*q[3]);
+    qdot[6] = .5 * (-q[10]*q[3] - q[11]*q[4] - q[12]*q[5]);
 
     // derivative of velocity
     // the z-axis of the body frame in world coordinates is equal to
@@ -79,6 +71,16 @@ void ompl::app::QuadrotorPlanning::ode(const control::ODESolver::StateType& q, c
     qdot[12] = u[3];
 }
 
+void ompl::app::QuadrotorPlanning::ode(const control::ODESolver::StateType& q, const control::Control *ctrl, control::ODESolver::StateType& qdot)
+{
+    const double *u = ctrl->as<control::RealVectorControlSpace::ControlType>()->values;
+
+    // zero out qdot
+    qdot.resize (q.size (), 0);
+
+    odeRHS(q, u, qdot);
+}
+
 void ompl::app::QuadrotorPlanning::postPropagate(const base::State* /*state*/, const control::Control* /*control*/, const double /*duration*/, base::State* result)
 {
     const base::CompoundStateSpace* cs = getStateSpace()->as<base::CompoundStateSpace>();
@@ -92,6 +94,201 @@ void ompl::app::QuadrotorPlanning::postPropagate(const base::State* /*state*/, c
     cs->getSubspace(1)->enforceBounds(csState[1]);
 }
 
+void ompl::app::QuadrotorPlanning::setPropagationMethod(PropagationMethod method)
+{
+    if (method == PropagationMethod::ANALYTIC)
+    {
+        OMPL_WARN("%s: there is no analytic solution for the quadrotor dynamics; using fixed-size integration", name_.c_str());
+        method = PropagationMethod::FIXED_SIZE;
+    }
+    propagationMethod_ = method;
+    if (method == PropagationMethod::FIXED_SIZE)
+        si_->setStatePropagator(
+            [this](const base::State* state, const control::Control* control, const double duration, base::State* result)
+            {
+                propagateFixedSize(state, control, duration, result);
+                postPropagate(state, control, duration, result);
+            });
+    else if (method == PropagationMethod::LIE_GROUP)
+        si_->setStatePropagator(
+            [this](const base::State* state, const control::Control* control, const double duration, base::State* result)
+            {
+                propagateLieGroup(state, control, duration, result);
+                postPropagate(state, control, duration, result);
+            });
+    else if (method == PropagationMethod::ADAPTIVE)
+    {
+        if (!adaptiveOdeSolver_)
+        {
+            adaptiveOdeSolver_ = std::make_shared<control::ODEAdaptiveSolver<>>(si_,
+                [this](const control::ODESolver::StateType& q, const control::Control *ctrl, control::ODESolver::StateType& qdot)
+                {
+                    ode(q, ctrl, qdot);
+                }, odeSolver->getIntegrationStepSize());
+            adaptiveOdeSolver_->setMaximumError(integrationTolerance_);
+        }
+        si_->setStatePropagator(control::ODESolver::getStatePropagator(adaptiveOdeSolver_,
+            [this](const base::State* state, const control::Control* control, const double duration, base::State* result)
+            {
+                postPropagate(state, control, duration, result);
+            }));
+    }
+    else
+        si_->setStatePropagator(control::ODESolver::getStatePropagator(odeSolver,
+            [this](const base::State* state, const control::Control* control, const double duration, base::State* result)
+            {
+                postPropagate(state, control, duration, result);
+            }));
+}
+
+void ompl::app::QuadrotorPlanning::propagateFixedSize(const base::State* state, const control::Control* control, const double duration, base::State* result) const
+{
+    const double *u = control->as<control::RealVectorControlSpace::ControlType>()->values;
+    const base::StateSpace *space = getStateSpace().get();
+    std::array<double, 13> q;
+
+    copyToArray(space, state, q);
+    integrateFixedSize(q, duration, odeSolver->getIntegrationStepSize(),
+        [this, u](const std::array<double, 13>& q, std::array<double, 13>& qdot)
+        {
+            odeRHS(q, u, qdot);
+        });
+    copyFromArray(space, q, result);
+}
+
+namespace
+{
+    // rotate quaternion q (x,y,z,w) by the rotation vector w * dt, expressed in the world frame
+    void rotate(double q[4], const double w[3], double dt)
+    {
+        const double norm = sqrt(w[0] * w[0] + w[1] * w[1] + w[2] * w[2]);
+        const double half = .5 * norm * dt;
+        const double k = norm > 1e-12 ? sin(half) / norm : .5 * dt;
+        const double d[4] = { k * w[0], k * w[1], k * w[2], cos(half) };
+        const double r[4] = {
+            d[3] * q[0] + d[0] * q[3] + d[1] * q[2] - d[2] * q[1],
+            d[3] * q[1] - d[0] * q[2] + d[1] * q[3] + d[2] * q[0],
+            d[3] * q[2] + d[0] * q[1] - d[1] * q[0] + d[2] * q[3],
+            d[3] * q[3] - d[0] * q[0] - d[1] * q[1] - d[2] * q[2] };
+        for (int i = 0; i < 4; ++i)
+            q[i] = r[i];
+    }
+
+    const char* propagationMethodName(ompl::app::PropagationMethod method)
+    {
+        switch (method)
+        {
+            case ompl::app::PropagationMethod::FIXED_SIZE:
+                return "fixed_size";
+            case ompl::app::PropagationMethod::ADAPTIVE:
+                return "adaptive";
+            case ompl::app::PropagationMethod::LIE_GROUP:
+                return "lie_group";
+            default:
+                return "ode";
+        }
+    }
+}
+
+void ompl::app::QuadrotorPlanning::propagateLieGroup(const base::State* state, const control::Control* control, const double duration, base::State* result) const
+{
+    const double *u = control->as<control::RealVectorControlSpace::ControlType>()->values;
+    const auto* s = state->as<base::CompoundStateSpace::StateType>();
+    const auto* pose = s->as<base::SE3StateSpace::StateType>(0);
+    const double *vel = s->as<base::RealVectorStateSpace::StateType>(1)->values;
+    const base::SO3StateSpace::StateType& rot = pose->rotation();
+    double p[3] = { pose->getX(), pose->getY(), pose->getZ() };
+    double q[4] = { rot.x, rot.y, rot.z, rot.w };
+    double v[3] = { vel[0], vel[1], vel[2] };
+    double w[3] = { vel[3], vel[4], vel[5] };
+
+    const double step = odeSolver->getIntegrationStepSize();
+    const unsigned int steps = std::max(1u, (unsigned int)std::ceil(std::abs(duration) / step - 1e-9));
+    const double h = duration / steps;
+    const double damping = .5 * h * massInv_ * beta_;
+    for (unsigned int k = 0; k < steps; ++k)
+    {
+        // the angular velocity changes linearly; its value halfway through the step
+        // gives a second-order accurate rotation
+        const double wm[3] = { w[0] + .5 * h * u[1], w[1] + .5 * h * u[2], w[2] + .5 * h * u[3] };
+        rotate(q, wm, .5 * h);
+
+        // thrust along the z-axis of the body frame halfway through the step (see odeRHS)
+        const double a[3] = {
+            -2. * massInv_ * u[0] * (q[3] * q[1] + q[0] * q[2]),
+            -2. * massInv_ * u[0] * (q[1] * q[2] - q[3] * q[0]),
+            -massInv_ * u[0] * (q[3] * q[3] - q[0] * q[0] - q[1] * q[1] + q[2] * q[2]) - 9.81 };
+        for (int i = 0; i < 3; ++i)
+        {
+            const double vNext = ((1. - damping) * v[i] + h * a[i]) / (1. + damping);
+            p[i] += .5 * h * (v[i] + vNext);
+            v[i] = vNext;
+        }
+
+        rotate(q, wm, .5 * h);
+        for (int i = 0; i < 3; ++i)
+            w[i] += h * u[i + 1];
+    }
+
+    // result may be the same state as state, so it is written last
+    auto* r = result->as<base::CompoundStateSpace::StateType>();
+    auto* rpose = r->as<base::SE3StateSpace::StateType>(0);
+    double *rvel = r->as<base::RealVectorStateSpace::StateType>(1)->values;
+    base::SO3StateSpace::StateType& rrot = rpose->rotation();
+    rpose->setXYZ(p[0], p[1], p[2]);
+    rrot.x = q[0];
+    rrot.y = q[1];
+    rrot.z = q[2];
+    rrot.w = q[3];
+    for (int i = 0; i < 3; ++i)
+    {
+        rvel[i] = v[i];
+        rvel[i + 3] = w[i];
+    }
+}
+
+void ompl::app::QuadrotorPlanning::setIntegrationStepSize(double step)
+{
+    odeSolver->setIntegrationStepSize(step);
+    if (adaptiveOdeSolver_)
+        adaptiveOdeSolver_->setIntegrationStepSize(step);
+}
+
+void ompl::app::QuadrotorPlanning::setIntegrationTolerance(double tolerance)
+{
+    integrationTolerance_ = tolerance;
+    if (adaptiveOdeSolver_)
+        adaptiveOdeSolver_->setMaximumError(tolerance);
+}
+
+void ompl::app::QuadrotorPlanning::declareParams()
+{
+    si_->params().declareParam<std::string>("propagation",
+        [this](const std::string &name)
+        {
+            if (name == "ode")
+                setPropagationMethod(PropagationMethod::ODE);
+            else if (name == "fixed_size")
+                setPropagationMethod(PropagationMethod::FIXED_SIZE);
+            else if (name == "adaptive")
+                setPropagationMethod(PropagationMethod::ADAPTIVE);
+            else if (name == "lie_group")
+                setPropagationMethod(PropagationMethod::LIE_GROUP);
+            else
+                OMPL_ERROR("%s: unknown propagation method '%s'", name_.c_str(), name.c_str());
+        },
+        [this]
+        {
+            return std::string(propagationMethodName(propagationMethod_));
+        });
+    si_->params().declareParam<double>("integration_step_size",
+        [this](double step) { setIntegrationStepSize(step); },
+        [this] { return getIntegrationStepSize(); });
+    si_->params().declareParam<double>("integration_tolerance",
+        [this](double tolerance) { setIntegrationTolerance(tolerance); },
+        [this] { return getIntegrationTolerance(); });
+}
+
 ompl::base::StateSpacePtr ompl::app::QuadrotorPlanning::constructStateSpace()
 {
     auto stateSpace(std::make_shared<base::CompoundStateSpace>());
@@ -115,3 +312,17 @@ void ompl::app::QuadrotorPlanning::setDefaultBounds()
     controlbounds.setHigh(0, 15.);
     getControlSpace()->as<control::RealVectorControlSpace>()->setBounds(controlbounds);
 }
+
+void ompl::app::QuadrotorPlanning::propagateBatch(const std::vector<const base::State*> &states,
+    const std::vector<const control::Control*> &controls, const std::vector<double> &durations,
+    const std::vector<base::State*> &results)
+{
+    propagateBatchFixedSize<13, 4>(getStateSpace().get(), states, controls, durations, results,
+        odeSolver->getIntegrationStepSize(),
+        [this](const StridedVector<double>& q, const StridedVector<const double>& u, StridedVector<double>& qdot)
+        {
+            odeRHS(q, u, qdot);
+        });
+    for (std::size_t i = 0; i < states.size(); ++i)
+        postPropagate(states[i], controls[i], durations[i], results[i]);
+}
@@ -32,11 +32,26 @@ namespace ompl
             the body frame in world coordinates, \f$\alpha\f$ is the angular
             acceleration, \f$m\f$ is the mass, and \f$\beta\f$ is a damping coefficient.
             The system is controlled through \f$u=(u_0,u_1,u_2,u_3)\f$.
+
+            Besides PropagationMethod::ODE and PropagationMethod::FIXED_SIZE,
+            the quadrotor supports PropagationMethod::ADAPTIVE, which
+            adjusts the integration step to keep the error below a
+            tolerance, and PropagationMethod::LIE_GROUP, which updates the
+            orientation with the exponential map of the angular velocity (so
+            the quaternion stays unit length) and integrates the damping
+            implicitly. The latter remains stable for much larger integration
+            steps. All methods integrate the same quaternion kinematics,
+            \f$\dot q = \frac{1}{2}\omega q\f$ with the angular velocity
+            \f$\omega\f$ in the world frame, so they differ only in their
+            integration error. The method is also available as the "propagation"
+            parameter of the space information, together with
+            "integration_step_size" and "integration_tolerance", so that
+            benchmark configurations can select it.
         */
         class QuadrotorPlanning : public AppBase<AppType::CONTROL>
         {
         public:
-            QuadrotorPlanning()
+            explicit QuadrotorPlanning(PropagationMethod method = PropagationMethod::ODE)
                 : AppBase<AppType::CONTROL>(constructControlSpace(), Motion_3D),
                   odeSolver(std::make_shared<control::ODEBasicSolver<>>(si_, [this](const control::ODESolver::StateType& q, const control::Control *ctrl, control::ODESolver::StateType& qdot)
                       {
@@ -44,13 +59,10 @@ namespace ompl
                       }))
             {
                 name_ = std::string("Quadrotor");
+                setStateLayout(Layout_FirstComponent);
                 setDefaultBounds();
-
-                si_->setStatePropagator(control::ODESolver::getStatePropagator(odeSolver,
-                    [this](const base::State* state, const control::Control* control, const double duration, base::State* result)
-                    {
-                        postPropagate(state, control, duration, result);
-                    }));
+                setPropagationMethod(method);
+                declareParams();
             }
             ~QuadrotorPlanning() override = default;
 
@@ -86,6 +98,43 @@ namespace ompl
             }
             virtual void setDefaultBounds();
 
+            /** \brief Select how the state propagator integrates the equations
+                of motion. There is no closed form solution, so
+                PropagationMethod::ANALYTIC is treated as
+                PropagationMethod::FIXED_SIZE. */
+            void setPropagationMethod(PropagationMethod method);
+
+            PropagationMethod getPropagationMethod() const
+            {
+                return propagationMethod_;
+            }
+
+            /** \brief Set the (initial) step size of the numerical integration */
+            void setIntegrationStepSize(double step);
+
+            double getIntegrationStepSize() const
+            {
+                return odeSolver->getIntegrationStepSize();
+            }
+
+            /** \brief Set the maximum error per step of PropagationMethod::ADAPTIVE */
+            void setIntegrationTolerance(double tolerance);
+
+            double getIntegrationTolerance() const
+            {
+                return integrationTolerance_;
+            }
+
+            /** \brief Propagate states[i] with controls[i] for durations[i],
+                for all \e i. The systems are integrated in lockstep, like
+                PropagationMethod::FIXED_SIZE but on a structure-of-arrays
+                layout that the compiler can vectorize, independent of the
+                selected propagation method. results[i] may be the same
+                state as states[i]. */
+            void propagateBatch(const std::vector<const base::State*> &states,
+                                const std::vector<const control::Control*> &controls,
+                                const std::vector<double> &durations, const std::vector<base::State*> &results);
+
         protected:
 
             const base::State* getGeometricComponentStateInternal(const base::State* state, unsigned int /*index*/) const override
@@ -97,6 +146,27 @@ namespace ompl
 
             virtual void postPropagate(const base::State* state, const control::Control* control, double duration, base::State* result);
 
+            /** \brief Integrate the equations of motion with a fixed-size state
+                vector. This evaluates odeRHS(), not the virtual ode(), so a
+                derived class that changes the dynamics should use
+                PropagationMethod::ODE. */
+            void propagateFixedSize(const base::State* state, const control::Control* control, double duration, base::State* result) const;
+
+            /** \brief The right-hand side of the equations of motion for controls
+                \e u, shared by ode(), propagateFixedSize() and propagateBatch() */
+            template <typename StateVector, typename ControlVector>
+            void odeRHS(const StateVector& q, const ControlVector& u, StateVector& qdot) const;
+
+            /** \brief Integrate the equations of motion with steps that keep the
+                orientation on SO(3): the rotation is advanced with the
+                exponential map of the angular velocity halfway through the
+                step, the velocity with the implicit midpoint rule. */
+            void propagateLieGroup(const base::State* state, const control::Control* control, double duration, base::State* result) const;
+
+            /** \brief Declare the propagation parameters in the parameter set
+                of the space information */
+            void declareParams();
+
             static control::ControlSpacePtr constructControlSpace()
             {
                 return std::make_shared<control::RealVectorControlSpace>(constructStateSpace(), 4);
@@ -107,6 +177,10 @@ namespace ompl
             double massInv_{1.};
             double beta_{1.};
             control::ODESolverPtr odeSolver;
+            /** \brief Allocated when PropagationMethod::ADAPTIVE is first selected */
+            std::shared_ptr<control::ODEAdaptiveSolver<>> adaptiveOdeSolver_;
+            double integrationTolerance_{1e-6};
+            PropagationMethod propagationMethod_{PropagationMethod::ODE};
         };
 
     }
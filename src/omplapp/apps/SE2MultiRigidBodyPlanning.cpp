@@ -17,6 +17,7 @@ ompl::app::SE2MultiRigidBodyPlanning::SE2MultiRigidBodyPlanning(unsigned int n)
 {
     assert (n > 0);
     name_ = "Multi rigid body planning (2D)";
+    setStateLayout(Layout_MultiRigidBody);
     // Adding n SE(2) StateSpaces
     for (unsigned int i = 0; i < n_; ++i)
         si_->getStateSpace()->as<base::CompoundStateSpace>()->addSubspace(
@@ -30,6 +30,7 @@ namespace ompl
             SE2RigidBodyPlanning() : AppBase<AppType::GEOMETRIC>(std::make_shared<base::SE2StateSpace>(), Motion_2D)
             {
                 name_ = "Rigid body planning (2D)";
+                setStateLayout(Layout_RigidBody);
             }
 
             ~SE2RigidBodyPlanning() override = default;
@@ -17,6 +17,7 @@ ompl::app::SE3MultiRigidBodyPlanning::SE3MultiRigidBodyPlanning(unsigned int n)
 {
     assert (n > 0);
     name_ = "Multi rigid body planning (3D)";
+    setStateLayout(Layout_MultiRigidBody);
     // Adding n SE(3) StateSpaces
     for (unsigned int i = 0; i < n_; ++i)
         si_->getStateSpace()->as<base::CompoundStateSpace>()->addSubspace(
@@ -30,6 +30,7 @@ namespace ompl
             SE3RigidBodyPlanning() : AppBase<AppType::GEOMETRIC>(std::make_shared<base::SE3StateSpace>(), Motion_3D)
             {
                 name_ = "Rigid body planning (3D)";
+                setStateLayout(Layout_RigidBody);
             }
 
             ~SE3RigidBodyPlanning() override = default;
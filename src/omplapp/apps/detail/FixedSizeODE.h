@@ -0,0 +1,174 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_APPS_DETAIL_FIXED_SIZE_ODE_
+#define OMPLAPP_APPS_DETAIL_FIXED_SIZE_ODE_
+
+#include <ompl/base/StateSpace.h>
+#include <ompl/control/spaces/RealVectorControlSpace.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace ompl
+{
+    namespace app
+    {
+        /** \brief Copy the real values of \e state into \e q, in the same
+            order as control::ODESolver does */
+        template <std::size_t N>
+        void copyToArray(const base::StateSpace *space, const base::State *state, std::array<double, N> &q)
+        {
+            for (std::size_t i = 0; i < N; ++i)
+                q[i] = *space->getValueAddressAtIndex(state, i);
+        }
+
+        /** \brief Copy \e q into the real values of \e state */
+        template <std::size_t N>
+        void copyFromArray(const base::StateSpace *space, const std::array<double, N> &q, base::State *state)
+        {
+            for (std::size_t i = 0; i < N; ++i)
+                *space->getValueAddressAtIndex(state, i) = q[i];
+        }
+
+        /** \brief Integrate \f$\dot q = f(q)\f$ over \e duration with
+            fourth-order Runge-Kutta steps of equal size, no larger than
+            \e step. The system is called as \c f(q,qdot). Unlike
+            control::ODEBasicSolver, all intermediate vectors live on the
+            stack, so integration does not allocate. Negative durations
+            integrate backwards in time. */
+        template <std::size_t N, typename F>
+        void integrateFixedSize(std::array<double, N> &q, double duration, double step, const F &f)
+        {
+            using Vector = std::array<double, N>;
+            const unsigned int steps = std::max(1u, (unsigned int)std::ceil(std::abs(duration) / step - 1e-9));
+            const double h = duration / steps;
+            Vector k1, k2, k3, k4, tmp;
+
+            for (unsigned int s = 0; s < steps; ++s)
+            {
+                f(q, k1);
+                for (std::size_t i = 0; i < N; ++i)
+                    tmp[i] = q[i] + .5 * h * k1[i];
+                f(tmp, k2);
+                for (std::size_t i = 0; i < N; ++i)
+                    tmp[i] = q[i] + .5 * h * k2[i];
+                f(tmp, k3);
+                for (std::size_t i = 0; i < N; ++i)
+                    tmp[i] = q[i] + h * k3[i];
+                f(tmp, k4);
+                for (std::size_t i = 0; i < N; ++i)
+                    q[i] += h / 6. * (k1[i] + 2. * k2[i] + 2. * k3[i] + k4[i]);
+            }
+        }
+
+        /** \brief One element of a batch of vectors stored as a structure of
+            arrays: component \e i is at data[i * stride]. Evaluating the
+            equations of motion on these views for consecutive elements
+            touches consecutive memory, which lets the compiler vectorize the
+            loop over the batch. */
+        template <typename T>
+        struct StridedVector
+        {
+            T           *data;
+            std::size_t  stride;
+
+            T& operator[](std::size_t i) const
+            {
+                return data[i * stride];
+            }
+        };
+
+        /** \brief Integrate the \e count systems in \e q in lockstep with
+            fourth-order Runge-Kutta steps. \e q stores \e N components
+            per system as a structure of arrays (component \e i of system
+            \e j is q[i * count + j]). All systems take the same number of
+            steps, so that each system takes equal steps no larger than
+            \e step over its own duration. The system is called as
+            \c f(j,q,qdot), with StridedVector views of system \e j. */
+        template <std::size_t N, typename F>
+        void integrateBatch(std::vector<double> &q, std::size_t count, const std::vector<double> &durations,
+                            double step, const F &f)
+        {
+            double maxDuration = 0.;
+            for (double d : durations)
+                maxDuration = std::max(maxDuration, std::abs(d));
+            const unsigned int steps = std::max(1u, (unsigned int)std::ceil(maxDuration / step - 1e-9));
+            std::vector<double> h(count), k1(N * count), k2(N * count), k3(N * count), k4(N * count), tmp(N * count);
+            for (std::size_t j = 0; j < count; ++j)
+                h[j] = durations[j] / steps;
+
+            auto evaluate = [&](std::vector<double> &x, std::vector<double> &xdot)
+            {
+                for (std::size_t j = 0; j < count; ++j)
+                    f(j, StridedVector<double>{&x[j], count}, StridedVector<double>{&xdot[j], count});
+            };
+            auto advance = [&](double c, const std::vector<double> &k)
+            {
+                for (std::size_t i = 0; i < N; ++i)
+                    for (std::size_t j = 0; j < count; ++j)
+                        tmp[i * count + j] = q[i * count + j] + c * h[j] * k[i * count + j];
+            };
+
+            for (unsigned int s = 0; s < steps; ++s)
+            {
+                evaluate(q, k1);
+                advance(.5, k1);
+                evaluate(tmp, k2);
+                advance(.5, k2);
+                evaluate(tmp, k3);
+                advance(1., k3);
+                evaluate(tmp, k4);
+                for (std::size_t i = 0; i < N; ++i)
+                    for (std::size_t j = 0; j < count; ++j)
+                    {
+                        const std::size_t l = i * count + j;
+                        q[l] += h[j] / 6. * (k1[l] + 2. * k2[l] + 2. * k3[l] + k4[l]);
+                    }
+            }
+        }
+
+        /** \brief Propagate states[j] with controls[j] for durations[j] for
+            all \e j with integrateBatch(). The states have \e N real values
+            and the controls are RealVectorControlSpace controls of
+            dimension \e M. The system is called as \c f(q,u,qdot) with
+            StridedVector views. results[j] may be the same state as
+            states[j]. */
+        template <std::size_t N, std::size_t M, typename F>
+        void propagateBatchFixedSize(const base::StateSpace *space, const std::vector<const base::State*> &states,
+                                     const std::vector<const control::Control*> &controls,
+                                     const std::vector<double> &durations, const std::vector<base::State*> &results,
+                                     double step, const F &f)
+        {
+            const std::size_t count = states.size();
+            std::vector<double> q(N * count), u(M * count);
+            for (std::size_t j = 0; j < count; ++j)
+            {
+                const double *values = controls[j]->as<control::RealVectorControlSpace::ControlType>()->values;
+                for (std::size_t i = 0; i < N; ++i)
+                    q[i * count + j] = *space->getValueAddressAtIndex(states[j], i);
+                for (std::size_t i = 0; i < M; ++i)
+                    u[i * count + j] = values[i];
+            }
+            integrateBatch<N>(q, count, durations, step,
+                [&](std::size_t j, StridedVector<double> x, StridedVector<double> xdot)
+                {
+                    f(x, StridedVector<const double>{&u[j], count}, xdot);
+                });
+            for (std::size_t j = 0; j < count; ++j)
+                for (std::size_t i = 0; i < N; ++i)
+                    *space->getValueAddressAtIndex(results[j], i) = q[i * count + j];
+        }
+    }
+}
+
+#endif
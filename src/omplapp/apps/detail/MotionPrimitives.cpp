@@ -0,0 +1,152 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#include "omplapp/apps/detail/MotionPrimitives.h"
+#include "omplapp/geometry/detail/FCLMethodWrapper.h"
+#include <ompl/base/spaces/SE2StateSpace.h>
+#include <ompl/util/Exception.h>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+struct ompl::app::MotionPrimitives::SweptVolumes
+{
+    std::vector<FCLMethodWrapper::SweptVolume> volumes;
+};
+
+ompl::app::MotionPrimitives::MotionPrimitives(const control::SpaceInformationPtr &si,
+    const std::vector<std::vector<double>> &controls, const std::vector<unsigned int> &steps)
+    : si_(si), volumes_(new SweptVolumes())
+{
+    if (dynamic_cast<const base::SE2StateSpace*>(si_->getStateSpace().get()) == nullptr)
+        throw Exception("Motion primitives require an SE(2) state space");
+    if (controls.size() != steps.size())
+        throw Exception("Every motion primitive needs a control and a number of steps");
+    const unsigned int dim = si_->getControlSpace()->getDimension();
+    for (std::size_t i = 0 ; i < controls.size() ; ++i)
+    {
+        if (controls[i].size() != dim)
+            throw Exception("The control of motion primitive " + std::to_string(i) + " does not have "
+                + std::to_string(dim) + " values");
+        Primitive primitive;
+        primitive.control = si_->allocControl();
+        for (unsigned int k = 0 ; k < dim ; ++k)
+            *si_->getControlSpace()->getValueAddressAtIndex(primitive.control, k) = controls[i][k];
+        primitive.steps = std::max(1u, steps[i]);
+        primitives_.push_back(std::move(primitive));
+    }
+}
+
+ompl::app::MotionPrimitives::~MotionPrimitives()
+{
+    for (auto &primitive : primitives_)
+    {
+        si_->freeControl(primitive.control);
+        si_->freeStates(primitive.states);
+    }
+}
+
+void ompl::app::MotionPrimitives::build(const FCLMethodWrapper *wrapper)
+{
+    const control::StatePropagatorPtr &propagator = si_->getStatePropagator();
+    const double stepSize = si_->getPropagationStepSize();
+    base::State *identity = si_->allocState();
+    auto *se2 = identity->as<base::SE2StateSpace::StateType>();
+    se2->setXY(0.0, 0.0);
+    se2->setYaw(0.0);
+
+    // the same steps as control::SpaceInformation::propagateWhileValid()
+    volumes_->volumes.clear();
+    for (auto &primitive : primitives_)
+    {
+        si_->freeStates(primitive.states);
+        primitive.states.resize(primitive.steps);
+        si_->allocStates(primitive.states);
+        const base::State *from = identity;
+        for (auto *state : primitive.states)
+        {
+            propagator->propagate(from, primitive.control, stepSize, state);
+            from = state;
+        }
+        if (wrapper != nullptr)
+            volumes_->volumes.push_back(wrapper->sweepRobot(
+                std::vector<const base::State*>(primitive.states.begin(), primitive.states.end())));
+    }
+    si_->freeState(identity);
+    wrapper_ = wrapper;
+}
+
+void ompl::app::MotionPrimitives::getControl(std::size_t i, control::Control *control) const
+{
+    si_->copyControl(control, primitives_[i].control);
+}
+
+void ompl::app::MotionPrimitives::getEndState(std::size_t i, const base::State *start, base::State *end) const
+{
+    compose(start, primitives_[i].states.back(), end);
+}
+
+bool ompl::app::MotionPrimitives::isValid(std::size_t i, const base::State *start) const
+{
+    const Primitive &primitive = primitives_[i];
+    base::State *state = si_->allocState();
+    bool valid = true;
+    for (std::size_t k = 0 ; valid && k < primitive.states.size() ; ++k)
+    {
+        compose(start, primitive.states[k], state);
+        valid = wrapper_ != nullptr ? si_->satisfiesBounds(state) : si_->isValid(state);
+    }
+    si_->freeState(state);
+    return valid && (wrapper_ == nullptr || wrapper_->isSweptVolumeCollisionFree(volumes_->volumes[i], start));
+}
+
+void ompl::app::MotionPrimitives::compose(const base::State *start, const base::State *relative, base::State *result) const
+{
+    const auto *s = start->as<base::SE2StateSpace::StateType>();
+    const auto *r = relative->as<base::SE2StateSpace::StateType>();
+    const double c = cos(s->getYaw()), sn = sin(s->getYaw());
+    const double x = s->getX() + c * r->getX() - sn * r->getY();
+    const double y = s->getY() + sn * r->getX() + c * r->getY();
+    const double yaw = s->getYaw() + r->getYaw();
+    auto *out = result->as<base::SE2StateSpace::StateType>();
+    out->setXY(x, y);
+    out->setYaw(yaw);
+    si_->getStateSpace()->as<base::SE2StateSpace>()->as<base::SO2StateSpace>(1)->enforceBounds(
+        out->as<base::SO2StateSpace::StateType>(1));
+}
+
+ompl::app::PrimitiveDirectedControlSampler::PrimitiveDirectedControlSampler(const control::SpaceInformation *si,
+    MotionPrimitivesPtr primitives) : control::DirectedControlSampler(si), primitives_(std::move(primitives))
+{
+}
+
+unsigned int ompl::app::PrimitiveDirectedControlSampler::sampleTo(control::Control *control, const base::State *source,
+                                                                   base::State *dest)
+{
+    // try the primitives in the order of the distance of their end to dest
+    std::vector<std::pair<double, std::size_t>> order;
+    base::State *end = si_->allocState();
+    for (std::size_t i = 0 ; i < primitives_->size() ; ++i)
+    {
+        primitives_->getEndState(i, source, end);
+        order.emplace_back(si_->distance(end, dest), i);
+    }
+    si_->freeState(end);
+    std::sort(order.begin(), order.end());
+
+    for (const auto &candidate : order)
+        if (primitives_->isValid(candidate.second, source))
+        {
+            primitives_->getControl(candidate.second, control);
+            primitives_->getEndState(candidate.second, source, dest);
+            return primitives_->getSteps(candidate.second);
+        }
+    return 0;
+}
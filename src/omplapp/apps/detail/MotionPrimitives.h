@@ -0,0 +1,132 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_APPS_DETAIL_MOTION_PRIMITIVES_
+#define OMPLAPP_APPS_DETAIL_MOTION_PRIMITIVES_
+
+#include <ompl/control/DirectedControlSampler.h>
+#include <ompl/control/SpaceInformation.h>
+#include <memory>
+#include <vector>
+
+namespace ompl
+{
+    namespace app
+    {
+        class FCLMethodWrapper;
+
+        /** \brief A library of maneuvers of a robot whose motion does not
+            depend on where it is, such as a car in the plane. Every
+            primitive applies one control for a number of propagation
+            steps. The states along a primitive are computed once, from
+            the identity pose of an SE(2) state space, and moved to the
+            start of every motion by composing poses, so no propagation is
+            needed while planning. If an FCL collision checker is given to
+            build(), the robot at the states of a primitive is merged into
+            one swept volume, and a primitive is checked by a single
+            swept-volume query; otherwise the moved states are checked one
+            by one. Both give the same result as propagating and checking
+            every step, up to floating point error. */
+        class MotionPrimitives
+        {
+        public:
+            /** \brief Constructor. \e controls[i] is applied for \e steps[i]
+                propagation steps; the values of every control must match
+                the control space of \e si. */
+            MotionPrimitives(const control::SpaceInformationPtr &si, const std::vector<std::vector<double>> &controls,
+                             const std::vector<unsigned int> &steps);
+
+            ~MotionPrimitives();
+
+            MotionPrimitives(const MotionPrimitives&) = delete;
+            MotionPrimitives& operator=(const MotionPrimitives&) = delete;
+
+            /** \brief Propagate every primitive from the identity pose with
+                the state propagator of the space information, and build the
+                swept volumes with \e wrapper if it is not nullptr. Must be
+                called after the state propagator and the step size are
+                set up, and again when they change. */
+            void build(const FCLMethodWrapper *wrapper);
+
+            /** \brief The number of primitives */
+            std::size_t size() const
+            {
+                return primitives_.size();
+            }
+
+            /** \brief Copy the control of primitive \e i to \e control */
+            void getControl(std::size_t i, control::Control *control) const;
+
+            /** \brief The number of propagation steps of primitive \e i */
+            unsigned int getSteps(std::size_t i) const
+            {
+                return primitives_[i].steps;
+            }
+
+            /** \brief Set \e end to the state that primitive \e i reaches from \e start */
+            void getEndState(std::size_t i, const base::State *start, base::State *end) const;
+
+            /** \brief Return true if the states of primitive \e i from \e
+                start are valid. The states within the bounds of the state
+                space are checked first, then collisions with the swept
+                volume. */
+            bool isValid(std::size_t i, const base::State *start) const;
+
+            /** \brief Return true if the primitives are checked with swept volumes */
+            bool hasSweptVolumes() const
+            {
+                return wrapper_ != nullptr;
+            }
+
+        private:
+            struct Primitive
+            {
+                control::Control              *control;
+                unsigned int                   steps;
+                // the states after every step, starting at the identity pose
+                std::vector<base::State*>      states;
+            };
+
+            /** \brief The swept volumes of the primitives (FCL types are kept out of this header) */
+            struct SweptVolumes;
+
+            /** \brief Set \e result to \e relative moved to \e start */
+            void compose(const base::State *start, const base::State *relative, base::State *result) const;
+
+            control::SpaceInformationPtr  si_;
+            std::vector<Primitive>        primitives_;
+            std::unique_ptr<SweptVolumes> volumes_;
+            const FCLMethodWrapper       *wrapper_{nullptr};
+        };
+
+        using MotionPrimitivesPtr = std::shared_ptr<MotionPrimitives>;
+
+        /** \brief A directed control sampler that extends towards a state
+            with the valid motion primitive that ends closest to it. */
+        class PrimitiveDirectedControlSampler : public control::DirectedControlSampler
+        {
+        public:
+            PrimitiveDirectedControlSampler(const control::SpaceInformation *si, MotionPrimitivesPtr primitives);
+
+            unsigned int sampleTo(control::Control *control, const base::State *source, base::State *dest) override;
+
+            unsigned int sampleTo(control::Control *control, const control::Control * /*previous*/,
+                                  const base::State *source, base::State *dest) override
+            {
+                return sampleTo(control, source, dest);
+            }
+
+        private:
+            MotionPrimitivesPtr primitives_;
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,176 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#include "omplapp/apps/detail/ParallelPathSimplifier.h"
+#include "omplapp/geometry/detail/ParallelBatch.h"
+#include <ompl/util/RandomNumbers.h>
+#include <utility>
+
+ompl::app::ParallelPathSimplifier::ParallelPathSimplifier(const base::SpaceInformationPtr &si, CheckerAllocator allocChecker,
+                                                          unsigned int numThreads)
+    : si_(si), allocChecker_(std::move(allocChecker)), numThreads_(numThreads)
+{
+}
+
+std::function<bool(const ompl::base::State*)> ompl::app::ParallelPathSimplifier::allocChecker() const
+{
+    if (allocChecker_)
+        return allocChecker_();
+    const base::SpaceInformation *si = si_.get();
+    return [si](const base::State *state) { return si->isValid(state); };
+}
+
+bool ompl::app::ParallelPathSimplifier::checkMotion(const std::function<bool(const base::State*)> &isValid,
+                                                    const base::State *s1, const base::State *s2, base::State *scratch) const
+{
+    if (!allocChecker_)
+        return si_->checkMotion(s1, s2);
+    // the same states as base::DiscreteMotionValidator
+    if (!isValid(s2))
+        return false;
+    const unsigned int count = si_->getStateSpace()->validSegmentCount(s1, s2);
+    for (unsigned int k = 1 ; k < count ; ++k)
+    {
+        si_->getStateSpace()->interpolate(s1, s2, (double)k / (double)count, scratch);
+        if (!isValid(scratch))
+            return false;
+    }
+    return true;
+}
+
+bool ompl::app::ParallelPathSimplifier::shortcutPath(geometric::PathGeometric &path, const base::PlannerTerminationCondition &ptc)
+{
+    std::vector<base::State*> &states = path.getStates();
+    RNG rng;
+    bool changed = false;
+    bool first = true;
+    unsigned int emptyRounds = 0;
+    while (!ptc && emptyRounds < maxEmptyRounds_ && states.size() > 2)
+    {
+        const std::size_t n = states.size();
+        std::vector<double> along(n, 0.0);
+        for (std::size_t i = 1 ; i < n ; ++i)
+            along[i] = along[i - 1] + si_->distance(states[i - 1], states[i]);
+        const std::size_t maxStep = std::max<std::size_t>(2, (std::size_t)(rangeRatio_ * n));
+
+        // random shortcuts that skip at least one vertex; the direct connection is tried first
+        std::vector<std::pair<std::size_t, std::size_t>> candidates;
+        if (first)
+            candidates.emplace_back(0, n - 1);
+        first = false;
+        while (candidates.size() < candidates_)
+        {
+            const std::size_t i = rng.uniformInt(0, (int)n - 3);
+            const std::size_t j = rng.uniformInt((int)i + 2, (int)std::min(n - 1, i + maxStep));
+            candidates.emplace_back(i, j);
+        }
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+        std::vector<char> valid(candidates.size(), 0);
+        char *result = valid.data();
+        parallelFor(candidates.size(), numThreads_, [this, &ptc, &states, &candidates, result](std::size_t begin, std::size_t end)
+            {
+                std::function<bool(const base::State*)> isValid = allocChecker();
+                base::State *scratch = si_->allocState();
+                for (std::size_t k = begin ; k < end && !ptc ; ++k)
+                    result[k] = checkMotion(isValid, states[candidates[k].first], states[candidates[k].second], scratch) ? 1 : 0;
+                si_->freeState(scratch);
+            });
+
+        // apply the valid shortcuts that save the most length first, as long as they do not overlap
+        std::vector<std::pair<double, std::size_t>> savings;
+        for (std::size_t k = 0 ; k < candidates.size() ; ++k)
+            if (valid[k])
+            {
+                const std::size_t i = candidates[k].first, j = candidates[k].second;
+                const double saving = along[j] - along[i] - si_->distance(states[i], states[j]);
+                if (saving > 0.0)
+                    savings.emplace_back(saving, k);
+            }
+        std::sort(savings.begin(), savings.end(), std::greater<std::pair<double, std::size_t>>());
+        // segment i of the path ends at vertex i + 1
+        std::vector<char> covered(n - 1, 0);
+        std::vector<char> removed(n, 0);
+        bool applied = false;
+        for (const auto &saving : savings)
+        {
+            const std::size_t i = candidates[saving.second].first, j = candidates[saving.second].second;
+            if (std::find(covered.begin() + i, covered.begin() + j, 1) != covered.begin() + j)
+                continue;
+            std::fill(covered.begin() + i, covered.begin() + j, 1);
+            std::fill(removed.begin() + i + 1, removed.begin() + j, 1);
+            applied = true;
+        }
+
+        if (!applied)
+        {
+            ++emptyRounds;
+            continue;
+        }
+        emptyRounds = 0;
+        changed = true;
+        std::size_t kept = 0;
+        for (std::size_t i = 0 ; i < n ; ++i)
+            if (removed[i])
+                si_->freeState(states[i]);
+            else
+                states[kept++] = states[i];
+        states.resize(kept);
+    }
+    return changed;
+}
+
+bool ompl::app::ParallelPathSimplifier::checkPath(const geometric::PathGeometric &path, std::size_t *firstInvalid) const
+{
+    const std::vector<base::State*> &states = path.getStates();
+    if (states.empty())
+        return true;
+
+    // item 0 is the first vertex; the items of segment i end at offset[i + 1]
+    std::vector<std::size_t> offset(states.size(), 1);
+    for (std::size_t i = 1 ; i < states.size() ; ++i)
+        offset[i] = offset[i - 1] + std::max(1u, si_->getStateSpace()->validSegmentCount(states[i - 1], states[i]));
+
+    std::vector<bool> valid;
+    parallelBatch(offset.back(), numThreads_, valid, [this, &states, &offset](std::size_t begin, std::size_t end, char *result)
+        {
+            std::function<bool(const base::State*)> isValid = allocChecker();
+            base::State *scratch = si_->allocState();
+            for (std::size_t item = begin ; item < end ; ++item)
+            {
+                if (item == 0)
+                {
+                    result[item] = isValid(states[0]) ? 1 : 0;
+                    continue;
+                }
+                const std::size_t i = std::upper_bound(offset.begin(), offset.end(), item) - offset.begin();
+                const std::size_t count = offset[i] - offset[i - 1];
+                const std::size_t k = item - offset[i - 1] + 1;
+                const base::State *state = states[i];
+                if (k < count)
+                {
+                    si_->getStateSpace()->interpolate(states[i - 1], states[i], (double)k / (double)count, scratch);
+                    state = scratch;
+                }
+                result[item] = isValid(state) ? 1 : 0;
+            }
+            si_->freeState(scratch);
+        });
+
+    for (std::size_t item = 0 ; item < valid.size() ; ++item)
+        if (!valid[item])
+        {
+            if (firstInvalid != nullptr)
+                *firstInvalid = item == 0 ? 0 : std::upper_bound(offset.begin(), offset.end(), item) - offset.begin() - 1;
+            return false;
+        }
+    return true;
+}
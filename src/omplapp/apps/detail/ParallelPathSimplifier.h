@@ -0,0 +1,133 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_APPS_DETAIL_PARALLEL_PATH_SIMPLIFIER_
+#define OMPLAPP_APPS_DETAIL_PARALLEL_PATH_SIMPLIFIER_
+
+#include <ompl/base/PlannerTerminationCondition.h>
+#include <ompl/base/SpaceInformation.h>
+#include <ompl/geometric/PathGeometric.h>
+#include <algorithm>
+#include <functional>
+
+namespace ompl
+{
+    namespace app
+    {
+        /** \brief Shortcut and validate geometric paths with the motion
+            checks spread over several threads. This is the parallel
+            counterpart of geometric::PathSimplifier::reduceVertices():
+            every round, a batch of random shortcuts between vertices of
+            the path is checked concurrently, and the valid shortcuts that
+            save the most length and do not overlap are applied at once.
+
+            Motions are checked at the resolution of the state space (see
+            base::StateSpace::validSegmentCount()), with one state validity
+            check per interpolated state. If a checker allocator is given,
+            every thread allocates its own checker with it (such as
+            RigidBodyGeometry::allocSequenceChecker()), so the threads do
+            not share query objects; otherwise motions are checked with
+            base::SpaceInformation::checkMotion(), which must then be safe
+            to call concurrently. */
+        class ParallelPathSimplifier
+        {
+        public:
+            /** \brief Allocate a state validity check for one thread */
+            using CheckerAllocator = std::function<std::function<bool(const base::State*)>()>;
+
+            ParallelPathSimplifier(const base::SpaceInformationPtr &si, CheckerAllocator allocChecker = CheckerAllocator(),
+                                   unsigned int numThreads = 0);
+
+            /** \brief Set the number of threads (zero for one per core) */
+            void setThreadCount(unsigned int numThreads)
+            {
+                numThreads_ = numThreads;
+            }
+
+            unsigned int getThreadCount() const
+            {
+                return numThreads_;
+            }
+
+            /** \brief Set the number of shortcuts checked per round */
+            void setCandidateCount(unsigned int candidates)
+            {
+                candidates_ = std::max(1u, candidates);
+            }
+
+            unsigned int getCandidateCount() const
+            {
+                return candidates_;
+            }
+
+            /** \brief Set the number of consecutive rounds without a valid
+                shortcut after which shortcutPath() stops */
+            void setMaxEmptyRounds(unsigned int rounds)
+            {
+                maxEmptyRounds_ = std::max(1u, rounds);
+            }
+
+            unsigned int getMaxEmptyRounds() const
+            {
+                return maxEmptyRounds_;
+            }
+
+            /** \brief Set the largest number of vertices a shortcut skips,
+                as a fraction of the number of vertices of the path (as in
+                geometric::PathSimplifier::reduceVertices()) */
+            void setRangeRatio(double ratio)
+            {
+                rangeRatio_ = ratio;
+            }
+
+            double getRangeRatio() const
+            {
+                return rangeRatio_;
+            }
+
+            /** \brief Remove vertices of \e path by connecting vertices
+                that are further apart, until getMaxEmptyRounds() rounds in
+                a row find no valid shortcut or \e ptc is satisfied. Returns
+                true if the path was changed. */
+            bool shortcutPath(geometric::PathGeometric &path, const base::PlannerTerminationCondition &ptc);
+
+            /** \brief Same as above, for at most \e maxTime seconds */
+            bool shortcutPath(geometric::PathGeometric &path, double maxTime = 1.0)
+            {
+                return shortcutPath(path, base::timedPlannerTerminationCondition(maxTime));
+            }
+
+            /** \brief Check the vertices of \e path and the states
+                interpolated between them. Returns true if all are valid;
+                otherwise, if \e firstInvalid is not nullptr, it is set to
+                the index of the first segment with an invalid state
+                (segment i ends at vertex i + 1; segment 0 also covers the
+                first vertex). */
+            bool checkPath(const geometric::PathGeometric &path, std::size_t *firstInvalid = nullptr) const;
+
+        private:
+            /** \brief A check for one thread, or si->checkMotion() if empty */
+            std::function<bool(const base::State*)> allocChecker() const;
+
+            /** \brief Check the motion from \e s1 to \e s2, not including \e s1 */
+            bool checkMotion(const std::function<bool(const base::State*)> &isValid, const base::State *s1,
+                             const base::State *s2, base::State *scratch) const;
+
+            base::SpaceInformationPtr si_;
+            CheckerAllocator          allocChecker_;
+            unsigned int              numThreads_;
+            unsigned int              candidates_{256};
+            unsigned int              maxEmptyRounds_{3};
+            double                    rangeRatio_{0.33};
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,439 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_APPS_DETAIL_POSE_NEAREST_NEIGHBORS_
+#define OMPLAPP_APPS_DETAIL_POSE_NEAREST_NEIGHBORS_
+
+#include "omplapp/geometry/GeometrySpecification.h"
+#include <ompl/base/spaces/SE2StateSpace.h>
+#include <ompl/base/spaces/SE3StateSpace.h>
+#include <ompl/datastructures/NearestNeighbors.h>
+#include <ompl/util/Exception.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace ompl
+{
+    namespace app
+    {
+        /** \brief Where PoseNearestNeighbors finds the positions of the
+            robot parts in a state. The distance between two states must be
+            at least \e scale times the Euclidean distance between the
+            positions of all parts, stacked into one vector; for the apps,
+            \e scale is the smallest weight of a translation in the state
+            space. PoseNearestNeighbors takes the layout that is current()
+            in the thread that constructs it, since planners construct their
+            nearest neighbor structures without arguments (see
+            Scope). */
+        struct PoseLayout
+        {
+            GeometricStateExtractor extract;
+            MotionModel             mtype{Motion_3D};
+            /** \brief The number of robot parts, zero for no positions */
+            unsigned int            parts{0};
+            double                  scale{0.0};
+
+            /** \brief The number of coordinates of the stacked positions */
+            unsigned int dimension() const
+            {
+                return parts * (mtype == Motion_2D ? 2 : 3);
+            }
+
+            /** \brief The layout used by PoseNearestNeighbors constructed in this thread */
+            static PoseLayout& current()
+            {
+                static thread_local PoseLayout layout;
+                return layout;
+            }
+
+            class Scope;
+        };
+
+        /** \brief Make a layout current() while this object exists */
+        class PoseLayout::Scope
+        {
+        public:
+            explicit Scope(PoseLayout layout) : previous_(std::move(current()))
+            {
+                current() = std::move(layout);
+            }
+
+            ~Scope()
+            {
+                current() = std::move(previous_);
+            }
+
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+
+        private:
+            PoseLayout previous_;
+        };
+
+        /** \brief Nearest neighbors of the motions of a planner whose
+            motions keep their state in a member \c state, such as RRT and
+            RRTConnect. The positions of the robot parts are kept in one
+            flat array and indexed by a k-d tree. Since the distance of two
+            states is at least PoseLayout::scale times the distance of their
+            positions, a subtree or a motion whose positions are too far
+            away is skipped without evaluating the distance function; the
+            rotations and any other components are only compared for the
+            remaining candidates. The results are exact, provided the
+            distance function is the distance of the state space. The tree
+            is rebuilt when a quarter of the motions were added after the
+            last build, and those motions are scanned linearly until then.
+            Removing a motion from the tree only marks it as removed; the
+            tree is rebuilt without the removed motions once a quarter of
+            its motions are removed. Without a PoseLayout, every query is a
+            linear scan. */
+        template<typename _T>
+        class PoseNearestNeighbors : public NearestNeighbors<_T>
+        {
+        public:
+            PoseNearestNeighbors() : layout_(PoseLayout::current()), dim_(layout_.dimension())
+            {
+            }
+
+            ~PoseNearestNeighbors() override = default;
+
+            bool reportsSortedResults() const override
+            {
+                return true;
+            }
+
+            void clear() override
+            {
+                data_.clear();
+                keys_.clear();
+                removed_.clear();
+                order_.clear();
+                nodes_.clear();
+                built_ = 0;
+                removedCount_ = 0;
+            }
+
+            void add(const _T &data) override
+            {
+                data_.push_back(data);
+                removed_.push_back(false);
+                keys_.resize(data_.size() * dim_);
+                computeKey(data, keys_.data() + (data_.size() - 1) * dim_);
+                if (dim_ > 0 && data_.size() - built_ > (built_ / 4 > MIN_UNINDEXED ? built_ / 4 : MIN_UNINDEXED))
+                    build();
+            }
+
+            void add(const std::vector<_T> &data) override
+            {
+                for (const auto &d : data)
+                {
+                    data_.push_back(d);
+                    removed_.push_back(false);
+                    keys_.resize(data_.size() * dim_);
+                    computeKey(d, keys_.data() + (data_.size() - 1) * dim_);
+                }
+                build();
+            }
+
+            bool remove(const _T &data) override
+            {
+                std::size_t i = data_.size();
+                while (i > 0 && (removed_[i - 1] || !(data_[i - 1] == data)))
+                    --i;
+                if (i == 0)
+                    return false;
+                --i;
+                if (i >= built_)
+                {
+                    // not in the tree: the linear scan does not keep indices
+                    data_.erase(data_.begin() + i);
+                    removed_.erase(removed_.begin() + i);
+                    keys_.erase(keys_.begin() + i * dim_, keys_.begin() + (i + 1) * dim_);
+                    return true;
+                }
+                removed_[i] = true;
+                if (++removedCount_ > (built_ / 4 > MIN_UNINDEXED ? built_ / 4 : MIN_UNINDEXED))
+                    build();
+                return true;
+            }
+
+            _T nearest(const _T &data) const override
+            {
+                std::vector<_T> nbh;
+                nearestK(data, 1, nbh);
+                if (nbh.empty())
+                    throw Exception("No elements found in nearest neighbors data structure");
+                return nbh[0];
+            }
+
+            void nearestK(const _T &data, std::size_t k, std::vector<_T> &nbh) const override
+            {
+                Query query(*this, data, k, std::numeric_limits<double>::infinity());
+                query.run();
+                query.result(nbh);
+            }
+
+            void nearestR(const _T &data, double radius, std::vector<_T> &nbh) const override
+            {
+                Query query(*this, data, std::numeric_limits<std::size_t>::max(), radius);
+                query.run();
+                query.result(nbh);
+            }
+
+            std::size_t size() const override
+            {
+                return data_.size() - removedCount_;
+            }
+
+            void list(std::vector<_T> &data) const override
+            {
+                data.clear();
+                data.reserve(size());
+                for (std::size_t i = 0 ; i < data_.size() ; ++i)
+                    if (!removed_[i])
+                        data.push_back(data_[i]);
+            }
+
+        protected:
+
+            /** \brief The number of motions added since the last build below which the tree is never rebuilt */
+            static const std::size_t MIN_UNINDEXED = 64;
+
+            /** \brief The largest number of motions in a leaf of the tree */
+            static const std::size_t LEAF_SIZE = 8;
+
+            /** \brief A node of the k-d tree, covering order_[begin, end).
+                Inner nodes split at \e split along \e axis. */
+            struct Node
+            {
+                std::size_t  begin;
+                std::size_t  end;
+                int          axis;
+                double       split;
+                std::size_t  left;
+                std::size_t  right;
+            };
+
+            /** \brief One k nearest or radius query */
+            class Query
+            {
+            public:
+                Query(const PoseNearestNeighbors &nn, const _T &data, std::size_t k, double radius)
+                    : nn_(nn), data_(data), key_(nn.dim_), k_(k), radius_(radius)
+                {
+                    nn_.computeKey(data, key_.data());
+                }
+
+                void run()
+                {
+                    if (k_ == 0)
+                        return;
+                    if (!nn_.nodes_.empty())
+                        visit(0);
+                    for (std::size_t i = nn_.built_ ; i < nn_.data_.size() ; ++i)
+                        consider(i);
+                }
+
+                void result(std::vector<_T> &nbh)
+                {
+                    std::sort_heap(heap_.begin(), heap_.end());
+                    nbh.resize(heap_.size());
+                    for (std::size_t i = 0 ; i < heap_.size() ; ++i)
+                        nbh[i] = nn_.data_[heap_[i].second];
+                }
+
+            private:
+                /** \brief The distance below which a motion is a neighbor */
+                double bound() const
+                {
+                    return heap_.size() < k_ ? radius_ : std::min(radius_, heap_.front().first);
+                }
+
+                void visit(std::size_t n)
+                {
+                    const Node &node = nn_.nodes_[n];
+                    if (node.axis < 0)
+                    {
+                        for (std::size_t j = node.begin ; j < node.end ; ++j)
+                            consider(nn_.order_[j]);
+                        return;
+                    }
+                    const double diff = key_[node.axis] - node.split;
+                    visit(diff < 0.0 ? node.left : node.right);
+                    // the positions on the far side are at least |diff| away
+                    if (nn_.layout_.scale * std::abs(diff) <= bound())
+                        visit(diff < 0.0 ? node.right : node.left);
+                }
+
+                void consider(std::size_t i)
+                {
+                    if (nn_.removed_[i])
+                        return;
+                    const double b = bound();
+                    if (nn_.layout_.scale > 0.0)
+                    {
+                        const double *p = nn_.keys_.data() + i * nn_.dim_;
+                        double d2 = 0.0;
+                        for (unsigned int a = 0 ; a < nn_.dim_ ; ++a)
+                            d2 += (key_[a] - p[a]) * (key_[a] - p[a]);
+                        if (nn_.layout_.scale * std::sqrt(d2) > b)
+                            return;
+                    }
+                    const double d = nn_.distFun_(data_, nn_.data_[i]);
+                    if (d > b)
+                        return;
+                    if (heap_.size() == k_)
+                    {
+                        std::pop_heap(heap_.begin(), heap_.end());
+                        heap_.pop_back();
+                    }
+                    heap_.emplace_back(d, i);
+                    std::push_heap(heap_.begin(), heap_.end());
+                }
+
+                const PoseNearestNeighbors               &nn_;
+                const _T                                 &data_;
+                std::vector<double>                       key_;
+                std::size_t                               k_;
+                double                                    radius_;
+                /** \brief Max-heap of the distances and indices of the neighbors found so far */
+                std::vector<std::pair<double, std::size_t>> heap_;
+            };
+
+            /** \brief Store the stacked positions of the parts at the state of \e data in \e key */
+            void computeKey(const _T &data, double *key) const
+            {
+                for (unsigned int i = 0 ; i < layout_.parts ; ++i)
+                {
+                    const base::State *part = layout_.extract(data->state, i);
+                    if (layout_.mtype == Motion_2D)
+                    {
+                        const auto *se2 = part->as<base::SE2StateSpace::StateType>();
+                        key[2 * i] = se2->getX();
+                        key[2 * i + 1] = se2->getY();
+                    }
+                    else
+                    {
+                        const auto *se3 = part->as<base::SE3StateSpace::StateType>();
+                        key[3 * i] = se3->getX();
+                        key[3 * i + 1] = se3->getY();
+                        key[3 * i + 2] = se3->getZ();
+                    }
+                }
+            }
+
+            /** \brief Drop the removed motions and index the others */
+            void build()
+            {
+                if (removedCount_ > 0)
+                {
+                    std::size_t n = 0;
+                    for (std::size_t i = 0 ; i < data_.size() ; ++i)
+                        if (!removed_[i])
+                        {
+                            if (n != i)
+                            {
+                                data_[n] = data_[i];
+                                std::copy(keys_.begin() + i * dim_, keys_.begin() + (i + 1) * dim_, keys_.begin() + n * dim_);
+                            }
+                            ++n;
+                        }
+                    data_.resize(n);
+                    keys_.resize(n * dim_);
+                    removed_.assign(n, false);
+                    removedCount_ = 0;
+                }
+                order_.resize(data_.size());
+                for (std::size_t i = 0 ; i < order_.size() ; ++i)
+                    order_[i] = i;
+                nodes_.clear();
+                built_ = data_.size();
+                if (built_ > 0 && dim_ > 0)
+                    buildNode(0, built_);
+                else
+                    built_ = 0;
+            }
+
+            /** \brief Build the subtree of order_[begin, end) and return its index */
+            std::size_t buildNode(std::size_t begin, std::size_t end)
+            {
+                const std::size_t n = nodes_.size();
+                nodes_.push_back(Node{begin, end, -1, 0.0, 0, 0});
+                if (end - begin <= LEAF_SIZE)
+                    return n;
+
+                // split the widest axis at the median
+                int axis = 0;
+                double widest = -1.0;
+                for (unsigned int a = 0 ; a < dim_ ; ++a)
+                {
+                    double low = std::numeric_limits<double>::infinity();
+                    double high = -low;
+                    for (std::size_t j = begin ; j < end ; ++j)
+                    {
+                        const double v = keys_[order_[j] * dim_ + a];
+                        low = std::min(low, v);
+                        high = std::max(high, v);
+                    }
+                    if (high - low > widest)
+                    {
+                        widest = high - low;
+                        axis = a;
+                    }
+                }
+                const std::size_t mid = begin + (end - begin) / 2;
+                std::nth_element(order_.begin() + begin, order_.begin() + mid, order_.begin() + end,
+                    [this, axis](std::size_t a, std::size_t b)
+                    {
+                        return keys_[a * dim_ + axis] < keys_[b * dim_ + axis];
+                    });
+                const double split = keys_[order_[mid] * dim_ + axis];
+                const std::size_t left = buildNode(begin, mid);
+                const std::size_t right = buildNode(mid, end);
+                nodes_[n].axis = axis;
+                nodes_[n].split = split;
+                nodes_[n].left = left;
+                nodes_[n].right = right;
+                return n;
+            }
+
+            /** \brief Where the positions are found */
+            PoseLayout               layout_;
+
+            /** \brief The number of coordinates per motion */
+            unsigned int             dim_;
+
+            /** \brief The motions, in the order they were added */
+            std::vector<_T>          data_;
+
+            /** \brief The positions of motion i at keys_[i * dim_], ... */
+            std::vector<double>      keys_;
+
+            /** \brief Whether motion i was removed; only motions in the tree are kept after removal */
+            std::vector<bool>        removed_;
+
+            /** \brief The indices of the indexed motions, ordered by the tree */
+            std::vector<std::size_t> order_;
+
+            /** \brief The k-d tree; the root is the first node */
+            std::vector<Node>        nodes_;
+
+            /** \brief The number of motions in the tree; the rest is scanned linearly */
+            std::size_t              built_{0};
+
+            /** \brief The number of removed motions still in the tree */
+            std::size_t              removedCount_{0};
+        };
+    }
+}
+
+#endif
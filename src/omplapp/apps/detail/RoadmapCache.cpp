@@ -0,0 +1,92 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#include "omplapp/apps/detail/RoadmapCache.h"
+#include <ompl/base/PlannerDataStorage.h>
+#include <ompl/geometric/planners/prm/PRM.h>
+#include <ompl/geometric/planners/prm/LazyPRM.h>
+#include <ompl/util/Console.h>
+#include <boost/crc.hpp>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+    /* The first bytes of every roadmap file, followed by the format version and the key */
+    const char ROADMAP_MAGIC[8] = { 'O', 'A', 'P', 'P', 'R', 'M', 'A', 'P' };
+    const std::uint32_t ROADMAP_VERSION = 1;
+}
+
+std::uint32_t ompl::app::roadmapKey(std::uint32_t geometryChecksum, const base::StateSpacePtr &space)
+{
+    std::stringstream settings;
+    space->printSettings(settings);
+    const std::string str = settings.str();
+    boost::crc_32_type crc;
+    crc.process_bytes(&geometryChecksum, sizeof(geometryChecksum));
+    crc.process_bytes(str.data(), str.size());
+    return crc.checksum();
+}
+
+bool ompl::app::storeRoadmap(const base::PlannerData &data, std::uint32_t key, const std::string &filename)
+{
+    std::ofstream out(filename.c_str(), std::ios::binary);
+    if (!out)
+    {
+        OMPL_ERROR("Unable to open '%s' for writing", filename.c_str());
+        return false;
+    }
+    out.write(ROADMAP_MAGIC, sizeof(ROADMAP_MAGIC));
+    out.write(reinterpret_cast<const char*>(&ROADMAP_VERSION), sizeof(ROADMAP_VERSION));
+    out.write(reinterpret_cast<const char*>(&key), sizeof(key));
+    base::PlannerDataStorage().store(data, out);
+    if (!out)
+    {
+        OMPL_ERROR("Unable to write roadmap to '%s'", filename.c_str());
+        return false;
+    }
+    OMPL_INFORM("Stored roadmap with %u vertices and %u edges in '%s'",
+                data.numVertices(), data.numEdges(), filename.c_str());
+    return true;
+}
+
+bool ompl::app::loadRoadmap(const std::string &filename, std::uint32_t key, base::PlannerData &data)
+{
+    std::ifstream in(filename.c_str(), std::ios::binary);
+    char magic[sizeof(ROADMAP_MAGIC)];
+    std::uint32_t version = 0, storedKey = 0;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(&version), sizeof(version));
+    in.read(reinterpret_cast<char*>(&storedKey), sizeof(storedKey));
+    if (!in || std::memcmp(magic, ROADMAP_MAGIC, sizeof(magic)) != 0 || version != ROADMAP_VERSION)
+    {
+        OMPL_ERROR("'%s' is not a roadmap file", filename.c_str());
+        return false;
+    }
+    if (storedKey != key)
+    {
+        OMPL_WARN("The roadmap in '%s' was computed for a different geometry or state space", filename.c_str());
+        return false;
+    }
+    base::PlannerDataStorage().load(in, data);
+    OMPL_INFORM("Loaded roadmap with %u vertices and %u edges from '%s'",
+                data.numVertices(), data.numEdges(), filename.c_str());
+    return true;
+}
+
+ompl::base::PlannerPtr ompl::app::allocRoadmapPlanner(const base::PlannerData &data, const std::string &name)
+{
+    if (name == "LazyPRM" || name == "LazyPRMstar")
+        return std::make_shared<geometric::LazyPRM>(data, name == "LazyPRMstar");
+    if (name != "PRM" && name != "PRMstar")
+        OMPL_INFORM("Searching the roadmap of %s with PRM", name.c_str());
+    return std::make_shared<geometric::PRM>(data, name == "PRMstar");
+}
@@ -0,0 +1,49 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_APPS_DETAIL_ROADMAP_CACHE_
+#define OMPLAPP_APPS_DETAIL_ROADMAP_CACHE_
+
+#include <ompl/base/Planner.h>
+#include <ompl/base/PlannerData.h>
+#include <ompl/base/StateSpace.h>
+#include <cstdint>
+#include <string>
+
+namespace ompl
+{
+    namespace app
+    {
+        /** \brief Combine \e geometryChecksum (see
+            RigidBodyGeometry::getGeometryChecksum()) with the settings of
+            \e space, including its bounds, into the key stored with a
+            roadmap. A roadmap is only reused for the same key. */
+        std::uint32_t roadmapKey(std::uint32_t geometryChecksum, const base::StateSpacePtr &space);
+
+        /** \brief Write the vertices and edges in \e data to \e filename,
+            after a header containing \e key. The graph is stored in the
+            binary format of base::PlannerDataStorage. Returns false if the
+            file cannot be written. */
+        bool storeRoadmap(const base::PlannerData &data, std::uint32_t key, const std::string &filename);
+
+        /** \brief Read a roadmap written by storeRoadmap() into \e data.
+            Returns false if the file cannot be read or was written for a
+            key other than \e key. */
+        bool loadRoadmap(const std::string &filename, std::uint32_t key, base::PlannerData &data);
+
+        /** \brief Allocate a planner that starts from the roadmap in \e
+            data. \e name selects PRM, PRMstar, LazyPRM, or LazyPRMstar;
+            roadmaps of other planners (such as the sparse roadmap of
+            SPARStwo) are searched with PRM. */
+        base::PlannerPtr allocRoadmapPlanner(const base::PlannerData &data, const std::string &name);
+    }
+}
+
+#endif
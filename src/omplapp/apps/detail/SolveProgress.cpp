@@ -0,0 +1,119 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#include "omplapp/apps/detail/SolveProgress.h"
+#include <ompl/base/PlannerData.h>
+#include <ompl/util/Console.h>
+#include <exception>
+
+ompl::app::SolveProgressTracker::SolveProgressTracker(base::PlannerPtr planner, base::ProblemDefinitionPtr pdef,
+    PositionFn position, SolveProgressCallback callback, double period, bool graph)
+    : planner_(std::move(planner)), pdef_(std::move(pdef)), position_(std::move(position)),
+      callback_(std::move(callback)), period_(period), owner_(std::this_thread::get_id()),
+      start_(ompl::time::now()), last_(start_)
+{
+    // the planner data of multithreaded planners changes while it is read
+    graph_ = graph && planner_ && !planner_->getSpecs().multithreaded;
+    if (graph && !graph_ && planner_)
+        OMPL_DEBUG("%s is multithreaded; only the best cost is reported while it solves", planner_->getName().c_str());
+}
+
+ompl::base::PlannerTerminationCondition ompl::app::SolveProgressTracker::wrap(const base::PlannerTerminationCondition &ptc)
+{
+    return base::PlannerTerminationCondition([this, ptc]
+        {
+            if (ptc())
+                return true;
+            poll();
+            return stopped_.load();
+        });
+}
+
+void ompl::app::SolveProgressTracker::finish()
+{
+    snapshot(true);
+}
+
+void ompl::app::SolveProgressTracker::poll()
+{
+    // other threads of the planner only see whether to stop
+    if (stopped_ || std::this_thread::get_id() != owner_)
+        return;
+    const ompl::time::point now = ompl::time::now();
+    if (ompl::time::seconds(now - last_) < period_)
+        return;
+    last_ = now;
+    snapshot(false);
+}
+
+void ompl::app::SolveProgressTracker::snapshot(bool done)
+{
+    SolveProgress progress;
+    progress.index = index_++;
+    progress.time = ompl::time::seconds(ompl::time::now() - start_);
+    progress.done = done;
+    progress.firstVertex = vertices_.size();
+
+    if (graph_ && planner_)
+    {
+        base::PlannerData data(planner_->getSpaceInformation());
+        planner_->getPlannerData(data);
+        const unsigned int n = data.numVertices();
+        // the indices of the vertices of this planner data among the reported ones
+        std::vector<std::size_t> ids(n);
+        double p[3];
+        for (unsigned int i = 0 ; i < n ; ++i)
+        {
+            const base::State *state = data.getVertex(i).getState();
+            auto it = vertices_.find(state);
+            if (it == vertices_.end())
+            {
+                it = vertices_.emplace(state, vertices_.size()).first;
+                position_(state, p);
+                progress.vertices.insert(progress.vertices.end(), p, p + 3);
+            }
+            ids[i] = it->second;
+        }
+        std::vector<unsigned int> out;
+        for (unsigned int i = 0 ; i < n ; ++i)
+        {
+            data.getEdges(i, out);
+            for (unsigned int j : out)
+                if (edges_.emplace(ids[i], ids[j]).second)
+                {
+                    progress.edges.push_back(ids[i]);
+                    progress.edges.push_back(ids[j]);
+                }
+        }
+    }
+
+    if (pdef_->hasSolution())
+    {
+        const base::PathPtr path = pdef_->getSolutionPath();
+        const base::OptimizationObjectivePtr &objective = pdef_->getOptimizationObjective();
+        progress.hasSolution = true;
+        progress.bestCost = objective ? path->cost(objective).value() : path->length();
+    }
+
+    try
+    {
+        if (!callback_(progress))
+        {
+            if (!done)
+                OMPL_INFORM("Solving stopped by the progress callback after %f seconds", progress.time);
+            stopped_ = true;
+        }
+    }
+    catch (std::exception &e)
+    {
+        OMPL_ERROR("Progress callback failed, stopping: %s", e.what());
+        stopped_ = true;
+    }
+}
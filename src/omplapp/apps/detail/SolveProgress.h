@@ -0,0 +1,119 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_APPS_DETAIL_SOLVE_PROGRESS_
+#define OMPLAPP_APPS_DETAIL_SOLVE_PROGRESS_
+
+#include <ompl/base/Planner.h>
+#include <ompl/base/PlannerTerminationCondition.h>
+#include <ompl/base/ProblemDefinition.h>
+#include <ompl/util/Time.h>
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ompl
+{
+    namespace app
+    {
+        /** \brief A snapshot of a running solve(), see
+            AppBase::setProgressCallback(). Only the vertices and edges
+            added to the planner data since the previous snapshot of the
+            same solve are included, so a client that keeps all snapshots
+            has the whole graph. */
+        struct SolveProgress
+        {
+            /** \brief The number of the snapshot, starting at zero for every solve */
+            unsigned int        index{0};
+            /** \brief Seconds since the start of the solve */
+            double              time{0.0};
+            /** \brief The index of the first new vertex among all vertices of the solve */
+            std::size_t         firstVertex{0};
+            /** \brief x, y, z of the first robot at every new vertex (z is zero for 2D motion models) */
+            std::vector<double> vertices;
+            /** \brief The new edges, as consecutive pairs of vertex indices */
+            std::vector<std::size_t> edges;
+            /** \brief Whether a solution has been found */
+            bool                hasSolution{false};
+            /** \brief The cost of the best solution (its length if there is no optimization objective) */
+            double              bestCost{std::numeric_limits<double>::infinity()};
+            /** \brief Whether this is the last snapshot of the solve */
+            bool                done{false};
+        };
+
+        /** \brief Called with every snapshot; returning false stops the planner */
+        using SolveProgressCallback = std::function<bool(const SolveProgress&)>;
+
+        /** \brief Take snapshots of a planner while it solves, from its
+            termination condition. A snapshot is taken whenever the
+            condition returned by wrap() is evaluated in the thread that
+            created the tracker and at least \e period seconds have passed
+            since the previous one, so the planner data is only read
+            between iterations of the planner. Vertices are recognized by
+            the addresses of their states; edges that the planner removes
+            (as RRT* does when rewiring) are not reported. The planner
+            data of planners that grow their graph in other threads, such
+            as PRM, CForest, or SPARS, cannot be read while they run, so for
+            planners whose specs say they are multithreaded, or if \e graph
+            is false, only the best cost is reported. */
+        class SolveProgressTracker
+        {
+        public:
+            /** \brief Store x, y, z of the first robot at a state */
+            using PositionFn = std::function<void(const base::State*, double*)>;
+
+            SolveProgressTracker(base::PlannerPtr planner, base::ProblemDefinitionPtr pdef, PositionFn position,
+                                 SolveProgressCallback callback, double period, bool graph);
+
+            /** \brief A termination condition that is satisfied when \e ptc
+                is, or once the callback returned false. It must not outlive
+                the tracker. */
+            base::PlannerTerminationCondition wrap(const base::PlannerTerminationCondition &ptc);
+
+            /** \brief Send the last snapshot of the solve */
+            void finish();
+
+            /** \brief Return true if the callback asked to stop */
+            bool stopped() const
+            {
+                return stopped_;
+            }
+
+        private:
+            /** \brief Send a snapshot if it is time for one */
+            void poll();
+
+            /** \brief Send a snapshot of the planner data and the best solution */
+            void snapshot(bool done);
+
+            base::PlannerPtr                               planner_;
+            base::ProblemDefinitionPtr                     pdef_;
+            PositionFn                                     position_;
+            SolveProgressCallback                          callback_;
+            double                                         period_;
+            bool                                           graph_;
+            std::thread::id                                owner_;
+            ompl::time::point                              start_;
+            ompl::time::point                              last_;
+            unsigned int                                   index_{0};
+            std::atomic<bool>                              stopped_{false};
+            // the index of every reported vertex
+            std::unordered_map<const base::State*, std::size_t> vertices_;
+            std::set<std::pair<std::size_t, std::size_t>>  edges_;
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,206 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#include "omplapp/apps/detail/ValidStateReservoir.h"
+#include <ompl/util/Console.h>
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+namespace
+{
+    /* The number of candidate states (or pairs of states) checked at once */
+    const std::size_t RESERVOIR_BATCH = 256;
+}
+
+ompl::app::ValidStateReservoir::ValidStateReservoir(const base::SpaceInformationPtr &si, std::size_t capacity,
+                                                    BatchChecker check, double nearObstacleDistance)
+    : si_(si), check_(std::move(check)), nearObstacleDistance_(nearObstacleDistance), pool_(capacity)
+{
+    si_->allocStates(pool_);
+}
+
+ompl::app::ValidStateReservoir::~ValidStateReservoir()
+{
+    stop();
+    si_->freeStates(pool_);
+}
+
+void ompl::app::ValidStateReservoir::start()
+{
+    std::lock_guard<std::mutex> _(lock_);
+    if (worker_.joinable() || pool_.empty())
+        return;
+    stop_ = false;
+    worker_ = std::thread(&ValidStateReservoir::fill, this);
+}
+
+void ompl::app::ValidStateReservoir::stop()
+{
+    {
+        std::lock_guard<std::mutex> _(lock_);
+        stop_ = true;
+        ready_ = 0;
+    }
+    refill_.notify_all();
+    filled_.notify_all();
+    if (worker_.joinable())
+        worker_.join();
+}
+
+bool ompl::app::ValidStateReservoir::sample(base::State *state)
+{
+    {
+        std::lock_guard<std::mutex> _(lock_);
+        if (ready_ == 0)
+        {
+            ++misses_;
+            return false;
+        }
+        // move the served state past the ready ones, so that the worker overwrites it
+        std::size_t i = rng_.uniformInt(0, (int)ready_ - 1);
+        si_->copyState(state, pool_[i]);
+        std::swap(pool_[i], pool_[--ready_]);
+    }
+    refill_.notify_one();
+    return true;
+}
+
+void ompl::app::ValidStateReservoir::waitFor(std::size_t count)
+{
+    std::unique_lock<std::mutex> l(lock_);
+    count = std::min(count, pool_.size());
+    filled_.wait(l, [this, count] { return stop_ || ready_ >= count; });
+}
+
+std::size_t ompl::app::ValidStateReservoir::size() const
+{
+    std::lock_guard<std::mutex> _(lock_);
+    return ready_;
+}
+
+std::size_t ompl::app::ValidStateReservoir::getMisses() const
+{
+    std::lock_guard<std::mutex> _(lock_);
+    return misses_;
+}
+
+std::size_t ompl::app::ValidStateReservoir::getCheckedCount() const
+{
+    std::lock_guard<std::mutex> _(lock_);
+    return checked_;
+}
+
+void ompl::app::ValidStateReservoir::fill()
+{
+    // state samplers are not thread safe, so the worker has its own
+    base::StateSamplerPtr sampler = si_->allocStateSampler();
+    const bool near = nearObstacleDistance_ > 0.0;
+    std::vector<base::State*> candidates(near ? 2 * RESERVOIR_BATCH : RESERVOIR_BATCH);
+    si_->allocStates(candidates);
+    std::vector<const base::State*> batch;
+    std::vector<bool> valid;
+    std::vector<const base::State*> accepted;
+
+    try
+    {
+        while (true)
+        {
+            std::size_t count;
+            {
+                std::unique_lock<std::mutex> l(lock_);
+                refill_.wait(l, [this] { return stop_ || ready_ < pool_.size(); });
+                if (stop_)
+                    break;
+                count = std::min(RESERVOIR_BATCH, pool_.size() - ready_);
+            }
+
+            // near obstacles, every candidate is followed by one at a Gaussian distance
+            batch.assign(candidates.begin(), candidates.begin() + (near ? 2 * count : count));
+            for (std::size_t i = 0 ; i < count ; ++i)
+                if (near)
+                {
+                    sampler->sampleUniform(candidates[2 * i]);
+                    sampler->sampleGaussian(candidates[2 * i + 1], candidates[2 * i], nearObstacleDistance_);
+                }
+                else
+                    sampler->sampleUniform(candidates[i]);
+            check_(batch, valid);
+
+            accepted.clear();
+            if (near)
+            {
+                for (std::size_t i = 0 ; i < count ; ++i)
+                    if (valid[2 * i] != valid[2 * i + 1])
+                        accepted.push_back(valid[2 * i] ? batch[2 * i] : batch[2 * i + 1]);
+            }
+            else
+            {
+                for (std::size_t i = 0 ; i < count ; ++i)
+                    if (valid[i])
+                        accepted.push_back(batch[i]);
+            }
+
+            {
+                std::lock_guard<std::mutex> _(lock_);
+                // a stopped reservoir stays empty
+                for (const base::State *state : accepted)
+                    if (!stop_ && ready_ < pool_.size())
+                        si_->copyState(pool_[ready_++], state);
+                checked_ += batch.size();
+            }
+            if (!accepted.empty())
+                filled_.notify_all();
+        }
+    }
+    catch (std::exception &e)
+    {
+        OMPL_ERROR("Unable to fill the valid state reservoir: %s", e.what());
+        std::lock_guard<std::mutex> _(lock_);
+        stop_ = true;
+    }
+    filled_.notify_all();
+    si_->freeStates(candidates);
+}
+
+ompl::app::ReservoirValidStateSampler::ReservoirValidStateSampler(const base::SpaceInformation *si,
+                                                                  ValidStateReservoirPtr reservoir)
+    : base::ValidStateSampler(si), reservoir_(std::move(reservoir)), sampler_(si->allocStateSampler())
+{
+    name_ = "reservoir";
+}
+
+bool ompl::app::ReservoirValidStateSampler::sample(base::State *state)
+{
+    if (reservoir_ && reservoir_->sample(state))
+        return true;
+    unsigned int attempts = 0;
+    bool valid = false;
+    do
+    {
+        sampler_->sampleUniform(state);
+        valid = si_->isValid(state);
+        ++attempts;
+    } while (!valid && attempts < attempts_);
+    return valid;
+}
+
+bool ompl::app::ReservoirValidStateSampler::sampleNear(base::State *state, const base::State *near, const double distance)
+{
+    unsigned int attempts = 0;
+    bool valid = false;
+    do
+    {
+        sampler_->sampleUniformNear(state, near, distance);
+        valid = si_->isValid(state);
+        ++attempts;
+    } while (!valid && attempts < attempts_);
+    return valid;
+}
@@ -0,0 +1,130 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_APPS_DETAIL_VALID_STATE_RESERVOIR_
+#define OMPLAPP_APPS_DETAIL_VALID_STATE_RESERVOIR_
+
+#include <ompl/base/SpaceInformation.h>
+#include <ompl/base/ValidStateSampler.h>
+#include <ompl/util/RandomNumbers.h>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ompl
+{
+    namespace app
+    {
+        /** \brief A pool of valid states that is filled by a background
+            thread. Candidate states are sampled in batches and checked
+            with a batch validity check (such as
+            RigidBodyGeometry::isValidBatch()), so that the cost of
+            rejecting invalid samples in narrow passages is paid on other
+            cores. Every state is served once by sample(); the states that
+            were served are replaced in the background. */
+        class ValidStateReservoir
+        {
+        public:
+            /** \brief Check states[i] and set valid[i] */
+            using BatchChecker = std::function<void(const std::vector<const base::State*> &states, std::vector<bool> &valid)>;
+
+            /** \brief Keep up to \e capacity valid states of \e si. If \e
+                nearObstacleDistance is positive, the reservoir only keeps
+                states close to obstacles: candidates are sampled in pairs
+                at a Gaussian distance with that standard deviation, and the
+                valid state of a pair with one invalid state is kept, as in
+                base::GaussianValidStateSampler. Call start() to begin
+                filling the reservoir. */
+            ValidStateReservoir(const base::SpaceInformationPtr &si, std::size_t capacity, BatchChecker check,
+                                double nearObstacleDistance = 0.0);
+
+            ~ValidStateReservoir();
+
+            /** \brief Start the thread that fills the reservoir */
+            void start();
+
+            /** \brief Stop the thread that fills the reservoir and discard
+                its states; sample() fails from then on. */
+            void stop();
+
+            /** \brief Copy a random state of the reservoir to \e state and
+                remove it from the reservoir. Returns false if the reservoir
+                is empty. */
+            bool sample(base::State *state);
+
+            /** \brief Block until the reservoir holds at least \e count
+                states, or until the reservoir is stopped */
+            void waitFor(std::size_t count);
+
+            /** \brief The number of states in the reservoir */
+            std::size_t size() const;
+
+            std::size_t capacity() const
+            {
+                return pool_.size();
+            }
+
+            double getNearObstacleDistance() const
+            {
+                return nearObstacleDistance_;
+            }
+
+            /** \brief The number of calls of sample() that found the reservoir empty */
+            std::size_t getMisses() const;
+
+            /** \brief The number of candidate states checked so far */
+            std::size_t getCheckedCount() const;
+
+        private:
+            void fill();
+
+            base::SpaceInformationPtr     si_;
+            BatchChecker                  check_;
+            double                        nearObstacleDistance_;
+
+            /** \brief pool_[0, ready_) are valid states that have not been served */
+            std::vector<base::State*>     pool_;
+            std::size_t                   ready_{0};
+            std::size_t                   misses_{0};
+            std::size_t                   checked_{0};
+            bool                          stop_{false};
+            RNG                           rng_;
+
+            mutable std::mutex            lock_;
+            std::condition_variable       refill_;
+            std::condition_variable       filled_;
+            std::thread                   worker_;
+        };
+
+        using ValidStateReservoirPtr = std::shared_ptr<ValidStateReservoir>;
+
+        /** \brief A valid state sampler that serves the states of a
+            ValidStateReservoir in constant time. If the reservoir is empty,
+            and for sampleNear(), it samples uniformly like
+            base::UniformValidStateSampler. */
+        class ReservoirValidStateSampler : public base::ValidStateSampler
+        {
+        public:
+            ReservoirValidStateSampler(const base::SpaceInformation *si, ValidStateReservoirPtr reservoir);
+
+            bool sample(base::State *state) override;
+            bool sampleNear(base::State *state, const base::State *near, double distance) override;
+
+        private:
+            ValidStateReservoirPtr reservoir_;
+            base::StateSamplerPtr  sampler_;
+        };
+    }
+}
+
+#endif
@@ -11,14 +11,19 @@
 /* Author: Ioan Sucan */
 
 #include "omplapp/apps/detail/appUtil.h"
+#include "omplapp/geometry/detail/assimpUtil.h"
+#include "omplapp/geometry/detail/SignedDistanceField.h"
 #include <ompl/base/spaces/SE2StateSpace.h>
 #include <ompl/base/spaces/SE3StateSpace.h>
 #include <ompl/control/planners/syclop/GridDecomposition.h>
 #include <ompl/base/objectives/MaximizeMinClearanceObjective.h>
 #include <ompl/base/objectives/MechanicalWorkOptimizationObjective.h>
 #include <ompl/base/objectives/PathLengthOptimizationObjective.h>
+#include <algorithm>
+#include <cmath>
 #include <limits>
 #include <utility>
+#include <vector>
 
 void ompl::app::InferProblemDefinitionBounds(const base::ProblemDefinitionPtr &pdef, const GeometricStateExtractor &se, double factor, double add,
                                              unsigned int robotCount, const base::StateSpacePtr &space, MotionModel mtype)
@@ -94,39 +99,63 @@ namespace ompl
     {
         namespace detail
         {
+            /* Cell sizes for a projection made of the positions of several
+               robots in a space with \e bounds, \e dim coordinates per robot.
+               Every axis is divided into 20 cells, unless \e cellSize is
+               positive; then cells have that size, but every axis has
+               between 5 and 100 cells. */
+            void projectionCellSizes(const base::RealVectorBounds &bounds, unsigned int dim, unsigned int robots, double cellSize,
+                                     base::RealVectorBounds &projectionBounds, std::vector<double> &cellSizes)
+            {
+                const std::vector<double> b = bounds.getDifference();
+                projectionBounds = base::RealVectorBounds(dim * robots);
+                cellSizes.resize(dim * robots);
+                for (unsigned int r = 0 ; r < robots ; ++r)
+                    for (unsigned int k = 0 ; k < dim ; ++k)
+                    {
+                        projectionBounds.setLow(r * dim + k, bounds.low[k]);
+                        projectionBounds.setHigh(r * dim + k, bounds.high[k]);
+                        cellSizes[r * dim + k] = cellSize > 0.0 ? std::max(b[k] / 100.0, std::min(b[k] / 5.0, cellSize)) : b[k] / 20.0;
+                    }
+            }
+
             class GeometricStateProjector2D : public base::ProjectionEvaluator
             {
             public:
 
-                GeometricStateProjector2D(const base::StateSpacePtr &space, const base::StateSpacePtr &gspace, GeometricStateExtractor se) : base::ProjectionEvaluator(space), gm_(gspace->as<base::SE2StateSpace>()), se_(std::move(se))
+                GeometricStateProjector2D(const base::StateSpacePtr &space, const base::StateSpacePtr &gspace, GeometricStateExtractor se,
+                                          unsigned int robots, double cellSize)
+                    : base::ProjectionEvaluator(space), gm_(gspace->as<base::SE2StateSpace>()), se_(std::move(se)),
+                      robots_(std::max(1u, robots)), cellSize_(cellSize)
                 {
                 }
 
                 unsigned int getDimension() const override
                 {
-                    return 2;
+                    return 2 * robots_;
                 }
 
                 void project(const base::State *state, Eigen::Ref<Eigen::VectorXd> projection) const override
                 {
-                    const base::State *gs = se_(state, 0);
-                    projection(0) = gs->as<base::SE2StateSpace::StateType>()->getX();
-                    projection(1) = gs->as<base::SE2StateSpace::StateType>()->getY();
+                    for (unsigned int r = 0 ; r < robots_ ; ++r)
+                    {
+                        const base::State *gs = se_(state, r);
+                        projection(2 * r) = gs->as<base::SE2StateSpace::StateType>()->getX();
+                        projection(2 * r + 1) = gs->as<base::SE2StateSpace::StateType>()->getY();
+                    }
                 }
 
                 void defaultCellSizes() override
                 {
-                    bounds_ = gm_->getBounds();
-                    const std::vector<double> b = bounds_.getDifference();
-                    cellSizes_.resize(2);
-                    cellSizes_[0] = b[0] / 20.0;
-                    cellSizes_[1] = b[1] / 20.0;
+                    projectionCellSizes(gm_->getBounds(), 2, robots_, cellSize_, bounds_, cellSizes_);
                 }
 
             protected:
 
                 const base::SE2StateSpace *gm_;
                 GeometricStateExtractor    se_;
+                unsigned int               robots_;
+                double                     cellSize_;
 
             };
 
@@ -134,37 +163,40 @@ namespace ompl
             {
             public:
 
-                GeometricStateProjector3D(const base::StateSpacePtr &space, const base::StateSpacePtr &gspace, GeometricStateExtractor se) : base::ProjectionEvaluator(space), gm_(gspace->as<base::SE3StateSpace>()), se_(std::move(se))
+                GeometricStateProjector3D(const base::StateSpacePtr &space, const base::StateSpacePtr &gspace, GeometricStateExtractor se,
+                                          unsigned int robots, double cellSize)
+                    : base::ProjectionEvaluator(space), gm_(gspace->as<base::SE3StateSpace>()), se_(std::move(se)),
+                      robots_(std::max(1u, robots)), cellSize_(cellSize)
                 {
                 }
 
                 unsigned int getDimension() const override
                 {
-                    return 3;
+                    return 3 * robots_;
                 }
 
                 void project(const base::State *state, Eigen::Ref<Eigen::VectorXd> projection) const override
                 {
-                    const base::State *gs = se_(state, 0);
-                    projection(0) = gs->as<base::SE3StateSpace::StateType>()->getX();
-                    projection(1) = gs->as<base::SE3StateSpace::StateType>()->getY();
-                    projection(2) = gs->as<base::SE3StateSpace::StateType>()->getZ();
+                    for (unsigned int r = 0 ; r < robots_ ; ++r)
+                    {
+                        const base::State *gs = se_(state, r);
+                        projection(3 * r) = gs->as<base::SE3StateSpace::StateType>()->getX();
+                        projection(3 * r + 1) = gs->as<base::SE3StateSpace::StateType>()->getY();
+                        projection(3 * r + 2) = gs->as<base::SE3StateSpace::StateType>()->getZ();
+                    }
                 }
 
                 void defaultCellSizes() override
                 {
-                    bounds_ = gm_->getBounds();
-                    const std::vector<double> b = bounds_.getDifference();
-                    cellSizes_.resize(3);
-                    cellSizes_[0] = b[0] / 20.0;
-                    cellSizes_[1] = b[1] / 20.0;
-                    cellSizes_[2] = b[2] / 20.0;
+                    projectionCellSizes(gm_->getBounds(), 3, robots_, cellSize_, bounds_, cellSizes_);
                 }
 
             protected:
 
                 const base::SE3StateSpace *gm_;
                 GeometricStateExtractor    se_;
+                unsigned int               robots_;
+                double                     cellSize_;
             };
 
 
@@ -230,16 +262,105 @@ namespace ompl
                 const base::StateSpacePtr space_;
                 const ompl::base::StateSpace::ValueLocation& position_;
             };
+
+            /* A grid decomposition (Decomposition2D or Decomposition3D)
+               whose region volumes are estimates of the free space in the
+               regions: the volume of a region is scaled by the fraction of
+               the points of a finer grid inside it that are outside every
+               obstacle. Syclop computes the weights of regions from their
+               volumes, so leads avoid regions that are filled by obstacles. */
+            template<typename D>
+            class ObstacleAwareDecomposition : public D
+            {
+            public:
+
+                /* z is the height at which a 2D environment is sampled */
+                ObstacleAwareDecomposition(const base::RealVectorBounds &bounds, const base::StateSpacePtr &space,
+                                           const std::vector<aiVector3D> &triangles, double z)
+                    : D(bounds, space), volumes_(D::getNumRegions(), D::getRegionVolume(0))
+                {
+                    if (!triangles.empty())
+                        estimateFreeVolumes(triangles, z);
+                }
+
+                double getRegionVolume(int rid) override
+                {
+                    return volumes_[rid];
+                }
+
+            protected:
+
+                void estimateFreeVolumes(const std::vector<aiVector3D> &triangles, double z)
+                {
+                    const unsigned int dim = D::getDimension();
+                    const unsigned int n = volumes_.size();
+                    const auto regionsPerAxis = (unsigned int)std::lround(std::pow((double)n, 1.0 / dim));
+                    const unsigned int perAxis = regionsPerAxis * SAMPLES_PER_REGION;
+                    const base::RealVectorBounds &bounds = D::getBounds();
+                    const std::vector<double> extent = bounds.getDifference();
+                    const double spacing = *std::min_element(extent.begin(), extent.end()) / perAxis;
+
+                    base::RealVectorBounds triBounds(3);
+                    scene::inferBounds(triBounds, triangles, 1.0, 0.0);
+                    const std::vector<double> b = triBounds.getDifference();
+                    const double triExtent[3] = { b[0], b[1], b[2] };
+                    const SignedDistanceField sdf(triangles, SignedDistanceField::cellSizeFor(triExtent, spacing, spacing, MAX_FIELD_POINTS), spacing);
+
+                    std::vector<unsigned int> free(n, 0), total(n, 0);
+                    std::vector<unsigned int> index(dim, 0);
+                    std::vector<double> coord(dim);
+                    double p[3] = { 0.0, 0.0, z };
+                    while (index[dim - 1] < perAxis)
+                    {
+                        for (unsigned int k = 0 ; k < dim ; ++k)
+                            p[k] = coord[k] = bounds.low[k] + (index[k] + 0.5) * extent[k] / perAxis;
+                        const int rid = D::coordToRegion(coord);
+                        ++total[rid];
+                        if (sdf.distance(p) > 0.0)
+                            ++free[rid];
+
+                        // the next point of the grid, with the first axis varying fastest
+                        for (unsigned int k = 0 ; k < dim && ++index[k] == perAxis && k + 1 < dim ; ++k)
+                            index[k] = 0;
+                    }
+
+                    unsigned int blocked = 0;
+                    for (unsigned int rid = 0 ; rid < n ; ++rid)
+                        if (total[rid] > 0)
+                        {
+                            // regions without free samples keep a small volume, so
+                            // that Syclop can still reach them
+                            const double fraction = (double)free[rid] / total[rid];
+                            volumes_[rid] *= fraction > MIN_FREE_FRACTION ? fraction : MIN_FREE_FRACTION;
+                            if (free[rid] == 0)
+                                ++blocked;
+                        }
+                    OMPL_INFORM("Obstacle-aware decomposition: %u of %u regions are inside obstacles", blocked, n);
+                }
+
+                /* Number of samples per region along every axis */
+                static const unsigned int SAMPLES_PER_REGION = 4;
+
+                /* Largest number of points of the signed distance field */
+                static const std::size_t MAX_FIELD_POINTS = 1 << 22;
+
+                /* Smallest fraction of the volume of a region that is kept */
+                static constexpr double MIN_FREE_FRACTION = 1e-3;
+
+                /* The estimated free volume of every region */
+                std::vector<double> volumes_;
+            };
         }
     }
 }
 
 ompl::base::ProjectionEvaluatorPtr ompl::app::allocGeometricStateProjector(const base::StateSpacePtr &space, MotionModel mtype,
-                                                                           const base::StateSpacePtr &gspace, const GeometricStateExtractor &se)
+                                                                           const base::StateSpacePtr &gspace, const GeometricStateExtractor &se,
+                                                                           unsigned int robotCount, double cellSize)
 {
     if (mtype == Motion_2D)
-        return std::make_shared<detail::GeometricStateProjector2D>(space, gspace, se);
-    return std::make_shared<detail::GeometricStateProjector3D>(space, gspace, se);
+        return std::make_shared<detail::GeometricStateProjector2D>(space, gspace, se, robotCount, cellSize);
+    return std::make_shared<detail::GeometricStateProjector3D>(space, gspace, se, robotCount, cellSize);
 }
 
 ompl::control::DecompositionPtr ompl::app::allocDecomposition(const base::StateSpacePtr &space, MotionModel mtype,
@@ -253,6 +374,56 @@ ompl::control::DecompositionPtr ompl::app::allocDecomposition(const base::StateS
     return std::make_shared<detail::Decomposition3D>(gspace->as<ompl::base::SE3StateSpace>()->getBounds(), space);
 }
 
+ompl::control::DecompositionPtr ompl::app::allocObstacleAwareDecomposition(const base::StateSpacePtr &space, MotionModel mtype,
+    const base::StateSpacePtr &gspace, const GeometrySpecification &geom)
+{
+    const_cast<ompl::base::StateSpace*>(space.get())->computeLocations();
+
+    std::vector<aiVector3D> triangles;
+    for (unsigned int i = 0 ; i < geom.obstacles.size() ; ++i)
+        if (geom.obstacles[i] != nullptr)
+        {
+            scene::IndexedMesh mesh;
+            scene::extractIndexedTriangles(geom.obstacles[i], mesh);
+            const aiVector3D shift = geom.obstaclesShift.size() > i ? geom.obstaclesShift[i] : aiVector3D(0.0, 0.0, 0.0);
+            for (unsigned int index : mesh.indices)
+                triangles.push_back(mesh.vertices[index] - shift);
+        }
+
+    if (mtype == Motion_2D)
+    {
+        // 2D environments are extruded polygons; sample them halfway up
+        double zLow = 0.0, zHigh = 0.0;
+        if (!triangles.empty())
+        {
+            auto z = std::minmax_element(triangles.begin(), triangles.end(),
+                [](const aiVector3D &a, const aiVector3D &b) { return a.z < b.z; });
+            zLow = z.first->z;
+            zHigh = z.second->z;
+        }
+        return std::make_shared<detail::ObstacleAwareDecomposition<detail::Decomposition2D>>(
+            gspace->as<ompl::base::SE2StateSpace>()->getBounds(), space, triangles, (zLow + zHigh) / 2.0);
+    }
+    return std::make_shared<detail::ObstacleAwareDecomposition<detail::Decomposition3D>>(
+        gspace->as<ompl::base::SE3StateSpace>()->getBounds(), space, triangles, 0.0);
+}
+
+void ompl::app::copyStatesToReals(const base::StateSpace &space, const std::vector<base::State*> &states, double *values)
+{
+    const std::vector<base::StateSpace::ValueLocation> &locations = space.getValueLocations();
+    for (const base::State *state : states)
+        for (const auto &location : locations)
+            *values++ = *space.getValueAddressAtLocation(state, location);
+}
+
+void ompl::app::copyRealsToStates(const base::StateSpace &space, const double *values, const std::vector<base::State*> &states)
+{
+    const std::vector<base::StateSpace::ValueLocation> &locations = space.getValueLocations();
+    for (base::State *state : states)
+        for (const auto &location : locations)
+            *space.getValueAddressAtLocation(state, location) = *values++;
+}
+
 ompl::base::OptimizationObjectivePtr ompl::app::getOptimizationObjective(
     const base::SpaceInformationPtr &si, const std::string &objective, double threshold)
 {
@@ -24,14 +24,42 @@ namespace ompl
                                           unsigned int robotCount, const base::StateSpacePtr &space, MotionModel mtype);
         void InferEnvironmentBounds(const base::StateSpacePtr &space, const RigidBodyGeometry &rbg);
 
+        /** \brief Allocate a projection to the positions of the first \e
+            robotCount robots (2 or 3 coordinates each, depending on the
+            MotionModel). Every axis of the bounds of \e gspace is divided
+            into 20 cells, unless \e cellSize is positive; then cells have
+            that size, limited so that every axis has between 5 and 100
+            cells. */
         base::ProjectionEvaluatorPtr allocGeometricStateProjector(const base::StateSpacePtr &space, MotionModel mtype,
-                                                                  const base::StateSpacePtr &gspace, const GeometricStateExtractor &se);
+                                                                  const base::StateSpacePtr &gspace, const GeometricStateExtractor &se,
+                                                                  unsigned int robotCount = 1, double cellSize = 0.0);
 
         /** \brief Allocate a default 2D/3D grid decomposition (depending on the MotionModel)
             for use with the SyclopEST and SyclopRRT planners. */
         control::DecompositionPtr allocDecomposition(const base::StateSpacePtr &space, MotionModel mtype,
             const base::StateSpacePtr &gspace);
 
+        /** \brief Allocate the same grid decomposition as allocDecomposition(),
+            but with region volumes that only count the part of every region
+            outside the obstacles of \e geom, estimated by sampling the
+            signed distance to the environment on a finer grid. Syclop
+            weighs regions by their volume, so its leads avoid regions that
+            are blocked by obstacles. */
+        control::DecompositionPtr allocObstacleAwareDecomposition(const base::StateSpacePtr &space, MotionModel mtype,
+            const base::StateSpacePtr &gspace, const GeometrySpecification &geom);
+
+        /** \brief Store the values of \e states in \e values, one row per
+            state with the values of base::StateSpace::copyToReals(). The
+            locations of the values are looked up once for all states, and
+            no memory is allocated; \e values must have room for
+            states.size() * space.getValueLocations().size() values. The
+            space must be set up. */
+        void copyStatesToReals(const base::StateSpace &space, const std::vector<base::State*> &states, double *values);
+
+        /** \brief The inverse of copyStatesToReals(): set the values of the
+            allocated \e states from the rows of \e values */
+        void copyRealsToStates(const base::StateSpace &space, const double *values, const std::vector<base::State*> &states);
+
         /** \brief Create an optimization objective. The objective name can be:
             "length", "max min clearance", or "mechanical work" */
         ompl::base::OptimizationObjectivePtr getOptimizationObjective(const base::SpaceInformationPtr &si, const std::string &objective, double threshold);
@@ -29,6 +29,29 @@ namespace ompl
 
         using GeometricStateExtractor = std::function<const base::State *(const base::State *, unsigned int)>;
 
+        /// Where the geometric component of every robot part is found in a
+        /// state, for collision checkers specialized on the layout.
+        /// Layout_Generic means only the GeometricStateExtractor knows;
+        /// Layout_RigidBody means the state itself; Layout_FirstComponent
+        /// means the first component of a compound state, for all parts;
+        /// Layout_MultiRigidBody means component i for part i.
+        enum StateLayout { Layout_Generic, Layout_RigidBody, Layout_FirstComponent, Layout_MultiRigidBody };
+
+        /// Summary of the vertices of a mesh, computed once when the mesh is loaded
+        struct MeshBounds
+        {
+            /// Average of all the vertices
+            aiVector3D  center;
+            /// Minimum of the vertex coordinates
+            aiVector3D  low;
+            /// Maximum of the vertex coordinates
+            aiVector3D  high;
+            /// Largest distance between center and a vertex
+            double      radius{0.0};
+            /// Number of vertices
+            std::size_t vertices{0};
+        };
+
         class GeometrySpecification
         {
         public:
@@ -37,9 +60,11 @@ namespace ompl
 
             std::vector<const aiScene *> robot;
             std::vector<aiVector3D>      robotShift;
+            std::vector<MeshBounds>      robotBounds;
 
             std::vector<const aiScene *> obstacles;
             std::vector<aiVector3D>      obstaclesShift;
+            std::vector<MeshBounds>      obstaclesBounds;
         };
 
     }
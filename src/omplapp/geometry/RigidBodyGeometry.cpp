@@ -11,10 +11,269 @@
 /* Author: Ioan Sucan */
 
 #include "omplapp/geometry/RigidBodyGeometry.h"
+#include "omplapp/geometry/detail/ConvexDecomposition.h"
 #if OMPL_HAS_PQP
 #include "omplapp/geometry/detail/PQPStateValidityChecker.h"
 #endif
 #include "omplapp/geometry/detail/FCLStateValidityChecker.h"
+#include "omplapp/geometry/detail/StaticFCLStateValidityChecker.h"
+#include "omplapp/geometry/detail/LazyStateValidityChecker.h"
+#include "omplapp/geometry/detail/PolygonStateValidityChecker.h"
+#include "omplapp/geometry/detail/SDFStateValidityChecker.h"
+#include "omplapp/geometry/detail/ParallelBatch.h"
+#include "omplapp/geometry/detail/Trace.h"
+#include <assimp/Exporter.hpp>
+#include <assimp/config.h>
+#include <algorithm>
+#include <boost/crc.hpp>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+    /* The post-processing applied to every imported mesh */
+    const unsigned int MESH_IMPORT_FLAGS =
+        aiProcess_GenNormals             |
+        aiProcess_Triangulate            |
+        aiProcess_JoinIdenticalVertices  |
+        aiProcess_SortByPType            |
+        aiProcess_OptimizeGraph;
+
+    /* The post-processing applied to meshes imported for collision
+       checking only; everything but the positions is removed early */
+    const unsigned int HEADLESS_IMPORT_FLAGS =
+        aiProcess_RemoveComponent        |
+        aiProcess_Triangulate            |
+        aiProcess_JoinIdenticalVertices  |
+        aiProcess_SortByPType;
+
+    /* The components removed from meshes imported for collision checking only */
+    const int HEADLESS_REMOVED_COMPONENTS =
+        aiComponent_NORMALS | aiComponent_TANGENTS_AND_BITANGENTS | aiComponent_COLORS |
+        aiComponent_TEXCOORDS | aiComponent_BONEWEIGHTS | aiComponent_ANIMATIONS | aiComponent_TEXTURES |
+        aiComponent_LIGHTS | aiComponent_CAMERAS | aiComponent_MATERIALS;
+
+    /* Name of the cache file for a mesh, derived from a checksum of its
+       contents and the post-processing flags */
+    std::string meshCacheKey(const boost::filesystem::path &path, unsigned int flags)
+    {
+        std::ifstream in(path.string().c_str(), std::ios::binary);
+        boost::crc_32_type crc;
+        std::uintmax_t size = 0;
+        char buffer[1 << 16];
+        while (in.read(buffer, sizeof(buffer)) || in.gcount() > 0)
+        {
+            crc.process_bytes(buffer, in.gcount());
+            size += in.gcount();
+        }
+        std::stringstream key;
+        key << std::hex << crc.checksum() << '_' << size << '_' << flags << ".assbin";
+        return key.str();
+    }
+
+    /* The FCL transform of an obstacle at position p and orientation q */
+    ompl::app::FCLMethodWrapper::Transform obstacleTransform(const aiVector3D &p, aiQuaternion q)
+    {
+        using ompl::app::FCLMethodWrapper;
+        q.Normalize();
+#if FCL_MAJOR_VERSION==0 && FCL_MINOR_VERSION<6
+        return FCLMethodWrapper::Transform(FCLMethodWrapper::Quaternion(q.w, q.x, q.y, q.z),
+                                           FCLMethodWrapper::Vector3(p.x, p.y, p.z));
+#else
+        return fcl::Translation3d(p.x, p.y, p.z) * FCLMethodWrapper::Quaternion(q.w, q.x, q.y, q.z);
+#endif
+    }
+
+    /* Add the obstacles of a RigidBodyGeometry to an FCL checker */
+    template <typename Checker, typename Obstacles>
+    void setObstacles(Checker &checker, const Obstacles &obstacles)
+    {
+        for (const auto &obstacle : obstacles)
+        {
+            const ompl::app::FCLMethodWrapper::Transform tf =
+                obstacleTransform(obstacle.second.position, obstacle.second.orientation);
+#if OMPL_HAS_OCTOMAP
+            if (obstacle.second.octree)
+            {
+                checker.setOctreeObstacle(obstacle.first, obstacle.second.octree, tf);
+                continue;
+            }
+#endif
+            checker.setObstacle(obstacle.first, obstacle.second.scene.get(), tf);
+        }
+    }
+
+#if OMPL_HAS_OCTOMAP
+    /* The points of a scan in the form octomap takes */
+    octomap::Pointcloud toPointcloud(const std::vector<aiVector3D> &points)
+    {
+        octomap::Pointcloud cloud;
+        cloud.reserve(points.size());
+        for (const auto &p : points)
+            cloud.push_back(p.x, p.y, p.z);
+        return cloud;
+    }
+#endif
+
+    /* The convex decompositions of the robot parts of geom, in the frames of the parts */
+    std::vector<std::vector<ompl::app::ConvexHull>> robotConvexDecomposition(const ompl::app::GeometrySpecification &geom,
+        double maxConcavity, unsigned int maxHulls, const boost::filesystem::path &cacheDirectory)
+    {
+        std::vector<std::vector<ompl::app::ConvexHull>> hulls;
+        for (std::size_t i = 0; i < geom.robot.size(); ++i)
+        {
+            ompl::app::scene::IndexedMesh mesh;
+            ompl::app::scene::extractIndexedTriangles(geom.robot[i], mesh);
+            const aiVector3D shift = geom.robotShift.size() > i ? geom.robotShift[i] : aiVector3D(0.0, 0.0, 0.0);
+            std::vector<aiVector3D> triangles;
+            triangles.reserve(mesh.indices.size());
+            for (unsigned int index : mesh.indices)
+                triangles.push_back(mesh.vertices[index] - shift);
+            hulls.push_back(ompl::app::getConvexDecomposition(triangles, maxConcavity, maxHulls, cacheDirectory.string()));
+            OMPL_INFORM("Robot piece %u decomposed into %u convex hulls", (unsigned int)i, (unsigned int)hulls.back().size());
+        }
+        return hulls;
+    }
+
+    /* The FCL checker, specialized on the state layout unless it is Layout_Generic */
+    template<ompl::app::MotionModel T>
+    std::shared_ptr<ompl::app::FCLStateValidityChecker<T>> allocFCLStateValidityChecker(ompl::app::StateLayout layout,
+        const ompl::base::SpaceInformationPtr &si, const ompl::app::GeometrySpecification &geom,
+        const ompl::app::GeometricStateExtractor &se, bool selfCollision, bool broadphase, bool singlePrecision)
+    {
+        using namespace ompl::app;
+        switch (layout)
+        {
+            case Layout_RigidBody:
+                return std::make_shared<StaticFCLStateValidityChecker<T, Layout_RigidBody>>(si, geom, se, selfCollision,
+                                                                                           broadphase, singlePrecision);
+            case Layout_FirstComponent:
+                return std::make_shared<StaticFCLStateValidityChecker<T, Layout_FirstComponent>>(si, geom, se, selfCollision,
+                                                                                                broadphase, singlePrecision);
+            case Layout_MultiRigidBody:
+                return std::make_shared<StaticFCLStateValidityChecker<T, Layout_MultiRigidBody>>(si, geom, se, selfCollision,
+                                                                                                broadphase, singlePrecision);
+            default:
+                return std::make_shared<FCLStateValidityChecker<T>>(si, geom, se, selfCollision, broadphase, singlePrecision);
+        }
+    }
+}
+
+boost::filesystem::path ompl::app::RigidBodyGeometry::defaultMeshCacheDirectory()
+{
+    const char *dir = std::getenv("OMPLAPP_MESH_CACHE");
+    return dir != nullptr ? boost::filesystem::path(dir) : boost::filesystem::path();
+}
+
+void ompl::app::RigidBodyGeometry::setMeshCacheDirectory(const boost::filesystem::path &dir)
+{
+    if (!dir.empty() && !boost::filesystem::is_directory(dir))
+    {
+        boost::system::error_code ec;
+        boost::filesystem::create_directories(dir, ec);
+        if (ec)
+            OMPL_WARN("Unable to create mesh cache directory '%s': %s", dir.string().c_str(), ec.message().c_str());
+    }
+    meshCache_ = dir;
+}
+
+const aiScene* ompl::app::RigidBodyGeometry::importMesh(Assimp::Importer &importer, const boost::filesystem::path &path) const
+{
+    ScopedTrace trace("load mesh", "geometry");
+    const unsigned int flags = headlessImport_ ? HEADLESS_IMPORT_FLAGS : MESH_IMPORT_FLAGS;
+    if (headlessImport_)
+        importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS, HEADLESS_REMOVED_COMPONENTS);
+    if (meshCache_.empty() || path.empty() || !boost::filesystem::is_directory(meshCache_))
+        return importer.ReadFile(path.string().c_str(), flags);
+
+    const boost::filesystem::path cached = meshCache_ / meshCacheKey(path, flags);
+    if (boost::filesystem::exists(cached))
+    {
+        // the cached scene has already been post-processed
+        const aiScene *scene = importer.ReadFile(cached.string().c_str(), 0);
+        if (scene != nullptr)
+            return scene;
+        OMPL_WARN("Unable to read cached mesh '%s'. Importing '%s' instead.", cached.string().c_str(), path.string().c_str());
+    }
+
+    const aiScene *scene = importer.ReadFile(path.string().c_str(), flags);
+    if (scene != nullptr)
+    {
+        // write to a temporary file first, so concurrent processes never read a partial file
+        boost::filesystem::path tmp = cached;
+        tmp += boost::filesystem::unique_path(".%%%%-%%%%-%%%%");
+        Assimp::Exporter exporter;
+        boost::system::error_code ec;
+        if (exporter.Export(scene, "assbin", tmp.string()) == AI_SUCCESS)
+            boost::filesystem::rename(tmp, cached, ec);
+        else
+            OMPL_WARN("Unable to cache mesh '%s': %s", path.string().c_str(), exporter.GetErrorString());
+        if (ec)
+            OMPL_WARN("Unable to cache mesh '%s': %s", path.string().c_str(), ec.message().c_str());
+        boost::filesystem::remove(tmp, ec);
+    }
+    return scene;
+}
+
+ompl::app::RigidBodyGeometry::ScenePtr ompl::app::RigidBodyGeometry::loadMesh(const boost::filesystem::path &path) const
+{
+    // Imported scenes are never modified, so all instances loading the same
+    // unmodified file in the same mode share the scene
+    static std::mutex lock;
+    static std::map<std::string, std::weak_ptr<const aiScene> > scenes;
+
+    std::string key;
+    boost::system::error_code ec;
+    if (!path.empty())
+    {
+        std::time_t modified = boost::filesystem::last_write_time(path, ec);
+        if (!ec)
+            key = path.string() + '|' + std::to_string(modified) + (headlessImport_ ? "|headless" : "");
+    }
+
+    if (!key.empty())
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = scenes.find(key);
+        if (it != scenes.end())
+            if (ScenePtr loaded = it->second.lock())
+                return loaded;
+    }
+
+    ScenePtr loaded;
+    if (headlessImport_)
+    {
+        // only the triangles are kept; the importer and its scene are freed on return
+        Assimp::Importer importer;
+        if (const aiScene *imported = importMesh(importer, path))
+            loaded.reset(scene::compactScene(imported));
+    }
+    else
+    {
+        // the scene is owned by its importer
+        auto importer = std::make_shared<Assimp::Importer>();
+        if (const aiScene *imported = importMesh(*importer, path))
+            loaded = ScenePtr(importer, imported);
+    }
+    if (!key.empty() && loaded)
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        for (auto it = scenes.begin() ; it != scenes.end() ; )
+            if (it->second.expired())
+                it = scenes.erase(it);
+            else
+                ++it;
+        scenes[key] = loaded;
+    }
+    return loaded;
+}
 
 boost::filesystem::path ompl::app::RigidBodyGeometry::findMeshFile(const std::string& fname)
 {
@@ -34,7 +293,8 @@ boost::filesystem::path ompl::app::RigidBodyGeometry::findMeshFile(const std::st
 
 bool ompl::app::RigidBodyGeometry::setRobotMesh(const std::string &robot)
 {
-    importerRobot_.clear();
+    robotScenes_.clear();
+    robotBounds_.clear();
     computeGeometrySpecification();
     return addRobotMesh(robot);
 }
@@ -42,35 +302,32 @@ bool ompl::app::RigidBodyGeometry::setRobotMesh(const std::string &robot)
 bool ompl::app::RigidBodyGeometry::addRobotMesh(const std::string &robot)
 {
     assert(!robot.empty());
-    std::size_t p = importerRobot_.size();
-    importerRobot_.resize(p + 1);
-    importerRobot_[p] = std::make_shared<Assimp::Importer>();
+    std::size_t p = robotScenes_.size();
+    robotScenes_.resize(p + 1);
 
     const boost::filesystem::path path = findMeshFile(robot);
     if (path.empty())
         OMPL_ERROR("File '%s' not found in mesh path.", robot.c_str());
-    const aiScene* robotScene = importerRobot_[p]->ReadFile(path.string().c_str(),
-                                                            aiProcess_GenNormals             |
-                                                            aiProcess_Triangulate            |
-                                                            aiProcess_JoinIdenticalVertices  |
-                                                            aiProcess_SortByPType            |
-                                                            aiProcess_OptimizeGraph);
+    robotScenes_[p] = loadMesh(path);
+    const aiScene* robotScene = robotScenes_[p].get();
     if (robotScene != nullptr)
     {
         if (!robotScene->HasMeshes())
         {
             OMPL_ERROR("There is no mesh specified in the indicated robot resource: %s", robot.c_str());
-            importerRobot_.resize(p);
+            robotScenes_.resize(p);
         }
     }
     else
     {
         OMPL_ERROR("Unable to load robot scene: %s", robot.c_str());
-        importerRobot_.resize(p);
+        robotScenes_.resize(p);
     }
 
-    if (p < importerRobot_.size())
+    if (p < robotScenes_.size())
     {
+        robotBounds_.resize(p + 1);
+        scene::computeBounds(robotScene, robotBounds_[p]);
         computeGeometrySpecification();
         return true;
     }
@@ -79,7 +336,8 @@ bool ompl::app::RigidBodyGeometry::addRobotMesh(const std::string &robot)
 
 bool ompl::app::RigidBodyGeometry::setEnvironmentMesh(const std::string &env)
 {
-    importerEnv_.clear();
+    envScenes_.clear();
+    envBounds_.clear();
     computeGeometrySpecification();
     return addEnvironmentMesh(env);
 }
@@ -87,36 +345,33 @@ bool ompl::app::RigidBodyGeometry::setEnvironmentMesh(const std::string &env)
 bool ompl::app::RigidBodyGeometry::addEnvironmentMesh(const std::string &env)
 {
     assert(!env.empty());
-    std::size_t p = importerEnv_.size();
-    importerEnv_.resize(p + 1);
-    importerEnv_[p] = std::make_shared<Assimp::Importer>();
+    std::size_t p = envScenes_.size();
+    envScenes_.resize(p + 1);
 
     const boost::filesystem::path path = findMeshFile(env);
     if (path.empty())
         OMPL_ERROR("File '%s' not found in mesh path.", env.c_str());
-    const aiScene* envScene = importerEnv_[p]->ReadFile(path.string().c_str(),
-                                                        aiProcess_GenNormals             |
-                                                        aiProcess_Triangulate            |
-                                                        aiProcess_JoinIdenticalVertices  |
-                                                        aiProcess_SortByPType            |
-                                                        aiProcess_OptimizeGraph);
+    envScenes_[p] = loadMesh(path);
+    const aiScene* envScene = envScenes_[p].get();
 
     if (envScene != nullptr)
     {
         if (!envScene->HasMeshes())
         {
             OMPL_ERROR("There is no mesh specified in the indicated environment resource: %s", env.c_str());
-            importerEnv_.resize(p);
+            envScenes_.resize(p);
         }
     }
     else
     {
         OMPL_ERROR("Unable to load environment scene: %s", env.c_str());
-        importerEnv_.resize(p);
+        envScenes_.resize(p);
     }
 
-    if (p < importerEnv_.size())
+    if (p < envScenes_.size())
     {
+        envBounds_.resize(p + 1);
+        scene::computeBounds(envScene, envBounds_[p]);
         computeGeometrySpecification();
         return true;
     }
@@ -124,17 +379,69 @@ bool ompl::app::RigidBodyGeometry::addEnvironmentMesh(const std::string &env)
         return false;
 }
 
-ompl::base::RealVectorBounds ompl::app::RigidBodyGeometry::inferEnvironmentBounds() const
+bool ompl::app::RigidBodyGeometry::addEnvironmentMeshes(const std::vector<std::string> &env)
 {
-    base::RealVectorBounds bounds(3);
+    std::vector<boost::filesystem::path> paths;
+    for (const auto &e : env)
+    {
+        assert(!e.empty());
+        paths.push_back(findMeshFile(e));
+        if (paths.back().empty())
+            OMPL_ERROR("File '%s' not found in mesh path.", e.c_str());
+    }
 
-    for (const auto & i : importerEnv_)
+    // every thread imports every n-th file with its own importer
+    std::vector<ScenePtr> scenes(paths.size());
+    const std::size_t n = std::max(1u, std::min(std::thread::hardware_concurrency(), (unsigned int)paths.size()));
+    auto load = [this, &paths, &scenes, n](std::size_t first)
+        {
+            for (std::size_t i = first ; i < paths.size() ; i += n)
+                scenes[i] = loadMesh(paths[i]);
+        };
+    std::vector<std::thread> threads;
+    for (std::size_t t = 1 ; t < n ; ++t)
+        threads.emplace_back(load, t);
+    load(0);
+    for (auto &thread : threads)
+        thread.join();
+
+    bool result = true;
+    for (std::size_t i = 0 ; i < scenes.size() ; ++i)
     {
-        std::vector<aiVector3D> vertices;
-        scene::extractVertices(i->GetScene(), vertices);
-        scene::inferBounds(bounds, vertices, factor_, add_);
+        const aiScene* envScene = scenes[i].get();
+        if (envScene == nullptr)
+            OMPL_ERROR("Unable to load environment scene: %s", env[i].c_str());
+        else if (!envScene->HasMeshes())
+            OMPL_ERROR("There is no mesh specified in the indicated environment resource: %s", env[i].c_str());
+        else
+        {
+            envScenes_.push_back(scenes[i]);
+            envBounds_.emplace_back();
+            scene::computeBounds(envScene, envBounds_.back());
+            continue;
+        }
+        result = false;
     }
 
+    computeGeometrySpecification();
+    return result;
+}
+
+ompl::base::RealVectorBounds ompl::app::RigidBodyGeometry::inferEnvironmentBounds() const
+{
+    base::RealVectorBounds bounds(3);
+
+    // the bounding box of all the environment meshes
+    const float inf = std::numeric_limits<float>::infinity();
+    aiVector3D low(inf, inf, inf), high(-inf, -inf, -inf);
+    for (const auto & b : envBounds_)
+        for (unsigned int k = 0 ; k < 3 ; ++k)
+        {
+            low[k] = std::min(low[k], b.low[k]);
+            high[k] = std::max(high[k], b.high[k]);
+        }
+    scene::inferBounds(bounds, low, high, factor_, add_);
+
     if (mtype_ == Motion_2D)
     {
         bounds.low.resize(2);
@@ -149,6 +456,43 @@ const ompl::app::GeometrySpecification& ompl::app::RigidBodyGeometry::getGeometr
     return geom_;
 }
 
+std::uint32_t ompl::app::RigidBodyGeometry::getGeometryChecksum() const
+{
+    boost::crc_32_type crc;
+    scene::IndexedMesh mesh;
+    auto process = [&crc, &mesh](const aiScene *s)
+        {
+            scene::extractIndexedTriangles(s, mesh);
+            crc.process_bytes(mesh.vertices.data(), mesh.vertices.size() * sizeof(aiVector3D));
+            crc.process_bytes(mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+        };
+
+    crc.process_bytes(&mtype_, sizeof(mtype_));
+    for (const auto *s : geom_.obstacles)
+        process(s);
+    for (const auto *s : geom_.robot)
+        process(s);
+    crc.process_bytes(geom_.obstaclesShift.data(), geom_.obstaclesShift.size() * sizeof(aiVector3D));
+    crc.process_bytes(geom_.robotShift.data(), geom_.robotShift.size() * sizeof(aiVector3D));
+    for (const auto &obstacle : obstacles_)
+    {
+        if (obstacle.second.scene)
+            process(obstacle.second.scene.get());
+#if OMPL_HAS_OCTOMAP
+        if (obstacle.second.octree)
+        {
+            std::stringstream tree;
+            obstacle.second.octree->writeBinaryConst(tree);
+            const std::string bytes = tree.str();
+            crc.process_bytes(bytes.data(), bytes.size());
+        }
+#endif
+        crc.process_bytes(&obstacle.second.position, sizeof(aiVector3D));
+        crc.process_bytes(&obstacle.second.orientation, sizeof(aiQuaternion));
+    }
+    return crc.checksum();
+}
+
 void ompl::app::RigidBodyGeometry::computeGeometrySpecification()
 {
     validitySvc_.reset();
@@ -156,13 +500,15 @@ void ompl::app::RigidBodyGeometry::computeGeometrySpecification()
     geom_.obstaclesShift.clear();
     geom_.robot.clear();
     geom_.robotShift.clear();
+    geom_.obstaclesBounds = envBounds_;
+    geom_.robotBounds = robotBounds_;
 
-    for (auto & i : importerEnv_)
-        geom_.obstacles.push_back(i->GetScene());
+    for (auto & i : envScenes_)
+        geom_.obstacles.push_back(i.get());
 
-    for (unsigned int i = 0 ; i < importerRobot_.size() ; ++i)
+    for (unsigned int i = 0 ; i < robotScenes_.size() ; ++i)
     {
-        geom_.robot.push_back(importerRobot_[i]->GetScene());
+        geom_.robot.push_back(robotScenes_[i].get());
         aiVector3D c = getRobotCenter(i);
         if (mtype_ == Motion_2D)
             c[2] = 0.0;
@@ -172,12 +518,9 @@ void ompl::app::RigidBodyGeometry::computeGeometrySpecification()
 
 aiVector3D ompl::app::RigidBodyGeometry::getRobotCenter(unsigned int robotIndex) const
 {
-    aiVector3D s(0.0, 0.0, 0.0);
-    if (robotIndex >= importerRobot_.size())
+    if (robotIndex >= robotBounds_.size())
         throw Exception("Robot " + std::to_string(robotIndex) + " not found.");
-
-    scene::sceneCenter(importerRobot_[robotIndex]->GetScene(), s);
-    return s;
+    return robotBounds_[robotIndex].center;
 }
 
 void ompl::app::RigidBodyGeometry::setStateValidityCheckerType (CollisionChecker ctype)
@@ -194,33 +537,304 @@ void ompl::app::RigidBodyGeometry::setStateValidityCheckerType (CollisionChecker
     }
 }
 
+unsigned int ompl::app::RigidBodyGeometry::addObstacle(const std::string &mesh, const aiVector3D &position,
+                                                       const aiQuaternion &orientation)
+{
+    const boost::filesystem::path path = findMeshFile(mesh);
+    if (path.empty())
+        throw Exception("File '" + mesh + "' not found in mesh path.");
+    ScenePtr meshScene = loadMesh(path);
+    const aiScene* scene = meshScene.get();
+    if (scene == nullptr || !scene->HasMeshes())
+        throw Exception("There is no mesh specified in the indicated obstacle resource: " + mesh);
+
+    const unsigned int id = nextObstacle_++;
+    obstacles_[id] = Obstacle{meshScene, position, orientation};
+    const FCLMethodWrapper::Transform tf = obstacleTransform(position, orientation);
+    // a checker that has not been built yet picks up obstacles_ when it is
+    base::StateValidityChecker *checker = getStateValidityCheckerInstance(false);
+    if (auto *fcl2 = dynamic_cast<FCLStateValidityChecker<Motion_2D>*>(checker))
+        fcl2->setObstacle(id, scene, tf);
+    else if (auto *fcl3 = dynamic_cast<FCLStateValidityChecker<Motion_3D>*>(checker))
+        fcl3->setObstacle(id, scene, tf);
+    environmentChanged();
+    return id;
+}
+
+#if OMPL_HAS_OCTOMAP
+unsigned int ompl::app::RigidBodyGeometry::addOctree(const std::shared_ptr<octomap::OcTree> &tree,
+                                                     const aiVector3D &position, const aiQuaternion &orientation)
+{
+    if (!tree)
+        throw Exception("No octree given");
+    const unsigned int id = nextObstacle_++;
+    obstacles_[id] = Obstacle{nullptr, position, orientation, tree};
+    updateOctree(id);
+    return id;
+}
+
+void ompl::app::RigidBodyGeometry::updateOctree(unsigned int id)
+{
+    auto it = obstacles_.find(id);
+    if (it == obstacles_.end() || !it->second.octree)
+        throw Exception("Octree obstacle " + std::to_string(id) + " not found.");
+    const FCLMethodWrapper::Transform tf = obstacleTransform(it->second.position, it->second.orientation);
+    // a checker that has not been built yet picks up obstacles_ when it is
+    base::StateValidityChecker *checker = getStateValidityCheckerInstance(false);
+    if (auto *fcl2 = dynamic_cast<FCLStateValidityChecker<Motion_2D>*>(checker))
+        fcl2->setOctreeObstacle(id, it->second.octree, tf);
+    else if (auto *fcl3 = dynamic_cast<FCLStateValidityChecker<Motion_3D>*>(checker))
+        fcl3->setOctreeObstacle(id, it->second.octree, tf);
+    environmentChanged();
+}
+
+unsigned int ompl::app::RigidBodyGeometry::addPointCloud(const std::vector<aiVector3D> &points, double resolution,
+                                                         const aiVector3D &origin)
+{
+    if (resolution <= 0.0)
+        throw Exception("The resolution of a point cloud must be positive");
+    auto tree = std::make_shared<octomap::OcTree>(resolution);
+    tree->insertPointCloud(toPointcloud(points), octomap::point3d(origin.x, origin.y, origin.z), -1.0, false, true);
+    return addOctree(tree);
+}
+
+void ompl::app::RigidBodyGeometry::updatePointCloud(unsigned int id, const std::vector<aiVector3D> &points,
+                                                    const aiVector3D &origin, bool replace)
+{
+    std::shared_ptr<octomap::OcTree> tree = getOctree(id);
+    if (!tree)
+        throw Exception("Octree obstacle " + std::to_string(id) + " not found.");
+    if (replace)
+        tree->clear();
+    tree->insertPointCloud(toPointcloud(points), octomap::point3d(origin.x, origin.y, origin.z), -1.0, false, true);
+    updateOctree(id);
+}
+
+std::shared_ptr<octomap::OcTree> ompl::app::RigidBodyGeometry::getOctree(unsigned int id) const
+{
+    auto it = obstacles_.find(id);
+    return it == obstacles_.end() ? nullptr : it->second.octree;
+}
+#endif
+
+void ompl::app::RigidBodyGeometry::moveObstacle(unsigned int id, const aiVector3D &position,
+                                                const aiQuaternion &orientation)
+{
+    auto it = obstacles_.find(id);
+    if (it == obstacles_.end())
+        throw Exception("Obstacle " + std::to_string(id) + " not found.");
+    it->second.position = position;
+    it->second.orientation = orientation;
+    const FCLMethodWrapper::Transform tf = obstacleTransform(position, orientation);
+    // a checker that has not been built yet picks up obstacles_ when it is
+    base::StateValidityChecker *checker = getStateValidityCheckerInstance(false);
+    if (auto *fcl2 = dynamic_cast<FCLStateValidityChecker<Motion_2D>*>(checker))
+        fcl2->moveObstacle(id, tf);
+    else if (auto *fcl3 = dynamic_cast<FCLStateValidityChecker<Motion_3D>*>(checker))
+        fcl3->moveObstacle(id, tf);
+    environmentChanged();
+}
+
+void ompl::app::RigidBodyGeometry::removeObstacle(unsigned int id)
+{
+    if (obstacles_.erase(id) == 0)
+        throw Exception("Obstacle " + std::to_string(id) + " not found.");
+    // a checker that has not been built yet picks up obstacles_ when it is
+    base::StateValidityChecker *checker = getStateValidityCheckerInstance(false);
+    if (auto *fcl2 = dynamic_cast<FCLStateValidityChecker<Motion_2D>*>(checker))
+        fcl2->removeObstacle(id);
+    else if (auto *fcl3 = dynamic_cast<FCLStateValidityChecker<Motion_3D>*>(checker))
+        fcl3->removeObstacle(id);
+    environmentChanged();
+}
+
+void ompl::app::RigidBodyGeometry::clearClearanceCache()
+{
+    base::StateValidityChecker *checker = getStateValidityCheckerInstance(false);
+    if (auto *fcl2 = dynamic_cast<FCLStateValidityChecker<Motion_2D>*>(checker))
+        fcl2->clearClearanceCache();
+    else if (auto *fcl3 = dynamic_cast<FCLStateValidityChecker<Motion_3D>*>(checker))
+        fcl3->clearClearanceCache();
+}
+
 const ompl::base::StateValidityCheckerPtr& ompl::app::RigidBodyGeometry::allocStateValidityChecker(const base::SpaceInformationPtr &si, const GeometricStateExtractor &se, bool selfCollision)
 {
     if (validitySvc_)
         return validitySvc_;
 
     GeometrySpecification geom = getGeometrySpecification();
+    if (!lazyChecker_)
+        validitySvc_ = buildStateValidityChecker(ctype_, si, geom, se, selfCollision);
+    else
+    {
+        // the scenes of geom are kept alive until the checker is built,
+        // even if the meshes are replaced in the meantime; the space
+        // information owns the checker, so it is only referenced weakly
+        std::vector<ScenePtr> scenes(envScenes_);
+        scenes.insert(scenes.end(), robotScenes_.begin(), robotScenes_.end());
+        std::weak_ptr<base::SpaceInformation> weakSI(si);
+        const CollisionChecker ctype = ctype_;
+        base::StateValidityCheckerSpecs specs;
+        specs.clearanceComputationType = ctype == SDF ? base::StateValidityCheckerSpecs::BOUNDED_APPROXIMATE :
+            base::StateValidityCheckerSpecs::EXACT;
+        validitySvc_ = std::make_shared<LazyStateValidityChecker>(si,
+            [this, ctype, weakSI, geom, se, selfCollision, scenes]
+            {
+                base::SpaceInformationPtr si = weakSI.lock();
+                if (!si)
+                    throw Exception("The space information of the state validity checker no longer exists");
+                return buildStateValidityChecker(ctype, si, geom, se, selfCollision);
+            }, specs);
+    }
 
-    switch (ctype_)
+    if (!obstacles_.empty() && ctype_ != FCL)
+        OMPL_WARN("Obstacles added with addObstacle() are only checked by the FCL collision checker");
+    if (convexDecomposition_ && ctype_ != FCL)
+        OMPL_WARN("Convex decompositions of the robot are only used by the FCL collision checker");
+
+    return validitySvc_;
+}
+
+ompl::base::StateValidityCheckerPtr ompl::app::RigidBodyGeometry::buildStateValidityChecker(CollisionChecker ctype,
+    const base::SpaceInformationPtr &si, const GeometrySpecification &geom, const GeometricStateExtractor &se, bool selfCollision) const
+{
+    base::StateValidityCheckerPtr svc;
+    switch (ctype)
     {
 #if OMPL_HAS_PQP
         case PQP:
             if (mtype_ == Motion_2D)
-                validitySvc_ = std::make_shared<PQPStateValidityChecker<Motion_2D>>(si, geom, se, selfCollision);
+                svc = std::make_shared<PQPStateValidityChecker<Motion_2D>>(si, geom, se, selfCollision);
             else
-                validitySvc_ = std::make_shared<PQPStateValidityChecker<Motion_3D>>(si, geom, se, selfCollision);
+                svc = std::make_shared<PQPStateValidityChecker<Motion_3D>>(si, geom, se, selfCollision);
             break;
 #endif
         case FCL:
             if (mtype_ == Motion_2D)
-                validitySvc_ = std::make_shared<FCLStateValidityChecker<Motion_2D>>(si, geom, se, selfCollision);
+            {
+                auto checker = allocFCLStateValidityChecker<Motion_2D>(stateLayout_, si, geom, se, selfCollision,
+                                                                          broadphase_, singlePrecision_);
+                if (convexDecomposition_)
+                    checker->setConvexParts(robotConvexDecomposition(geom, maxConcavity_, maxConvexHulls_, meshCache_));
+                if (coarseEnvironment_)
+                    checker->setCoarseEnvironment(true, coarseEnvironmentRatio_);
+                checker->setClearanceCache(clearanceCacheSize_);
+                setObstacles(*checker, obstacles_);
+                svc = checker;
+            }
             else
-                validitySvc_ = std::make_shared<FCLStateValidityChecker<Motion_3D>>(si, geom, se, selfCollision);
+            {
+                auto checker = allocFCLStateValidityChecker<Motion_3D>(stateLayout_, si, geom, se, selfCollision,
+                                                                          broadphase_, singlePrecision_);
+                if (convexDecomposition_)
+                    checker->setConvexParts(robotConvexDecomposition(geom, maxConcavity_, maxConvexHulls_, meshCache_));
+                if (coarseEnvironment_)
+                    checker->setCoarseEnvironment(true, coarseEnvironmentRatio_);
+                checker->setClearanceCache(clearanceCacheSize_);
+                setObstacles(*checker, obstacles_);
+                svc = checker;
+            }
+            break;
+
+        case SDF:
+            if (mtype_ == Motion_2D)
+                svc = std::make_shared<SDFStateValidityChecker<Motion_2D>>(si, geom, se, selfCollision);
+            else
+                svc = std::make_shared<SDFStateValidityChecker<Motion_3D>>(si, geom, se, selfCollision);
+            break;
+
+        case POLYGON:
+            if (mtype_ == Motion_2D)
+                svc = std::make_shared<PolygonStateValidityChecker>(si, geom, se, selfCollision);
+            else
+            {
+                OMPL_WARN("The polygon collision checker is only available for 2D problems. Using FCL instead.");
+                svc = std::make_shared<FCLStateValidityChecker<Motion_3D>>(si, geom, se, selfCollision, broadphase_, singlePrecision_);
+            }
             break;
 
         default:
-            OMPL_ERROR("Unexpected collision checker type (%d) encountered", ctype_);
+            OMPL_ERROR("Unexpected collision checker type (%d) encountered", ctype);
     };
 
-    return validitySvc_;
+    return svc;
+}
+
+ompl::base::StateValidityChecker* ompl::app::RigidBodyGeometry::getStateValidityCheckerInstance(bool build) const
+{
+    const auto *lazy = dynamic_cast<const LazyStateValidityChecker*>(validitySvc_.get());
+    if (lazy == nullptr)
+        return validitySvc_.get();
+    return build || lazy->isBuilt() ? lazy->get().get() : nullptr;
+}
+
+void ompl::app::RigidBodyGeometry::isValidBatch(const std::vector<const base::State*> &states, std::vector<bool> &valid,
+                                                unsigned int numThreads) const
+{
+    if (!validitySvc_)
+        throw Exception("The state validity checker has not been allocated");
+
+    // use the batch interface of the checker, if it has one
+    const base::StateValidityChecker *checker = getStateValidityCheckerInstance(true);
+    if (const auto *fcl2 = dynamic_cast<const FCLStateValidityChecker<Motion_2D>*>(checker))
+        fcl2->isValidBatch(states, valid, numThreads);
+    else if (const auto *fcl3 = dynamic_cast<const FCLStateValidityChecker<Motion_3D>*>(checker))
+        fcl3->isValidBatch(states, valid, numThreads);
+    else if (const auto *sdf2 = dynamic_cast<const SDFStateValidityChecker<Motion_2D>*>(checker))
+        sdf2->isValidBatch(states, valid, numThreads);
+    else if (const auto *sdf3 = dynamic_cast<const SDFStateValidityChecker<Motion_3D>*>(checker))
+        sdf3->isValidBatch(states, valid, numThreads);
+    else if (const auto *polygon = dynamic_cast<const PolygonStateValidityChecker*>(checker))
+        polygon->isValidBatch(states, valid, numThreads);
+    else
+        // all collision checkers of this class can be called concurrently
+        parallelBatch(states.size(), numThreads, valid, [checker, &states](std::size_t begin, std::size_t end, char *result)
+            {
+                for (std::size_t k = begin ; k < end ; ++k)
+                    result[k] = checker->isValid(states[k]) ? 1 : 0;
+            });
+}
+
+void ompl::app::RigidBodyGeometry::clearanceBatch(const std::vector<const base::State*> &states, std::vector<double> &clearance,
+                                                  unsigned int numThreads) const
+{
+    if (!validitySvc_)
+        throw Exception("The state validity checker has not been allocated");
+
+    const base::StateValidityChecker *checker = getStateValidityCheckerInstance(true);
+    clearance.resize(states.size());
+    double *result = clearance.data();
+    parallelFor(states.size(), numThreads, [checker, &states, result](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t k = begin ; k < end ; ++k)
+                result[k] = checker->clearance(states[k]);
+        });
+}
+
+std::function<bool(const ompl::base::State*)> ompl::app::RigidBodyGeometry::allocSequenceChecker() const
+{
+    if (!validitySvc_)
+        return std::function<bool(const base::State*)>();
+    const base::StateValidityCheckerPtr &svc = LazyStateValidityChecker::resolve(validitySvc_);
+    if (const auto *fcl2 = dynamic_cast<const FCLStateValidityChecker<Motion_2D>*>(svc.get()))
+        return fcl2->allocSequenceChecker();
+    if (const auto *fcl3 = dynamic_cast<const FCLStateValidityChecker<Motion_3D>*>(svc.get()))
+        return fcl3->allocSequenceChecker();
+    return [svc](const base::State *state) { return svc->isValid(state); };
+}
+
+ompl::app::CheckerStatistics* ompl::app::RigidBodyGeometry::getCheckerStatistics() const
+{
+    const base::StateValidityChecker *checker = getStateValidityCheckerInstance(true);
+    if (const auto *fcl2 = dynamic_cast<const FCLStateValidityChecker<Motion_2D>*>(checker))
+        return &fcl2->getFCLWrapper()->getStatistics();
+    if (const auto *fcl3 = dynamic_cast<const FCLStateValidityChecker<Motion_3D>*>(checker))
+        return &fcl3->getFCLWrapper()->getStatistics();
+#if OMPL_HAS_PQP
+    if (const auto *pqp2 = dynamic_cast<const PQPStateValidityChecker<Motion_2D>*>(checker))
+        return &pqp2->getStatistics();
+    if (const auto *pqp3 = dynamic_cast<const PQPStateValidityChecker<Motion_3D>*>(checker))
+        return &pqp3->getStatistics();
+#endif
+    return nullptr;
 }
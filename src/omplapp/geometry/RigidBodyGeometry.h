@@ -17,10 +17,16 @@
 #include "omplapp/geometry/GeometrySpecification.h"
 #include <ompl/base/SpaceInformation.h>
 #include <ompl/base/spaces/RealVectorBounds.h>
+#include <functional>
+#include <map>
 #include <memory>
 #include <assimp/scene.h>
 #include <assimp/Importer.hpp>
+#if OMPL_HAS_OCTOMAP
+#include <octomap/OcTree.h>
+#endif
 #include <boost/filesystem.hpp>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -30,14 +36,24 @@ namespace ompl
     /** \brief Namespace containing code specific to OMPL.app */
     namespace app
     {
-        /** \brief Enumeration of the possible collision checker types */
+        /** \brief Enumeration of the possible collision checker types. SDF
+            checks the robot against a precomputed signed distance field of
+            the environment, which is fast but conservative and only
+            suitable for static environments. POLYGON checks the
+            projections of the meshes onto the plane and is only available
+            for 2D problems. */
         enum CollisionChecker
-            { PQP, FCL };
+            { PQP, FCL, SDF, POLYGON };
+
+        class CheckerStatistics;
 
         class RigidBodyGeometry
         {
         public:
 
+            /** \brief An imported scene, which keeps whatever owns it alive */
+            using ScenePtr = std::shared_ptr<const aiScene>;
+
             /** \brief Constructor expects a state space that can represent a rigid body */
             /// \param mtype The motion model (2D or 3D) for the rigid body.
             /// \param ctype The type of collision checker to use for rigid body planning.
@@ -68,17 +84,17 @@ namespace ompl
 
             bool hasEnvironment() const
             {
-                return !importerEnv_.empty();
+                return !envScenes_.empty();
             }
 
             bool hasRobot() const
             {
-                return !importerRobot_.empty();
+                return !robotScenes_.empty();
             }
 
             unsigned int getLoadedRobotCount() const
             {
-                return importerRobot_.size();
+                return robotScenes_.size();
             }
 
             /** \brief Get the robot's center (average of all the vertices of all its parts) */
@@ -94,6 +110,13 @@ namespace ompl
                 env). Returns 1 on success, 0 on failure. */
             virtual bool addEnvironmentMesh(const std::string &env);
 
+            /** \brief Add several files representing parts of the
+                environment (\e env) at once. The files are imported
+                concurrently, and the geometry specification is updated only
+                once, after all files are loaded. Returns true if all files
+                were loaded; files that fail to load are skipped. */
+            virtual bool addEnvironmentMeshes(const std::vector<std::string> &env);
+
              /** \brief This function specifies the name of the CAD
                  file representing the robot (\e robot). Returns 1 on success, 0 on failure. */
             virtual bool setRobotMesh(const std::string &robot);
@@ -105,11 +128,306 @@ namespace ompl
             /** \brief Change the type of collision checking for the rigid body */
             virtual void setStateValidityCheckerType (CollisionChecker ctype);
 
+            /** \brief If \e broadphase is true, the FCL collision checker keeps
+                each mesh of the environment as a separate collision object in a
+                broadphase structure instead of merging all meshes into a single
+                BVH. This is faster for large environments with many disjoint
+                objects. It has no effect on the PQP collision checker. */
+            void setBroadPhaseEnvironment(bool broadphase)
+            {
+                if (broadphase != broadphase_)
+                {
+                    broadphase_ = broadphase;
+                    validitySvc_.reset();
+                }
+            }
+
+            /** \brief Get the value set by setBroadPhaseEnvironment() */
+            bool getBroadPhaseEnvironment() const
+            {
+                return broadphase_;
+            }
+
+            /** \brief If \e singlePrecision is true, the FCL collision checker
+                stores the environment BVH in single precision, which halves
+                its memory. The robot is inflated by a small margin to
+                account for the rounding, so the checks stay conservative.
+                It has no effect with a broadphase environment or on the
+                other collision checkers. */
+            void setSinglePrecision(bool singlePrecision)
+            {
+                if (singlePrecision != singlePrecision_)
+                {
+                    singlePrecision_ = singlePrecision;
+                    validitySvc_.reset();
+                }
+            }
+
+            /** \brief Get the value set by setSinglePrecision() */
+            bool getSinglePrecision() const
+            {
+                return singlePrecision_;
+            }
+
+            /** \brief If \e enable is true, the FCL collision checker replaces
+                every robot part by an approximate convex decomposition of at
+                most \e maxHulls convex pieces when checking the environment,
+                and uses GJK/EPA on the pieces instead of the meshes. Parts are
+                split until the concavity of every piece is below \e
+                maxConcavity times the radius of the part; a piece can add at
+                most that much to the part, so the checks stay conservative.
+                Decompositions are stored in the mesh cache directory (see
+                setMeshCacheDirectory()), if any, and reused. It has no
+                effect on the other collision checkers. */
+            void setConvexDecomposition(bool enable, double maxConcavity = 0.05, unsigned int maxHulls = 16)
+            {
+                if (enable != convexDecomposition_ || maxConcavity != maxConcavity_ || maxHulls != maxConvexHulls_)
+                {
+                    convexDecomposition_ = enable;
+                    maxConcavity_ = maxConcavity;
+                    maxConvexHulls_ = maxHulls;
+                    validitySvc_.reset();
+                }
+            }
+
+            /** \brief Return true if the robot parts are checked as convex pieces, see setConvexDecomposition() */
+            bool getConvexDecomposition() const
+            {
+                return convexDecomposition_;
+            }
+
+            /** \brief Get the concavity limit set by setConvexDecomposition() */
+            double getMaxConcavity() const
+            {
+                return maxConcavity_;
+            }
+
+            /** \brief Get the maximum number of pieces per robot part set by setConvexDecomposition() */
+            unsigned int getMaxConvexHulls() const
+            {
+                return maxConvexHulls_;
+            }
+
+            /** \brief If \e enable is true, the FCL collision checker first
+                tests every robot part against a simplified copy of the
+                environment with about \e ratio times its triangles, and
+                only checks the full environment if the part is close to
+                the copy (see FCLMethodWrapper::setCoarseEnvironment()). The
+                test is conservative, so it does not change which states are
+                valid. It pays off for detailed environments with a lot of
+                free space, such as scans. It has no effect with a broadphase
+                or single precision environment or on the other collision
+                checkers. */
+            void setCoarseEnvironment(bool enable, double ratio = 0.03)
+            {
+                if (enable != coarseEnvironment_ || ratio != coarseEnvironmentRatio_)
+                {
+                    coarseEnvironment_ = enable;
+                    coarseEnvironmentRatio_ = ratio;
+                    validitySvc_.reset();
+                }
+            }
+
+            /** \brief Return true if the coarse environment first pass is enabled, see setCoarseEnvironment() */
+            bool getCoarseEnvironment() const
+            {
+                return coarseEnvironment_;
+            }
+
+            /** \brief Get the triangle ratio set by setCoarseEnvironment() */
+            double getCoarseEnvironmentRatio() const
+            {
+                return coarseEnvironmentRatio_;
+            }
+
+            /** \brief Declare where the geometric components of the robot
+                parts are found in a state. With any layout but
+                Layout_Generic (the default), the FCL collision checker is
+                specialized on the layout (see StaticFCLStateValidityChecker),
+                which saves the callbacks of the GeometricStateExtractor in
+                plain collision queries. The layout must agree with the
+                extractor given to allocStateValidityChecker(). */
+            void setStateLayout(StateLayout layout)
+            {
+                if (layout != stateLayout_)
+                {
+                    stateLayout_ = layout;
+                    validitySvc_.reset();
+                }
+            }
+
+            /** \brief Get the value set by setStateLayout() */
+            StateLayout getStateLayout() const
+            {
+                return stateLayout_;
+            }
+
+            /** \brief If \e lazy is true (the default), allocStateValidityChecker()
+                returns a LazyStateValidityChecker, and the collision models
+                are only built when the first state is checked. Setting up a
+                problem then takes no time, however often the meshes are
+                replaced before planning starts. Code that needs the type of
+                the checker in the space information should look at
+                LazyStateValidityChecker::resolve(). */
+            void setLazyStateValidityChecker(bool lazy)
+            {
+                if (lazy != lazyChecker_)
+                {
+                    lazyChecker_ = lazy;
+                    validitySvc_.reset();
+                }
+            }
+
+            /** \brief Get the value set by setLazyStateValidityChecker() */
+            bool getLazyStateValidityChecker() const
+            {
+                return lazyChecker_;
+            }
+
+            /** \brief Let the FCL collision checker remember the validity
+                and clearance of up to \e entries recently checked states
+                (see ClearanceCache), or disable this if \e entries is zero.
+                This saves distance queries with clearance-based optimization
+                objectives, which ask for the clearance of the same states
+                many times. The cache is emptied when obstacles change. It
+                has no effect on the other collision checkers. */
+            void setClearanceCacheSize(std::size_t entries)
+            {
+                if (entries != clearanceCacheSize_)
+                {
+                    clearanceCacheSize_ = entries;
+                    validitySvc_.reset();
+                }
+            }
+
+            /** \brief Get the value set by setClearanceCacheSize() */
+            std::size_t getClearanceCacheSize() const
+            {
+                return clearanceCacheSize_;
+            }
+
+            /** \brief Forget the validity and clearance of all states
+                remembered by the FCL collision checker, if it was built.
+                Changes made through this class already do this; call it
+                after changing anything else that moves the robot or the
+                environment, such as the meshes of a shared scene. */
+            void clearClearanceCache();
+
+            /** \brief Add the mesh in file \e mesh to the environment as a
+                separate obstacle at \e position and \e orientation, and
+                return its identifier. Unlike addEnvironmentMesh(), this does
+                not rebuild the collision checker: the FCL checker keeps every
+                obstacle as a collision object with its own BVH in a
+                broadphase structure and updates it in place, so planners can
+                replan right after obstacles are added, moved, or removed.
+                Obstacles are ignored by the PQP and SDF checkers and do not
+                change the inferred environment bounds. Throws an Exception
+                if the mesh cannot be loaded. Must not be called while other
+                threads use the checker. */
+            unsigned int addObstacle(const std::string &mesh, const aiVector3D &position,
+                                     const aiQuaternion &orientation = aiQuaternion());
+
+            /** \brief Move the obstacle \e id returned by addObstacle() to
+                \e position and \e orientation */
+            void moveObstacle(unsigned int id, const aiVector3D &position,
+                              const aiQuaternion &orientation = aiQuaternion());
+
+            /** \brief Remove the obstacle \e id returned by addObstacle() */
+            void removeObstacle(unsigned int id);
+
+#if OMPL_HAS_OCTOMAP
+            /** \brief Add the occupied cells of \e tree to the environment
+                as an obstacle at \e position and \e orientation, and return
+                its identifier, which moveObstacle() and removeObstacle()
+                accept like that of addObstacle(). The FCL checker queries the
+                tree directly, without converting it to a mesh. The tree is
+                shared, not copied: after changing it, call updateOctree().
+                Octrees are ignored by the PQP and SDF checkers and do not
+                change the inferred environment bounds. FCL has no continuous
+                collision checking for octrees, so the continuous motion
+                validator checks motions against them at discrete states, at
+                the state validity checking resolution. Must not be called
+                while other threads use the checker. */
+            unsigned int addOctree(const std::shared_ptr<octomap::OcTree> &tree, const aiVector3D &position = aiVector3D(),
+                                   const aiQuaternion &orientation = aiQuaternion());
+
+            /** \brief Make the checker see the changes to the tree of the
+                obstacle \e id added by addOctree() or addPointCloud(). This
+                takes constant time; the caches of the checker are emptied. */
+            void updateOctree(unsigned int id);
+
+            /** \brief Add the points of a depth sensor scan to the
+                environment as an octree with cells of size \e resolution,
+                and return the identifier of the obstacle (see addOctree()).
+                \e points and \e origin, the position of the sensor, are in
+                the frame of the environment. */
+            unsigned int addPointCloud(const std::vector<aiVector3D> &points, double resolution,
+                                       const aiVector3D &origin = aiVector3D());
+
+            /** \brief Insert a new scan into the octree of obstacle \e id. If
+                \e replace is true, the previous scans are forgotten;
+                otherwise the cells along the rays from \e origin to the
+                points become free, and the cells at the points occupied, so
+                the tree follows a changing environment. Only the cells on
+                these rays are touched, so the time depends on the size of
+                the scan rather than the size of the environment. */
+            void updatePointCloud(unsigned int id, const std::vector<aiVector3D> &points, const aiVector3D &origin,
+                                  bool replace = false);
+
+            /** \brief The tree of obstacle \e id, or nullptr if it is not an octree */
+            std::shared_ptr<octomap::OcTree> getOctree(unsigned int id) const;
+#endif
+
+            /** \brief Get the number of obstacles added by addObstacle() */
+            unsigned int getObstacleCount() const
+            {
+                return obstacles_.size();
+            }
+
             /** \brief Allocate default state validity checker using FCL. */
             const base::StateValidityCheckerPtr& allocStateValidityChecker(const base::SpaceInformationPtr &si, const GeometricStateExtractor &se, bool selfCollision);
 
+            /** \brief Check a batch of states with the checker allocated by
+                allocStateValidityChecker(). On return, \e valid[i] is true
+                iff \e states[i] is valid. Roadmap planners and other code
+                that needs many states checked at once can use this to spread
+                the checks over \e numThreads threads (zero selects one
+                thread per core). The FCL checker converts all poses at once
+                and reuses its query objects across the batch. */
+            void isValidBatch(const std::vector<const base::State*> &states, std::vector<bool> &valid,
+                              unsigned int numThreads = 0) const;
+
+            /** \brief Compute the clearance of a batch of states with the
+                checker allocated by allocStateValidityChecker(), spread over
+                \e numThreads threads like isValidBatch(). On return,
+                \e clearance[i] is the clearance of \e states[i]. */
+            void clearanceBatch(const std::vector<const base::State*> &states, std::vector<double> &clearance,
+                                unsigned int numThreads = 0) const;
+
+            /** \brief Return the counters and timers of the checker allocated
+                by allocStateValidityChecker(), or nullptr if there is no
+                checker or it is not instrumented. Collection is disabled
+                until it is enabled on the returned object. */
+            CheckerStatistics* getCheckerStatistics() const;
+
+            /** \brief Return a function that checks states with the checker
+                allocated by allocStateValidityChecker(), meant for checking
+                a sequence of states on one thread (such as the intermediate
+                states of a propagation). The FCL checker reuses its query
+                objects for all states of the sequence; other checkers are
+                called through isValid(). The function is empty if no checker
+                has been allocated. */
+            std::function<bool(const base::State*)> allocSequenceChecker() const;
+
             const GeometrySpecification& getGeometrySpecification() const;
 
+            /** \brief Return a checksum of the triangles of the robot and
+                the environment, including the obstacles added by
+                addObstacle() and their poses. Data computed for one
+                geometry, such as a stored roadmap, can be checked with it
+                before it is reused. */
+            std::uint32_t getGeometryChecksum() const;
+
             /** \brief The bounds of the environment are inferred
                 based on the axis-aligned bounding box for the objects
                 in the environment. The inferred size is multiplied by
@@ -155,12 +473,89 @@ namespace ompl
                 meshPath_ = path;
             }
 
+            /** \brief Set a directory where imported meshes are cached.
+                Importing a mesh with Assimp (including post-processing such
+                as joining identical vertices) can take seconds for large
+                files. With a cache directory set, every imported mesh is
+                also saved there in Assimp's binary format, and later imports
+                of a file with identical contents read the cached copy. An
+                empty path disables the cache. The default is the value of
+                the OMPLAPP_MESH_CACHE environment variable, if set. */
+            void setMeshCacheDirectory(const boost::filesystem::path &dir);
+
+            /** \brief Get the directory set by setMeshCacheDirectory() */
+            const boost::filesystem::path& getMeshCacheDirectory() const
+            {
+                return meshCache_;
+            }
+
+            /** \brief If \e headless is true, meshes loaded from now on are
+                imported for collision checking only, as benchmarks and
+                planning services need them. Assimp neither generates
+                normals nor optimizes the node graph, and drops materials,
+                texture coordinates and colors during the import. The
+                triangles of every mesh are then copied, in world
+                coordinates, into a compact scene (see scene::compactScene()),
+                and the importer is freed. This makes loading faster and
+                keeps less memory per app, but the scenes cannot be rendered
+                as before, so the GUI must not use it. Meshes that are
+                already loaded are not affected. */
+            void setHeadlessMeshImport(bool headless)
+            {
+                headlessImport_ = headless;
+            }
+
+            /** \brief Get the value set by setHeadlessMeshImport() */
+            bool getHeadlessMeshImport() const
+            {
+                return headlessImport_;
+            }
+
         protected:
             /** \brief return absolute path to mesh file if it exists and an empty path otherwise */
             boost::filesystem::path findMeshFile(const std::string& fname);
 
+            /** \brief Return the scene in \e path, or nullptr if it cannot be
+                imported. Scenes are shared by all instances that load the
+                same file in the same mode (see setHeadlessMeshImport()). */
+            ScenePtr loadMesh(const boost::filesystem::path &path) const;
+
+            /** \brief Import the mesh in \e path with \e importer, using the mesh cache if set */
+            const aiScene* importMesh(Assimp::Importer &importer, const boost::filesystem::path &path) const;
+
             void computeGeometrySpecification();
 
+            /** \brief Called after an obstacle was added, moved, or
+                removed, or the tree of an octree obstacle changed (see
+                addObstacle() and addOctree()). The checker has already seen
+                the change; derived classes override this to drop their own
+                results that depend on the environment. */
+            virtual void environmentChanged()
+            {
+            }
+
+            /** \brief Build a state validity checker of type \e ctype for \e geom */
+            base::StateValidityCheckerPtr buildStateValidityChecker(CollisionChecker ctype, const base::SpaceInformationPtr &si,
+                                                                    const GeometrySpecification &geom,
+                                                                    const GeometricStateExtractor &se, bool selfCollision) const;
+
+            /** \brief The checker allocated by allocStateValidityChecker(),
+                without the LazyStateValidityChecker around it. If the
+                checker has not been built yet, it is built if \e build is
+                true, and nullptr is returned otherwise. */
+            base::StateValidityChecker* getStateValidityCheckerInstance(bool build) const;
+
+            /** \brief An obstacle added by addObstacle(), or by addOctree() if it has a tree */
+            struct Obstacle
+            {
+                ScenePtr                          scene;
+                aiVector3D                        position;
+                aiQuaternion                      orientation;
+#if OMPL_HAS_OCTOMAP
+                std::shared_ptr<octomap::OcTree>  octree;
+#endif
+            };
+
             MotionModel         mtype_;
 
             /** \brief The factor to multiply inferred environment bounds by (default 1) */
@@ -169,11 +564,17 @@ namespace ompl
             /** \brief The value to add to inferred environment bounds (default 0) */
             double              add_;
 
-            /** \brief Instance of assimp importer used to load environment */
-            std::vector< std::shared_ptr<Assimp::Importer> > importerEnv_;
+            /** \brief The scenes of the environment */
+            std::vector<ScenePtr>         envScenes_;
+
+            /** \brief The scenes of the robot parts */
+            std::vector<ScenePtr>         robotScenes_;
+
+            /** \brief Bounds of the scenes in envScenes_ */
+            std::vector<MeshBounds>       envBounds_;
 
-            /** \brief Instance of assimp importer used to load robot */
-            std::vector< std::shared_ptr<Assimp::Importer> > importerRobot_;
+            /** \brief Bounds of the scenes in robotScenes_ */
+            std::vector<MeshBounds>       robotBounds_;
 
             /** \brief Object containing mesh data for robot and environment */
             GeometrySpecification         geom_;
@@ -184,10 +585,55 @@ namespace ompl
             /** \brief Value containing the type of collision checking to use */
             CollisionChecker              ctype_;
 
+            /** \brief Whether environment meshes are kept as separate objects for broadphase collision checking */
+            bool                          broadphase_{false};
+
+            /** \brief Whether the FCL environment model is stored in single precision */
+            bool                          singlePrecision_{false};
+
+            /** \brief Whether robot parts are checked as convex pieces */
+            bool                          convexDecomposition_{false};
+
+            /** \brief Concavity limit of the convex decomposition, relative to the radius of a part */
+            double                        maxConcavity_{0.05};
+
+            /** \brief Maximum number of convex pieces per robot part */
+            unsigned int                  maxConvexHulls_{16};
+
+            /** \brief Whether the FCL checker tests a simplified environment first */
+            bool                          coarseEnvironment_{false};
+
+            /** \brief The fraction of the triangles of the environment kept in the simplified copy */
+            double                        coarseEnvironmentRatio_{0.03};
+
+            /** \brief Where the geometric components of the robot parts are found in a state */
+            StateLayout                   stateLayout_{Layout_Generic};
+
+            /** \brief Whether the state validity checker is built on first use */
+            bool                          lazyChecker_{true};
+
+            /** \brief The number of states remembered by the clearance cache of the FCL checker */
+            std::size_t                   clearanceCacheSize_{0};
+
+            /** \brief Obstacles added by addObstacle(), by identifier */
+            std::map<unsigned int, Obstacle> obstacles_;
+
+            /** \brief Identifier of the next obstacle added by addObstacle() */
+            unsigned int                  nextObstacle_{0};
+
             /** \brief Paths to search for mesh files if mesh file names do not correspond to
              * absolute paths */
             std::vector<boost::filesystem::path> meshPath_{OMPLAPP_RESOURCE_DIR};
 
+            /** \brief Directory for cached imported meshes (empty if disabled) */
+            boost::filesystem::path       meshCache_{defaultMeshCacheDirectory()};
+
+            /** \brief Whether meshes are imported for collision checking only */
+            bool                          headlessImport_{false};
+
+        private:
+            static boost::filesystem::path defaultMeshCacheDirectory();
+
         };
 
     }
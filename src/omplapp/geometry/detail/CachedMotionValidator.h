@@ -0,0 +1,174 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_GEOMETRY_DETAIL_CACHED_MOTION_VALIDATOR_
+#define OMPLAPP_GEOMETRY_DETAIL_CACHED_MOTION_VALIDATOR_
+
+#include <ompl/base/MotionValidator.h>
+#include <ompl/base/SpaceInformation.h>
+
+#include "omplapp/geometry/detail/ShardedLRUCache.h"
+#include "omplapp/geometry/detail/Trace.h"
+
+#include <boost/functional/hash.hpp>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace ompl
+{
+    namespace app
+    {
+        /** \brief A motion validator that remembers the outcome of the
+            motions checked by another motion validator. Lazy planners such
+            as LazyPRM check the same edges again in every query in one
+            environment; with this validator, a motion that was checked
+            before costs a table lookup.
+
+            Motions are keyed by the values of both endpoint states (see
+            base::StateSpace::copyToReals()), so only motions between exactly
+            equal states match, in the same direction, and the cache never
+            changes the outcome of a check. For invalid motions, the time of
+            the last valid state is remembered too, and the last valid state
+            is reconstructed by interpolation. At most \e capacity motions
+            are kept; the least recently used ones are dropped first (see
+            ShardedLRUCache), and the cache can be used from several
+            threads. The results are only valid as long
+            as the environment does not change; call clear() after moving
+            obstacles (AppBase does so when its obstacles change). */
+        class CachedMotionValidator : public base::MotionValidator
+        {
+        public:
+            CachedMotionValidator(base::SpaceInformation *si, base::MotionValidatorPtr validator, std::size_t capacity = 65536)
+                : base::MotionValidator(si), validator_(std::move(validator)), cache_(capacity)
+            {
+            }
+
+            CachedMotionValidator(const base::SpaceInformationPtr &si, base::MotionValidatorPtr validator, std::size_t capacity = 65536)
+                : CachedMotionValidator(si.get(), std::move(validator), capacity)
+            {
+            }
+
+            ~CachedMotionValidator() override = default;
+
+            bool checkMotion(const base::State *s1, const base::State *s2) const override
+            {
+                ScopedTrace trace("checkMotion", "checker", Trace::sample());
+                std::vector<double> key;
+                motionKey(s1, s2, key);
+                Result result;
+                bool valid;
+                if (cache_.lookup(key, result))
+                {
+                    ++hits_;
+                    valid = result.valid;
+                }
+                else
+                {
+                    ++misses_;
+                    valid = validator_->checkMotion(s1, s2);
+                    // the time of the last valid state is not known yet
+                    cache_.store(std::move(key), Result{valid, -1.0});
+                }
+                valid ? valid_++ : invalid_++;
+                return valid;
+            }
+
+            bool checkMotion(const base::State *s1, const base::State *s2, std::pair<base::State*, double> &lastValid) const override
+            {
+                ScopedTrace trace("checkMotion", "checker", Trace::sample());
+                std::vector<double> key;
+                motionKey(s1, s2, key);
+                Result result;
+                bool valid;
+                if (cache_.lookup(key, result) && (result.valid || result.time >= 0.0))
+                {
+                    ++hits_;
+                    valid = result.valid;
+                    if (!valid)
+                    {
+                        if (lastValid.first != nullptr)
+                            si_->getStateSpace()->interpolate(s1, s2, result.time, lastValid.first);
+                        lastValid.second = result.time;
+                    }
+                }
+                else
+                {
+                    ++misses_;
+                    valid = validator_->checkMotion(s1, s2, lastValid);
+                    cache_.store(std::move(key), Result{valid, valid ? 1.0 : lastValid.second});
+                }
+                valid ? valid_++ : invalid_++;
+                return valid;
+            }
+
+            /** \brief Get the motion validator whose checks are cached */
+            const base::MotionValidatorPtr& getMotionValidator() const
+            {
+                return validator_;
+            }
+
+            /** \brief Get the maximum number of motions kept */
+            std::size_t getCapacity() const
+            {
+                return cache_.getCapacity();
+            }
+
+            /** \brief Get the number of motions kept */
+            std::size_t size() const
+            {
+                return cache_.size();
+            }
+
+            /** \brief Forget all motions */
+            void clear()
+            {
+                cache_.clear();
+            }
+
+            /** \brief Get the number of checks answered from the cache */
+            std::size_t getHitCount() const
+            {
+                return hits_;
+            }
+
+            /** \brief Get the number of checks passed to the cached motion validator */
+            std::size_t getMissCount() const
+            {
+                return misses_;
+            }
+
+        private:
+            /** \brief The outcome of a motion check */
+            struct Result
+            {
+                bool   valid;
+                // the time of the last valid state of an invalid motion, negative if unknown
+                double time;
+            };
+
+            void motionKey(const base::State *s1, const base::State *s2, std::vector<double> &key) const
+            {
+                std::vector<double> values;
+                si_->getStateSpace()->copyToReals(key, s1);
+                si_->getStateSpace()->copyToReals(values, s2);
+                key.insert(key.end(), values.begin(), values.end());
+            }
+
+            base::MotionValidatorPtr                                                       validator_;
+            ShardedLRUCache<std::vector<double>, Result, boost::hash<std::vector<double>>> cache_;
+            mutable std::atomic<std::size_t>                                               hits_{0};
+            mutable std::atomic<std::size_t>                                               misses_{0};
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,228 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_GEOMETRY_DETAIL_CHECKER_STATISTICS_
+#define OMPLAPP_GEOMETRY_DETAIL_CHECKER_STATISTICS_
+
+#include "omplapp/geometry/detail/PerThread.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ompl
+{
+    namespace app
+    {
+        /** \brief Optional counters and timers for the hot path of the
+            collision checkers. Collection is disabled by default; a
+            disabled instance costs one relaxed atomic load per query.
+
+            Every thread updates its own slot, so threads that check states
+            concurrently do not contend for the same cache lines. The slots
+            are summed when the statistics are read. */
+        class CheckerStatistics
+        {
+        public:
+
+            /** \brief The quantities that are counted */
+            enum Counter
+            {
+                QUERIES,            ///< discrete collision queries
+                COLLISIONS,         ///< discrete collision queries that found a collision
+                NARROWPHASE_TESTS,  ///< mesh-mesh collision tests
+                BV_TESTS,           ///< bounding volume overlap tests (if the collision library reports them)
+                SPHERE_TESTS,       ///< bounding sphere tests of the sphere tree first pass
+                DISTANCE_QUERIES,   ///< mesh-mesh distance queries
+                CCD_QUERIES,        ///< continuous collision queries
+                CCD_TESTS,          ///< mesh-mesh continuous collision tests
+                COARSE_TESTS,       ///< collision tests of the coarse environment first pass
+                COUNTER_COUNT
+            };
+
+            /** \brief The phases of a query that are timed */
+            enum Phase
+            {
+                POSE_CONVERSION,    ///< computing the transforms of the robot parts
+                ENVIRONMENT,        ///< checking the robot against the environment
+                SELF_COLLISION,     ///< checking the robot parts against each other
+                DISTANCE,           ///< clearance computations
+                CONTINUOUS,         ///< continuous collision checking
+                PHASE_COUNT
+            };
+
+            /** \brief The statistics collected by one thread */
+            class Slot
+            {
+            public:
+
+                Slot()
+                {
+                    clear();
+                }
+
+                /** \brief Increase counter \e c by \e n */
+                void add(Counter c, std::uint64_t n = 1)
+                {
+                    // only the owning thread writes to the slot
+                    counters_[c].store(counters_[c].load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+                }
+
+                /** \brief Add \e ns nanoseconds to the time spent in phase \e p */
+                void addTime(Phase p, std::uint64_t ns)
+                {
+                    time_[p].store(time_[p].load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+                }
+
+            private:
+
+                friend class CheckerStatistics;
+
+                void clear()
+                {
+                    for (auto &c : counters_)
+                        c.store(0, std::memory_order_relaxed);
+                    for (auto &t : time_)
+                        t.store(0, std::memory_order_relaxed);
+                }
+
+                std::atomic<std::uint64_t> counters_[COUNTER_COUNT];
+                std::atomic<std::uint64_t> time_[PHASE_COUNT];
+            };
+
+            /** \brief Adds the time between its construction and destruction
+                to a phase. Does nothing if \e slot is nullptr. */
+            class Timer
+            {
+            public:
+
+                Timer(Slot *slot, Phase phase) : slot_(slot), phase_(phase)
+                {
+                    if (slot_ != nullptr)
+                        start_ = std::chrono::steady_clock::now();
+                }
+
+                Timer(const Timer&) = delete;
+                Timer& operator=(const Timer&) = delete;
+
+                ~Timer()
+                {
+                    if (slot_ != nullptr)
+                        slot_->addTime(phase_, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::steady_clock::now() - start_).count());
+                }
+
+            private:
+
+                Slot                                  *slot_;
+                Phase                                  phase_;
+                std::chrono::steady_clock::time_point  start_;
+            };
+
+            CheckerStatistics() = default;
+            CheckerStatistics(const CheckerStatistics&) = delete;
+            CheckerStatistics& operator=(const CheckerStatistics&) = delete;
+
+            /** \brief Enable or disable collection */
+            void setEnabled(bool enabled)
+            {
+                enabled_.store(enabled, std::memory_order_relaxed);
+            }
+
+            /** \brief Return true if statistics are collected */
+            bool isEnabled() const
+            {
+                return enabled_.load(std::memory_order_relaxed);
+            }
+
+            /** \brief Return the slot of the calling thread, or nullptr if
+                collection is disabled. Instrumented code looks the slot up
+                once per query and passes it on. */
+            Slot* slot() const
+            {
+                if (!isEnabled())
+                    return nullptr;
+                bool created;
+                Slot *&slot = slots_.get(&created);
+                if (created)
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    all_.emplace_back(new Slot());
+                    slot = all_.back().get();
+                }
+                return slot;
+            }
+
+            /** \brief Reset all counters and timers. This should only be
+                called while no queries are running. */
+            void clear()
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                for (auto &slot : all_)
+                    slot->clear();
+            }
+
+            /** \brief The value of counter \e c, summed over all threads */
+            std::uint64_t get(Counter c) const
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                std::uint64_t n = 0;
+                for (const auto &slot : all_)
+                    n += slot->counters_[c].load(std::memory_order_relaxed);
+                return n;
+            }
+
+            /** \brief The time in seconds spent in phase \e p, summed over all threads */
+            double getTime(Phase p) const
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                std::uint64_t ns = 0;
+                for (const auto &slot : all_)
+                    ns += slot->time_[p].load(std::memory_order_relaxed);
+                return ns * 1e-9;
+            }
+
+            /** \brief Add all nonzero statistics to \e properties, using the
+                naming convention of ompl::tools::Benchmark run properties */
+            void getProperties(std::map<std::string, std::string> &properties) const
+            {
+                static const char *counters[COUNTER_COUNT] = {
+                    "checker queries", "checker collisions", "checker narrowphase tests", "checker bv tests",
+                    "checker sphere tests", "checker distance queries", "checker ccd queries", "checker ccd tests",
+                    "checker coarse tests" };
+                static const char *phases[PHASE_COUNT] = {
+                    "checker pose conversion time", "checker environment time", "checker self collision time",
+                    "checker distance time", "checker ccd time" };
+                for (int c = 0 ; c < COUNTER_COUNT ; ++c)
+                    if (std::uint64_t n = get((Counter)c))
+                        properties[std::string(counters[c]) + " INTEGER"] = std::to_string(n);
+                for (int p = 0 ; p < PHASE_COUNT ; ++p)
+                {
+                    double t = getTime((Phase)p);
+                    if (t > 0.0)
+                        properties[std::string(phases[p]) + " REAL"] = std::to_string(t);
+                }
+            }
+
+        private:
+
+            std::atomic<bool>                    enabled_{false};
+            PerThread<Slot*>                     slots_;
+            mutable std::mutex                   mutex_;
+            mutable std::vector<std::unique_ptr<Slot>> all_;
+        };
+    }
+}
+
+#endif
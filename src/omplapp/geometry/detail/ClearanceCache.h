@@ -0,0 +1,138 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_GEOMETRY_DETAIL_CLEARANCE_CACHE_
+#define OMPLAPP_GEOMETRY_DETAIL_CLEARANCE_CACHE_
+
+#include <ompl/base/StateSpace.h>
+
+#include "omplapp/geometry/detail/ShardedLRUCache.h"
+
+#include <boost/functional/hash.hpp>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace ompl
+{
+    namespace app
+    {
+        /** \brief The clearance and validity of recently checked states.
+            Clearance-based optimization objectives evaluate the clearance
+            of the same states again and again (when costs are compared,
+            when RRT* rewires, and when the cost of a path is computed), and
+            every evaluation is a distance query against the environment.
+            With this cache, a state that was evaluated before costs a table
+            lookup.
+
+            States are keyed by their values (see
+            base::StateSpace::copyToReals()), not by their addresses, so a
+            state that is freed and reallocated is not mistaken for another,
+            and only exactly equal states match. At most \e capacity states
+            are kept; the least recently used ones are dropped first (see
+            ShardedLRUCache), and the cache can be used from several
+            threads. The entries are only valid as long
+            as the environment does not change; call clear() after changing
+            it. */
+        class ClearanceCache
+        {
+        public:
+            /** \brief What is known about a state */
+            struct Entry
+            {
+                /** \brief The clearance, NaN if not known */
+                double clearance{std::numeric_limits<double>::quiet_NaN()};
+                /** \brief 1 if the state is valid, 0 if not, -1 if not known */
+                int    valid{-1};
+
+                bool hasClearance() const
+                {
+                    return !std::isnan(clearance);
+                }
+            };
+
+            ClearanceCache(base::StateSpacePtr space, std::size_t capacity)
+                : space_(std::move(space)), cache_(capacity)
+            {
+            }
+
+            /** \brief Look up \e state. Returns false if nothing is known about it. */
+            bool lookup(const base::State *state, Entry &entry) const
+            {
+                std::vector<double> key;
+                space_->copyToReals(key, state);
+                if (!cache_.lookup(key, entry))
+                {
+                    ++misses_;
+                    return false;
+                }
+                ++hits_;
+                return true;
+            }
+
+            /** \brief Remember what is known about \e state. Known values
+                of an earlier entry for \e state that \e entry does not know
+                are kept. */
+            void store(const base::State *state, const Entry &entry)
+            {
+                std::vector<double> key;
+                space_->copyToReals(key, state);
+                cache_.store(std::move(key), entry, [](Entry &stored, const Entry &e)
+                    {
+                        if (e.hasClearance())
+                            stored.clearance = e.clearance;
+                        if (e.valid >= 0)
+                            stored.valid = e.valid;
+                    });
+            }
+
+            /** \brief Forget all states */
+            void clear()
+            {
+                cache_.clear();
+            }
+
+            /** \brief Get the maximum number of states kept */
+            std::size_t getCapacity() const
+            {
+                return cache_.getCapacity();
+            }
+
+            /** \brief Get the number of states kept */
+            std::size_t size() const
+            {
+                return cache_.size();
+            }
+
+            /** \brief Get the number of lookups that found the state */
+            std::size_t getHitCount() const
+            {
+                return hits_;
+            }
+
+            /** \brief Get the number of lookups that did not find the state */
+            std::size_t getMissCount() const
+            {
+                return misses_;
+            }
+
+        private:
+            base::StateSpacePtr                                                           space_;
+            ShardedLRUCache<std::vector<double>, Entry, boost::hash<std::vector<double>>> cache_;
+            mutable std::atomic<std::size_t>                                              hits_{0};
+            mutable std::atomic<std::size_t>                                              misses_{0};
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,181 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_GEOMETRY_DETAIL_COHERENCE_CACHE_
+#define OMPLAPP_GEOMETRY_DETAIL_COHERENCE_CACHE_
+
+#include <ompl/base/spaces/SE2StateSpace.h>
+#include <ompl/base/spaces/SE3StateSpace.h>
+#include <ompl/util/Exception.h>
+
+#include "omplapp/geometry/GeometrySpecification.h"
+#include "omplapp/geometry/detail/PerThread.h"
+
+#include <boost/math/constants/constants.hpp>
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+namespace ompl
+{
+    namespace app
+    {
+        /// @cond IGNORE
+        template<MotionModel T>
+        struct CoherencePose
+        {
+            using type = base::SE3StateSpace::StateType;
+
+            /** \brief Number of values stored per pose */
+            static const std::size_t SIZE = 7;
+
+            static void store(const base::State *state, double *pose)
+            {
+                const auto *s = static_cast<const type*>(state);
+                const auto &q = s->rotation();
+                pose[0] = s->getX();
+                pose[1] = s->getY();
+                pose[2] = s->getZ();
+                pose[3] = q.x;
+                pose[4] = q.y;
+                pose[5] = q.z;
+                pose[6] = q.w;
+            }
+
+            /** \brief Upper bound on the distance any point within \e radius
+                of the origin of the part frame moves between \e pose and \e state */
+            static double displacement(const double *pose, const base::State *state, double radius)
+            {
+                const auto *s = static_cast<const type*>(state);
+                const auto &q = s->rotation();
+                const double dx = s->getX() - pose[0], dy = s->getY() - pose[1], dz = s->getZ() - pose[2];
+                const double dot = std::min(1.0, std::fabs(q.x * pose[3] + q.y * pose[4] + q.z * pose[5] + q.w * pose[6]));
+                // a rotation by angle a moves a point at distance r by at most r * a
+                return sqrt(dx * dx + dy * dy + dz * dz) + radius * 2.0 * acos(dot);
+            }
+
+            static double displacement(const base::State *from, const base::State *to, double radius)
+            {
+                double pose[SIZE];
+                store(from, pose);
+                return displacement(pose, to, radius);
+            }
+        };
+
+        template<>
+        struct CoherencePose<Motion_2D>
+        {
+            using type = base::SE2StateSpace::StateType;
+
+            static const std::size_t SIZE = 3;
+
+            static void store(const base::State *state, double *pose)
+            {
+                const auto *s = static_cast<const type*>(state);
+                pose[0] = s->getX();
+                pose[1] = s->getY();
+                pose[2] = s->getYaw();
+            }
+
+            static double displacement(const double *pose, const base::State *state, double radius)
+            {
+                const auto *s = static_cast<const type*>(state);
+                const double dx = s->getX() - pose[0], dy = s->getY() - pose[1];
+                double da = std::fabs(s->getYaw() - pose[2]);
+                if (da > boost::math::constants::pi<double>())
+                    da = 2.0 * boost::math::constants::pi<double>() - da;
+                return sqrt(dx * dx + dy * dy) + radius * da;
+            }
+
+            static double displacement(const base::State *from, const base::State *to, double radius)
+            {
+                double pose[SIZE];
+                store(from, pose);
+                return displacement(pose, to, radius);
+            }
+        };
+        /// @endcond
+
+        /** \brief Cache exploiting the temporal coherence of collision
+            queries. For every thread, the cache remembers the last pose of
+            each robot part that was certified to be at a given distance from
+            the environment. A new pose of a part is known to be free of
+            collisions with the environment if no point of the part can have
+            moved by more than that distance, which is bounded using the
+            radius of the part around its frame origin and the change in
+            pose.
+
+            Only collisions with the environment are covered; self
+            collisions still need to be checked separately. */
+        template<MotionModel T>
+        class CoherenceCache
+        {
+        public:
+
+            /** \brief Constructor. \e partRadii contains, for each robot part,
+                the maximum distance of a point of the part from the origin of
+                its frame. */
+            CoherenceCache(GeometricStateExtractor se, std::vector<double> partRadii)
+                : extractState_(std::move(se)), radii_(std::move(partRadii))
+            {
+            }
+
+            /** \brief Return true if all robot parts at \e state are known to
+                be free of collisions with the environment */
+            bool covers(const base::State *state) const
+            {
+                const Entry &entry = entry_.get();
+                if (entry.clearance.empty())
+                    return false;
+                for (std::size_t i = 0 ; i < radii_.size() ; ++i)
+                    if (CoherencePose<T>::displacement(&entry.pose[i * CoherencePose<T>::SIZE],
+                                                       extractState_(state, i), radii_[i]) >= entry.clearance[i])
+                        return false;
+                return true;
+            }
+
+            /** \brief Remember that at \e state, the distance between robot
+                part \e i and the environment is at least \e clearance[i] */
+            void update(const base::State *state, const std::vector<double> &clearance) const
+            {
+                if (clearance.size() != radii_.size())
+                    throw Exception("Number of clearance values does not match the number of robot parts");
+                Entry &entry = entry_.get();
+                entry.pose.resize(radii_.size() * CoherencePose<T>::SIZE);
+                for (std::size_t i = 0 ; i < radii_.size() ; ++i)
+                    CoherencePose<T>::store(extractState_(state, i), &entry.pose[i * CoherencePose<T>::SIZE]);
+                entry.clearance = clearance;
+            }
+
+            /** \brief Forget the certified pose of the calling thread */
+            void clear() const
+            {
+                entry_.get().clearance.clear();
+            }
+
+        private:
+
+            struct Entry
+            {
+                std::vector<double> pose;
+                std::vector<double> clearance;
+            };
+
+            GeometricStateExtractor extractState_;
+
+            std::vector<double>     radii_;
+
+            PerThread<Entry>        entry_;
+        };
+    }
+}
+
+#endif
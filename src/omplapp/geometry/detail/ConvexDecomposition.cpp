@@ -0,0 +1,559 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#include "omplapp/geometry/detail/ConvexDecomposition.h"
+#include "omplapp/geometry/detail/GeometryRegistry.h"
+#include <ompl/util/Console.h>
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <set>
+#include <sstream>
+#include <utility>
+
+namespace
+{
+    /* The first bytes of every decomposition file, followed by the format version and the key */
+    const char CONVEX_MAGIC[8] = { 'O', 'A', 'P', 'P', 'C', 'V', 'X', 'D' };
+    const std::uint32_t CONVEX_VERSION = 1;
+
+    struct Vec
+    {
+        double x, y, z;
+    };
+
+    Vec operator-(const Vec &a, const Vec &b)
+    {
+        return Vec{a.x - b.x, a.y - b.y, a.z - b.z};
+    }
+
+    Vec operator+(const Vec &a, const Vec &b)
+    {
+        return Vec{a.x + b.x, a.y + b.y, a.z + b.z};
+    }
+
+    Vec operator*(const Vec &a, double s)
+    {
+        return Vec{a.x * s, a.y * s, a.z * s};
+    }
+
+    double dot(const Vec &a, const Vec &b)
+    {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+
+    Vec cross(const Vec &a, const Vec &b)
+    {
+        return Vec{a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+    }
+
+    double norm(const Vec &a)
+    {
+        return std::sqrt(dot(a, a));
+    }
+
+    Vec toVec(const aiVector3D &v)
+    {
+        return Vec{v.x, v.y, v.z};
+    }
+
+    /* Distance from p to triangle (a, b, c); see Ericson, Real-Time Collision Detection, 5.1.5 */
+    double pointTriangleDistance(const Vec &p, const Vec &a, const Vec &b, const Vec &c)
+    {
+        const Vec ab = b - a, ac = c - a, ap = p - a;
+        const double d1 = dot(ab, ap), d2 = dot(ac, ap);
+        if (d1 <= 0.0 && d2 <= 0.0)
+            return norm(p - a);
+        const Vec bp = p - b;
+        const double d3 = dot(ab, bp), d4 = dot(ac, bp);
+        if (d3 >= 0.0 && d4 <= d3)
+            return norm(p - b);
+        const double vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+            return norm(p - (a + ab * (d1 / (d1 - d3))));
+        const Vec cp = p - c;
+        const double d5 = dot(ab, cp), d6 = dot(ac, cp);
+        if (d6 >= 0.0 && d5 <= d6)
+            return norm(p - c);
+        const double vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+            return norm(p - (a + ac * (d2 / (d2 - d6))));
+        const double va = d3 * d6 - d5 * d4;
+        if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0)
+            return norm(p - (b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)))));
+        const double denom = 1.0 / (va + vb + vc);
+        return norm(p - (a + ab * (vb * denom) + ac * (vc * denom)));
+    }
+
+    struct Face
+    {
+        std::array<unsigned int, 3> v;
+        Vec                         normal;
+        double                      offset;
+        bool                        alive;
+    };
+
+    Face makeFace(const std::vector<Vec> &p, unsigned int a, unsigned int b, unsigned int c)
+    {
+        Vec n = cross(p[b] - p[a], p[c] - p[a]);
+        const double len = norm(n);
+        if (len > 0.0)
+            n = n * (1.0 / len);
+        return Face{{{ a, b, c }}, n, dot(n, p[a]), true};
+    }
+
+    /* Index of the point of p farthest from the line through a and b, along with that distance */
+    std::pair<unsigned int, double> farthest(const std::vector<Vec> &p, const Vec &a, const Vec &b)
+    {
+        std::pair<unsigned int, double> best(0, -1.0);
+        const Vec d = b - a;
+        for (unsigned int i = 0 ; i < p.size() ; ++i)
+        {
+            const double dist = norm(cross(d, p[i] - a));
+            if (dist > best.second)
+                best = std::make_pair(i, dist);
+        }
+        if (norm(d) > 0.0)
+            best.second /= norm(d);
+        return best;
+    }
+
+    /* The hull of p, which is not flat. Incremental construction: every
+       point outside the current hull replaces the faces it sees by a fan
+       of faces connecting it to the horizon. */
+    void incrementalHull(const std::vector<Vec> &p, unsigned int i0, unsigned int i1, unsigned int i2, unsigned int i3,
+                         double eps, std::vector<Face> &faces)
+    {
+        faces.clear();
+        if (dot(cross(p[i1] - p[i0], p[i2] - p[i0]), p[i3] - p[i0]) > 0.0)
+            std::swap(i1, i2);
+        faces.push_back(makeFace(p, i0, i1, i2));
+        faces.push_back(makeFace(p, i0, i3, i1));
+        faces.push_back(makeFace(p, i1, i3, i2));
+        faces.push_back(makeFace(p, i2, i3, i0));
+
+        std::set<std::pair<unsigned int, unsigned int>> edges;
+        std::vector<std::size_t> visible;
+        for (unsigned int i = 0 ; i < p.size() ; ++i)
+        {
+            if (i == i0 || i == i1 || i == i2 || i == i3)
+                continue;
+            visible.clear();
+            for (std::size_t f = 0 ; f < faces.size() ; ++f)
+                if (faces[f].alive && dot(faces[f].normal, p[i]) - faces[f].offset > eps)
+                    visible.push_back(f);
+            if (visible.empty())
+                continue;
+
+            edges.clear();
+            for (std::size_t f : visible)
+            {
+                faces[f].alive = false;
+                for (int k = 0 ; k < 3 ; ++k)
+                    edges.insert(std::make_pair(faces[f].v[k], faces[f].v[(k + 1) % 3]));
+            }
+            // edges of visible faces whose neighbor is not visible form the horizon
+            for (const auto &e : edges)
+                if (edges.find(std::make_pair(e.second, e.first)) == edges.end())
+                    faces.push_back(makeFace(p, e.first, e.second, i));
+        }
+    }
+
+    /* Store the faces that are still alive in hull, with only the points they use */
+    void compactHull(const std::vector<Vec> &p, const std::vector<Face> &faces, ompl::app::ConvexHull &hull)
+    {
+        std::map<unsigned int, unsigned int> index;
+        for (const auto &f : faces)
+        {
+            if (!f.alive)
+                continue;
+            std::array<unsigned int, 3> face;
+            for (int k = 0 ; k < 3 ; ++k)
+            {
+                auto it = index.emplace(f.v[k], (unsigned int)hull.vertices.size());
+                if (it.second)
+                    hull.vertices.emplace_back(p[f.v[k]].x, p[f.v[k]].y, p[f.v[k]].z);
+                face[k] = it.first->second;
+            }
+            hull.faces.push_back(face);
+        }
+    }
+
+    /* Vertices of the triangles in tris */
+    std::vector<aiVector3D> clusterPoints(const std::vector<aiVector3D> &triangles, const std::vector<unsigned int> &tris)
+    {
+        std::vector<aiVector3D> points;
+        points.reserve(3 * tris.size());
+        for (unsigned int t : tris)
+            for (unsigned int k = 0 ; k < 3 ; ++k)
+                points.push_back(triangles[3 * t + k]);
+        return points;
+    }
+
+    struct Cluster
+    {
+        std::vector<unsigned int> tris;
+        ompl::app::ConvexHull     hull;
+        double                    concavity;
+    };
+
+    /* Return true if p is inside the closed mesh triangles: a ray from p
+       crosses its surface an odd number of times */
+    bool insideMesh(const Vec &p, const std::vector<aiVector3D> &triangles)
+    {
+        // a direction that is unlikely to be parallel to faces or hit edges of regular meshes
+        const Vec d{0.5773, 0.5779, 0.5767};
+        unsigned int crossings = 0;
+        for (std::size_t t = 0 ; t + 2 < triangles.size() ; t += 3)
+        {
+            const Vec a = toVec(triangles[t]);
+            const Vec e1 = toVec(triangles[t + 1]) - a, e2 = toVec(triangles[t + 2]) - a;
+            const Vec q = cross(d, e2);
+            const double det = dot(e1, q);
+            if (std::abs(det) < 1e-300)
+                continue;
+            const Vec s = p - a;
+            const double u = dot(s, q) / det;
+            if (u < 0.0 || u > 1.0)
+                continue;
+            const Vec r = cross(s, e1);
+            const double v = dot(d, r) / det;
+            if (v < 0.0 || u + v > 1.0)
+                continue;
+            if (dot(e2, r) / det > 0.0)
+                ++crossings;
+        }
+        return crossings % 2 == 1;
+    }
+
+    /* Compute the hull of the triangles of cluster and its concavity: the
+       largest distance between the center of a hull face outside the mesh
+       and the surface of the mesh. Faces inside the mesh are where the
+       mesh was cut into clusters. */
+    void makeCluster(const std::vector<aiVector3D> &triangles, Cluster &cluster)
+    {
+        ompl::app::computeConvexHull(clusterPoints(triangles, cluster.tris), cluster.hull);
+        cluster.concavity = 0.0;
+        for (const auto &f : cluster.hull.faces)
+        {
+            const Vec c = (toVec(cluster.hull.vertices[f[0]]) + toVec(cluster.hull.vertices[f[1]]) +
+                toVec(cluster.hull.vertices[f[2]])) * (1.0 / 3.0);
+            double dist = std::numeric_limits<double>::infinity();
+            for (std::size_t t = 0 ; t + 2 < triangles.size() && dist > cluster.concavity ; t += 3)
+                dist = std::min(dist, pointTriangleDistance(c, toVec(triangles[t]), toVec(triangles[t + 1]), toVec(triangles[t + 2])));
+            if (dist > cluster.concavity && !insideMesh(c, triangles))
+                cluster.concavity = dist;
+        }
+    }
+}
+
+bool ompl::app::computeConvexHull(const std::vector<aiVector3D> &points, ConvexHull &hull)
+{
+    hull.vertices.clear();
+    hull.faces.clear();
+
+    std::vector<Vec> p;
+    {
+        std::set<std::array<float, 3>> distinct;
+        for (const auto &v : points)
+            if (distinct.insert(std::array<float, 3>{{ v.x, v.y, v.z }}).second)
+                p.push_back(toVec(v));
+    }
+    if (p.empty())
+        return false;
+
+    Vec low = p[0], high = p[0];
+    for (const auto &v : p)
+    {
+        low = Vec{std::min(low.x, v.x), std::min(low.y, v.y), std::min(low.z, v.z)};
+        high = Vec{std::max(high.x, v.x), std::max(high.y, v.y), std::max(high.z, v.z)};
+    }
+    const double magnitude = std::max(std::max(std::abs(low.x), std::abs(high.x)), std::max(std::max(std::abs(low.y),
+        std::abs(high.y)), std::max(std::abs(low.z), std::abs(high.z))));
+    const double scale = norm(high - low);
+    const double eps = 1e-9 * (scale + magnitude);
+    // half the thickness of the hull of a flat point set; well above the
+    // rounding error of the single precision output
+    const double thickness = 1e-5 * (scale + magnitude) + std::numeric_limits<float>::min();
+
+    // the initial tetrahedron: two distant points, the point farthest from
+    // their line, and the point farthest from the plane of the three
+    unsigned int i0 = 0;
+    for (unsigned int i = 1 ; i < p.size() ; ++i)
+        if (p[i].x < p[i0].x)
+            i0 = i;
+    unsigned int i1 = i0;
+    for (unsigned int i = 0 ; i < p.size() ; ++i)
+        if (norm(p[i] - p[i0]) > norm(p[i1] - p[i0]))
+            i1 = i;
+    const std::pair<unsigned int, double> i2 = farthest(p, p[i0], p[i1]);
+    unsigned int i3 = i0;
+    double height = 0.0;
+    Vec n{0.0, 0.0, 1.0};
+    if (norm(p[i1] - p[i0]) > eps && i2.second > eps)
+    {
+        n = cross(p[i1] - p[i0], p[i2.first] - p[i0]);
+        n = n * (1.0 / norm(n));
+        for (unsigned int i = 0 ; i < p.size() ; ++i)
+            if (std::abs(dot(n, p[i] - p[i0])) > height)
+            {
+                height = std::abs(dot(n, p[i] - p[i0]));
+                i3 = i;
+            }
+    }
+
+    if (height <= eps)
+    {
+        std::vector<Vec> thick;
+        if (norm(p[i1] - p[i0]) > eps && i2.second > eps)
+            // a flat set: offset it to both sides of its plane
+            for (const auto &v : p)
+            {
+                thick.push_back(v + n * thickness);
+                thick.push_back(v - n * thickness);
+            }
+        else
+            // a point or a line: use a thin box around the points
+            for (int k = 0 ; k < 8 ; ++k)
+                thick.push_back(Vec{(k & 1) ? high.x + thickness : low.x - thickness,
+                                    (k & 2) ? high.y + thickness : low.y - thickness,
+                                    (k & 4) ? high.z + thickness : low.z - thickness});
+        p.swap(thick);
+
+        // the thick set is not flat; find its initial tetrahedron again
+        i0 = 0;
+        for (unsigned int i = 1 ; i < p.size() ; ++i)
+            if (p[i].x < p[i0].x)
+                i0 = i;
+        i1 = i0;
+        for (unsigned int i = 0 ; i < p.size() ; ++i)
+            if (norm(p[i] - p[i0]) > norm(p[i1] - p[i0]))
+                i1 = i;
+        const std::pair<unsigned int, double> j2 = farthest(p, p[i0], p[i1]);
+        n = cross(p[i1] - p[i0], p[j2.first] - p[i0]);
+        n = n * (1.0 / norm(n));
+        height = 0.0;
+        for (unsigned int i = 0 ; i < p.size() ; ++i)
+            if (std::abs(dot(n, p[i] - p[i0])) > height)
+            {
+                height = std::abs(dot(n, p[i] - p[i0]));
+                i3 = i;
+            }
+        std::vector<Face> faces;
+        incrementalHull(p, i0, i1, j2.first, i3, eps, faces);
+        compactHull(p, faces, hull);
+    }
+    else
+    {
+        std::vector<Face> faces;
+        incrementalHull(p, i0, i1, i2.first, i3, eps, faces);
+        compactHull(p, faces, hull);
+    }
+    return true;
+}
+
+void ompl::app::computeConvexDecomposition(const std::vector<aiVector3D> &triangles, double maxConcavity,
+                                           unsigned int maxHulls, std::vector<ConvexHull> &hulls)
+{
+    hulls.clear();
+    const unsigned int n = triangles.size() / 3;
+    if (n == 0)
+        return;
+
+    aiVector3D low = triangles[0], high = triangles[0];
+    for (const auto &v : triangles)
+        for (unsigned int k = 0 ; k < 3 ; ++k)
+        {
+            low[k] = std::min(low[k], v[k]);
+            high[k] = std::max(high[k], v[k]);
+        }
+    const double limit = maxConcavity * (high - low).Length() / 2.0;
+
+    std::vector<Cluster> clusters(1);
+    clusters[0].tris.resize(n);
+    for (unsigned int t = 0 ; t < n ; ++t)
+        clusters[0].tris[t] = t;
+    makeCluster(triangles, clusters[0]);
+
+    while (clusters.size() < std::max(1u, maxHulls))
+    {
+        // split the most concave cluster
+        std::size_t worst = 0;
+        for (std::size_t c = 1 ; c < clusters.size() ; ++c)
+            if (clusters[c].concavity > clusters[worst].concavity)
+                worst = c;
+        if (clusters[worst].concavity <= limit || clusters[worst].tris.size() < 2)
+            break;
+
+        // at the median of the triangle centers along the longest side of their bounding box
+        std::vector<unsigned int> &tris = clusters[worst].tris;
+        std::vector<Vec> centers(n);
+        Vec clow{std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity()};
+        Vec chigh = clow * -1.0;
+        for (unsigned int t : tris)
+        {
+            const Vec c = (toVec(triangles[3 * t]) + toVec(triangles[3 * t + 1]) + toVec(triangles[3 * t + 2])) * (1.0 / 3.0);
+            centers[t] = c;
+            clow = Vec{std::min(clow.x, c.x), std::min(clow.y, c.y), std::min(clow.z, c.z)};
+            chigh = Vec{std::max(chigh.x, c.x), std::max(chigh.y, c.y), std::max(chigh.z, c.z)};
+        }
+        const Vec extent = chigh - clow;
+        const int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+        std::nth_element(tris.begin(), tris.begin() + tris.size() / 2, tris.end(),
+            [&centers, axis](unsigned int a, unsigned int b)
+            {
+                const double ca = axis == 0 ? centers[a].x : (axis == 1 ? centers[a].y : centers[a].z);
+                const double cb = axis == 0 ? centers[b].x : (axis == 1 ? centers[b].y : centers[b].z);
+                return ca < cb;
+            });
+
+        Cluster upper;
+        upper.tris.assign(tris.begin() + tris.size() / 2, tris.end());
+        tris.resize(tris.size() / 2);
+        makeCluster(triangles, clusters[worst]);
+        makeCluster(triangles, upper);
+        clusters.push_back(std::move(upper));
+    }
+
+    for (auto &c : clusters)
+        hulls.push_back(std::move(c.hull));
+}
+
+bool ompl::app::storeConvexDecomposition(const std::vector<ConvexHull> &hulls, std::uint64_t key, const std::string &filename)
+{
+    std::ofstream out(filename.c_str(), std::ios::binary);
+    if (!out)
+    {
+        OMPL_ERROR("Unable to open '%s' for writing", filename.c_str());
+        return false;
+    }
+    out.write(CONVEX_MAGIC, sizeof(CONVEX_MAGIC));
+    out.write(reinterpret_cast<const char*>(&CONVEX_VERSION), sizeof(CONVEX_VERSION));
+    out.write(reinterpret_cast<const char*>(&key), sizeof(key));
+    const std::uint32_t count = hulls.size();
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    for (const auto &hull : hulls)
+    {
+        const std::uint32_t sizes[2] = { (std::uint32_t)hull.vertices.size(), (std::uint32_t)hull.faces.size() };
+        out.write(reinterpret_cast<const char*>(sizes), sizeof(sizes));
+        for (const auto &v : hull.vertices)
+        {
+            const float xyz[3] = { v.x, v.y, v.z };
+            out.write(reinterpret_cast<const char*>(xyz), sizeof(xyz));
+        }
+        for (const auto &f : hull.faces)
+        {
+            const std::uint32_t abc[3] = { f[0], f[1], f[2] };
+            out.write(reinterpret_cast<const char*>(abc), sizeof(abc));
+        }
+    }
+    if (!out)
+    {
+        OMPL_ERROR("Unable to write convex decomposition to '%s'", filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool ompl::app::loadConvexDecomposition(const std::string &filename, std::uint64_t key, std::vector<ConvexHull> &hulls)
+{
+    hulls.clear();
+    std::ifstream in(filename.c_str(), std::ios::binary);
+    char magic[sizeof(CONVEX_MAGIC)];
+    std::uint32_t version = 0, count = 0;
+    std::uint64_t storedKey = 0;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(&version), sizeof(version));
+    in.read(reinterpret_cast<char*>(&storedKey), sizeof(storedKey));
+    in.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if (!in || std::memcmp(magic, CONVEX_MAGIC, sizeof(magic)) != 0 || version != CONVEX_VERSION)
+    {
+        OMPL_ERROR("'%s' is not a convex decomposition file", filename.c_str());
+        return false;
+    }
+    if (storedKey != key)
+    {
+        OMPL_WARN("The convex decomposition in '%s' was computed for a different mesh", filename.c_str());
+        return false;
+    }
+
+    hulls.resize(count);
+    for (auto &hull : hulls)
+    {
+        std::uint32_t sizes[2] = { 0, 0 };
+        in.read(reinterpret_cast<char*>(sizes), sizeof(sizes));
+        if (!in)
+            break;
+        hull.vertices.resize(sizes[0]);
+        hull.faces.resize(sizes[1]);
+        for (auto &v : hull.vertices)
+        {
+            float xyz[3];
+            in.read(reinterpret_cast<char*>(xyz), sizeof(xyz));
+            v = aiVector3D(xyz[0], xyz[1], xyz[2]);
+        }
+        for (auto &f : hull.faces)
+        {
+            std::uint32_t abc[3];
+            in.read(reinterpret_cast<char*>(abc), sizeof(abc));
+            if (!in || abc[0] >= sizes[0] || abc[1] >= sizes[0] || abc[2] >= sizes[0])
+            {
+                in.setstate(std::ios::failbit);
+                break;
+            }
+            f = std::array<unsigned int, 3>{{ abc[0], abc[1], abc[2] }};
+        }
+    }
+    if (!in)
+    {
+        OMPL_ERROR("Unable to read convex decomposition from '%s'", filename.c_str());
+        hulls.clear();
+        return false;
+    }
+    return true;
+}
+
+std::vector<ompl::app::ConvexHull> ompl::app::getConvexDecomposition(const std::vector<aiVector3D> &triangles, double maxConcavity,
+                                                                     unsigned int maxHulls, const std::string &cacheDirectory)
+{
+    std::vector<ConvexHull> hulls;
+    const GeometryKey mesh = triangleKey(triangles);
+    std::uint64_t key = fnv1a(fnv1a(fnv1a(mesh.first, (std::uint64_t)mesh.second), maxConcavity), maxHulls);
+
+    boost::filesystem::path cached;
+    if (!cacheDirectory.empty() && boost::filesystem::is_directory(cacheDirectory))
+    {
+        std::stringstream name;
+        name << "convex_" << std::hex << key << ".bin";
+        cached = boost::filesystem::path(cacheDirectory) / name.str();
+        if (boost::filesystem::exists(cached) && loadConvexDecomposition(cached.string(), key, hulls))
+            return hulls;
+    }
+
+    computeConvexDecomposition(triangles, maxConcavity, maxHulls, hulls);
+    OMPL_INFORM("Decomposed a mesh with %u triangles into %u convex hulls", (unsigned int)triangles.size() / 3,
+                (unsigned int)hulls.size());
+    if (!cached.empty())
+    {
+        // write to a temporary file first, so concurrent processes never read a partial file
+        boost::filesystem::path tmp = cached;
+        tmp += boost::filesystem::unique_path(".%%%%-%%%%-%%%%");
+        boost::system::error_code ec;
+        if (storeConvexDecomposition(hulls, key, tmp.string()))
+            boost::filesystem::rename(tmp, cached, ec);
+        if (ec)
+            OMPL_WARN("Unable to cache convex decomposition in '%s': %s", cached.string().c_str(), ec.message().c_str());
+    }
+    return hulls;
+}
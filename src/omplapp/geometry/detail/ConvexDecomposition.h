@@ -0,0 +1,70 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_GEOMETRY_DETAIL_CONVEX_DECOMPOSITION_
+#define OMPLAPP_GEOMETRY_DETAIL_CONVEX_DECOMPOSITION_
+
+#include <assimp/types.h>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ompl
+{
+    namespace app
+    {
+        /** \brief A convex polytope given by its vertices and triangular
+            faces. The vertices of every face are in counterclockwise order
+            when seen from outside. */
+        struct ConvexHull
+        {
+            std::vector<aiVector3D>                  vertices;
+            std::vector<std::array<unsigned int, 3>> faces;
+        };
+
+        /** \brief Compute the convex hull of \e points. Point sets that are
+            flat (or lie on a line) get a hull that is slightly thicker than
+            the points, so that the hull always has a volume. Returns false
+            if \e points is empty. */
+        bool computeConvexHull(const std::vector<aiVector3D> &points, ConvexHull &hull);
+
+        /** \brief Compute an approximate convex decomposition of the
+            triangle soup \e triangles (three consecutive points per
+            triangle): a set of at most \e maxHulls convex hulls whose union
+            contains all triangles. Starting from the hull of all triangles,
+            the hull with the largest concavity is replaced by the hulls of
+            the two halves of its triangles, until every concavity is below
+            \e maxConcavity times the radius of the mesh. The concavity of a
+            hull is the largest distance from the center of one of its faces
+            that is outside the mesh to the surface of the mesh; the mesh is
+            assumed to be closed. */
+        void computeConvexDecomposition(const std::vector<aiVector3D> &triangles, double maxConcavity,
+                                        unsigned int maxHulls, std::vector<ConvexHull> &hulls);
+
+        /** \brief Write \e hulls to \e filename, after a header containing
+            \e key. Returns false if the file cannot be written. */
+        bool storeConvexDecomposition(const std::vector<ConvexHull> &hulls, std::uint64_t key, const std::string &filename);
+
+        /** \brief Read hulls written by storeConvexDecomposition(). Returns
+            false if the file cannot be read or was written for a key other
+            than \e key. */
+        bool loadConvexDecomposition(const std::string &filename, std::uint64_t key, std::vector<ConvexHull> &hulls);
+
+        /** \brief Return the decomposition of \e triangles computed by
+            computeConvexDecomposition(). If \e cacheDirectory is not empty,
+            decompositions are stored in that directory and reused for
+            identical triangles and parameters. */
+        std::vector<ConvexHull> getConvexDecomposition(const std::vector<aiVector3D> &triangles, double maxConcavity,
+                                                       unsigned int maxHulls, const std::string &cacheDirectory);
+    }
+}
+
+#endif
@@ -0,0 +1,241 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2011, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_GEOMETRY_DETAIL_FCL_CONSERVATIVE_ADVANCEMENT_MOTION_VALIDATOR_
+#define OMPLAPP_GEOMETRY_DETAIL_FCL_CONSERVATIVE_ADVANCEMENT_MOTION_VALIDATOR_
+
+#include <ompl/base/MotionValidator.h>
+#include <ompl/base/SpaceInformation.h>
+
+#include "omplapp/geometry/detail/FCLMethodWrapper.h"
+#include "omplapp/geometry/detail/FCLStateValidityChecker.h"
+#include "omplapp/geometry/detail/LazyStateValidityChecker.h"
+#include "omplapp/geometry/detail/CoherenceCache.h"
+#include "omplapp/geometry/GeometrySpecification.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace ob = ompl::base;
+
+namespace ompl
+{
+    namespace app
+    {
+        /// \brief A motion validator that advances along a motion in steps
+        /// that are provably collision free. At every step, the distance
+        /// between each robot part and the environment (and between pairs
+        /// of parts, if self collisions are checked) is computed, and the
+        /// motion advances by the largest amount that cannot move any point
+        /// of a part farther than that distance. The geometric components
+        /// of the states are assumed to be interpolated at constant speed,
+        /// as is the case for SE(2) and SE(3).
+        ///
+        /// Where this step would be shorter than the resolution of the
+        /// state space, i.e., close to obstacles, the validator falls back
+        /// to discrete checks at the resolution of the state space. The
+        /// clearance is not queried again for the next DISCRETE_STEPS
+        /// steps, since it can only grow by a little per step, so near
+        /// contact a motion costs one clearance query per DISCRETE_STEPS + 1
+        /// discrete checks on top of what DiscreteMotionValidator does.
+        /// Collisions are located by bisection.
+        template<MotionModel T>
+        class FCLConservativeAdvancementMotionValidator : public ob::MotionValidator
+        {
+        public:
+
+            /// \brief Constructor
+            FCLConservativeAdvancementMotionValidator(ob::SpaceInformation* si) : ob::MotionValidator(si)
+            {
+                defaultSettings();
+            }
+
+            /// \brief Constructor
+            FCLConservativeAdvancementMotionValidator(const ob::SpaceInformationPtr &si) : ob::MotionValidator(si)
+            {
+                defaultSettings();
+            }
+
+            /// \brief Destructor
+            ~FCLConservativeAdvancementMotionValidator() override = default;
+
+            /// \brief Returns true if motion between s1 and s2 is collision free.
+            bool checkMotion(const ob::State *s1, const ob::State *s2) const override
+            {
+                ScopedTrace trace("checkMotion", "checker", Trace::sample());
+                // assume motion starts in a valid configuration so s1 is valid;
+                // checking s2 first rejects many invalid motions cheaply
+                double unused;
+                bool valid = si_->isValid(s2) && advance(s1, s2, false, nullptr, unused);
+
+                // Increment valid/invalid motion counters
+                valid ? valid_++ : invalid_++;
+
+                return valid;
+            }
+
+            /// \brief Checks the motion between s1 and s2. If the motion is
+            /// invalid, lastValid contains the last valid state and the
+            /// parameterized time [0,1) when this state occurs.
+            bool checkMotion(const ob::State *s1, const ob::State *s2, std::pair<ob::State*, double> &lastValid) const override
+            {
+                ScopedTrace trace("checkMotion", "checker", Trace::sample());
+                bool valid = advance(s1, s2, true, lastValid.first, lastValid.second);
+
+                // Increment valid/invalid motion counters
+                valid ? valid_++ : invalid_++;
+
+                return valid;
+            }
+
+        protected:
+
+            /// \brief Advance from s1 towards s2 as long as the motion is
+            /// known to be collision free. Returns true if s2 was reached.
+            /// Otherwise, \e lastValidTime (and \e lastValidState, if not
+            /// nullptr) are set to the last valid point of the motion. s2
+            /// itself is only checked if \e checkEnd is true.
+            bool advance(const ob::State *s1, const ob::State *s2, bool checkEnd,
+                         ob::State *lastValidState, double &lastValidTime) const
+            {
+                // Upper bound on the distance a point of each part moves along the whole motion
+                const GeometricStateExtractor &extract = fclWrapper_->getStateExtractor();
+                std::vector<double> rate(radii_.size());
+                for (std::size_t i = 0 ; i < radii_.size() ; ++i)
+                    rate[i] = CoherencePose<T>::displacement(extract(s1, i), extract(s2, i), radii_[i]);
+
+                const double minStep = resolution(s1, s2);
+                std::vector<double> envDist, selfDist;
+                ob::State *state = si_->cloneState(s1);
+                double t = 0.0, tPrev = 0.0;
+                unsigned int discrete = 0;
+                bool valid = true;
+                while (t < 1.0)
+                {
+                    double step = 0.0;
+                    if (discrete > 0)
+                        // still close to contact; the clearance cannot have grown much
+                        --discrete;
+                    else
+                    {
+                        // the largest step for which no part can reach an obstacle or another part
+                        step = std::numeric_limits<double>::infinity();
+                        fclWrapper_->partClearances(state, envDist);
+                        for (std::size_t i = 0 ; i < envDist.size() ; ++i)
+                            if (rate[i] > 0.0)
+                                step = std::min(step, envDist[i] / rate[i]);
+                        fclWrapper_->selfClearances(state, selfDist);
+                        for (std::size_t i = 0, k = 0 ; i < radii_.size() && k < selfDist.size() ; ++i)
+                            for (std::size_t j = i + 1 ; j < radii_.size() ; ++j, ++k)
+                                if (rate[i] + rate[j] > 0.0)
+                                    step = std::min(step, selfDist[k] / (rate[i] + rate[j]));
+                        if (step < minStep)
+                            discrete = DISCRETE_STEPS;
+                    }
+
+                    if (step < minStep)
+                    {
+                        // close to contact; do what a discrete motion validator would
+                        if (t > 0.0 && !si_->isValid(state))
+                        {
+                            valid = false;
+                            break;
+                        }
+                        step = minStep;
+                    }
+
+                    tPrev = t;
+                    t = std::min(1.0, t + step);
+                    if (t < 1.0)
+                        si_->getStateSpace()->interpolate(s1, s2, t, state);
+                }
+                si_->freeState(state);
+
+                if (valid && checkEnd && !si_->isValid(s2))
+                    valid = false;
+
+                if (valid)
+                {
+                    lastValidTime = 1.0;
+                    if (lastValidState != nullptr)
+                        si_->copyState(lastValidState, s2);
+                }
+                else
+                    lastValidTime = bisect(s1, s2, tPrev, std::min(t, 1.0), minStep, lastValidState);
+                return valid;
+            }
+
+            /// \brief Find the last valid time in [lo, hi], where the state at
+            /// \e lo is valid and the state at \e hi is not. The time is
+            /// located up to a small fraction of \e minStep.
+            double bisect(const ob::State *s1, const ob::State *s2, double lo, double hi, double minStep,
+                          ob::State *lastValidState) const
+            {
+                ob::State *state = si_->allocState();
+                for (unsigned int k = 0 ; k < MAX_BISECTIONS && hi - lo > minStep * BISECTION_PRECISION ; ++k)
+                {
+                    const double mid = (lo + hi) / 2.0;
+                    si_->getStateSpace()->interpolate(s1, s2, mid, state);
+                    if (si_->isValid(state))
+                        lo = mid;
+                    else
+                        hi = mid;
+                }
+                si_->freeState(state);
+
+                if (lastValidState != nullptr)
+                {
+                    if (lo > 0.0)
+                        si_->getStateSpace()->interpolate(s1, s2, lo, lastValidState);
+                    else
+                        si_->copyState(lastValidState, s1);
+                }
+                return lo;
+            }
+
+            /// \brief Step (as a fraction of the motion) used for discrete checks
+            double resolution(const ob::State *s1, const ob::State *s2) const
+            {
+                return 1.0 / std::max(1u, si_->getStateSpace()->validSegmentCount(s1, s2));
+            }
+
+            /// \brief Restore settings to default values.
+            void defaultSettings()
+            {
+                const auto *checker = dynamic_cast<const FCLStateValidityChecker<T>*>(
+                    LazyStateValidityChecker::resolve(si_->getStateValidityChecker()).get());
+                if (checker == nullptr)
+                    throw Exception("The conservative advancement motion validator requires a FCLStateValidityChecker");
+                fclWrapper_ = checker->getFCLWrapper();
+                radii_ = fclWrapper_->getPartRadii();
+            }
+
+            /// \brief Maximum number of bisection steps used to locate a collision
+            static const unsigned int MAX_BISECTIONS = 20;
+
+            /// \brief Precision of bisection, as a fraction of the state space resolution
+            static constexpr double BISECTION_PRECISION = 1e-2;
+
+            /// \brief Number of discrete steps taken without querying the
+            /// clearance after a step shorter than the resolution
+            static const unsigned int DISCRETE_STEPS = 8;
+
+            /// \brief Wrapper for FCL collision and distance methods
+            FCLMethodWrapperPtr         fclWrapper_;
+
+            /// \brief Maximum distance of a point of each robot part from the origin of its frame
+            std::vector<double>         radii_;
+        };
+    }
+}
+
+#endif
@@ -13,13 +13,19 @@
 #ifndef OMPLAPP_GEOMETRY_DETAIL_FCL_CONTINUOUS_MOTION_VALIDATOR_
 #define OMPLAPP_GEOMETRY_DETAIL_FCL_CONTINUOUS_MOTION_VALIDATOR_
 
+#include <ompl/base/GenericParam.h>
 #include <ompl/base/MotionValidator.h>
 #include <ompl/base/SpaceInformation.h>
 
 #include "omplapp/geometry/detail/FCLMethodWrapper.h"
 #include "omplapp/geometry/detail/FCLStateValidityChecker.h"
+#include "omplapp/geometry/detail/LazyStateValidityChecker.h"
 #include "omplapp/geometry/GeometrySpecification.h"
 
+#include <string>
+#include <utility>
+#include <vector>
+
 namespace ob = ompl::base;
 
 namespace ompl
@@ -49,11 +55,13 @@ namespace ompl
             /// \brief Returns true if motion between s1 and s2 is collision free.
             bool checkMotion(const ob::State *s1, const ob::State *s2) const override
             {
+                ScopedTrace trace("checkMotion", "checker", Trace::sample());
                 double unused;
 
                 // assume motion starts in a valid configuration so s1 is valid
                 // Must check validity of s2 before performing collision check between s1 and s2
-                bool valid = si_->isValid(s2) && fclWrapper_->isValid (s1, s2, unused);
+                bool valid = si_->isValid(s2) && fclWrapper_->isValid (s1, s2, unused) &&
+                    checkOctreeObstacles(s1, s2, unused);
 
                 // Increment valid/invalid motion counters
                 valid ? valid_++ : invalid_++;
@@ -66,12 +74,19 @@ namespace ompl
             /// parameterized time [0,1) when this state occurs.
             bool checkMotion(const ob::State *s1, const ob::State *s2, std::pair<ob::State*, double> &lastValid) const override
             {
+                ScopedTrace trace("checkMotion", "checker", Trace::sample());
                 bool valid = false;
 
                 // if there is a collision, collisionTime will contain the time to collision,
                 // parameterized from [0,1), where s1 is 0 and s2 is 1.
                 double collisionTime;
                 valid = fclWrapper_->isValid (s1, s2, collisionTime);
+                double octreeTime;
+                if (!checkOctreeObstacles(s1, s2, octreeTime) && (valid || octreeTime < collisionTime))
+                {
+                    valid = false;
+                    collisionTime = octreeTime;
+                }
 
                 // Find the last valid state before collision...
                 // NOTE: This should probably be refactored so that the continuous checker
@@ -113,8 +128,169 @@ namespace ompl
                 return valid;
             }
 
+            /// \brief Get the parameters of continuous collision checking.
+            /// These are \e ccd_motion (translation, linear, screw or
+            /// spline), \e ccd_gjk_solver (libccd or indep), \e ccd_solver
+            /// (naive, conservative_advancement, ray_shooting or
+            /// polynomial), \e ccd_max_iterations and \e ccd_tolerance.
+            ob::ParamSet& params()
+            {
+                return params_;
+            }
+
+            /// \brief Get the parameters of continuous collision checking
+            const ob::ParamSet& params() const
+            {
+                return params_;
+            }
+
+            /// \brief Set the motion model used to interpolate between the
+            /// poses of the robot (one of translation, linear, screw or spline)
+            void setMotionType(const std::string &type)
+            {
+                static const std::vector<std::pair<std::string, fcl::CCDMotionType>> types{
+                    {"translation", fcl::CCDM_TRANS}, {"linear", fcl::CCDM_LINEAR},
+                    {"screw", fcl::CCDM_SCREW}, {"spline", fcl::CCDM_SPLINE}};
+                FCLMethodWrapper::ContinuousCollisionRequest request = fclWrapper_->getContinuousCollisionRequest();
+                request.ccd_motion_type = lookup(types, type, "motion type");
+                fclWrapper_->setContinuousCollisionRequest(request);
+            }
+
+            /// \brief Get the motion model used to interpolate between the poses of the robot
+            std::string getMotionType() const
+            {
+                switch (fclWrapper_->getContinuousCollisionRequest().ccd_motion_type)
+                {
+                    case fcl::CCDM_TRANS: return "translation";
+                    case fcl::CCDM_LINEAR: return "linear";
+                    case fcl::CCDM_SCREW: return "screw";
+                    default: return "spline";
+                }
+            }
+
+            /// \brief Set the GJK solver used for continuous collision checking (libccd or indep)
+            void setGJKSolverType(const std::string &type)
+            {
+                static const std::vector<std::pair<std::string, fcl::GJKSolverType>> types{
+                    {"libccd", fcl::GST_LIBCCD}, {"indep", fcl::GST_INDEP}};
+                FCLMethodWrapper::ContinuousCollisionRequest request = fclWrapper_->getContinuousCollisionRequest();
+                request.gjk_solver_type = lookup(types, type, "GJK solver type");
+                fclWrapper_->setContinuousCollisionRequest(request);
+            }
+
+            /// \brief Get the GJK solver used for continuous collision checking
+            std::string getGJKSolverType() const
+            {
+                return fclWrapper_->getContinuousCollisionRequest().gjk_solver_type == fcl::GST_LIBCCD ? "libccd" : "indep";
+            }
+
+            /// \brief Set the continuous collision solver (one of naive,
+            /// conservative_advancement, ray_shooting or polynomial)
+            void setSolverType(const std::string &type)
+            {
+                static const std::vector<std::pair<std::string, fcl::CCDSolverType>> types{
+                    {"naive", fcl::CCDC_NAIVE}, {"conservative_advancement", fcl::CCDC_CONSERVATIVE_ADVANCEMENT},
+                    {"ray_shooting", fcl::CCDC_RAY_SHOOTING}, {"polynomial", fcl::CCDC_POLYNOMIAL_SOLVER}};
+                FCLMethodWrapper::ContinuousCollisionRequest request = fclWrapper_->getContinuousCollisionRequest();
+                request.ccd_solver_type = lookup(types, type, "solver type");
+                fclWrapper_->setContinuousCollisionRequest(request);
+            }
+
+            /// \brief Get the continuous collision solver
+            std::string getSolverType() const
+            {
+                switch (fclWrapper_->getContinuousCollisionRequest().ccd_solver_type)
+                {
+                    case fcl::CCDC_NAIVE: return "naive";
+                    case fcl::CCDC_CONSERVATIVE_ADVANCEMENT: return "conservative_advancement";
+                    case fcl::CCDC_RAY_SHOOTING: return "ray_shooting";
+                    default: return "polynomial";
+                }
+            }
+
+            /// \brief Set the maximum number of iterations of the continuous collision solver
+            void setMaxIterations(unsigned int iterations)
+            {
+                FCLMethodWrapper::ContinuousCollisionRequest request = fclWrapper_->getContinuousCollisionRequest();
+                request.num_max_iterations = iterations;
+                fclWrapper_->setContinuousCollisionRequest(request);
+            }
+
+            /// \brief Get the maximum number of iterations of the continuous collision solver
+            unsigned int getMaxIterations() const
+            {
+                return fclWrapper_->getContinuousCollisionRequest().num_max_iterations;
+            }
+
+            /// \brief Set the tolerance on the computed time of contact
+            void setTolerance(double tolerance)
+            {
+                FCLMethodWrapper::ContinuousCollisionRequest request = fclWrapper_->getContinuousCollisionRequest();
+                request.toc_err = tolerance;
+                fclWrapper_->setContinuousCollisionRequest(request);
+            }
+
+            /// \brief Get the tolerance on the computed time of contact
+            double getTolerance() const
+            {
+                return fclWrapper_->getContinuousCollisionRequest().toc_err;
+            }
+
         protected:
 
+            /// \brief FCL has no continuous collision checking for octrees
+            /// (see RigidBodyGeometry::addOctree()), so if there are any,
+            /// check the states along the motion at the resolution of the
+            /// space information, up to and including \e s2, like
+            /// DiscreteMotionValidator. Returns false, and the time of the
+            /// first invalid state in \e time, if one of them is invalid.
+            bool checkOctreeObstacles(const ob::State *s1, const ob::State *s2, double &time) const
+            {
+                if (!fclWrapper_->hasOctreeObstacles())
+                    return true;
+                const unsigned int nd = stateSpace_->validSegmentCount(s1, s2);
+                ob::State *test = si_->allocState();
+                bool valid = true;
+                for (unsigned int j = 1 ; j <= nd && valid ; ++j)
+                {
+                    time = (double)j / (double)nd;
+                    stateSpace_->interpolate(s1, s2, time, test);
+                    valid = si_->isValid(test);
+                }
+                si_->freeState(test);
+                return valid;
+            }
+
+            /// \brief Find the FCL constant called \e name
+            template<typename E>
+            static E lookup(const std::vector<std::pair<std::string, E>> &values, const std::string &name, const char *what)
+            {
+                for (const auto &v : values)
+                    if (v.first == name)
+                        return v.second;
+                throw Exception("Unknown continuous collision checking " + std::string(what) + ": " + name);
+            }
+
+            /// \brief Declare the parameters of continuous collision checking
+            void declareParams()
+            {
+                params_.declareParam<std::string>("ccd_motion",
+                    [this](const std::string &type) { setMotionType(type); },
+                    [this] { return getMotionType(); });
+                params_.declareParam<std::string>("ccd_gjk_solver",
+                    [this](const std::string &type) { setGJKSolverType(type); },
+                    [this] { return getGJKSolverType(); });
+                params_.declareParam<std::string>("ccd_solver",
+                    [this](const std::string &type) { setSolverType(type); },
+                    [this] { return getSolverType(); });
+                params_.declareParam<unsigned int>("ccd_max_iterations",
+                    [this](unsigned int iterations) { setMaxIterations(iterations); },
+                    [this] { return getMaxIterations(); });
+                params_.declareParam<double>("ccd_tolerance",
+                    [this](double tolerance) { setTolerance(tolerance); },
+                    [this] { return getTolerance(); });
+            }
+
             /// \brief Restore settings to default values.
             void defaultSettings(MotionModel mm)
             {
@@ -127,7 +303,7 @@ namespace ompl
                 {
                     case app::Motion_2D:
                         const app::FCLStateValidityChecker<app::Motion_2D> *fcl_2d_state_checker;
-                        fcl_2d_state_checker = dynamic_cast <const app::FCLStateValidityChecker<app::Motion_2D>* > (si_->getStateValidityChecker ().get ());
+                        fcl_2d_state_checker = dynamic_cast <const app::FCLStateValidityChecker<app::Motion_2D>* > (app::LazyStateValidityChecker::resolve(si_->getStateValidityChecker ()).get ());
 
                         if (fcl_2d_state_checker == nullptr)
                         {
@@ -141,7 +317,7 @@ namespace ompl
 
                     case app::Motion_3D:
                         const app::FCLStateValidityChecker<app::Motion_3D> *fcl_3d_state_checker;
-                        fcl_3d_state_checker = dynamic_cast <const app::FCLStateValidityChecker<app::Motion_3D>* > (si_->getStateValidityChecker ().get ());
+                        fcl_3d_state_checker = dynamic_cast <const app::FCLStateValidityChecker<app::Motion_3D>* > (app::LazyStateValidityChecker::resolve(si_->getStateValidityChecker ()).get ());
 
                         if (fcl_3d_state_checker == nullptr)
                         {
@@ -164,6 +340,8 @@ namespace ompl
                     OMPL_ERROR("FCLWrapper object is not valid.");
                     assert (fclWrapper_ != 0);
                 }
+                else
+                    declareParams();
             }
 
             /// \brief Wrapper for FCL collision and distance methods
@@ -171,6 +349,9 @@ namespace ompl
 
             /// \brief Handle to the statespace that this motion validator operates in.
             ob::StateSpace*             stateSpace_;
+
+            /// \brief Parameters of continuous collision checking
+            ob::ParamSet                params_;
         };
     }
 }
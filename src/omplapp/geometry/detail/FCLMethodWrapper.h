@@ -18,6 +18,14 @@
 // OMPL and OMPL.app headers
 #include "omplapp/geometry/GeometrySpecification.h"
 #include "omplapp/geometry/detail/assimpUtil.h"
+#include "omplapp/geometry/detail/CheckerStatistics.h"
+#include "omplapp/geometry/detail/ConvexDecomposition.h"
+#include "omplapp/geometry/detail/GeometryRegistry.h"
+#include "omplapp/geometry/detail/ParallelBatch.h"
+#include "omplapp/geometry/detail/SphereTree.h"
+#include "omplapp/geometry/detail/Trace.h"
+#include "omplapp/geometry/detail/VertexClustering.h"
+#include <ompl/util/Exceptions.h>
 
 // FCL Headers
 #include <fcl/config.h>
@@ -27,13 +35,26 @@
 #include <fcl/collision_node.h>
 #include <fcl/traversal/traversal_node_setup.h>
 #include <fcl/continuous_collision.h>
+#include <fcl/broadphase/broadphase_dynamic_AABB_tree.h>
 #else
 #include <fcl/narrowphase/collision.h>
 #include <fcl/narrowphase/distance.h>
 #include <fcl/narrowphase/continuous_collision.h>
+#include <fcl/broadphase/broadphase_dynamic_AABB_tree.h>
+#endif
+#if OMPL_HAS_OCTOMAP
+#if FCL_MAJOR_VERSION==0 && FCL_MINOR_VERSION<6
+#include <fcl/octree.h>
+#else
+#include <fcl/geometry/octree/octree.h>
+#endif
 #endif
 
-// STL headers
+// Eigen and STL headers
+#include <Eigen/Core>
+#include <algorithm>
+#include <future>
+#include <map>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -66,6 +87,9 @@ namespace ompl
             using ContinuousCollisionResult = fcl::ContinuousCollisionResult;
             using DistanceRequest = fcl::DistanceRequest;
             using DistanceResult = fcl::DistanceResult;
+            using CollisionObject = fcl::CollisionObject;
+            using CollisionGeometryPtr = boost::shared_ptr<fcl::CollisionGeometry>;
+            using BroadPhaseManager = fcl::DynamicAABBTreeCollisionManager;
 #else
             using Vector3 = fcl::Vector3d;
             using Quaternion = fcl::Quaterniond;
@@ -79,20 +103,158 @@ namespace ompl
             using ContinuousCollisionResult = fcl::ContinuousCollisionResult<double>;
             using DistanceRequest = fcl::DistanceRequest<double>;
             using DistanceResult = fcl::DistanceResult<double>;
+            using CollisionObject = fcl::CollisionObject<double>;
+            using CollisionGeometryPtr = std::shared_ptr<fcl::CollisionGeometry<double>>;
+            using BroadPhaseManager = fcl::DynamicAABBTreeCollisionManager<double>;
+            /// \brief Single precision model of the environment, see the constructor
+            using ModelF = fcl::BVHModel<fcl::OBBRSSf>;
+            using TransformF = fcl::Transform3f;
 #endif
 
             using FCLPoseFromStateCallback = std::function<void(Transform &, const base::State *)>;
 
+            /// \brief Vector of transforms with the alignment Eigen requires
+            using TransformVector = std::vector<Transform, Eigen::aligned_allocator<Transform>>;
+
+            /// \brief Constructor. If \e broadphase is true, every mesh of the
+            /// environment becomes a separate collision object in a dynamic
+            /// AABB tree, instead of merging all of them into one BVH. Objects
+            /// whose bounding box does not overlap the bounding box of a robot
+            /// part are then culled before narrowphase collision checking,
+            /// which is much faster for large environments with many
+            /// disjoint objects.
+            ///
+            /// If \e singlePrecision is true, the merged environment BVH is
+            /// stored in single precision, which halves its memory. To keep
+            /// the results safe, environment queries then use single
+            /// precision copies of the robot parts that are inflated by a
+            /// small margin covering the rounding errors (see
+            /// getPrecisionMargin()), so states within that margin of an
+            /// obstacle are reported in collision. The sphere tree first
+            /// pass is not used for such environments. Single precision
+            /// models require FCL 0.6 or later and are not used with
+            /// \e broadphase.
             FCLMethodWrapper(const GeometrySpecification &geom,
                              GeometricStateExtractor se,
                              bool selfCollision,
-                             FCLPoseFromStateCallback poseCallback)
+                             FCLPoseFromStateCallback poseCallback,
+                             bool broadphase = false,
+                             bool singlePrecision = false)
                 : extractState_(std::move(se)), selfCollision_(selfCollision),
-                  poseFromStateCallback_(std::move(poseCallback))
+                  poseFromStateCallback_(std::move(poseCallback)), broadphase_(broadphase),
+                  singlePrecision_(singlePrecision && !broadphase),
+                  continuousCollisionRequest_(10, 0.0001, fcl::CCDM_SCREW, fcl::GST_LIBCCD, fcl::CCDC_CONSERVATIVE_ADVANCEMENT)
             {
+#if FCL_MAJOR_VERSION==0 && FCL_MINOR_VERSION<6
+                if (singlePrecision_)
+                {
+                    OMPL_WARN("Single precision collision models require FCL 0.6 or later. Using double precision.");
+                    singlePrecision_ = false;
+                }
+#else
+                if (singlePrecision && broadphase)
+                    OMPL_WARN("Single precision collision models are not used with a broadphase environment");
+#endif
                 configure(geom);
             }
 
+            /// \brief Add the meshes of \e scene to the environment as one
+            /// collision object with transform \e tf, identified by \e id.
+            /// The object gets its own BVH and is kept in a broadphase
+            /// structure next to the rest of the environment, so adding,
+            /// moving, and removing it takes time proportional to the size of
+            /// \e scene only. An object with the same \e id is replaced.
+            /// Must not be called while other threads use this object.
+            void setObstacle(unsigned int id, const aiScene *scene, const Transform &tf)
+            {
+                removeObstacle(id);
+                std::pair<std::vector<Vector3>, std::vector<fcl::Triangle>> tri_model =
+                    getFCLModelFromScene(scene, aiVector3D(0.0, 0.0, 0.0));
+                auto *model = new Model();
+                CollisionGeometryPtr geometry(model);
+                model->beginModel();
+                model->addSubModel(tri_model.first, tri_model.second);
+                model->endModel();
+                model->computeLocalAABB();
+
+                std::unique_ptr<CollisionObject> object(new CollisionObject(geometry, tf));
+                if (!environmentManager_)
+                    environmentManager_.reset(new BroadPhaseManager());
+                environmentManager_->registerObject(object.get());
+                obstacles_[id] = std::move(object);
+                OMPL_DEBUG("Added obstacle %u with %d triangles", id, model->num_tris);
+            }
+
+#if OMPL_HAS_OCTOMAP
+            /// \brief Add the occupied cells of \e tree to the environment
+            /// as one collision object with transform \e tf, identified by
+            /// \e id, like setObstacle(). The tree is referenced, not copied,
+            /// and queries traverse it directly, so no mesh is built. After
+            /// the tree changes, such as when a new scan is inserted, call
+            /// this function again to update the bounding box of the object;
+            /// that takes constant time. An object with the same \e id is
+            /// replaced. Must not be called while other threads use this
+            /// object.
+            void setOctreeObstacle(unsigned int id, const std::shared_ptr<const octomap::OcTree> &tree, const Transform &tf)
+            {
+                removeObstacle(id);
+#if FCL_MAJOR_VERSION==0 && FCL_MINOR_VERSION<6
+                // FCL 0.5 keeps the tree in a boost::shared_ptr
+                boost::shared_ptr<const octomap::OcTree> boostTree(tree.get(), [tree](const octomap::OcTree*) {});
+                auto *octree = new fcl::OcTree(boostTree);
+#else
+                auto *octree = new fcl::OcTree<double>(tree);
+#endif
+                CollisionGeometryPtr geometry(octree);
+                octree->computeLocalAABB();
+
+                std::unique_ptr<CollisionObject> object(new CollisionObject(geometry, tf));
+                if (!environmentManager_)
+                    environmentManager_.reset(new BroadPhaseManager());
+                environmentManager_->registerObject(object.get());
+                obstacles_[id] = std::move(object);
+                ++octreeObstacles_;
+                OMPL_DEBUG("Added octree obstacle %u with %lu leaves", id, (unsigned long)tree->getNumLeafNodes());
+            }
+#endif
+
+            /// \brief Change the transform of the object added as \e id by
+            /// setObstacle(). Returns false if there is no such object. Must
+            /// not be called while other threads use this object.
+            bool moveObstacle(unsigned int id, const Transform &tf)
+            {
+                auto it = obstacles_.find(id);
+                if (it == obstacles_.end())
+                    return false;
+                it->second->setTransform(tf);
+                it->second->computeAABB();
+                environmentManager_->update(it->second.get());
+                return true;
+            }
+
+            /// \brief Remove the object added as \e id by setObstacle().
+            /// Returns false if there is no such object. Must not be called
+            /// while other threads use this object.
+            bool removeObstacle(unsigned int id)
+            {
+                auto it = obstacles_.find(id);
+                if (it == obstacles_.end())
+                    return false;
+                if (it->second->collisionGeometry()->getObjectType() != fcl::OT_BVH)
+                    --octreeObstacles_;
+                environmentManager_->unregisterObject(it->second.get());
+                obstacles_.erase(it);
+                return true;
+            }
+
+            /// \brief Return true if an obstacle was added by
+            /// setOctreeObstacle(). The continuous collision check
+            /// isValid(s1, s2, collisionTime) does not see such obstacles.
+            bool hasOctreeObstacles() const
+            {
+                return octreeObstacles_ > 0;
+            }
+
             virtual ~FCLMethodWrapper()
             {
                 for (auto & robotPart : robotParts_)
@@ -103,69 +265,137 @@ namespace ompl
             /// environment or itself.
             virtual bool isValid(const base::State *state) const
             {
-#if FCL_MAJOR_VERSION==0 && FCL_MINOR_VERSION<6
-                static Transform identity;
-#else
-                static Transform identity(Transform::Identity());
-#endif
                 CollisionRequest collisionRequest;
                 CollisionResult collisionResult;
-                Transform transform;
+                return isStateValid(state, collisionRequest, collisionResult);
+            }
 
-                if (environment_.num_tris > 0)
+            /// \brief Checks whether the given robot state collides with the
+            /// environment or itself, looking up the environment test of
+            /// every robot part in \e cache first. The cache is called as
+            /// \c cache.isFree(state,i,check), where \c check() performs
+            /// the test of part \e i. Self collisions are always checked.
+            template<typename Cache>
+            bool isValid(const base::State *state, const Cache &cache) const
+            {
+                CheckerStatistics::Slot *stats = statistics_.slot();
+                CollisionRequest collisionRequest;
+                CollisionResult collisionResult;
+                PoseBuffer poses(robotParts_.size());
+                computePoses(state, poses, stats);
+                if (stats != nullptr)
+                    stats->add(CheckerStatistics::QUERIES);
+
+                bool valid = true;
                 {
-                    // Performing collision checking with environment.
-                    for (std::size_t i = 0; i < robotParts_.size(); ++i)
-                    {
-                        poseFromStateCallback_(transform, extractState_(state, i));
-                        if (fcl::collide(robotParts_[i], transform, &environment_,
-                            identity, collisionRequest, collisionResult) > 0)
-                            return false;
-                    }
+                    CheckerStatistics::Timer timer(stats, CheckerStatistics::ENVIRONMENT);
+                    for (std::size_t i = 0; valid && i < robotParts_.size(); ++i)
+                        valid = cache.isFree(state, i,
+                            [&]
+                            {
+                                return isPartEnvironmentCollisionFree(poses[i], i, collisionRequest, collisionResult, stats);
+                            });
                 }
-
-                // Checking for self collision
-                if (selfCollision_)
+                if (valid)
                 {
-                    Transform trans_i, trans_j;
-                    for (std::size_t i = 0 ; i < robotParts_.size(); ++i)
-                    {
-                        poseFromStateCallback_(trans_i, extractState_(state, i));
+                    CheckerStatistics::Timer timer(stats, CheckerStatistics::SELF_COLLISION);
+                    valid = isSelfCollisionFree(poses.data(), collisionRequest, collisionResult, stats);
+                }
+                if (!valid && stats != nullptr)
+                    stats->add(CheckerStatistics::COLLISIONS);
+                return valid;
+            }
 
-                        for (std::size_t j  = i + 1 ; j < robotParts_.size(); ++j)
-                        {
-                            poseFromStateCallback_(trans_j, extractState_(state, j));
-                            if (fcl::collide(robotParts_[i], trans_i, robotParts_[j], trans_j,
-                                collisionRequest, collisionResult) > 0)
-                                return false;
-                        }
-                    }
+            /// \brief Checks whether the robot collides with the environment
+            /// or itself when every part \e i is at the pose that \e poseOf
+            /// sets, called as \c poseOf(tf,i). Unlike isValid(), the poses
+            /// are not computed through the state extractor and the pose
+            /// callback, so a caller that knows the layout of its states at
+            /// compile time gets the conversion inlined.
+            template<typename PoseOf>
+            bool isValidAt(const PoseOf &poseOf) const
+            {
+                CheckerStatistics::Slot *stats = statistics_.slot();
+                CollisionRequest collisionRequest;
+                CollisionResult collisionResult;
+                PoseBuffer poses(robotParts_.size());
+                {
+                    CheckerStatistics::Timer timer(stats, CheckerStatistics::POSE_CONVERSION);
+                    for (std::size_t i = 0; i < robotParts_.size(); ++i)
+                        poseOf(poses[i], i);
                 }
+                return isPoseValid(poses.data(), collisionRequest, collisionResult, stats);
+            }
 
-                return true;
+            /// \brief Checks a batch of robot states for collisions with the
+            /// environment or itself. On return, \e valid[i] is true iff
+            /// \e states[i] is collision free. The FCL request and result
+            /// objects are set up once and reused for all states. If \e
+            /// numThreads is larger than one, the batch is split in contiguous
+            /// chunks that are checked concurrently.
+            virtual void isValidBatch(const std::vector<const base::State*> &states, std::vector<bool> &valid,
+                                      unsigned int numThreads = 1) const
+            {
+                runBatch(states.size(), numThreads, valid,
+                    [this, &states](std::size_t k, const CollisionRequest &request, CollisionResult &result)
+                    {
+                        return isStateValid(states[k], request, result);
+                    });
+            }
+
+            /// \brief Checks a batch of precomputed robot poses. \e poses
+            /// contains \e count groups of transforms, one transform per
+            /// robot part; on return, \e valid[k] is true iff the robot is
+            /// collision free when its parts are at poses[k * n], ...,
+            /// poses[k * n + n - 1], where n is the number of robot parts.
+            virtual void isValidBatch(const Transform *poses, std::size_t count, std::vector<bool> &valid,
+                                      unsigned int numThreads = 1) const
+            {
+                const std::size_t n = robotParts_.size();
+                runBatch(count, numThreads, valid,
+                    [this, poses, n](std::size_t k, const CollisionRequest &request, CollisionResult &result)
+                    {
+                        return isPoseValid(poses + k * n, request, result, statistics_.slot());
+                    });
             }
 
             /// \brief Check the continuous motion between s1 and s2.  If there is a collision
             /// collisionTime will contain the parameterized time to collision in the range [0,1).
+            /// FCL has no continuous collision checking for octrees, so
+            /// obstacles added by setOctreeObstacle() are skipped; see
+            /// hasOctreeObstacles().
             virtual bool isValid(const base::State *s1, const base::State *s2, double &collisionTime) const
             {
-                Transform transi_beg, transi_end, trans;
-                ContinuousCollisionRequest collisionRequest(10, 0.0001, fcl::CCDM_SCREW,
-                    fcl::GST_LIBCCD, fcl::CCDC_CONSERVATIVE_ADVANCEMENT);
+                Transform trans;
+                const ContinuousCollisionRequest &collisionRequest = continuousCollisionRequest_;
                 ContinuousCollisionResult collisionResult;
+                CheckerStatistics::Slot *stats = statistics_.slot();
+                if (stats != nullptr)
+                    stats->add(CheckerStatistics::CCD_QUERIES);
+
+                // Getting the translation and rotation of all parts from s1 and s2
+                PoseBuffer begin(robotParts_.size()), end(robotParts_.size());
+                computePoses(s1, begin, stats);
+                computePoses(s2, end, stats);
+                CheckerStatistics::Timer timer(stats, CheckerStatistics::CONTINUOUS);
+
+                // The bounds of the parts during the motion; parts and
+                // environment objects whose bounds do not overlap cannot collide
+                std::vector<SweptBounds> bounds;
+                const bool cull = sweptPartBounds(begin.data(), end.data(), bounds);
 
                 // Checking for collision with environment
-                if (environment_.num_tris > 0)
+                if (environment_->num_tris > 0)
                 {
                     for (size_t i = 0; i < robotParts_.size(); ++i)
                     {
-                        // Getting the translation and rotation from s1 and s2
-                        poseFromStateCallback_(transi_beg, extractState_(s1, i));
-                        poseFromStateCallback_(transi_end, extractState_(s2, i));
-
+                        if (cull && !bounds[i].overlaps(environment_->aabb_local.min_, environment_->aabb_local.max_))
+                            continue;
                         // Checking for collision
-                        fcl::continuousCollide(robotParts_[i], transi_beg, transi_end,
-                            &environment_, trans, trans,
+                        if (stats != nullptr)
+                            stats->add(CheckerStatistics::CCD_TESTS);
+                        fcl::continuousCollide(robotParts_[i], begin[i], end[i],
+                            environment_.get(), trans, trans,
                             collisionRequest, collisionResult);
                         if (collisionResult.is_collide)
                         {
@@ -174,24 +404,71 @@ namespace ompl
                         }
                     }
                 }
+#if !(FCL_MAJOR_VERSION==0 && FCL_MINOR_VERSION<6)
+                if (environmentF_)
+                {
+                    const fcl::ContinuousCollisionRequest<float> request(collisionRequest.num_max_iterations,
+                        collisionRequest.toc_err, collisionRequest.ccd_motion_type, collisionRequest.gjk_solver_type,
+                        collisionRequest.ccd_solver_type);
+                    fcl::ContinuousCollisionResult<float> result;
+                    const TransformF identity(TransformF::Identity());
+                    for (size_t i = 0; i < robotParts_.size(); ++i)
+                    {
+                        if (cull && !bounds[i].overlaps(environmentF_->aabb_local.min_, environmentF_->aabb_local.max_))
+                            continue;
+                        if (stats != nullptr)
+                            stats->add(CheckerStatistics::CCD_TESTS);
+                        fcl::continuousCollide(robotPartsF_[i].get(), begin[i].cast<float>(), end[i].cast<float>(),
+                            environmentF_.get(), identity, identity, request, result);
+                        if (result.is_collide)
+                        {
+                            collisionTime = result.time_of_contact;
+                            return false;
+                        }
+                    }
+                }
+#endif
+                if (environmentManager_)
+                {
+                    // Continuous collision checking against the individual environment objects
+                    std::vector<CollisionObject*> objects;
+                    environmentManager_->getObjects(objects);
+                    for (size_t i = 0; i < robotParts_.size(); ++i)
+                    {
+                        for (const auto *object : objects)
+                        {
+                            if (cull && !bounds[i].overlaps(object->getAABB().min_, object->getAABB().max_))
+                                continue;
+                            if (object->collisionGeometry()->getObjectType() != fcl::OT_BVH)
+                                continue;
+                            if (stats != nullptr)
+                                stats->add(CheckerStatistics::CCD_TESTS);
+                            fcl::continuousCollide(robotParts_[i], begin[i], end[i],
+                                object->collisionGeometry().get(), object->getTransform(), object->getTransform(),
+                                collisionRequest, collisionResult);
+                            if (collisionResult.is_collide)
+                            {
+                                collisionTime = collisionResult.time_of_contact;
+                                return false;
+                            }
+                        }
+                    }
+                }
 
                 // Checking for self collision
                 if (selfCollision_)
                 {
-                    Transform transj_beg, transj_end;
                     for (std::size_t i = 0 ; i < robotParts_.size(); ++i)
                     {
-                        poseFromStateCallback_(transi_beg, extractState_(s1, i));
-                        poseFromStateCallback_(transi_end, extractState_(s2, i));
-
                         for (std::size_t j = i+1; j < robotParts_.size(); ++j)
                         {
-                            poseFromStateCallback_(transj_beg, extractState_(s1, j));
-                            poseFromStateCallback_(transj_end, extractState_(s2, j));
-
+                            if (cull && !bounds[i].overlaps(bounds[j]))
+                                continue;
                             // Checking for collision
-                            fcl::continuousCollide(robotParts_[i], transi_beg, transi_end,
-                                 robotParts_[j], transj_beg, transj_end,
+                            if (stats != nullptr)
+                                stats->add(CheckerStatistics::CCD_TESTS);
+                            fcl::continuousCollide(robotParts_[i], begin[i], end[i],
+                                 robotParts_[j], begin[j], end[j],
                                  collisionRequest, collisionResult);
                             if (collisionResult.is_collide)
                             {
@@ -204,70 +481,1212 @@ namespace ompl
                 return true;
             }
 
-            /// \brief Returns the minimum distance from the given robot state and the environment
+            /// \brief An axis aligned box that contains a robot part during a continuous motion
+            struct SweptBounds
+            {
+                double low[3];
+                double high[3];
+
+                template<typename V>
+                bool overlaps(const V &otherLow, const V &otherHigh) const
+                {
+                    for (int k = 0; k < 3; ++k)
+                        if (high[k] < otherLow[k] || otherHigh[k] < low[k])
+                            return false;
+                    return true;
+                }
+
+                bool overlaps(const SweptBounds &other) const
+                {
+                    return overlaps(other.low, other.high);
+                }
+            };
+
+            /// \brief Compute the boxes that contain the robot parts while
+            /// they move from \e begin to \e end with the motion type of the
+            /// continuous collision settings. Every point of part \e i stays
+            /// within the radius of the part (see getPartRadii()) of the
+            /// origin of its frame. For translations and linear
+            /// interpolation, the origin moves on the segment between its
+            /// poses. For screw motions, it moves on a helix through both
+            /// poses, which gets at most 1/sin(1) times the distance between
+            /// them away from the segment, since FCL turns by at most pi.
+            /// Returns false, and leaves \e bounds empty, for motions that
+            /// are not bounded this way (splines, and screw motions before
+            /// FCL 0.6, which may turn the long way round).
+            bool sweptPartBounds(const Transform *begin, const Transform *end, std::vector<SweptBounds> &bounds) const
+            {
+                double deviation;
+                switch (continuousCollisionRequest_.ccd_motion_type)
+                {
+                    case fcl::CCDM_TRANS:
+                    case fcl::CCDM_LINEAR:
+                        deviation = 0.0;
+                        break;
+#if !(FCL_MAJOR_VERSION==0 && FCL_MINOR_VERSION<6)
+                    case fcl::CCDM_SCREW:
+                        deviation = 1.0 / std::sin(1.0);
+                        break;
+#endif
+                    default:
+                        bounds.clear();
+                        return false;
+                }
+                bounds.resize(robotParts_.size());
+                for (std::size_t i = 0; i < robotParts_.size(); ++i)
+                {
+#if FCL_MAJOR_VERSION==0 && FCL_MINOR_VERSION<6
+                    const Vector3 &a = begin[i].getTranslation();
+                    const Vector3 &b = end[i].getTranslation();
+#else
+                    const Vector3 a = begin[i].translation();
+                    const Vector3 b = end[i].translation();
+#endif
+                    double d2 = 0.0;
+                    for (int k = 0; k < 3; ++k)
+                        d2 += (b[k] - a[k]) * (b[k] - a[k]);
+                    const double margin = partRadii_[i] + deviation * std::sqrt(d2);
+                    for (int k = 0; k < 3; ++k)
+                    {
+                        bounds[i].low[k] = std::min(a[k], b[k]) - margin;
+                        bounds[i].high[k] = std::max(a[k], b[k]) + margin;
+                    }
+                }
+                return true;
+            }
+
+            /// \brief Set the settings used for continuous collision checking.
+            /// This is not thread safe and should only be called while no
+            /// queries are running.
+            void setContinuousCollisionRequest(const ContinuousCollisionRequest &request)
+            {
+                continuousCollisionRequest_ = request;
+            }
+
+            /// \brief Get the settings used for continuous collision checking
+            const ContinuousCollisionRequest& getContinuousCollisionRequest() const
+            {
+                return continuousCollisionRequest_;
+            }
+
+            /// \brief Returns the minimum distance from the given robot state
+            /// and the environment. If a relative error was set with
+            /// setClearanceRelativeError(), the result may exceed the exact
+            /// distance by that fraction.
             virtual double clearance(const base::State *state) const
             {
+                DistanceRequest distanceRequest;
+                distanceRequest.rel_err = clearanceRelErr_;
+                double minDist = std::numeric_limits<double>::infinity();
+                CheckerStatistics::Slot *stats = statistics_.slot();
+                PoseBuffer poses(robotParts_.size());
+                computePoses(state, poses, stats);
+                CheckerStatistics::Timer timer(stats, CheckerStatistics::DISTANCE);
+                for (std::size_t i = 0; i < robotParts_.size(); ++i)
+                    minDist = std::min(minDist, partDistance(poses[i], i, distanceRequest, stats));
+                return minDist;
+            }
+
+            /// \brief Return true if the distance between the robot at \e
+            /// state and the environment is larger than \e threshold. This
+            /// is cheaper than clearance(): every distance query starts with
+            /// \e threshold as its best distance, so FCL skips all pairs of
+            /// bounding volumes that are further apart, and stops once a
+            /// closer pair of triangles is found. The remaining parts are
+            /// skipped once one part is too close.
+            virtual bool clearanceExceeds(const base::State *state, double threshold) const
+            {
+                if (threshold < 0.0)
+                    threshold = 0.0;
+                // distances not below the bound are reported as the bound
+                const double bound = std::nextafter(threshold, std::numeric_limits<double>::infinity());
+                DistanceRequest distanceRequest;
+                CheckerStatistics::Slot *stats = statistics_.slot();
+                PoseBuffer poses(robotParts_.size());
+                computePoses(state, poses, stats);
+                CheckerStatistics::Timer timer(stats, CheckerStatistics::DISTANCE);
+                for (std::size_t i = 0; i < robotParts_.size(); ++i)
+                    if (partDistance(poses[i], i, distanceRequest, stats, bound) < bound)
+                        return false;
+                return true;
+            }
+
+            /// \brief Allow clearance() to overestimate distances by the
+            /// fraction \e relErr, which lets FCL prune more of the
+            /// environment. Zero (the default) computes exact distances.
+            /// This is not thread safe and should only be called while no
+            /// queries are running.
+            void setClearanceRelativeError(double relErr)
+            {
+                clearanceRelErr_ = std::max(0.0, relErr);
+            }
+
+            /// \brief Get the value set by setClearanceRelativeError()
+            double getClearanceRelativeError() const
+            {
+                return clearanceRelErr_;
+            }
+
+            /// \brief Compute the distance between each robot part and the
+            /// environment. On return, \e dist[i] is the distance for part
+            /// \e i, which is zero or negative if the part is in collision.
+            virtual void partClearances(const base::State *state, std::vector<double> &dist) const
+            {
+                DistanceRequest distanceRequest;
+                dist.resize(robotParts_.size());
+                PoseBuffer poses(robotParts_.size());
+                computePoses(state, poses);
+                for (std::size_t i = 0; i < robotParts_.size(); ++i)
+                    dist[i] = partDistance(poses[i], i, distanceRequest);
+            }
+
+            /// \brief Compute the distance between every pair of robot parts
+            /// that is checked for self collisions. On return, \e dist
+            /// contains the distances of the pairs (0,1), (0,2), ..., (1,2),
+            /// ..., in that order, or is empty if self collisions are not
+            /// checked.
+            virtual void selfClearances(const base::State *state, std::vector<double> &dist) const
+            {
+                dist.clear();
+                if (!selfCollision_)
+                    return;
+                PoseBuffer poses(robotParts_.size());
+                computePoses(state, poses);
+                for (std::size_t i = 0 ; i < robotParts_.size(); ++i)
+                    for (std::size_t j = i + 1 ; j < robotParts_.size(); ++j)
+                    {
+                        DistanceRequest distanceRequest(true);
+                        DistanceResult distanceResult;
+                        fcl::distance(robotParts_[i], poses[i], robotParts_[j], poses[j], distanceRequest, distanceResult);
+                        dist.push_back(distanceResult.min_distance);
+                    }
+            }
+
+            /// \brief Checks whether the robot parts at the given state collide with each other
+            virtual bool isSelfCollisionFree(const base::State *state) const
+            {
+                if (!selfCollision_)
+                    return true;
+                CollisionRequest collisionRequest;
+                CollisionResult collisionResult;
+                PoseBuffer poses(robotParts_.size());
+                computePoses(state, poses);
+                return isSelfCollisionFree(poses.data(), collisionRequest, collisionResult);
+            }
+
+            /// \brief Return the number of robot parts
+            std::size_t getPartCount() const
+            {
+                return robotParts_.size();
+            }
+
+            /// \brief Return, for every robot part, the maximum distance of a
+            /// point of the part from the origin of its frame
+            std::vector<double> getPartRadii() const
+            {
+                std::vector<double> radii;
+                for (const auto *part : robotParts_)
+                {
+                    double r2 = 0.0;
+                    for (int k = 0; k < part->num_vertices; ++k)
+                    {
+                        const Vector3 &v = part->vertices[k];
+                        r2 = std::max(r2, (double)(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]));
+                    }
+                    radii.push_back(sqrt(r2));
+                }
+                return radii;
+            }
+
+            /// \brief Return the callback that extracts the geometric component of a robot part from a state
+            const GeometricStateExtractor& getStateExtractor() const
+            {
+                return extractState_;
+            }
+
+            /// \brief Enable or disable the sphere tree first pass. When
+            /// enabled, a hierarchy of bounding spheres is built for every
+            /// robot part, and a part whose spheres are collision free is
+            /// accepted without checking its mesh against the environment.
+            /// This has no effect if the environment is split into separate
+            /// objects for broadphase collision checking. Must not be called
+            /// while other threads use this object.
+            void setSphereTrees(bool enable)
+            {
+                sphereTrees_.clear();
+                if (!enable)
+                    return;
+                for (const auto *part : robotParts_)
+                {
+                    std::vector<aiVector3D> triangles;
+                    triangles.reserve(3 * part->num_tris);
+                    for (int t = 0 ; t < part->num_tris ; ++t)
+                        for (int k = 0 ; k < 3 ; ++k)
+                        {
+                            const Vector3 &v = part->vertices[part->tri_indices[t][k]];
+                            triangles.emplace_back(v[0], v[1], v[2]);
+                        }
+                    sphereTrees_.emplace_back(triangles);
+                }
+            }
+
+            /// \brief Return true if the sphere tree first pass is enabled
+            bool getSphereTrees() const
+            {
+                return !sphereTrees_.empty();
+            }
+
+            /// \brief Enable or disable the coarse environment first pass.
+            /// When enabled, a simplified copy of the environment with about
+            /// \e ratio times its triangles is built by merging the vertices
+            /// in every cell of a grid (see clusterVerticesToRatio()). Every
+            /// point of the environment is within the largest distance a
+            /// vertex moved, the margin, of the copy, so a robot part that
+            /// is further than the margin from the copy cannot touch the
+            /// environment, and is accepted without checking the full model.
+            /// The test collides the bounding box of every part, grown by the
+            /// margin, with the copy. Only parts close to obstacles
+            /// are checked against the full model, which pays off for
+            /// detailed environments with a lot of free space, such as
+            /// scans. Copies of identical environments are shared. This has
+            /// no effect if the environment is split into separate objects
+            /// for broadphase collision checking or stored in single
+            /// precision. Must not be called while other threads use this
+            /// object.
+            void setCoarseEnvironment(bool enable, double ratio = 0.03)
+            {
+                coarseEnvironment_.reset();
+                if (!enable || environment_->num_tris == 0)
+                    return;
+                std::vector<Vector3> points(environment_->vertices, environment_->vertices + environment_->num_vertices);
+                std::vector<fcl::Triangle> triangles(environment_->tri_indices, environment_->tri_indices + environment_->num_tris);
+                GeometryKey key = triangleKey(points, triangles);
+                key.first = fnv1a(key.first, ratio);
+                coarseEnvironment_ = GeometryRegistry<const CoarseEnvironment>::get(key,
+                    [&points, &triangles, ratio]
+                    {
+                        std::vector<Vector3> coarsePoints;
+                        std::vector<fcl::Triangle> coarseTriangles;
+                        auto coarse = std::make_shared<CoarseEnvironment>();
+                        coarse->margin = clusterVerticesToRatio(points, triangles, ratio, coarsePoints, coarseTriangles);
+                        coarse->model = std::make_shared<Model>();
+                        coarse->model->beginModel();
+                        coarse->model->addSubModel(coarsePoints, coarseTriangles);
+                        coarse->model->endModel();
+                        coarse->model->computeLocalAABB();
+                        return coarse;
+                    });
+                OMPL_INFORM("Coarse environment model with %d of %d triangles, margin %g (%lu bytes)",
+                            coarseEnvironment_->model->num_tris, environment_->num_tris, coarseEnvironment_->margin,
+                            (unsigned long)getModelMemory(*coarseEnvironment_->model));
+            }
+
+            /// \brief Return true if the coarse environment first pass is enabled
+            bool getCoarseEnvironment() const
+            {
+                return coarseEnvironment_ != nullptr;
+            }
+
+            /// \brief Check the robot against the environment with convex
+            /// pieces instead of the meshes of its parts: \e hulls[i] are the
+            /// pieces of part \e i in the frame of the part, and together
+            /// contain its triangles (see computeConvexDecomposition()).
+            /// Collision checks and distance queries against the environment
+            /// then use GJK/EPA on the pieces, which is much cheaper than
+            /// traversing a detailed mesh. Since the pieces contain the parts,
+            /// they can only report more collisions and smaller distances.
+            /// Continuous collision checking, self collisions, and single
+            /// precision environments still use the meshes. An empty \e hulls
+            /// goes back to the meshes. Requires FCL 0.6.1 or later. Must not
+            /// be called while other threads use this object.
+            void setConvexParts(const std::vector<std::vector<ConvexHull>> &hulls)
+            {
+                convexParts_.clear();
+                convexObjects_.clear();
+                if (hulls.empty())
+                    return;
+                if (hulls.size() != robotParts_.size())
+                    throw Exception("The number of convex decompositions does not match the number of robot parts");
+#if FCL_MAJOR_VERSION==0 && (FCL_MINOR_VERSION<6 || (FCL_MINOR_VERSION==6 && FCL_PATCH_VERSION<1))
+                OMPL_WARN("Convex robot parts require FCL 0.6.1 or later. Using the meshes.");
+#else
+                unsigned int count = 0;
+                for (const auto &part : hulls)
+                {
+                    convexParts_.emplace_back();
+                    convexObjects_.emplace_back();
+                    for (const auto &hull : part)
+                    {
+                        auto vertices = std::make_shared<std::vector<Vector3>>();
+                        vertices->reserve(hull.vertices.size());
+                        for (const auto &v : hull.vertices)
+                            vertices->emplace_back(v.x, v.y, v.z);
+                        // every face is stored as its number of vertices followed by their indices
+                        auto faces = std::make_shared<std::vector<int>>();
+                        faces->reserve(4 * hull.faces.size());
+                        for (const auto &f : hull.faces)
+                            faces->insert(faces->end(), {3, (int)f[0], (int)f[1], (int)f[2]});
+                        auto convex = std::make_shared<fcl::Convex<double>>(vertices, (int)hull.faces.size(), faces);
+                        convex->computeLocalAABB();
+                        convexParts_.back().push_back(convex);
+                        convexObjects_.back().emplace_back(new CollisionObject(convex));
+                        ++count;
+                    }
+                }
+                OMPL_INFORM("Using %u convex pieces for %lu robot parts", count, (unsigned long)robotParts_.size());
+#endif
+            }
+
+            /// \brief Return true if the environment is checked with convex pieces, see setConvexParts()
+            bool hasConvexParts() const
+            {
+                return !convexParts_.empty();
+            }
+
+            /// \brief The counters and timers of the queries (disabled by default)
+            CheckerStatistics& getStatistics() const
+            {
+                return statistics_;
+            }
+
+            /// \brief Return true if the environment is stored in single precision
+            bool isSinglePrecision() const
+            {
+                return singlePrecision_;
+            }
+
+            /// \brief The distance by which the robot parts are inflated for
+            /// queries against a single precision environment (zero if the
+            /// environment is stored in double precision)
+            double getPrecisionMargin() const
+            {
+                return precisionMargin_;
+            }
+
+            /// \brief Approximate number of bytes used by the collision
+            /// models of the robot and the environment, including the
+            /// separate environment objects and obstacles
+            std::size_t getModelMemory() const
+            {
+                std::size_t bytes = getModelMemory(*environment_);
+                if (coarseEnvironment_)
+                    bytes += getModelMemory(*coarseEnvironment_->model);
+                for (const auto *part : robotParts_)
+                    bytes += getModelMemory(*part);
+#if !(FCL_MAJOR_VERSION==0 && FCL_MINOR_VERSION<6)
+                if (environmentF_)
+                    bytes += getModelMemory(*environmentF_);
+                for (const auto &part : robotPartsF_)
+                    bytes += getModelMemory(*part);
+#endif
+                for (const auto &object : environmentObjects_)
+                    bytes += getObjectMemory(*object);
+                for (const auto &obstacle : obstacles_)
+                    bytes += getObjectMemory(*obstacle.second);
+                return bytes;
+            }
+
+            /// \brief The volume swept by the robot parts along a motion, see sweepRobot()
+            using SweptVolume = std::vector<CollisionGeometryPtr>;
+
+            /// \brief Build, for every robot part, one model that contains
+            /// the triangles of the part at every state of \e states. The
+            /// states describe a motion that starts at the identity pose;
+            /// isSweptVolumeCollisionFree() places the volume at the start
+            /// of a motion. The parts must move rigidly with the state, as
+            /// the parts of a single robot do. The volume covers the robot
+            /// at the given states only, so it is as fine as the states are.
+            SweptVolume sweepRobot(const std::vector<const base::State*> &states) const
+            {
+                SweptVolume volume;
+                Transform pose;
+                for (std::size_t i = 0; i < robotParts_.size(); ++i)
+                {
+                    const Model *part = robotParts_[i];
+                    std::vector<Vector3> points;
+                    std::vector<fcl::Triangle> triangles;
+                    points.reserve(states.size() * part->num_vertices);
+                    triangles.reserve(states.size() * part->num_tris);
+                    for (const auto *state : states)
+                    {
+                        poseFromStateCallback_(pose, extractState_(state, i));
+                        const std::size_t offset = points.size();
+                        for (int k = 0; k < part->num_vertices; ++k)
+                            points.push_back(transformPoint(pose, part->vertices[k]));
+                        for (int t = 0; t < part->num_tris; ++t)
+                        {
+                            const fcl::Triangle &tri = part->tri_indices[t];
+                            triangles.emplace_back(offset + tri[0], offset + tri[1], offset + tri[2]);
+                        }
+                    }
+                    auto *model = new Model();
+                    volume.emplace_back(model);
+                    model->beginModel();
+                    model->addSubModel(points, triangles);
+                    model->endModel();
+                    model->computeLocalAABB();
+                }
+                return volume;
+            }
+
+            /// \brief Return true if \e volume, built by sweepRobot() and
+            /// moved to \e start, does not collide with the environment:
+            /// one query per robot part replaces the checks of all the
+            /// states of the motion. Self collisions are not checked.
+            /// Single precision environments are not supported (see
+            /// isSinglePrecision()).
+            bool isSweptVolumeCollisionFree(const SweptVolume &volume, const base::State *start) const
+            {
+                if (singlePrecision_)
+                    throw Exception("Swept volumes cannot be checked against single precision environments");
+#if FCL_MAJOR_VERSION==0 && FCL_MINOR_VERSION<6
+                static Transform identity;
+#else
+                static Transform identity(Transform::Identity());
+#endif
+                CheckerStatistics::Slot *stats = statistics_.slot();
+                CollisionRequest collisionRequest;
+                CollisionResult collisionResult;
+                Transform pose;
+                for (std::size_t i = 0; i < volume.size() && i < robotParts_.size(); ++i)
+                {
+                    poseFromStateCallback_(pose, extractState_(start, i));
+                    if (stats != nullptr)
+                        stats->add(CheckerStatistics::NARROWPHASE_TESTS);
+                    if (environment_->num_tris > 0 &&
+                        fcl::collide(volume[i].get(), pose, environment_.get(), identity, collisionRequest, collisionResult) > 0)
+                        return false;
+                    if (environmentManager_)
+                    {
+                        BroadPhaseCollisionData data{&collisionRequest, &collisionResult, false, stats};
+                        CollisionObject object(volume[i], pose);
+                        environmentManager_->collide(&object, &data, &broadPhaseCollisionCallback);
+                        if (data.collision)
+                            return false;
+                    }
+                }
+                return true;
+            }
+
+         protected:
+
+            /// \brief Maximum number of robot parts for which a PoseBuffer does not allocate memory
+            static const std::size_t MAX_STACK_PARTS = 16;
+
+            /// \brief The transforms of all robot parts for a single query.
+            /// Robots with up to MAX_STACK_PARTS parts are stored on the stack.
+            class PoseBuffer
+            {
+            public:
+                explicit PoseBuffer(std::size_t n) : poses_(stack_)
+                {
+                    if (n > MAX_STACK_PARTS)
+                    {
+                        heap_.resize(n);
+                        poses_ = heap_.data();
+                    }
+                }
+
+                PoseBuffer(const PoseBuffer&) = delete;
+                PoseBuffer& operator=(const PoseBuffer&) = delete;
+
+                Transform& operator[](std::size_t i)
+                {
+                    return poses_[i];
+                }
+
+                const Transform& operator[](std::size_t i) const
+                {
+                    return poses_[i];
+                }
+
+                const Transform* data() const
+                {
+                    return poses_;
+                }
+
+            private:
+                Transform       stack_[MAX_STACK_PARTS];
+                TransformVector heap_;
+                Transform      *poses_;
+            };
+
+         public:
+
+            /// \brief Checks the states of a sequence one after the other on a
+            /// single thread, such as the intermediate states of a
+            /// propagation. The pose buffer and the FCL request and result
+            /// objects are set up once and reused for every state.
+            class SequenceChecker
+            {
+            public:
+                explicit SequenceChecker(const FCLMethodWrapper &wrapper) : wrapper_(wrapper), poses_(wrapper.robotParts_.size())
+                {
+                }
+
+                /// \brief Checks whether the robot at \e state collides with the environment or itself
+                bool isValid(const base::State *state)
+                {
+                    CheckerStatistics::Slot *stats = wrapper_.statistics_.slot();
+                    collisionResult_.clear();
+                    wrapper_.computePoses(state, poses_, stats);
+                    return wrapper_.isPoseValid(poses_.data(), collisionRequest_, collisionResult_, stats);
+                }
+
+            private:
+                const FCLMethodWrapper &wrapper_;
+                PoseBuffer              poses_;
+                CollisionRequest        collisionRequest_;
+                CollisionResult         collisionResult_;
+            };
+
+         protected:
+
+            /// \brief Evaluate \e check(k, request, result) for k = 0, ...,
+            /// \e count - 1 and store the results in \e valid. The FCL request
+            /// and result objects are set up once per thread and reused. If
+            /// \e numThreads is larger than one, the batch is split in
+            /// contiguous chunks that are checked concurrently; zero selects
+            /// one thread per core.
+            template<typename F>
+            static void runBatch(std::size_t count, unsigned int numThreads, std::vector<bool> &valid, const F &check)
+            {
+                parallelBatch(count, numThreads, valid, [&check](std::size_t begin, std::size_t end, char *result)
+                    {
+                        CollisionRequest collisionRequest;
+                        CollisionResult collisionResult;
+                        for (std::size_t k = begin ; k < end ; ++k)
+                        {
+                            collisionResult.clear();
+                            result[k] = check(k, collisionRequest, collisionResult) ? 1 : 0;
+                        }
+                    });
+            }
+
+            /// \brief Collision check of a single state using caller provided
+            /// FCL request and result objects.
+            bool isStateValid(const base::State *state, const CollisionRequest &collisionRequest,
+                              CollisionResult &collisionResult) const
+            {
+                // The pose of every part is computed once and shared by the
+                // environment and the self collision pass
+                CheckerStatistics::Slot *stats = statistics_.slot();
+                PoseBuffer poses(robotParts_.size());
+                computePoses(state, poses, stats);
+                return isPoseValid(poses.data(), collisionRequest, collisionResult, stats);
+            }
+
+            /// \brief Collision check of the robot parts at \e poses, counted in \e stats (if not nullptr)
+            bool isPoseValid(const Transform *poses, const CollisionRequest &collisionRequest,
+                             CollisionResult &collisionResult, CheckerStatistics::Slot *stats) const
+            {
+                if (stats == nullptr)
+                    return isEnvironmentCollisionFree(poses, collisionRequest, collisionResult) &&
+                        isSelfCollisionFree(poses, collisionRequest, collisionResult);
+
+                stats->add(CheckerStatistics::QUERIES);
+                bool valid;
+                {
+                    CheckerStatistics::Timer timer(stats, CheckerStatistics::ENVIRONMENT);
+                    valid = isEnvironmentCollisionFree(poses, collisionRequest, collisionResult, stats);
+                }
+                if (valid)
+                {
+                    CheckerStatistics::Timer timer(stats, CheckerStatistics::SELF_COLLISION);
+                    valid = isSelfCollisionFree(poses, collisionRequest, collisionResult, stats);
+                }
+                if (!valid)
+                    stats->add(CheckerStatistics::COLLISIONS);
+                return valid;
+            }
+
+            /// \brief Check the robot parts at \e poses for collisions with the environment
+            bool isEnvironmentCollisionFree(const Transform *poses, const CollisionRequest &collisionRequest,
+                                            CollisionResult &collisionResult, CheckerStatistics::Slot *stats = nullptr) const
+            {
+                for (std::size_t i = 0; i < robotParts_.size(); ++i)
+                    if (!isPartEnvironmentCollisionFree(poses[i], i, collisionRequest, collisionResult, stats))
+                        return false;
+                return true;
+            }
+
+            /// \brief Check robot part \e i at \e pose for collisions with the environment
+            bool isPartEnvironmentCollisionFree(const Transform &pose, std::size_t i, const CollisionRequest &collisionRequest,
+                                                CollisionResult &collisionResult, CheckerStatistics::Slot *stats = nullptr) const
+            {
+#if FCL_MAJOR_VERSION==0 && FCL_MINOR_VERSION<6
+                static Transform identity;
+#else
+                static Transform identity(Transform::Identity());
+#endif
+                // the merged environment, then the objects in the broadphase
+                // manager (the separate meshes of the environment, or the
+                // obstacles added by setObstacle())
+                if (environment_->num_tris > 0 && !isCoarseCollisionFree(pose, i, stats) && (sphereTrees_.empty() || !sphereTrees_[i].isFree(
+                        [this, &pose, stats](const SphereTree::Sphere &sphere)
+                        {
+                            if (stats != nullptr)
+                                stats->add(CheckerStatistics::SPHERE_TESTS);
+                            return isSphereCollisionFree(pose, sphere);
+                        })))
+                {
+                    if (stats != nullptr)
+                        stats->add(CheckerStatistics::NARROWPHASE_TESTS);
+                    if (!convexParts_.empty())
+                    {
+                        for (const auto &piece : convexParts_[i])
+                            if (fcl::collide(piece.get(), pose, environment_.get(),
+                                    identity, collisionRequest, collisionResult) > 0)
+                                return false;
+                    }
+                    else if (fcl::collide(robotParts_[i], pose, environment_.get(),
+                            identity, collisionRequest, collisionResult) > 0)
+                        return false;
+                }
+#if !(FCL_MAJOR_VERSION==0 && FCL_MINOR_VERSION<6)
+                if (environmentF_)
+                {
+                    if (stats != nullptr)
+                        stats->add(CheckerStatistics::NARROWPHASE_TESTS);
+                    fcl::CollisionRequest<float> request(collisionRequest.num_max_contacts, collisionRequest.enable_contact);
+                    fcl::CollisionResult<float> result;
+                    if (fcl::collide(robotPartsF_[i].get(), pose.cast<float>(), environmentF_.get(),
+                            TransformF(TransformF::Identity()), request, result) > 0)
+                        return false;
+                }
+#endif
+                if (environmentManager_)
+                {
+                    // The broadphase manager only calls back for environment objects
+                    // whose bounding box overlaps that of the robot part
+                    BroadPhaseCollisionData data{&collisionRequest, &collisionResult, false, stats};
+                    if (!convexObjects_.empty())
+                    {
+                        for (const auto &piece : convexObjects_[i])
+                        {
+                            CollisionObject pieceObject(*piece);
+                            pieceObject.setTransform(pose);
+                            pieceObject.computeAABB();
+                            environmentManager_->collide(&pieceObject, &data, &broadPhaseCollisionCallback);
+                            if (data.collision)
+                                return false;
+                        }
+                        return true;
+                    }
+                    CollisionObject robotObject(*robotObjects_[i]);
+                    robotObject.setTransform(pose);
+                    robotObject.computeAABB();
+                    environmentManager_->collide(&robotObject, &data, &broadPhaseCollisionCallback);
+                    return !data.collision;
+                }
+                return true;
+            }
+
+            /// \brief Distance between robot part \e i at \e pose and the
+            /// environment. Distances of at least \e bound are not computed
+            /// and reported as \e bound, which lets FCL prune the pairs of
+            /// bounding volumes that are further apart.
+            double partDistance(const Transform &pose, std::size_t i, const DistanceRequest &distanceRequest,
+                                CheckerStatistics::Slot *stats = nullptr,
+                                double bound = std::numeric_limits<double>::infinity()) const
+            {
+                if (stats != nullptr)
+                    stats->add(CheckerStatistics::DISTANCE_QUERIES);
 #if FCL_MAJOR_VERSION==0 && FCL_MINOR_VERSION<6
                 static Transform identity;
 #else
                 static Transform identity(Transform::Identity());
 #endif
-                double minDist = std::numeric_limits<double>::infinity ();
-                if (environment_.num_tris > 0)
+                const bool bounded = bound < std::numeric_limits<double>::infinity();
+                double dist = bound;
+                if (environment_->num_tris > 0 && !convexParts_.empty())
+                {
+                    // the distance to the union of the pieces
+                    for (const auto &piece : convexParts_[i])
+                    {
+                        DistanceResult distanceResult;
+                        // FCL only replaces the distance of the result by smaller ones
+                        if (bounded)
+                            distanceResult.min_distance = dist;
+                        fcl::distance(piece.get(), pose, environment_.get(), identity, distanceRequest, distanceResult);
+                        dist = std::min(dist, distanceResult.min_distance);
+                    }
+                }
+                else if (environment_->num_tris > 0)
                 {
-                    DistanceRequest distanceRequest(true);
                     DistanceResult distanceResult;
-                    Transform trans;
-                    for (size_t i = 0; i < robotParts_.size (); ++i)
+                    if (bounded)
+                        distanceResult.min_distance = dist;
+                    fcl::distance(robotParts_[i], pose, environment_.get(), identity, distanceRequest, distanceResult);
+                    dist = distanceResult.min_distance;
+                }
+#if !(FCL_MAJOR_VERSION==0 && FCL_MINOR_VERSION<6)
+                if (environmentF_)
+                {
+                    // the inflated robot part makes this a lower bound of the distance
+                    fcl::DistanceRequest<float> request(distanceRequest.enable_nearest_points, distanceRequest.enable_signed_distance,
+                        distanceRequest.rel_err, distanceRequest.abs_err);
+                    fcl::DistanceResult<float> result;
+                    if (bounded)
+                    {
+                        // round up, so that no distance below the bound is reported for a free part
+                        float fbound = (float)std::min<double>(dist, std::numeric_limits<float>::max());
+                        if (fbound < dist)
+                            fbound = std::nextafter(fbound, std::numeric_limits<float>::infinity());
+                        result.min_distance = fbound;
+                    }
+                    fcl::distance(robotPartsF_[i].get(), pose.cast<float>(), environmentF_.get(),
+                        TransformF(TransformF::Identity()), request, result);
+                    dist = std::min<double>(dist, result.min_distance);
+                }
+#endif
+                if (environmentManager_ && dist > 0.)
+                {
+                    BroadPhaseDistanceData data{distanceRequest};
+                    if (bounded)
+                    {
+                        data.result.min_distance = dist;
+                        data.minDist = dist;
+                    }
+                    if (!convexObjects_.empty())
+                        for (const auto &piece : convexObjects_[i])
+                        {
+                            CollisionObject pieceObject(*piece);
+                            pieceObject.setTransform(pose);
+                            pieceObject.computeAABB();
+                            environmentManager_->distance(&pieceObject, &data, &broadPhaseDistanceCallback);
+                        }
+                    else
                     {
-                        poseFromStateCallback_(trans, extractState_(state, i));
-                        fcl::distance(robotParts_[i], trans, &environment_, identity, distanceRequest, distanceResult);
-                        if (distanceResult.min_distance < minDist)
-                            minDist = distanceResult.min_distance;
+                        CollisionObject robotObject(*robotObjects_[i]);
+                        robotObject.setTransform(pose);
+                        robotObject.computeAABB();
+                        environmentManager_->distance(&robotObject, &data, &broadPhaseDistanceCallback);
                     }
+                    dist = std::min(dist, data.minDist);
                 }
+                return dist;
+            }
 
-                return minDist;
+            /// \brief Return true if the coarse environment first pass shows
+            /// that robot part \e i at \e pose does not touch the
+            /// environment. Every point of the environment is within the
+            /// margin of the coarse copy, so a part is free if the bounding
+            /// box of the part (or of each of its convex pieces), grown by
+            /// the margin on every side, does not touch the copy. Boxes are
+            /// solid, so a copy that lies inside a box counts as contact.
+            bool isCoarseCollisionFree(const Transform &pose, std::size_t i, CheckerStatistics::Slot *stats) const
+            {
+                if (!coarseEnvironment_)
+                    return false;
+                if (stats != nullptr)
+                    stats->add(CheckerStatistics::COARSE_TESTS);
+                if (!convexParts_.empty())
+                {
+                    for (const auto &piece : convexParts_[i])
+                        if (!isCoarseBoxFree(pose, piece->aabb_local.min_, piece->aabb_local.max_))
+                            return false;
+                    return true;
+                }
+                return isCoarseBoxFree(pose, robotParts_[i]->aabb_local.min_, robotParts_[i]->aabb_local.max_);
             }
 
-         protected:
+            /// \brief Return true if the box from \e lo to \e hi in the
+            /// frame of a robot part at \e pose, grown by the margin of the
+            /// coarse environment, does not touch the coarse environment
+            bool isCoarseBoxFree(const Transform &pose, const Vector3 &lo, const Vector3 &hi) const
+            {
+                const double margin = coarseEnvironment_->margin;
+                const Vector3 center = transformPoint(pose, (lo + hi) * 0.5);
+#if FCL_MAJOR_VERSION==0 && FCL_MINOR_VERSION<6
+                static Transform identity;
+                fcl::Box shape(hi[0] - lo[0] + 2.0 * margin, hi[1] - lo[1] + 2.0 * margin, hi[2] - lo[2] + 2.0 * margin);
+                Transform tf(pose.getRotation(), center);
+#else
+                static Transform identity(Transform::Identity());
+                fcl::Boxd shape(hi[0] - lo[0] + 2.0 * margin, hi[1] - lo[1] + 2.0 * margin, hi[2] - lo[2] + 2.0 * margin);
+                Transform tf(pose);
+                tf.translation() = center;
+#endif
+                CollisionRequest collisionRequest;
+                CollisionResult collisionResult;
+                return fcl::collide(&shape, tf, coarseEnvironment_->model.get(), identity, collisionRequest, collisionResult) == 0;
+            }
+
+            /// \brief Check whether \e sphere, given in the frame of a robot
+            /// part at \e pose, is collision free
+            bool isSphereCollisionFree(const Transform &pose, const SphereTree::Sphere &sphere) const
+            {
+                const Vector3 center = transformPoint(pose, Vector3(sphere.center[0], sphere.center[1], sphere.center[2]));
+#if FCL_MAJOR_VERSION==0 && FCL_MINOR_VERSION<6
+                static Transform identity;
+                fcl::Sphere shape(sphere.radius);
+                Transform tf(center);
+#else
+                static Transform identity(Transform::Identity());
+                fcl::Sphered shape(sphere.radius);
+                Transform tf(Transform::Identity());
+                tf.translation() = center;
+#endif
+                CollisionRequest collisionRequest;
+                CollisionResult collisionResult;
+                return fcl::collide(&shape, tf, environment_.get(), identity, collisionRequest, collisionResult) == 0;
+            }
+
+            /// \brief Check the robot parts at \e poses for collisions with each other
+            bool isSelfCollisionFree(const Transform *poses, const CollisionRequest &collisionRequest,
+                                     CollisionResult &collisionResult, CheckerStatistics::Slot *stats = nullptr) const
+            {
+                if (!selfCollision_)
+                    return true;
+
+                for (std::size_t i = 0 ; i < robotParts_.size(); ++i)
+                {
+                    const Vector3 center_i = transformPoint(poses[i], robotParts_[i]->aabb_center);
+                    for (std::size_t j  = i + 1 ; j < robotParts_.size(); ++j)
+                    {
+                        // parts whose bounding spheres are disjoint cannot collide
+                        const Vector3 d = center_i - transformPoint(poses[j], robotParts_[j]->aabb_center);
+                        const double r = robotParts_[i]->aabb_radius + robotParts_[j]->aabb_radius;
+                        if (d[0] * d[0] + d[1] * d[1] + d[2] * d[2] > r * r)
+                            continue;
+                        if (stats != nullptr)
+                            stats->add(CheckerStatistics::NARROWPHASE_TESTS);
+                        if (fcl::collide(robotParts_[i], poses[i], robotParts_[j], poses[j],
+                            collisionRequest, collisionResult) > 0)
+                            return false;
+                    }
+                }
+                return true;
+            }
+
+            /// \brief Compute the transforms of all robot parts for \e state.
+            /// The time this takes is added to \e stats (if not nullptr).
+            void computePoses(const base::State *state, PoseBuffer &poses, CheckerStatistics::Slot *stats = nullptr) const
+            {
+                CheckerStatistics::Timer timer(stats, CheckerStatistics::POSE_CONVERSION);
+                for (std::size_t i = 0; i < robotParts_.size(); ++i)
+                    poseFromStateCallback_(poses[i], extractState_(state, i));
+            }
+
+            /// \brief Apply a transform to a point
+            static Vector3 transformPoint(const Transform &tf, const Vector3 &p)
+            {
+#if FCL_MAJOR_VERSION==0 && FCL_MINOR_VERSION<6
+                return tf.transform(p);
+#else
+                return tf * p;
+#endif
+            }
 
             /// \brief Configures the geometry of the robot and the environment
-            /// to setup validity checking.
+            /// to setup validity checking. The models of the environment and
+            /// of every robot part are independent, so they are built
+            /// concurrently on separate threads, which only read the scenes
+            /// of \e geom.
             void configure(const GeometrySpecification &geom)
             {
-                // Configuring the model of the environment
-                environment_.beginModel ();
-                std::pair<std::vector <Vector3>, std::vector<fcl::Triangle>> tri_model;
-                tri_model = getFCLModelFromScene(geom.obstacles, geom.obstaclesShift);
-                environment_.addSubModel(tri_model.first, tri_model.second);
+                std::future<void> environment = std::async(std::launch::async, [this, &geom] { configureEnvironment(geom); });
+                std::vector<std::future<std::unique_ptr<Model>>> parts;
+                for (std::size_t rbt = 0; rbt < geom.robot.size(); ++rbt)
+                    parts.push_back(std::async(std::launch::async, [this, &geom, rbt] { return buildRobotPart(geom, rbt); }));
 
-                environment_.endModel ();
-                environment_.computeLocalAABB();
+                for (auto &part : parts)
+                {
+                    Model *model = part.get().release();
+                    robotParts_.push_back(model);
+                    // the robot parts are owned by robotParts_; the shared pointer is only
+                    // needed to create collision objects for the broadphase manager
+                    robotObjects_.emplace_back(new CollisionObject(CollisionGeometryPtr(model, [](Model*) {})));
+                }
+                environment.get();
+                partRadii_ = getPartRadii();
+#if !(FCL_MAJOR_VERSION==0 && FCL_MINOR_VERSION<6)
+                if (environmentF_)
+                    configureSinglePrecisionRobot();
+#endif
+            }
+
+            /// \brief Build the model of the environment
+            void configureEnvironment(const GeometrySpecification &geom)
+            {
+                ScopedTrace trace("build environment BVH", "geometry");
+                if (broadphase_)
+                {
+                    environment_ = std::make_shared<Model>();
+                    configureBroadPhaseEnvironment(geom);
+                    return;
+                }
+
+                // Configuring the model of the environment. Environments
+                // made of identical triangles share a single model.
+                std::pair<std::vector <Vector3>, std::vector<fcl::Triangle>> tri_model =
+                    getFCLModelFromScene(geom.obstacles, geom.obstaclesShift);
+#if !(FCL_MAJOR_VERSION==0 && FCL_MINOR_VERSION<6)
+                if (singlePrecision_ && !tri_model.second.empty())
+                    configureSinglePrecisionEnvironment(tri_model);
+#endif
+                if (!environment_)
+                    environment_ = GeometryRegistry<const Model>::get(triangleKey(tri_model.first, tri_model.second),
+                        [&tri_model]
+                        {
+                            auto model = std::make_shared<Model>();
+                            model->beginModel();
+                            model->addSubModel(tri_model.first, tri_model.second);
+                            model->endModel();
+                            model->computeLocalAABB();
+                            return model;
+                        });
 
-                if (environment_.num_tris == 0)
+                if (tri_model.second.empty())
                     OMPL_INFORM("Empty environment loaded");
-                else
-                    OMPL_INFORM("Loaded environment model with %d triangles.", environment_.num_tris);
+                else if (environment_->num_tris > 0)
+                    OMPL_INFORM("Loaded environment model with %d triangles (%lu bytes).", environment_->num_tris,
+                                (unsigned long)getModelMemory(*environment_));
+            }
+
+            /// \brief Build the model of robot part \e rbt
+            std::unique_ptr<Model> buildRobotPart(const GeometrySpecification &geom, std::size_t rbt) const
+            {
+                ScopedTrace trace("build robot BVH", "geometry");
+                std::unique_ptr<Model> model(new Model());
+                model->beginModel();
+                aiVector3D shift(0.0, 0.0, 0.0);
+                if (geom.robotShift.size() > rbt)
+                    shift = geom.robotShift[rbt];
+
+                std::pair<std::vector <Vector3>, std::vector<fcl::Triangle>> tri_model = getFCLModelFromScene(geom.robot[rbt], shift);
+                model->addSubModel(tri_model.first, tri_model.second);
+
+                model->endModel();
+                model->computeLocalAABB();
+
+                OMPL_INFORM("Robot piece with %d triangles loaded (%lu bytes)", model->num_tris,
+                            (unsigned long)getModelMemory(*model));
+                return model;
+            }
+
+            /// \brief Approximate number of bytes used by the vertices,
+            /// triangles, and bounding volume hierarchy of \e model
+            template<typename M>
+            static std::size_t getModelMemory(const M &model)
+            {
+                return sizeof(M) + model.num_vertices * sizeof(model.vertices[0]) +
+                    model.num_tris * (sizeof(fcl::Triangle) + sizeof(unsigned int)) +
+                    model.getNumBVs() * sizeof(model.getBV(0));
+            }
+
+            /// \brief Approximate number of bytes used by the geometry of
+            /// \e object. Octrees (see setOctreeObstacle()) are referenced,
+            /// not copied, so only their FCL wrapper is counted.
+            static std::size_t getObjectMemory(const CollisionObject &object)
+            {
+                const auto *geometry = object.collisionGeometry().get();
+                if (geometry->getObjectType() == fcl::OT_BVH)
+                    return getModelMemory(*static_cast<const Model*>(geometry));
+#if OMPL_HAS_OCTOMAP
+#if FCL_MAJOR_VERSION==0 && FCL_MINOR_VERSION<6
+                if (geometry->getObjectType() == fcl::OT_OCTREE)
+                    return sizeof(fcl::OcTree);
+#else
+                if (geometry->getObjectType() == fcl::OT_OCTREE)
+                    return sizeof(fcl::OcTree<double>);
+#endif
+#endif
+                return 0;
+            }
+
+#if !(FCL_MAJOR_VERSION==0 && FCL_MINOR_VERSION<6)
+            /// \brief Build the single precision model of the environment
+            /// from \e tri_model. The double precision model stays empty.
+            void configureSinglePrecisionEnvironment(const std::pair<std::vector<Vector3>, std::vector<fcl::Triangle>> &tri_model)
+            {
+                environment_ = std::make_shared<Model>();
+                environmentF_ = GeometryRegistry<const ModelF>::get(triangleKey(tri_model.first, tri_model.second),
+                    [&tri_model]
+                    {
+                        std::vector<fcl::Vector3f> points;
+                        points.reserve(tri_model.first.size());
+                        for (const auto &p : tri_model.first)
+                            points.push_back(p.cast<float>());
+                        auto model = std::make_shared<ModelF>();
+                        model->beginModel();
+                        model->addSubModel(points, tri_model.second);
+                        model->endModel();
+                        model->computeLocalAABB();
+                        return model;
+                    });
+
+                double extent = 0.0;
+                for (int k = 0; k < environmentF_->num_vertices; ++k)
+                    extent = std::max(extent, (double)environmentF_->vertices[k].cwiseAbs().maxCoeff());
+                precisionExtent_ = extent;
+                OMPL_INFORM("Loaded single precision environment model with %d triangles (%lu bytes).",
+                            environmentF_->num_tris, (unsigned long)getModelMemory(*environmentF_));
+            }
 
-                // Configuring the model of the robot, composed of one or more pieces
-                for (size_t rbt = 0; rbt < geom.robot.size(); ++rbt)
+            /// \brief Build single precision copies of the robot parts, with
+            /// every vertex moved outward along its normal far enough that
+            /// every face moves out by at least getPrecisionMargin()
+            void configureSinglePrecisionRobot()
+            {
+                double radius = 0.0;
+                for (double r : getPartRadii())
+                    radius = std::max(radius, r);
+                // rounding the environment vertices, the robot vertices and
+                // the pose of a robot at most precisionExtent_ away from the
+                // origin each move points by less than FLT_EPSILON * extent
+                precisionMargin_ = 4.0 * std::numeric_limits<float>::epsilon() * (precisionExtent_ + radius);
+
+                for (const auto *part : robotParts_)
                 {
-                    auto* model = new Model();
-                    model->beginModel();
-                    aiVector3D shift(0.0, 0.0, 0.0);
-                    if (geom.robotShift.size() > rbt)
-                        shift = geom.robotShift[rbt];
+                    std::vector<Vector3> normals(part->num_vertices, Vector3::Zero());
+                    std::vector<Vector3> faceNormals(part->num_tris);
+                    for (int t = 0; t < part->num_tris; ++t)
+                    {
+                        const fcl::Triangle &tri = part->tri_indices[t];
+                        const Vector3 n = (part->vertices[tri[1]] - part->vertices[tri[0]]).cross(
+                            part->vertices[tri[2]] - part->vertices[tri[0]]);
+                        faceNormals[t] = n.norm() > 0.0 ? Vector3(n.normalized()) : Vector3::Zero();
+                        for (int k = 0; k < 3; ++k)
+                            normals[tri[k]] += n;
+                    }
+                    for (auto &n : normals)
+                        if (n.norm() > 0.0)
+                            n.normalize();
 
-                    tri_model = getFCLModelFromScene(geom.robot[rbt], shift);
-                    model->addSubModel(tri_model.first, tri_model.second);
+                    // the smallest cosine between a vertex normal and the normals of its faces
+                    std::vector<double> cosine(part->num_vertices, 1.0);
+                    for (int t = 0; t < part->num_tris; ++t)
+                        for (int k = 0; k < 3; ++k)
+                        {
+                            const int v = part->tri_indices[t][k];
+                            cosine[v] = std::min(cosine[v], normals[v].dot(faceNormals[t]));
+                        }
 
+                    std::vector<fcl::Vector3f> points(part->num_vertices);
+                    for (int k = 0; k < part->num_vertices; ++k)
+                        points[k] = (part->vertices[k] + normals[k] * (precisionMargin_ / std::max(0.1, cosine[k]))).cast<float>();
+                    std::vector<fcl::Triangle> triangles(part->tri_indices, part->tri_indices + part->num_tris);
+                    std::unique_ptr<ModelF> model(new ModelF());
+                    model->beginModel();
+                    model->addSubModel(points, triangles);
                     model->endModel();
                     model->computeLocalAABB();
+                    robotPartsF_.push_back(std::move(model));
+                }
+                OMPL_INFORM("Robot pieces inflated by %g for single precision collision checking", precisionMargin_);
+            }
+#endif
 
-                    OMPL_INFORM("Robot piece with %d triangles loaded", model->num_tris);
-                    robotParts_.push_back(model);
+            /// \brief Create a separate collision object for every mesh in the
+            /// environment and register them with a broadphase manager.
+            void configureBroadPhaseEnvironment(const GeometrySpecification &geom)
+            {
+                int numTris = 0;
+                std::vector<CollisionObject*> objects;
+                for (std::size_t i = 0; i < geom.obstacles.size(); ++i)
+                {
+                    std::vector<scene::IndexedMesh> meshes;
+                    scene::extractIndexedMeshTriangles(geom.obstacles[i], meshes);
+                    for (const auto &mesh : meshes)
+                    {
+                        aiVector3D shift(0.0, 0.0, 0.0);
+                        if (geom.obstaclesShift.size() > i)
+                            shift = geom.obstaclesShift[i];
+
+                        auto *model = new Model();
+                        CollisionGeometryPtr geometry(model);
+                        std::pair<std::vector<Vector3>, std::vector<fcl::Triangle>> tri_model = getFCLModelFromMesh(mesh, shift);
+                        model->beginModel();
+                        model->addSubModel(tri_model.first, tri_model.second);
+                        model->endModel();
+                        model->computeLocalAABB();
+                        numTris += model->num_tris;
+
+                        environmentObjects_.emplace_back(new CollisionObject(geometry));
+                        objects.push_back(environmentObjects_.back().get());
+                    }
                 }
+
+                if (objects.empty())
+                {
+                    OMPL_INFORM("Empty environment loaded");
+                    return;
+                }
+
+                environmentManager_.reset(new BroadPhaseManager());
+                environmentManager_->registerObjects(objects);
+                environmentManager_->setup();
+                OMPL_INFORM("Loaded environment with %d triangles in %u separate objects.", numTris, (unsigned int)objects.size());
+            }
+
+            /// \brief Convert an indexed mesh to FCL vertices and triangles,
+            /// subtracting \e shift from every vertex
+            std::pair<std::vector<Vector3>, std::vector<fcl::Triangle>> getFCLModelFromMesh(const scene::IndexedMesh &mesh,
+                                                                                           const aiVector3D &shift) const
+            {
+                std::pair<std::vector<Vector3>, std::vector<fcl::Triangle>> tri_model;
+                appendFCLModel(mesh, shift, tri_model);
+                return tri_model;
+            }
+
+            /// \brief Append the vertices and triangles of an indexed mesh to \e tri_model
+            static void appendFCLModel(const scene::IndexedMesh &mesh, const aiVector3D &shift,
+                                       std::pair<std::vector<Vector3>, std::vector<fcl::Triangle>> &tri_model)
+            {
+                std::vector<Vector3> &pts = tri_model.first;
+                std::vector<fcl::Triangle> &triangles = tri_model.second;
+                const std::size_t offset = pts.size();
+                pts.reserve(offset + mesh.vertices.size());
+                triangles.reserve(triangles.size() + mesh.indices.size() / 3);
+                for (const auto &v : mesh.vertices)
+                    pts.emplace_back(v[0] - shift[0], v[1] - shift[1], v[2] - shift[2]);
+                for (std::size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+                    triangles.emplace_back(offset + mesh.indices[i], offset + mesh.indices[i + 1], offset + mesh.indices[i + 2]);
+            }
+
+            /// \brief Data passed to broadPhaseCollisionCallback()
+            struct BroadPhaseCollisionData
+            {
+                const CollisionRequest  *request;
+                CollisionResult         *result;
+                bool                     collision;
+                CheckerStatistics::Slot *stats;
+            };
+
+            /// \brief Narrowphase check of a pair of objects reported by the broadphase manager
+            static bool broadPhaseCollisionCallback(CollisionObject *o1, CollisionObject *o2, void *cdata)
+            {
+                auto *data = static_cast<BroadPhaseCollisionData*>(cdata);
+                if (data->collision)
+                    return true;
+                if (data->stats != nullptr)
+                    data->stats->add(CheckerStatistics::NARROWPHASE_TESTS);
+                if (fcl::collide(o1, o2, *data->request, *data->result) > 0)
+                    data->collision = true;
+                // returning true stops the broadphase traversal
+                return data->collision;
+            }
+
+            /// \brief Data passed to broadPhaseDistanceCallback()
+            struct BroadPhaseDistanceData
+            {
+                DistanceRequest request{true};
+                DistanceResult  result;
+                double          minDist{std::numeric_limits<double>::infinity()};
+            };
+
+            /// \brief Narrowphase distance between a pair of objects reported by the broadphase manager
+            static bool broadPhaseDistanceCallback(CollisionObject *o1, CollisionObject *o2, void *cdata, double &dist)
+            {
+                auto *data = static_cast<BroadPhaseDistanceData*>(cdata);
+                fcl::distance(o1, o2, data->request, data->result);
+                if (data->result.min_distance < data->minDist)
+                    data->minDist = data->result.min_distance;
+                dist = data->minDist;
+                // returning true stops the broadphase traversal
+                return dist <= 0.;
             }
 
             /// \brief Convert a mesh to a FCL BVH model
@@ -282,40 +1701,24 @@ namespace ompl
             std::pair<std::vector<Vector3>, std::vector<fcl::Triangle>> getFCLModelFromScene(const std::vector<const aiScene*> &scenes, const std::vector<aiVector3D> &center) const
             {
                 // Model consists of a set of points, and a set of triangles
-                // that connect those points
-                std::vector<fcl::Triangle> triangles;
-                std::vector<Vector3> pts;
-
+                // that connect those points. Vertices shared by several
+                // triangles are stored once.
+                std::pair<std::vector<Vector3>, std::vector<fcl::Triangle>> tri_model;
+                scene::IndexedMesh mesh;
                 for (unsigned int i = 0; i < scenes.size(); ++i)
                 {
                     if (scenes[i] != nullptr)
                     {
-                        std::vector<aiVector3D> t;
-                        // extractTriangles is a misleading name.  this extracts the set of points,
-                        // where each set of three contiguous points consists of a triangle
-                        scene::extractTriangles(scenes[i], t);
-
-                        if (center.size() > i)
-                            for (auto & j : t)
-                                j -= center[i];
-
-                        assert(t.size() % 3 == 0);
-
-                        for (auto & p : t)
-                        {
-                            pts.emplace_back(p[0], p[1], p[2]);
-                        }
+                        scene::extractIndexedTriangles(scenes[i], mesh);
+                        appendFCLModel(mesh, center.size() > i ? center[i] : aiVector3D(0.0, 0.0, 0.0), tri_model);
                     }
                 }
-
-                for (unsigned int i = 0; i < pts.size(); i+=3)
-                    triangles.emplace_back(i, i+1, i+2);
-                
-                return std::make_pair(pts, triangles);
+                return tri_model;
             }
 
-            /// \brief Geometric model used for the environment
-            Model environment_;
+            /// \brief Geometric model used for the environment. The model is
+            /// read-only and may be shared with other instances.
+            std::shared_ptr<const Model> environment_;
 
             /// \brief List of components for the geometric model of the robot
             mutable std::vector<Model*> robotParts_;
@@ -328,6 +1731,80 @@ namespace ompl
 
             /// \brief Callback to extract translation and rotation from a state
             FCLPoseFromStateCallback    poseFromStateCallback_;
+
+            /// \brief Flag indicating whether the environment is split into separate objects
+            bool                        broadphase_;
+
+            /// \brief Flag indicating whether the environment is stored in single precision
+            bool                        singlePrecision_;
+
+#if !(FCL_MAJOR_VERSION==0 && FCL_MINOR_VERSION<6)
+            /// \brief Single precision model of the environment (if
+            /// singlePrecision_ is true and the environment is not empty).
+            /// environment_ is empty in that case.
+            std::shared_ptr<const ModelF> environmentF_;
+
+            /// \brief Inflated single precision copies of robotParts_, used
+            /// for queries against environmentF_
+            std::vector<std::unique_ptr<ModelF> > robotPartsF_;
+#endif
+
+            /// \brief Largest coordinate of the single precision environment
+            double                      precisionExtent_{0.0};
+
+            /// \brief Inflation of the single precision robot parts
+            double                      precisionMargin_{0.0};
+
+            /// \brief Collision objects for the elements of robotParts_, used
+            /// to query the broadphase manager. Queries work on copies of
+            /// these, since constructing a new object recomputes the bounding
+            /// box of the geometry.
+            std::vector<std::unique_ptr<CollisionObject> > robotObjects_;
+
+            /// \brief Convex pieces of the robot parts, see setConvexParts()
+            std::vector<std::vector<CollisionGeometryPtr> > convexParts_;
+
+            /// \brief Collision objects for the elements of convexParts_, used
+            /// to query the broadphase manager
+            std::vector<std::vector<std::unique_ptr<CollisionObject> > > convexObjects_;
+
+            /// \brief The separate environment objects (if broadphase_ is true)
+            std::vector<std::unique_ptr<CollisionObject> > environmentObjects_;
+
+            /// \brief Objects added by setObstacle(), by identifier
+            std::map<unsigned int, std::unique_ptr<CollisionObject> > obstacles_;
+
+            /// \brief The number of obstacles in obstacles_ that are octrees
+            std::size_t                 octreeObstacles_{0};
+
+            /// \brief Broadphase structure containing environmentObjects_ and obstacles_
+            std::unique_ptr<BroadPhaseManager> environmentManager_;
+
+            /// \brief Settings for continuous collision checking
+            ContinuousCollisionRequest  continuousCollisionRequest_;
+
+            /// \brief The radii of the robot parts, see getPartRadii()
+            std::vector<double>         partRadii_;
+
+            /// \brief Bounding sphere hierarchies of the robot parts (if enabled)
+            std::vector<SphereTree>     sphereTrees_;
+
+            /// \brief A simplified copy of environment_ and the largest
+            /// distance between a point of environment_ and the copy
+            struct CoarseEnvironment
+            {
+                std::shared_ptr<Model> model;
+                double                 margin;
+            };
+
+            /// \brief The model of the coarse environment first pass (if enabled)
+            std::shared_ptr<const CoarseEnvironment> coarseEnvironment_;
+
+            /// \brief Relative error allowed in clearance()
+            double                      clearanceRelErr_{0.0};
+
+            /// \brief Counters and timers of the queries
+            mutable CheckerStatistics   statistics_;
         };
     }
 }
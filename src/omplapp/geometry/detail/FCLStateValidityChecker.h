@@ -21,10 +21,16 @@
 #include <ompl/base/spaces/SE3StateSpace.h>
 
 #include "omplapp/geometry/detail/FCLMethodWrapper.h"
+#include "omplapp/geometry/detail/ClearanceCache.h"
+#include "omplapp/geometry/detail/CoherenceCache.h"
+#include "omplapp/geometry/detail/PartCollisionCache.h"
+#include "omplapp/geometry/detail/PoseBatch.h"
 #include "omplapp/geometry/GeometrySpecification.h"
 
 // Boost and STL headers
+#include <functional>
 #include <memory>
+#include <vector>
 
 namespace ob = ompl::base;
 
@@ -75,6 +81,27 @@ namespace ompl
 #endif
             }
         };
+
+        /// \brief Set \e tf to pose \e i of \e poses
+        inline void FCLPoseFromArrays(FCLMethodWrapper::Transform &tf, const PoseArrays &poses, std::size_t i)
+        {
+#if FCL_MAJOR_VERSION==0 && FCL_MINOR_VERSION<6
+            tf.setTransform(
+                    fcl::Matrix3f(poses.rotation(0, 0, i), poses.rotation(0, 1, i), poses.rotation(0, 2, i),
+                                  poses.rotation(1, 0, i), poses.rotation(1, 1, i), poses.rotation(1, 2, i),
+                                  poses.rotation(2, 0, i), poses.rotation(2, 1, i), poses.rotation(2, 2, i)),
+                    FCLMethodWrapper::Vector3(poses.translation(0, i), poses.translation(1, i), poses.translation(2, i))
+                );
+#else
+            tf.setIdentity();
+            for (unsigned int r = 0 ; r < 3 ; ++r)
+            {
+                for (unsigned int c = 0 ; c < 3 ; ++c)
+                    tf.linear()(r, c) = poses.rotation(r, c, i);
+                tf.translation()(r) = poses.translation(r, i);
+            }
+#endif
+        }
         /// @endcond
 
         /// \brief Wrapper for FCL collision and distance checking
@@ -83,13 +110,14 @@ namespace ompl
         {
         public:
             FCLStateValidityChecker(const ob::SpaceInformationPtr &si, const GeometrySpecification &geom,
-                                    const GeometricStateExtractor &se, bool selfCollision)
-            : ob::StateValidityChecker(si),
+                                    const GeometricStateExtractor &se, bool selfCollision, bool broadphase = false,
+                                    bool singlePrecision = false)
+            : ob::StateValidityChecker(si), extractState_(se),
               fclWrapper_(std::make_shared<FCLMethodWrapper>(geom, se, selfCollision,
                 [this](FCLMethodWrapper::Transform &tf, const ob::State *state)
                 {
                     stateConvertor_.FCLPoseFromState(tf, state);
-                }))
+                }, broadphase, singlePrecision))
             {
                 specs_.clearanceComputationType = base::StateValidityCheckerSpecs::EXACT;
             }
@@ -100,13 +128,312 @@ namespace ompl
             /// environment or itself.
             bool isValid(const ob::State *state) const override
             {
-                return si_->satisfiesBounds(state) && fclWrapper_->isValid(state);
+                ScopedTrace trace("isValid", "checker", Trace::sample());
+                if (!clearanceCache_)
+                    return checkValid(state);
+                ClearanceCache::Entry entry;
+                if (clearanceCache_->lookup(state, entry))
+                {
+                    if (entry.valid >= 0)
+                        return entry.valid != 0;
+                    // a known clearance only rules out collisions with the environment
+                    if (entry.hasClearance() && entry.clearance <= 0.0)
+                        return false;
+                }
+                entry = ClearanceCache::Entry();
+                entry.valid = checkValid(state) ? 1 : 0;
+                clearanceCache_->store(state, entry);
+                return entry.valid != 0;
+            }
+
+            /// \brief Check whether \e state is valid and compute its
+            /// clearance in one query. With the clearance cache enabled,
+            /// both the validity and the clearance are remembered, so that
+            /// a clearance-based optimization objective that asks for the
+            /// clearance of the state later does not query the environment
+            /// again. An exact clearance already tells whether the robot
+            /// is free of the environment, so the environment test of
+            /// isValid(state) and its caches are skipped; only the bounds
+            /// and self collisions are checked. If the clearance may be
+            /// approximate (see setClearanceRelativeError()), the validity
+            /// comes from the same test as isValid(state).
+            bool isValid(const ob::State *state, double &dist) const override
+            {
+                ScopedTrace trace("isValid", "checker", Trace::sample());
+                ClearanceCache::Entry entry;
+                if (clearanceCache_ && clearanceCache_->lookup(state, entry) &&
+                    entry.valid >= 0 && entry.hasClearance())
+                {
+                    dist = entry.clearance;
+                    return entry.valid != 0;
+                }
+
+                if (entry.hasClearance())
+                    dist = entry.clearance;
+                else
+                    dist = fclWrapper_->clearance(state);
+                bool valid;
+                if (entry.valid >= 0)
+                    valid = entry.valid != 0;
+                else if (fclWrapper_->getClearanceRelativeError() > 0.0)
+                    valid = checkValid(state);
+                else
+                    valid = dist > 0.0 && si_->satisfiesBounds(state) && fclWrapper_->isSelfCollisionFree(state);
+
+                if (clearanceCache_)
+                {
+                    entry.clearance = dist;
+                    entry.valid = valid ? 1 : 0;
+                    clearanceCache_->store(state, entry);
+                }
+                return valid;
+            }
+
+            /// \brief Enable or disable the coherence cache. When enabled,
+            /// every thread remembers the clearance of the robot at the last
+            /// state that needed a full check, and states whose robot pose
+            /// is provably within that clearance skip the check against the
+            /// environment. A full check then computes distances instead of
+            /// a plain collision test, which is more expensive; the cache
+            /// pays off when consecutive queries are close to each other and
+            /// the environment is open, as with RRTConnect or KPIECE.
+            void setCoherenceCache(bool enable)
+            {
+                if (enable && !coherenceCache_)
+                    coherenceCache_ = std::make_shared<CoherenceCache<T>>(extractState_, fclWrapper_->getPartRadii());
+                else if (!enable)
+                    coherenceCache_.reset();
+            }
+
+            /// \brief Return true if the coherence cache is enabled
+            bool getCoherenceCache() const
+            {
+                return coherenceCache_ != nullptr;
+            }
+
+            /// \brief Enable or disable the part cache. When enabled, the
+            /// result of the environment test of every robot part is cached
+            /// per thread, keyed on the pose of the part (see
+            /// PartCollisionCache), so that parts that did not move since an
+            /// earlier query are not checked against the environment again.
+            /// Collisions between parts are still checked for every query.
+            /// This pays off for several robots planned at once, where a
+            /// planner step often moves only a few of them. The part cache
+            /// takes precedence over the coherence cache. \e slots is the
+            /// number of poses remembered per part and thread.
+            void setPartCache(bool enable, std::size_t slots = 64)
+            {
+                if (enable)
+                    partCache_ = std::make_shared<PartCollisionCache<T>>(extractState_, fclWrapper_->getPartCount(), slots);
+                else
+                    partCache_.reset();
             }
 
-            /// \brief Returns the minimum distance from the given robot state and the environment
+            /// \brief Return true if the part cache is enabled
+            bool getPartCache() const
+            {
+                return partCache_ != nullptr;
+            }
+
+            /// \brief Add an obstacle to the environment, see
+            /// FCLMethodWrapper::setObstacle(). The caches are emptied, since
+            /// their entries assume the previous environment.
+            void setObstacle(unsigned int id, const aiScene *scene, const FCLMethodWrapper::Transform &tf)
+            {
+                fclWrapper_->setObstacle(id, scene, tf);
+                resetCaches();
+            }
+
+#if OMPL_HAS_OCTOMAP
+            /// \brief Add or update an octree obstacle, see
+            /// FCLMethodWrapper::setOctreeObstacle()
+            void setOctreeObstacle(unsigned int id, const std::shared_ptr<const octomap::OcTree> &tree,
+                                   const FCLMethodWrapper::Transform &tf)
+            {
+                fclWrapper_->setOctreeObstacle(id, tree, tf);
+                resetCaches();
+            }
+#endif
+
+            /// \brief Move an obstacle added by setObstacle()
+            bool moveObstacle(unsigned int id, const FCLMethodWrapper::Transform &tf)
+            {
+                if (!fclWrapper_->moveObstacle(id, tf))
+                    return false;
+                resetCaches();
+                return true;
+            }
+
+            /// \brief Remove an obstacle added by setObstacle()
+            bool removeObstacle(unsigned int id)
+            {
+                if (!fclWrapper_->removeObstacle(id))
+                    return false;
+                resetCaches();
+                return true;
+            }
+
+            /// \brief Enable or disable the sphere tree first pass, see FCLMethodWrapper::setSphereTrees()
+            void setSphereTrees(bool enable)
+            {
+                fclWrapper_->setSphereTrees(enable);
+            }
+
+            /// \brief Return true if the sphere tree first pass is enabled
+            bool getSphereTrees() const
+            {
+                return fclWrapper_->getSphereTrees();
+            }
+
+            /// \brief Enable or disable the coarse environment first pass, see FCLMethodWrapper::setCoarseEnvironment()
+            void setCoarseEnvironment(bool enable, double ratio = 0.03)
+            {
+                fclWrapper_->setCoarseEnvironment(enable, ratio);
+            }
+
+            /// \brief Return true if the coarse environment first pass is enabled
+            bool getCoarseEnvironment() const
+            {
+                return fclWrapper_->getCoarseEnvironment();
+            }
+
+            /// \brief Check the robot against the environment with convex pieces, see FCLMethodWrapper::setConvexParts()
+            void setConvexParts(const std::vector<std::vector<ConvexHull>> &hulls)
+            {
+                fclWrapper_->setConvexParts(hulls);
+                resetCaches();
+            }
+
+            /// \brief Checks a batch of states. On return, \e valid[i] is true
+            /// iff \e states[i] is within bounds and collision free. Collision
+            /// checks can be spread over \e numThreads threads.
+            void isValidBatch(const std::vector<const ob::State*> &states, std::vector<bool> &valid,
+                              unsigned int numThreads = 1) const
+            {
+                // only states within bounds need to be collision checked
+                std::vector<const ob::State*> inBounds;
+                std::vector<std::size_t> index;
+                inBounds.reserve(states.size());
+                index.reserve(states.size());
+                for (std::size_t i = 0 ; i < states.size() ; ++i)
+                    if (si_->satisfiesBounds(states[i]))
+                    {
+                        inBounds.push_back(states[i]);
+                        index.push_back(i);
+                    }
+
+                // convert the poses of all parts of all states at once; the pose
+                // of part i of state k ends up at index k * numParts + i
+                const std::size_t numParts = fclWrapper_->getPartCount();
+                FCLMethodWrapper::TransformVector poses(inBounds.size() * numParts);
+                std::vector<const ob::State*> partStates(inBounds.size());
+                PoseBatch<T> batch;
+                PoseArrays arrays;
+                for (std::size_t i = 0 ; i < numParts ; ++i)
+                {
+                    for (std::size_t k = 0 ; k < inBounds.size() ; ++k)
+                        partStates[k] = extractState_(inBounds[k], i);
+                    batch.convert(partStates, arrays);
+                    for (std::size_t k = 0 ; k < inBounds.size() ; ++k)
+                        FCLPoseFromArrays(poses[k * numParts + i], arrays, k);
+                }
+
+                std::vector<bool> collisionFree;
+                fclWrapper_->isValidBatch(poses.data(), inBounds.size(), collisionFree, numThreads);
+
+                valid.assign(states.size(), false);
+                for (std::size_t i = 0 ; i < index.size() ; ++i)
+                    valid[index[i]] = collisionFree[i];
+            }
+
+            /// \brief Return a function that checks states like isValid(), for
+            /// checking many states in a row on one thread, such as the
+            /// intermediate states of a propagation. The function keeps its
+            /// own FCL query objects, so they are not set up for every state.
+            std::function<bool(const ob::State*)> allocSequenceChecker() const
+            {
+                // the caches do their own bookkeeping per state
+                if (coherenceCache_ || partCache_ || clearanceCache_)
+                    return [this](const ob::State *state) { return isValid(state); };
+                const ob::SpaceInformation *si = si_;
+                FCLMethodWrapperPtr wrapper = fclWrapper_;
+                auto checker = std::make_shared<FCLMethodWrapper::SequenceChecker>(*wrapper);
+                return [si, wrapper, checker](const ob::State *state)
+                    {
+                        return si->satisfiesBounds(state) && checker->isValid(state);
+                    };
+            }
+
+            /// \brief Returns the minimum distance from the given robot state
+            /// and the environment. With the clearance cache enabled, the
+            /// distance is only computed for states not seen before.
             double clearance(const ob::State *state) const override
             {
-                return fclWrapper_->clearance(state);
+                ScopedTrace trace("clearance", "checker", Trace::sample());
+                if (!clearanceCache_)
+                    return fclWrapper_->clearance(state);
+                ClearanceCache::Entry entry;
+                if (clearanceCache_->lookup(state, entry) && entry.hasClearance())
+                    return entry.clearance;
+                entry = ClearanceCache::Entry();
+                entry.clearance = fclWrapper_->clearance(state);
+                clearanceCache_->store(state, entry);
+                return entry.clearance;
+            }
+
+            /// \brief Enable the clearance cache with room for \e capacity
+            /// states, or disable it if \e capacity is zero. The cache keeps
+            /// the validity and the clearance of recently checked states
+            /// (see ClearanceCache), which pays off with clearance-based
+            /// optimization objectives, since they evaluate the clearance of
+            /// the same states many times. The cache is emptied whenever the
+            /// environment changes; call clearClearanceCache() after changing
+            /// anything else that affects validity or clearance.
+            void setClearanceCache(std::size_t capacity)
+            {
+                if (capacity == 0)
+                    clearanceCache_.reset();
+                else if (!clearanceCache_ || clearanceCache_->getCapacity() != capacity)
+                    clearanceCache_ = std::make_shared<ClearanceCache>(si_->getStateSpace(), capacity);
+            }
+
+            /// \brief Get the clearance cache, or nullptr if it is disabled
+            const std::shared_ptr<ClearanceCache>& getClearanceCache() const
+            {
+                return clearanceCache_;
+            }
+
+            /// \brief Forget the validity and clearance of all states
+            void clearClearanceCache()
+            {
+                if (clearanceCache_)
+                    clearanceCache_->clear();
+            }
+
+            /// \brief Return true if the distance between the robot at \e
+            /// state and the environment is larger than \e threshold. This
+            /// is much cheaper than comparing clearance() to \e threshold.
+            bool clearanceExceeds(const ob::State *state, double threshold) const
+            {
+                return fclWrapper_->clearanceExceeds(state, threshold);
+            }
+
+            /// \brief Let clearance() overestimate the distance by up to the
+            /// fraction \e relErr in exchange for faster queries. The specs
+            /// of the checker report approximate clearance computation if \e
+            /// relErr is positive.
+            void setClearanceRelativeError(double relErr)
+            {
+                fclWrapper_->setClearanceRelativeError(relErr);
+                clearClearanceCache();
+                specs_.clearanceComputationType = fclWrapper_->getClearanceRelativeError() > 0.0 ?
+                    base::StateValidityCheckerSpecs::BOUNDED_APPROXIMATE : base::StateValidityCheckerSpecs::EXACT;
+            }
+
+            /// \brief Get the value set by setClearanceRelativeError()
+            double getClearanceRelativeError() const
+            {
+                return fclWrapper_->getClearanceRelativeError();
             }
 
             const FCLMethodWrapperPtr& getFCLWrapper() const
@@ -116,12 +443,61 @@ namespace ompl
 
          protected:
 
+            /// \brief Check \e state without the clearance cache
+            bool checkValid(const ob::State *state) const
+            {
+                if (!si_->satisfiesBounds(state))
+                    return false;
+                if (partCache_)
+                    return fclWrapper_->isValid(state, *partCache_);
+                if (!coherenceCache_)
+                    return fclWrapper_->isValid(state);
+
+                // a state close to the last certified one cannot collide with the environment
+                if (!coherenceCache_->covers(state))
+                {
+                    std::vector<double> dist;
+                    fclWrapper_->partClearances(state, dist);
+                    for (double d : dist)
+                        if (d <= 0.0)
+                            return false;
+                    coherenceCache_->update(state, dist);
+                }
+                return fclWrapper_->isSelfCollisionFree(state);
+            }
+
+            /// \brief Replace the enabled caches by empty ones. Clearing the
+            /// existing caches would only forget the entries of the calling
+            /// thread.
+            void resetCaches()
+            {
+                if (coherenceCache_)
+                    coherenceCache_ = std::make_shared<CoherenceCache<T>>(extractState_, fclWrapper_->getPartRadii());
+                if (partCache_)
+                    partCache_ = std::make_shared<PartCollisionCache<T>>(extractState_, fclWrapper_->getPartCount(),
+                                                                         partCache_->getSlots());
+                if (clearanceCache_)
+                    clearanceCache_->clear();
+            }
+
             /// \brief Object to convert a configuration of the robot to a type desirable for FCL
             OMPL_FCL_StateType<T>       stateConvertor_;
 
+            /// \brief Callback to get the geometric portion of a specific state
+            GeometricStateExtractor     extractState_;
+
             /// \brief Wrapper for FCL collision and distance methods
             FCLMethodWrapperPtr         fclWrapper_;
 
+            /// \brief Clearance certified for recent queries (if enabled)
+            std::shared_ptr<CoherenceCache<T>> coherenceCache_;
+
+            /// \brief Environment test results of single robot parts (if enabled)
+            std::shared_ptr<PartCollisionCache<T>> partCache_;
+
+            /// \brief Validity and clearance of recently checked states (if enabled)
+            std::shared_ptr<ClearanceCache> clearanceCache_;
+
         };
     }
 }
@@ -0,0 +1,128 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_GEOMETRY_DETAIL_GEOMETRY_REGISTRY_
+#define OMPLAPP_GEOMETRY_DETAIL_GEOMETRY_REGISTRY_
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace ompl
+{
+    namespace app
+    {
+        /// @cond IGNORE
+        /** \brief Identifies the triangles a collision model was built from */
+        using GeometryKey = std::pair<std::uint64_t, std::size_t>;
+
+        /** \brief Process-wide registry of read-only collision models of
+            type \e V. Models are identified by a hash of the triangles they
+            were built from, so identical environments loaded by different
+            RigidBodyGeometry instances (or different validity checkers) are
+            built once and shared. The registry only holds weak references;
+            a model is freed once the last checker using it is destroyed. */
+        template<typename V>
+        class GeometryRegistry
+        {
+        public:
+
+            /** \brief Return the model for \e key, or construct it with \e
+                build if no such model exists. The model is built without
+                holding the registry lock. If two threads build the same
+                model concurrently, both get the model registered first. */
+            static std::shared_ptr<V> get(const GeometryKey &key, const std::function<std::shared_ptr<V>()> &build)
+            {
+                Registry &r = registry();
+                {
+                    std::lock_guard<std::mutex> lock(r.mutex);
+                    auto it = r.models.find(key);
+                    if (it != r.models.end())
+                        if (std::shared_ptr<V> model = it->second.lock())
+                            return model;
+                }
+
+                std::shared_ptr<V> model = build();
+
+                std::lock_guard<std::mutex> lock(r.mutex);
+                // drop the entries of models that no longer exist
+                for (auto it = r.models.begin() ; it != r.models.end() ; )
+                    if (it->second.expired())
+                        it = r.models.erase(it);
+                    else
+                        ++it;
+                std::weak_ptr<V> &entry = r.models[key];
+                if (std::shared_ptr<V> existing = entry.lock())
+                    return existing;
+                entry = model;
+                return model;
+            }
+
+        private:
+
+            struct Registry
+            {
+                std::mutex                               mutex;
+                std::map<GeometryKey, std::weak_ptr<V> >         models;
+            };
+
+            static Registry& registry()
+            {
+                static Registry r;
+                return r;
+            }
+        };
+
+        /** \brief 64 bit FNV-1a hash of the bytes of \e value, continuing from \e hash */
+        template<typename T>
+        std::uint64_t fnv1a(std::uint64_t hash, const T &value)
+        {
+            unsigned char bytes[sizeof(T)];
+            std::memcpy(bytes, &value, sizeof(T));
+            for (unsigned char b : bytes)
+            {
+                hash ^= b;
+                hash *= 1099511628211ULL;
+            }
+            return hash;
+        }
+
+        /** \brief Compute the registry key for a triangle soup */
+        template<typename P>
+        GeometryKey triangleKey(const std::vector<P> &points)
+        {
+            std::uint64_t hash = 14695981039346656037ULL;
+            for (const P &p : points)
+                for (int k = 0 ; k < 3 ; ++k)
+                    hash = fnv1a(hash, (double)p[k]);
+            return std::make_pair(hash, points.size());
+        }
+
+        /** \brief Compute the registry key for vertices and triangles indexing them */
+        template<typename P, typename T>
+        GeometryKey triangleKey(const std::vector<P> &points, const std::vector<T> &triangles)
+        {
+            GeometryKey key = triangleKey(points);
+            for (const T &t : triangles)
+                for (int k = 0 ; k < 3 ; ++k)
+                    key.first = fnv1a(key.first, (std::uint64_t)t[k]);
+            key.second += triangles.size();
+            return key;
+        }
+        /// @endcond
+    }
+}
+
+#endif
@@ -0,0 +1,120 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_GEOMETRY_DETAIL_LAZY_STATE_VALIDITY_CHECKER_
+#define OMPLAPP_GEOMETRY_DETAIL_LAZY_STATE_VALIDITY_CHECKER_
+
+#include "omplapp/geometry/detail/Trace.h"
+#include <ompl/base/StateValidityChecker.h>
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <utility>
+
+namespace ompl
+{
+    namespace app
+    {
+        /** \brief A state validity checker that builds the checker it
+            forwards to on first use. Building a collision checker builds
+            the bounding volume hierarchies of the robot and the
+            environment, which is wasted work when the meshes are replaced
+            before any state is checked, as happens while a problem is set
+            up interactively. The checker is built exactly once, by the
+            first thread that needs it; other threads wait for it. */
+        class LazyStateValidityChecker : public base::StateValidityChecker
+        {
+        public:
+
+            using Allocator = std::function<base::StateValidityCheckerPtr()>;
+
+            /** \brief Constructor. \e alloc builds the checker; \e specs are
+                the specifications of that checker, which planners may read
+                before it is built. */
+            LazyStateValidityChecker(const base::SpaceInformationPtr &si, Allocator alloc,
+                                     const base::StateValidityCheckerSpecs &specs)
+                : base::StateValidityChecker(si), alloc_(std::move(alloc))
+            {
+                specs_ = specs;
+            }
+
+            bool isValid(const base::State *state) const override
+            {
+                return get()->isValid(state);
+            }
+
+            bool isValid(const base::State *state, double &dist) const override
+            {
+                return get()->isValid(state, dist);
+            }
+
+            bool isValid(const base::State *state, double &dist, base::State *validState, bool &validStateAvailable) const override
+            {
+                return get()->isValid(state, dist, validState, validStateAvailable);
+            }
+
+            double clearance(const base::State *state) const override
+            {
+                return get()->clearance(state);
+            }
+
+            double clearance(const base::State *state, base::State *validState, bool &validStateAvailable) const override
+            {
+                return get()->clearance(state, validState, validStateAvailable);
+            }
+
+            /** \brief Return the checker, building it if needed */
+            const base::StateValidityCheckerPtr& get() const
+            {
+                if (!built_.load(std::memory_order_acquire))
+                    std::call_once(once_, [this]
+                        {
+                            ScopedTrace trace("build collision checker", "geometry");
+                            checker_ = alloc_();
+                            alloc_ = nullptr;
+                            built_.store(true, std::memory_order_release);
+                        });
+                return checker_;
+            }
+
+            /** \brief Return true if the checker has been built */
+            bool isBuilt() const
+            {
+                return built_.load(std::memory_order_acquire);
+            }
+
+            /** \brief Return the checker \e svc forwards to (building it if
+                needed) if \e svc is a LazyStateValidityChecker, and \e svc
+                otherwise. Code that needs the concrete type of a checker
+                should look at the result of this function. */
+            static const base::StateValidityCheckerPtr& resolve(const base::StateValidityCheckerPtr &svc)
+            {
+                const auto *lazy = dynamic_cast<const LazyStateValidityChecker*>(svc.get());
+                return lazy != nullptr ? lazy->get() : svc;
+            }
+
+        private:
+
+            /** \brief Builds checker_; released once it has been called */
+            mutable Allocator                     alloc_;
+
+            /** \brief The checker queries are forwarded to */
+            mutable base::StateValidityCheckerPtr checker_;
+
+            mutable std::once_flag                once_;
+
+            /** \brief Whether checker_ is set, so that queries skip std::call_once */
+            mutable std::atomic<bool>             built_{false};
+        };
+    }
+}
+
+#endif
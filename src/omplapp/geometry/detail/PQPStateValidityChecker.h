@@ -19,14 +19,22 @@
 
 #include "omplapp/geometry/GeometrySpecification.h"
 #include "omplapp/geometry/detail/assimpUtil.h"
+#include "omplapp/geometry/detail/CheckerStatistics.h"
+#include "omplapp/geometry/detail/CoherenceCache.h"
+#include "omplapp/geometry/detail/GeometryRegistry.h"
+#include "omplapp/geometry/detail/PerThread.h"
+#include "omplapp/geometry/detail/SphereTree.h"
 
 #include <PQP.h>
+#include <array>
+#include <future>
+#include <map>
 #include <memory>
 #include <utility>
 #include <vector>
 #include <limits>
 #include <cmath>
-#include <mutex>
+#include <algorithm>
 
 namespace ompl
 {
@@ -111,7 +119,14 @@ namespace ompl
             construct PQP models internally.  The instance is still
             abstract however, as the isValid() function is not
             implemented (knowledge of the state space is needed for this
-            function to be implemented) */
+            function to be implemented)
+
+            The PQP models are shared by all threads (and by all checkers
+            using identical meshes) and are never modified after
+            configure(), so isValid() and clearance() can be called
+            concurrently without locking. The only state PQP itself mutates
+            during a query (the warm-start triangle of PQP_Distance()) is kept
+            in per-thread copies of the model headers. */
         template<MotionModel T>
         class PQPStateValidityChecker : public base::StateValidityChecker
         {
@@ -127,45 +142,365 @@ namespace ompl
 
             bool isValid(const base::State *state) const override
             {
-                using StateType = typename OMPL_StateType<T>::type;
-
                 if (!si_->satisfiesBounds(state))
                     return false;
 
+                if (!environment_)
+                    return true;
+
+                CheckerStatistics::Slot *stats = statistics_.slot();
+                if (stats == nullptr)
+                    return isCollisionFree(state, nullptr);
+                stats->add(CheckerStatistics::QUERIES);
+                const bool valid = isCollisionFree(state, stats);
+                if (!valid)
+                    stats->add(CheckerStatistics::COLLISIONS);
+                return valid;
+            }
+
+            double clearance(const base::State *state) const override
+            {
+                using StateType = typename OMPL_StateType<T>::type;
+
+                double dist = std::numeric_limits<double>::infinity();
+                if (environment_)
+                {
+                    static PQP_REAL identityTranslation[3] = { 0.0, 0.0, 0.0 };
+                    static PQP_REAL identityRotation[3][3] = { { 1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0} };
+
+                    const DistanceScratch &scratch = getDistanceScratch();
+                    CheckerStatistics::Slot *stats = statistics_.slot();
+                    CheckerStatistics::Timer timer(stats, CheckerStatistics::DISTANCE);
+
+                    PQP_REAL robTrans[3];
+                    PQP_REAL robRot[3][3];
+
+                    for (std::size_t i = 0 ; i < robotParts_.size() ; ++i)
+                    {
+                        stateConvertor_.PQP_pose_from_state(robTrans, robRot, *static_cast<const StateType*>(extractState_(state, i)));
+                        PQP_DistanceResult dr;
+                        PQP_Distance(&dr, robRot, robTrans, scratch.robotParts[i].get(),
+                                     identityRotation, identityTranslation, scratch.environment.get(), clearanceRelErr_, distanceTol_);
+                        if (stats != nullptr)
+                        {
+                            stats->add(CheckerStatistics::DISTANCE_QUERIES);
+                            stats->add(CheckerStatistics::BV_TESTS, dr.num_bv_tests);
+                        }
+                        if (dist > dr.Distance())
+                            dist = dr.Distance();
+                    }
+                }
+                return dist;
+            }
+
+            /** \brief Return true if the distance between the robot at \e
+                state and the environment is larger than \e threshold. This
+                uses PQP_Tolerance(), which stops as soon as the answer is
+                known and is much cheaper than comparing clearance() to
+                \e threshold. */
+            bool clearanceExceeds(const base::State *state, double threshold) const
+            {
+                using StateType = typename OMPL_StateType<T>::type;
+
                 if (!environment_)
                     return true;
 
                 static PQP_REAL identityTranslation[3] = { 0.0, 0.0, 0.0 };
                 static PQP_REAL identityRotation[3][3] = { { 1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0} };
 
-                std::lock_guard<std::mutex> slock(mutex_);
-
+                CheckerStatistics::Slot *stats = statistics_.slot();
+                CheckerStatistics::Timer timer(stats, CheckerStatistics::DISTANCE);
                 PQP_REAL robTrans[3];
                 PQP_REAL robRot[3][3];
-
                 for (std::size_t i = 0 ; i < robotParts_.size() ; ++i)
                 {
                     stateConvertor_.PQP_pose_from_state(robTrans, robRot, *static_cast<const StateType*>(extractState_(state, i)));
-                    PQP_CollideResult cr;
-                    PQP_Collide(&cr, robRot, robTrans, robotParts_[i].get(),
-                                identityRotation, identityTranslation, environment_.get(), PQP_FIRST_CONTACT);
-                    if (cr.Colliding() != 0)
+                    // PQP_Tolerance() only reads the models
+                    PQP_ToleranceResult tr;
+                    PQP_Tolerance(&tr, robRot, robTrans, robotParts_[i].get(),
+                                  identityRotation, identityTranslation, environment_.get(), threshold);
+                    if (stats != nullptr)
+                    {
+                        stats->add(CheckerStatistics::DISTANCE_QUERIES);
+                        stats->add(CheckerStatistics::BV_TESTS, tr.num_bv_tests);
+                    }
+                    if (tr.CloserThanTolerance() != 0)
                         return false;
                 }
+                return true;
+            }
+
+            /** \brief Relative error allowed in the distances computed by
+                clearance(). Larger values let PQP prune more of the
+                environment. The specs of the checker report approximate
+                clearance computation if \e relErr exceeds the default,
+                DISTANCE_REL_ERR. Must not be called while other threads use
+                the checker. */
+            void setClearanceRelativeError(double relErr)
+            {
+                clearanceRelErr_ = std::max(0.0, relErr);
+                specs_.clearanceComputationType = clearanceRelErr_ > DISTANCE_REL_ERR ?
+                    base::StateValidityCheckerSpecs::BOUNDED_APPROXIMATE : base::StateValidityCheckerSpecs::EXACT;
+            }
+
+            /** \brief Get the value set by setClearanceRelativeError() */
+            double getClearanceRelativeError() const
+            {
+                return clearanceRelErr_;
+            }
+
+            /** \brief Enable or disable the coherence cache. When enabled,
+                every thread remembers the clearance of the robot at the last
+                state that needed a full check, and states whose robot pose is
+                provably within that clearance skip the check against the
+                environment. A full check then computes distances instead of
+                a plain collision test, so the cache only pays off when
+                consecutive queries are close to each other. */
+            void setCoherenceCache(bool enable)
+            {
+                if (enable && !coherenceCache_)
+                {
+                    std::vector<double> radii;
+                    for (const auto &part : robotParts_)
+                        radii.push_back(computeFrameRadius(*part));
+                    coherenceCache_ = std::make_shared<CoherenceCache<T>>(extractState_, std::move(radii));
+                }
+                else if (!enable)
+                    coherenceCache_.reset();
+            }
+
+            /** \brief Return true if the coherence cache is enabled */
+            bool getCoherenceCache() const
+            {
+                return coherenceCache_ != nullptr;
+            }
+
+            /** \brief Enable or disable the sphere tree first pass. When
+                enabled, a hierarchy of bounding spheres is built for every
+                robot part, and a part whose spheres are collision free is
+                accepted without checking its mesh against the environment.
+                Spheres are checked with PQP_Tolerance(), which only needs
+                to find the environment triangles within the radius of the
+                sphere. Must not be called while other threads use the
+                checker. */
+            void setSphereTrees(bool enable)
+            {
+                sphereTrees_.clear();
+                pointModel_.reset();
+                if (!enable || !environment_)
+                    return;
+
+                // a tiny triangle with a corner at the origin stands in for the center of a sphere
+                PQP_REAL p0[3] = { 0.0, 0.0, 0.0 }, p1[3] = { 1e-6, 0.0, 0.0 }, p2[3] = { 0.0, 1e-6, 0.0 };
+                pointModel_ = std::make_shared<PQP_Model>();
+                pointModel_->BeginModel();
+                pointModel_->AddTri(p0, p1, p2, 0);
+                pointModel_->EndModel();
+                for (const auto &part : robotParts_)
+                {
+                    std::vector<aiVector3D> triangles;
+                    triangles.reserve(3 * part->num_tris);
+                    for (int t = 0 ; t < part->num_tris ; ++t)
+                        for (const PQP_REAL *p : { part->tris[t].p1, part->tris[t].p2, part->tris[t].p3 })
+                            triangles.emplace_back(p[0], p[1], p[2]);
+                    sphereTrees_.emplace_back(triangles);
+                }
+            }
+
+            /** \brief Return true if the sphere tree first pass is enabled */
+            bool getSphereTrees() const
+            {
+                return !sphereTrees_.empty();
+            }
+
+            /** \brief The counters and timers of the queries (disabled by default) */
+            CheckerStatistics& getStatistics() const
+            {
+                return statistics_;
+            }
+
+            /** \brief Approximate number of bytes used by the triangles and
+                bounding volume hierarchies of the robot and the environment.
+                The precision is fixed by PQP_REAL when PQP is built. */
+            std::size_t getModelMemory() const
+            {
+                std::size_t bytes = environment_ ? getModelMemory(*environment_) : 0;
+                for (const auto &part : robotParts_)
+                    bytes += getModelMemory(*part);
+                return bytes;
+            }
+
+        protected:
+
+            /** \brief Shared pointer wrapper for PQP_Model */
+            using PQPModelPtr = std::shared_ptr<PQP_Model>;
+
+            /** \brief Rotation and translation of a robot part */
+            struct PartPose
+            {
+                PQP_REAL trans[3];
+                PQP_REAL rot[3][3];
+            };
+
+            /** \brief Maximum number of robot parts for which a PoseBuffer does not allocate memory */
+            static const std::size_t MAX_STACK_PARTS = 16;
+
+            /** \brief The poses of all robot parts for a single query. Robots
+                with up to MAX_STACK_PARTS parts are stored on the stack. */
+            class PoseBuffer
+            {
+            public:
+                explicit PoseBuffer(std::size_t n) : poses_(stack_)
+                {
+                    if (n > MAX_STACK_PARTS)
+                    {
+                        heap_.resize(n);
+                        poses_ = heap_.data();
+                    }
+                }
+
+                PoseBuffer(const PoseBuffer&) = delete;
+                PoseBuffer& operator=(const PoseBuffer&) = delete;
+
+                PartPose& operator[](std::size_t i)
+                {
+                    return poses_[i];
+                }
+
+            private:
+                PartPose              stack_[MAX_STACK_PARTS];
+                std::vector<PartPose> heap_;
+                PartPose             *poses_;
+            };
+
+            /** \brief A sphere that contains a robot part, in the frame of the part */
+            struct BoundingSphere
+            {
+                PQP_REAL center[3];
+                double   radius;
+            };
+
+            /** \brief Approximate number of bytes used by \e model */
+            static std::size_t getModelMemory(const PQP_Model &model)
+            {
+                return sizeof(PQP_Model) + model.num_tris * sizeof(Tri) + model.num_bvs * sizeof(BV);
+            }
+
+            /** \brief Compute a bounding sphere for the triangles of \e model */
+            static BoundingSphere computeBoundingSphere(const PQP_Model &model)
+            {
+                BoundingSphere sphere{{0.0, 0.0, 0.0}, 0.0};
+                if (model.num_tris == 0)
+                    return sphere;
+
+                // center the sphere at the center of the axis aligned bounding box
+                PQP_REAL low[3], high[3];
+                for (int k = 0 ; k < 3 ; ++k)
+                {
+                    low[k] = std::numeric_limits<PQP_REAL>::max();
+                    high[k] = -std::numeric_limits<PQP_REAL>::max();
+                }
+                for (int t = 0 ; t < model.num_tris ; ++t)
+                    for (const PQP_REAL *p : { model.tris[t].p1, model.tris[t].p2, model.tris[t].p3 })
+                        for (int k = 0 ; k < 3 ; ++k)
+                        {
+                            low[k] = std::min(low[k], p[k]);
+                            high[k] = std::max(high[k], p[k]);
+                        }
+                for (int k = 0 ; k < 3 ; ++k)
+                    sphere.center[k] = (low[k] + high[k]) / 2.0;
+
+                double r2 = 0.0;
+                for (int t = 0 ; t < model.num_tris ; ++t)
+                    for (const PQP_REAL *p : { model.tris[t].p1, model.tris[t].p2, model.tris[t].p3 })
+                    {
+                        const double dx = p[0] - sphere.center[0], dy = p[1] - sphere.center[1], dz = p[2] - sphere.center[2];
+                        r2 = std::max(r2, dx * dx + dy * dy + dz * dz);
+                    }
+                sphere.radius = sqrt(r2);
+                return sphere;
+            }
+
+            /** \brief Maximum distance of a point of \e model from the origin of its frame */
+            static double computeFrameRadius(const PQP_Model &model)
+            {
+                double r2 = 0.0;
+                for (int t = 0 ; t < model.num_tris ; ++t)
+                    for (const PQP_REAL *p : { model.tris[t].p1, model.tris[t].p2, model.tris[t].p3 })
+                        r2 = std::max(r2, (double)(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]));
+                return sqrt(r2);
+            }
+
+            /** \brief Collision check of a state that satisfies the bounds,
+                counted in \e stats (if not nullptr) */
+            bool isCollisionFree(const base::State *state, CheckerStatistics::Slot *stats) const
+            {
+                using StateType = typename OMPL_StateType<T>::type;
+
+                static PQP_REAL identityTranslation[3] = { 0.0, 0.0, 0.0 };
+                static PQP_REAL identityRotation[3][3] = { { 1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0} };
+
+                // PQP_Collide() only reads the models, so no synchronization is needed here.
+                // The pose of every part is computed once and shared by both passes.
+                PoseBuffer poses(robotParts_.size());
+                {
+                    CheckerStatistics::Timer timer(stats, CheckerStatistics::POSE_CONVERSION);
+                    for (std::size_t i = 0 ; i < robotParts_.size() ; ++i)
+                        stateConvertor_.PQP_pose_from_state(poses[i].trans, poses[i].rot, *static_cast<const StateType*>(extractState_(state, i)));
+                }
+
+                {
+                    CheckerStatistics::Timer timer(stats, CheckerStatistics::ENVIRONMENT);
+                    if (!coherenceCache_)
+                    {
+                        for (std::size_t i = 0 ; i < robotParts_.size() ; ++i)
+                        {
+                            if (!sphereTrees_.empty() && sphereTrees_[i].isFree(
+                                    [this, &poses, i, stats](const SphereTree::Sphere &sphere)
+                                    {
+                                        return isSphereCollisionFree(poses[i], sphere, stats);
+                                    }))
+                                continue;
+                            PQP_CollideResult cr;
+                            PQP_Collide(&cr, poses[i].rot, poses[i].trans, robotParts_[i].get(),
+                                        identityRotation, identityTranslation, environment_.get(), PQP_FIRST_CONTACT);
+                            countTests(stats, cr.num_bv_tests);
+                            if (cr.Colliding() != 0)
+                                return false;
+                        }
+                    }
+                    else if (!coherenceCache_->covers(state))
+                    {
+                        // a state close to the last certified one cannot collide with the environment
+                        std::vector<double> dist(robotParts_.size());
+                        for (std::size_t i = 0 ; i < robotParts_.size() ; ++i)
+                            if ((dist[i] = partClearance(poses[i], i, stats)) <= 0.0)
+                                return false;
+                        coherenceCache_->update(state, dist);
+                    }
+                }
 
                 if (selfCollision_)
                 {
-                    PQP_REAL robTrans2[3];
-                    PQP_REAL robRot2[3][3];
+                    CheckerStatistics::Timer timer(stats, CheckerStatistics::SELF_COLLISION);
                     for (std::size_t i  = 0 ; i < robotParts_.size() ; ++i)
                     {
-                        stateConvertor_.PQP_pose_from_state(robTrans, robRot, *static_cast<const StateType*>(extractState_(state, i)));
+                        PQP_REAL ci[3];
+                        sphereCenter(poses[i], robotSpheres_[i], ci);
                         for (std::size_t j  = i + 1 ; j < robotParts_.size() ; ++j)
                         {
-                            stateConvertor_.PQP_pose_from_state(robTrans2, robRot2, *static_cast<const StateType*>(extractState_(state, j)));
+                            // parts whose bounding spheres are disjoint cannot collide
+                            PQP_REAL cj[3];
+                            sphereCenter(poses[j], robotSpheres_[j], cj);
+                            const double r = robotSpheres_[i].radius + robotSpheres_[j].radius;
+                            const double dx = ci[0] - cj[0], dy = ci[1] - cj[1], dz = ci[2] - cj[2];
+                            if (dx * dx + dy * dy + dz * dz > r * r)
+                                continue;
+
                             PQP_CollideResult cr;
-                            PQP_Collide(&cr, robRot, robTrans, robotParts_[i].get(),
-                                        robRot2, robTrans2, robotParts_[j].get(), PQP_FIRST_CONTACT);
+                            PQP_Collide(&cr, poses[i].rot, poses[i].trans, robotParts_[i].get(),
+                                        poses[j].rot, poses[j].trans, robotParts_[j].get(), PQP_FIRST_CONTACT);
+                            countTests(stats, cr.num_bv_tests);
                             if (cr.Colliding() != 0)
                                 return false;
                         }
@@ -175,42 +510,135 @@ namespace ompl
                 return true;
             }
 
-            double clearance(const base::State *state) const override
+
+            /** \brief Count a narrowphase test that performed \e bvTests bounding volume tests */
+            static void countTests(CheckerStatistics::Slot *stats, int bvTests)
             {
-                using StateType = typename OMPL_StateType<T>::type;
+                if (stats == nullptr)
+                    return;
+                stats->add(CheckerStatistics::NARROWPHASE_TESTS);
+                stats->add(CheckerStatistics::BV_TESTS, bvTests);
+            }
 
-                double dist = std::numeric_limits<double>::infinity();
-                if (environment_)
-                {
-                    static PQP_REAL identityTranslation[3] = { 0.0, 0.0, 0.0 };
-                    static PQP_REAL identityRotation[3][3] = { { 1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0} };
+            /** \brief Relative error tolerance passed to PQP_Distance() */
+            static constexpr double DISTANCE_REL_ERR = 1e-2;
 
-                    std::lock_guard<std::mutex> slock(mutex_);
+            /** \brief A lower bound on the distance between robot part \e i
+                at \e pose and the environment. PQP_Distance() may
+                overestimate the distance within its error tolerances, so the
+                value it reports is reduced accordingly. */
+            double partClearance(const PartPose &pose, std::size_t i, CheckerStatistics::Slot *stats = nullptr) const
+            {
+                static PQP_REAL identityTranslation[3] = { 0.0, 0.0, 0.0 };
+                static PQP_REAL identityRotation[3][3] = { { 1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0} };
 
-                    PQP_REAL robTrans[3];
-                    PQP_REAL robRot[3][3];
+                const DistanceScratch &scratch = getDistanceScratch();
+                PQP_DistanceResult dr;
+                PQP_Distance(&dr, const_cast<PQP_REAL(*)[3]>(pose.rot), const_cast<PQP_REAL*>(pose.trans), scratch.robotParts[i].get(),
+                             identityRotation, identityTranslation, scratch.environment.get(), DISTANCE_REL_ERR, distanceTol_);
+                if (stats != nullptr)
+                {
+                    stats->add(CheckerStatistics::DISTANCE_QUERIES);
+                    stats->add(CheckerStatistics::BV_TESTS, dr.num_bv_tests);
+                }
+                const double d = dr.Distance();
+                return std::min(d / (1.0 + DISTANCE_REL_ERR), d - distanceTol_);
+            }
 
-                    for (std::size_t i = 0 ; i < robotParts_.size() ; ++i)
-                    {
-                        stateConvertor_.PQP_pose_from_state(robTrans, robRot, *static_cast<const StateType*>(extractState_(state, i)));
-                        PQP_DistanceResult dr;
-                        PQP_Distance(&dr, robRot, robTrans, robotParts_[i].get(),
-                                     identityRotation, identityTranslation, environment_.get(), 1e-2, distanceTol_);
-                        if (dist > dr.Distance())
-                            dist = dr.Distance();
-                    }
+            /** \brief Check whether \e sphere, given in the frame of a robot
+                part at \e pose, is collision free. It is if its center is
+                farther than its radius from the environment. */
+            bool isSphereCollisionFree(const PartPose &pose, const SphereTree::Sphere &sphere,
+                                       CheckerStatistics::Slot *stats = nullptr) const
+            {
+                static PQP_REAL identityTranslation[3] = { 0.0, 0.0, 0.0 };
+                static PQP_REAL identityRotation[3][3] = { { 1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0} };
+
+                PQP_REAL center[3];
+                for (int k = 0 ; k < 3 ; ++k)
+                    center[k] = pose.rot[k][0] * sphere.center[0] + pose.rot[k][1] * sphere.center[1] +
+                        pose.rot[k][2] * sphere.center[2] + pose.trans[k];
+                // PQP_Tolerance() only reads the models
+                PQP_ToleranceResult tr;
+                PQP_Tolerance(&tr, identityRotation, center, pointModel_.get(),
+                              identityRotation, identityTranslation, environment_.get(), sphere.radius);
+                if (stats != nullptr)
+                {
+                    stats->add(CheckerStatistics::SPHERE_TESTS);
+                    stats->add(CheckerStatistics::BV_TESTS, tr.num_bv_tests);
                 }
-                return dist;
+                return tr.CloserThanTolerance() == 0;
             }
 
-        protected:
+            /** \brief Compute the center of \e sphere when its part is at \e pose */
+            static void sphereCenter(const PartPose &pose, const BoundingSphere &sphere, PQP_REAL center[3])
+            {
+                for (int k = 0 ; k < 3 ; ++k)
+                    center[k] = pose.rot[k][0] * sphere.center[0] + pose.rot[k][1] * sphere.center[1] +
+                        pose.rot[k][2] * sphere.center[2] + pose.trans[k];
+            }
 
-            /** \brief Shared pointer wrapper for PQP_Model */
-            using PQPModelPtr = std::shared_ptr<PQP_Model>;
+            /** \brief The models a thread passes to PQP_Distance(). These
+                share the bounding volumes and triangles with robotParts_ and
+                environment_, but each has its own last_tri member. */
+            struct DistanceScratch
+            {
+                std::vector<PQPModelPtr> robotParts;
+
+                PQPModelPtr              environment;
+            };
+
+            /** \brief Return a model that shares all the data of \e model
+                except for the last_tri member. The caller must make sure \e
+                model outlives the copy. */
+            static PQPModelPtr shallowCopy(const PQPModelPtr &model)
+            {
+                if (!model)
+                    return model;
+                PQPModelPtr copy(new PQP_Model(), [](PQP_Model *m)
+                    {
+                        // the arrays belong to the original model
+                        m->b = nullptr;
+                        m->tris = nullptr;
+                        delete m;
+                    });
+                *copy = *model;
+                return copy;
+            }
+
+            /** \brief Get the distance query scratch space for the calling thread */
+            const DistanceScratch& getDistanceScratch() const
+            {
+                bool created;
+                DistanceScratch &scratch = distanceScratch_.get(&created);
+                if (created)
+                {
+                    scratch.environment = shallowCopy(environment_);
+                    for (const auto &part : robotParts_)
+                        scratch.robotParts.push_back(shallowCopy(part));
+                }
+                return scratch;
+            }
 
             void configure(const GeometrySpecification &geom)
             {
-                std::pair<PQPModelPtr, double> p = getPQPModelFromScene(geom.obstacles, geom.obstaclesShift);
+                // the models of the environment and of the robot parts are
+                // independent, so they are built concurrently
+                std::future<std::pair<PQPModelPtr, double>> env = std::async(std::launch::async, [this, &geom]
+                    {
+                        return getPQPModelFromScene(geom.obstacles, geom.obstaclesShift);
+                    });
+                std::vector<std::future<PQPModelPtr>> parts;
+                for (unsigned int i = 0 ; i < geom.robot.size() ; ++i)
+                    parts.push_back(std::async(std::launch::async, [this, &geom, i]
+                        {
+                            aiVector3D shift(0.0, 0.0, 0.0);
+                            if (geom.robotShift.size() > i)
+                                shift = geom.robotShift[i];
+                            return getPQPModelFromScene(geom.robot[i], shift).first;
+                        }));
+
+                std::pair<PQPModelPtr, double> p = env.get();
                 environment_ = p.first;
                 avgEnvSide_ = p.second;
                 distanceTol_ = avgEnvSide_ / 100.0;
@@ -218,19 +646,18 @@ namespace ompl
                 if (!environment_)
                     OMPL_INFORM("Empty environment loaded");
                 else
-                    OMPL_INFORM("Loaded environment model with %d triangles. Average side length is %lf.", environment_->num_tris, avgEnvSide_);
+                    OMPL_INFORM("Loaded environment model with %d triangles (%lu bytes). Average side length is %lf.",
+                                environment_->num_tris, (unsigned long)getModelMemory(*environment_), avgEnvSide_);
 
-                for (unsigned int i = 0 ; i < geom.robot.size() ; ++i)
+                for (auto &part : parts)
                 {
-                    aiVector3D shift(0.0, 0.0, 0.0);
-                    if (geom.robotShift.size() > i)
-                        shift = geom.robotShift[i];
-                    PQPModelPtr m = getPQPModelFromScene(geom.robot[i], shift).first;
+                    PQPModelPtr m = part.get();
                     if (!m)
                         throw Exception("Invalid robot mesh");
 
-                    OMPL_INFORM("Loaded robot model with %d triangles", m->num_tris);
+                    OMPL_INFORM("Loaded robot model with %d triangles (%lu bytes)", m->num_tris, (unsigned long)getModelMemory(*m));
                     robotParts_.push_back(m);
+                    robotSpheres_.push_back(computeBoundingSphere(*m));
                 }
             }
 
@@ -244,18 +671,83 @@ namespace ompl
             /** \brief Convert a mesh to a PQP model */
             std::pair<PQPModelPtr, double> getPQPModelFromScene(const std::vector<const aiScene*> &scenes, const std::vector<aiVector3D> &center) const
             {
+                // PQP stores the corners of every triangle, but the shift
+                // only needs to be applied once per shared vertex
                 std::vector<aiVector3D> triangles;
+                scene::IndexedMesh mesh;
                 for (unsigned int i = 0 ; i < scenes.size() ; ++i)
                     if (scenes[i] != nullptr)
                     {
-                        std::vector<aiVector3D> t;
-                        scene::extractTriangles(scenes[i], t);
+                        scene::extractIndexedTriangles(scenes[i], mesh);
                         if (center.size() > i)
-                            for (auto & j : t)
-                                j -= center[i];
-                        triangles.insert(triangles.end(), t.begin(), t.end());
+                            for (auto & v : mesh.vertices)
+                                v -= center[i];
+                        triangles.reserve(triangles.size() + mesh.indices.size());
+                        for (unsigned int index : mesh.indices)
+                            triangles.push_back(mesh.vertices[index]);
+                    }
+                if (triangles.empty())
+                    return getPQPModelFromTris(triangles);
+
+                // meshes made of identical triangles share a single model
+                using ModelInfo = std::pair<PQPModelPtr, double>;
+                std::shared_ptr<ModelInfo> info = GeometryRegistry<ModelInfo>::get(triangleKey(triangles),
+                    [this, &triangles]
+                    {
+                        return std::make_shared<ModelInfo>(getPQPModelFromTris(triangles));
+                    });
+                // the returned model keeps the registry entry alive
+                return std::make_pair(PQPModelPtr(info, info->first.get()), info->second);
+            }
+
+            /** \brief Turn the thin surface \e triangles into a solid by
+                extruding it by \e padd along dimension \e d. The result has
+                the original triangles, a shifted copy with the opposite
+                orientation, and two side triangles per boundary edge (an
+                edge used by a single triangle). Interior edges get no side
+                walls, so a triangulated polygon grows to about four times
+                its number of triangles rather than eight. */
+            static std::vector<aiVector3D> extrude(const std::vector<aiVector3D> &triangles, unsigned int d, double padd)
+            {
+                // identify vertices by their coordinates to find the shared edges
+                std::map<std::array<float, 3>, unsigned int> ids;
+                std::vector<unsigned int> index(triangles.size());
+                for (std::size_t k = 0 ; k < triangles.size() ; ++k)
+                {
+                    const std::array<float, 3> key = {{ triangles[k].x, triangles[k].y, triangles[k].z }};
+                    index[k] = ids.emplace(key, (unsigned int)ids.size()).first->second;
+                }
+                std::map<std::pair<unsigned int, unsigned int>, unsigned int> edgeCount;
+                for (std::size_t t = 0 ; t + 2 < triangles.size() ; t += 3)
+                    for (std::size_t k = 0 ; k < 3 ; ++k)
+                    {
+                        const unsigned int a = index[t + k], b = index[t + (k + 1) % 3];
+                        ++edgeCount[std::make_pair(std::min(a, b), std::max(a, b))];
+                    }
+
+                std::vector<aiVector3D> result(triangles);
+                result.reserve(triangles.size() * 2 + edgeCount.size() * 6);
+                for (std::size_t t = 0 ; t + 2 < triangles.size() ; t += 3)
+                {
+                    aiVector3D x[3] = { triangles[t], triangles[t + 1], triangles[t + 2] };
+                    for (auto &v : x)
+                        v[d] += padd;
+                    result.push_back(x[0]); result.push_back(x[2]); result.push_back(x[1]);
+                }
+                for (std::size_t t = 0 ; t + 2 < triangles.size() ; t += 3)
+                    for (std::size_t k = 0 ; k < 3 ; ++k)
+                    {
+                        const unsigned int a = index[t + k], b = index[t + (k + 1) % 3];
+                        if (edgeCount[std::make_pair(std::min(a, b), std::max(a, b))] != 1)
+                            continue;
+                        const aiVector3D &v0 = triangles[t + k], &v1 = triangles[t + (k + 1) % 3];
+                        aiVector3D x0 = v0, x1 = v1;
+                        x0[d] += padd;
+                        x1[d] += padd;
+                        result.push_back(v0); result.push_back(x1); result.push_back(v1);
+                        result.push_back(v0); result.push_back(x0); result.push_back(x1);
                     }
-                return getPQPModelFromTris(triangles);
+                return result;
             }
 
             /** \brief Convert a set of triangles to a PQP model, but add extra padding if a particular dimension is disproportionately small */
@@ -273,30 +765,7 @@ namespace ompl
                 if (b[d] * 1000.0 < other && b[d] < 0.1)
                 {
                     OMPL_DEBUG("Adding padding for dimension %u so that collision checking is more accurate", d);
-                    std::vector<aiVector3D> extraTri;
-                    extraTri.reserve(triangles.size() * 8);
-                    const int N = triangles.size() / 3;
-                    double padd = other / 10.0;
-
-                    for (int j = 0 ; j < N ; ++j)
-                    {
-                        const aiVector3D &v0 = triangles[j * 3];
-                        const aiVector3D &v1 = triangles[j * 3 + 1];
-                        const aiVector3D &v2 = triangles[j * 3 + 2];
-                        aiVector3D x0 = v0; x0[d] += padd;
-                        aiVector3D x1 = v1; x1[d] += padd;
-                        aiVector3D x2 = v2; x2[d] += padd;
-                        extraTri.push_back(v0); extraTri.push_back(v1); extraTri.push_back(v2);
-                        extraTri.push_back(x0); extraTri.push_back(x2); extraTri.push_back(x1);
-                        extraTri.push_back(x1); extraTri.push_back(v1); extraTri.push_back(v2);
-                        extraTri.push_back(x1); extraTri.push_back(v2); extraTri.push_back(x2);
-                        extraTri.push_back(x1); extraTri.push_back(v0); extraTri.push_back(v1);
-                        extraTri.push_back(x1); extraTri.push_back(x0); extraTri.push_back(v0);
-                        extraTri.push_back(v0); extraTri.push_back(v2); extraTri.push_back(x2);
-                        extraTri.push_back(v0); extraTri.push_back(x2); extraTri.push_back(x0);
-                    }
-
-                    return getPQPModelFromTrisHelper(extraTri);
+                    return getPQPModelFromTrisHelper(extrude(triangles, d, other / 10.0));
                 }
                 else
                     return getPQPModelFromTrisHelper(triangles);
@@ -343,6 +812,9 @@ namespace ompl
             /** \brief Model of the robot */
             std::vector<PQPModelPtr>    robotParts_;
 
+            /** \brief Bounding spheres of the robot parts, used to skip self collision checks */
+            std::vector<BoundingSphere> robotSpheres_;
+
             /** \brief Model of the environment */
             PQPModelPtr                 environment_;
 
@@ -352,7 +824,23 @@ namespace ompl
             /** \brief Tolerance passed to PQP for distance calculations */
             double                      distanceTol_;
 
-            mutable std::mutex          mutex_;
+            /** \brief Relative error passed to PQP by clearance() */
+            double                      clearanceRelErr_{DISTANCE_REL_ERR};
+
+            /** \brief Per-thread copies of the models for distance queries */
+            PerThread<DistanceScratch>  distanceScratch_;
+
+            /** \brief Clearance certified for recent queries (if enabled) */
+            std::shared_ptr<CoherenceCache<T>> coherenceCache_;
+
+            /** \brief Bounding sphere hierarchies of the robot parts (if enabled) */
+            std::vector<SphereTree>     sphereTrees_;
+
+            /** \brief A model that is tested against the environment in place of the center of a sphere */
+            PQPModelPtr                 pointModel_;
+
+            /** \brief Counters and timers of the queries */
+            mutable CheckerStatistics   statistics_;
 
         };
 
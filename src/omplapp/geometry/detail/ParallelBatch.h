@@ -0,0 +1,96 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_GEOMETRY_DETAIL_PARALLEL_BATCH_
+#define OMPLAPP_GEOMETRY_DETAIL_PARALLEL_BATCH_
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace ompl
+{
+    namespace app
+    {
+        /// @cond IGNORE
+        /** \brief Call \e range(begin, end) on contiguous chunks that cover
+            [0, \e count). If \e numThreads is larger than one, the chunks
+            are processed concurrently; zero selects one thread per core. */
+        template<typename F>
+        void parallelFor(std::size_t count, unsigned int numThreads, const F &range)
+        {
+            if (numThreads == 0)
+                numThreads = std::max(1u, std::thread::hardware_concurrency());
+            std::size_t threads = std::max<std::size_t>(1, std::min<std::size_t>(numThreads, count));
+            if (threads == 1)
+                range(0, count);
+            else
+            {
+                std::vector<std::thread> workers;
+                std::size_t chunk = (count + threads - 1) / threads;
+                for (std::size_t t = 0 ; t < threads ; ++t)
+                    workers.emplace_back([&range, t, chunk, count]
+                        {
+                            range(std::min(t * chunk, count), std::min((t + 1) * chunk, count));
+                        });
+                for (auto &worker : workers)
+                    worker.join();
+            }
+        }
+
+        /** \brief Call \e item(i) for every i in [0, \e count) on up to
+            \e numThreads threads (zero selects one thread per core). Every
+            thread takes the next index as soon as it is done with the
+            previous one, so items that take very different times, such as
+            planning queries, are spread evenly. The calling thread takes
+            part. */
+        template<typename F>
+        void parallelForEach(std::size_t count, unsigned int numThreads, const F &item)
+        {
+            if (numThreads == 0)
+                numThreads = std::max(1u, std::thread::hardware_concurrency());
+            std::atomic<std::size_t> next(0);
+            auto worker = [&item, &next, count]
+                {
+                    for (std::size_t i = next++ ; i < count ; i = next++)
+                        item(i);
+                };
+            std::vector<std::thread> workers;
+            for (std::size_t t = 1 ; t < std::min<std::size_t>(numThreads, count) ; ++t)
+                workers.emplace_back(worker);
+            worker();
+            for (auto &w : workers)
+                w.join();
+        }
+
+        /** \brief Evaluate a batch of \e count independent checks and store
+            the outcomes in \e valid. \e checkRange(begin, end, result) must
+            set result[k] to 1 or 0 for k in [begin, end). If \e numThreads
+            is larger than one, the batch is split in contiguous chunks that
+            are checked concurrently; zero selects one thread per core. */
+        template<typename F>
+        void parallelBatch(std::size_t count, unsigned int numThreads, std::vector<bool> &valid, const F &checkRange)
+        {
+            // std::vector<bool> cannot be written concurrently, so collect the results per element first
+            std::vector<char> result(count, 0);
+            char *data = result.data();
+            parallelFor(count, numThreads, [&checkRange, data](std::size_t begin, std::size_t end)
+                {
+                    checkRange(begin, end, data);
+                });
+            valid.assign(result.begin(), result.end());
+        }
+
+        /// @endcond
+    }
+}
+
+#endif
@@ -0,0 +1,113 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_GEOMETRY_DETAIL_PART_COLLISION_CACHE_
+#define OMPLAPP_GEOMETRY_DETAIL_PART_COLLISION_CACHE_
+
+#include "omplapp/geometry/GeometrySpecification.h"
+#include "omplapp/geometry/detail/CoherenceCache.h"
+#include "omplapp/geometry/detail/PerThread.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace ompl
+{
+    namespace app
+    {
+        /** \brief Cache of the results of collision tests between single
+            robot parts and the environment, keyed on the pose of the part.
+            When a planner for several robots changes only some of them from
+            one state to the next, the others are not checked against the
+            environment again.
+
+            Every thread has a direct-mapped table with a fixed number of
+            slots per part; a pose that maps to an occupied slot replaces
+            its entry. Entries only match poses that are exactly equal, so
+            the cache never changes the outcome of a query. The results are
+            only valid as long as the environment does not change. */
+        template<MotionModel T>
+        class PartCollisionCache
+        {
+        public:
+
+            /** \brief Constructor. The table of every thread has \e slots
+                entries for each of the \e parts robot parts. */
+            PartCollisionCache(GeometricStateExtractor se, std::size_t parts, std::size_t slots = 64)
+                : extractState_(std::move(se)), parts_(parts), slots_(std::max<std::size_t>(1, slots))
+            {
+            }
+
+            /** \brief Return true if robot part \e i at \e state does not
+                collide with the environment. \e check() performs the test
+                if the pose of the part is not in the cache. */
+            template<typename F>
+            bool isFree(const base::State *state, std::size_t i, const F &check) const
+            {
+                std::vector<Entry> &table = table_.get();
+                if (table.empty())
+                    table.resize(parts_ * slots_);
+
+                double pose[CoherencePose<T>::SIZE];
+                CoherencePose<T>::store(extractState_(state, i), pose);
+                Entry &entry = table[i * slots_ + hash(pose) % slots_];
+                if (entry.used && std::equal(pose, pose + CoherencePose<T>::SIZE, entry.pose))
+                    return entry.free;
+
+                entry.free = check();
+                entry.used = true;
+                std::copy(pose, pose + CoherencePose<T>::SIZE, entry.pose);
+                return entry.free;
+            }
+
+            /** \brief Get the number of slots per part */
+            std::size_t getSlots() const
+            {
+                return slots_;
+            }
+
+            /** \brief Forget the entries of the calling thread */
+            void clear() const
+            {
+                table_.get().clear();
+            }
+
+        private:
+
+            struct Entry
+            {
+                double pose[CoherencePose<T>::SIZE];
+                bool   used{false};
+                bool   free{false};
+            };
+
+            static std::size_t hash(const double *pose)
+            {
+                std::size_t h = 0;
+                for (std::size_t k = 0 ; k < CoherencePose<T>::SIZE ; ++k)
+                    h = h * 1000003u ^ std::hash<double>()(pose[k]);
+                return h;
+            }
+
+            GeometricStateExtractor        extractState_;
+
+            std::size_t                    parts_;
+
+            std::size_t                    slots_;
+
+            PerThread<std::vector<Entry>>  table_;
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,93 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_GEOMETRY_DETAIL_PER_THREAD_
+#define OMPLAPP_GEOMETRY_DETAIL_PER_THREAD_
+
+#include <atomic>
+#include <map>
+#include <memory>
+
+namespace ompl
+{
+    namespace app
+    {
+        /// @cond IGNORE
+        /** \brief Data of type \e D that every thread gets its own copy of.
+            This is used for scratch space of collision queries, so that
+            const query functions can be called concurrently without
+            locking. The copy for a thread is default constructed the first
+            time that thread calls get(). */
+        template<typename D>
+        class PerThread
+        {
+        public:
+            PerThread() : id_(nextId()), alive_(std::make_shared<char>(0))
+            {
+            }
+
+            PerThread(const PerThread&) = delete;
+            PerThread& operator=(const PerThread&) = delete;
+
+            /** \brief Return the data of the calling thread. If \e created is
+                not nullptr, it is set to true iff the data was constructed
+                by this call. */
+            D& get(bool *created = nullptr) const
+            {
+                thread_local std::map<std::size_t, Entry> data;
+
+                auto it = data.find(id_);
+                if (it != data.end())
+                {
+                    if (created != nullptr)
+                        *created = false;
+                    return it->second.data;
+                }
+
+                // first access from this thread; drop the data of instances that no longer exist
+                for (auto d = data.begin() ; d != data.end() ; )
+                    if (d->second.owner.expired())
+                        d = data.erase(d);
+                    else
+                        ++d;
+
+                Entry &entry = data[id_];
+                entry.owner = alive_;
+                if (created != nullptr)
+                    *created = true;
+                return entry.data;
+            }
+
+        private:
+
+            struct Entry
+            {
+                std::weak_ptr<char> owner;
+                D                   data;
+            };
+
+            /** \brief Every instance gets a unique id, so that per-thread data
+                is never confused between instances allocated at the same address */
+            static std::size_t nextId()
+            {
+                static std::atomic<std::size_t> counter(0);
+                return counter++;
+            }
+
+            const std::size_t     id_;
+
+            /** \brief Expires when this instance is destroyed */
+            std::shared_ptr<char> alive_;
+        };
+        /// @endcond
+    }
+}
+
+#endif
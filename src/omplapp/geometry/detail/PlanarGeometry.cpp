@@ -0,0 +1,149 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#include "omplapp/geometry/detail/PlanarGeometry.h"
+#include <map>
+#include <set>
+#include <utility>
+
+namespace
+{
+    using ompl::app::planar::Point;
+
+    bool onSegment(const Point &p, const Point &a, const Point &b)
+    {
+        return std::min(a.x, b.x) <= p.x && p.x <= std::max(a.x, b.x) &&
+            std::min(a.y, b.y) <= p.y && p.y <= std::max(a.y, b.y);
+    }
+
+    double pointSegmentDistance(const Point &p, const Point &a, const Point &b)
+    {
+        const double dx = b.x - a.x, dy = b.y - a.y;
+        const double len2 = dx * dx + dy * dy;
+        double t = len2 > 0.0 ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / len2 : 0.0;
+        t = std::max(0.0, std::min(1.0, t));
+        const double ex = a.x + t * dx - p.x, ey = a.y + t * dy - p.y;
+        return std::sqrt(ex * ex + ey * ey);
+    }
+}
+
+bool ompl::app::planar::segmentsIntersect(const Point &a, const Point &b, const Point &c, const Point &d)
+{
+    const double d1 = orientation(c, d, a), d2 = orientation(c, d, b);
+    const double d3 = orientation(a, b, c), d4 = orientation(a, b, d);
+    if (((d1 > 0.0 && d2 < 0.0) || (d1 < 0.0 && d2 > 0.0)) && ((d3 > 0.0 && d4 < 0.0) || (d3 < 0.0 && d4 > 0.0)))
+        return true;
+    return (d1 == 0.0 && onSegment(a, c, d)) || (d2 == 0.0 && onSegment(b, c, d)) ||
+        (d3 == 0.0 && onSegment(c, a, b)) || (d4 == 0.0 && onSegment(d, a, b));
+}
+
+double ompl::app::planar::segmentDistance(const Point &a, const Point &b, const Point &c, const Point &d)
+{
+    if (segmentsIntersect(a, b, c, d))
+        return 0.0;
+    return std::min(std::min(pointSegmentDistance(a, c, d), pointSegmentDistance(b, c, d)),
+                    std::min(pointSegmentDistance(c, a, b), pointSegmentDistance(d, a, b)));
+}
+
+ompl::app::planar::Shape::Shape(const std::vector<aiVector3D> &triangles)
+{
+    // vertices that project to the same point are merged, such as the
+    // top and bottom vertices of an extruded polygon
+    std::map<std::pair<double, double>, unsigned int> ids;
+    auto id = [this, &ids](const aiVector3D &v)
+        {
+            auto it = ids.emplace(std::make_pair((double)v.x, (double)v.y), (unsigned int)points.size());
+            if (it.second)
+                points.push_back(Point{v.x, v.y});
+            return it.first->second;
+        };
+
+    Box box;
+    for (const auto &v : triangles)
+        box.add(Point{v.x, v.y});
+    const double extent = std::max(box.high.x - box.low.x, box.high.y - box.low.y);
+    const double minArea = 1e-12 * extent * extent;
+
+    std::set<std::array<unsigned int, 3>> distinct;
+    for (std::size_t t = 0 ; t + 2 < triangles.size() ; t += 3)
+    {
+        std::array<unsigned int, 3> tri = {{ id(triangles[t]), id(triangles[t + 1]), id(triangles[t + 2]) }};
+        if (std::abs(orientation(points[tri[0]], points[tri[1]], points[tri[2]])) <= minArea)
+            continue;
+        std::sort(tri.begin(), tri.end());
+        if (distinct.insert(tri).second)
+            this->triangles.push_back(tri);
+    }
+
+    // for every edge, whether there are triangles to its left and to its right
+    std::map<std::array<unsigned int, 2>, std::pair<bool, bool>> sides;
+    for (const auto &tri : this->triangles)
+        for (int k = 0 ; k < 3 ; ++k)
+        {
+            const unsigned int a = tri[k], b = tri[(k + 1) % 3];
+            const std::array<unsigned int, 2> edge = {{ std::min(a, b), std::max(a, b) }};
+            const bool left = orientation(points[edge[0]], points[edge[1]], points[tri[(k + 2) % 3]]) > 0.0;
+            std::pair<bool, bool> &s = sides[edge];
+            (left ? s.first : s.second) = true;
+        }
+    for (const auto &s : sides)
+        if (!s.second.first || !s.second.second)
+            edges.push_back(s.first);
+}
+
+ompl::app::planar::BoxTree::BoxTree(const std::vector<Box> &boxes)
+{
+    if (boxes.empty())
+        return;
+    std::vector<Point> centers(boxes.size());
+    index_.resize(boxes.size());
+    for (unsigned int i = 0 ; i < boxes.size() ; ++i)
+    {
+        centers[i] = Point{(boxes[i].low.x + boxes[i].high.x) / 2.0, (boxes[i].low.y + boxes[i].high.y) / 2.0};
+        index_[i] = i;
+    }
+    nodes_.reserve(2 * (boxes.size() / LEAF_SIZE + 1));
+    nodes_.emplace_back();
+    build(0, 0, boxes.size(), boxes, centers);
+    boxes_.reserve(boxes.size());
+    for (unsigned int i : index_)
+        boxes_.push_back(boxes[i]);
+}
+
+void ompl::app::planar::BoxTree::build(unsigned int node, unsigned int first, unsigned int count,
+                                       const std::vector<Box> &boxes, std::vector<Point> &centers)
+{
+    Box box;
+    for (unsigned int k = first ; k < first + count ; ++k)
+        box.add(boxes[index_[k]]);
+    nodes_[node].box = box;
+    if (count <= LEAF_SIZE)
+    {
+        nodes_[node].first = first;
+        nodes_[node].count = count;
+        return;
+    }
+
+    // split at the median center along the longer side of the box
+    const bool alongX = box.high.x - box.low.x >= box.high.y - box.low.y;
+    const unsigned int half = count / 2;
+    std::nth_element(index_.begin() + first, index_.begin() + first + half, index_.begin() + first + count,
+        [&centers, alongX](unsigned int a, unsigned int b)
+        {
+            return alongX ? centers[a].x < centers[b].x : centers[a].y < centers[b].y;
+        });
+    const unsigned int left = nodes_.size();
+    nodes_.emplace_back();
+    nodes_.emplace_back();
+    nodes_[node].first = left;
+    nodes_[node].count = 0;
+    build(left, first, half, boxes, centers);
+    build(left + 1, first + half, count - half, boxes, centers);
+}
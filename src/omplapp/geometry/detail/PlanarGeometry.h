@@ -0,0 +1,218 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_GEOMETRY_DETAIL_PLANAR_GEOMETRY_
+#define OMPLAPP_GEOMETRY_DETAIL_PLANAR_GEOMETRY_
+
+#include <assimp/types.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+namespace ompl
+{
+    namespace app
+    {
+        /// @cond IGNORE
+        namespace planar
+        {
+            struct Point
+            {
+                double x, y;
+            };
+
+            /** \brief Axis-aligned box in the plane */
+            struct Box
+            {
+                Point low{std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity()};
+                Point high{-std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity()};
+
+                void add(const Point &p)
+                {
+                    low.x = std::min(low.x, p.x);
+                    low.y = std::min(low.y, p.y);
+                    high.x = std::max(high.x, p.x);
+                    high.y = std::max(high.y, p.y);
+                }
+
+                void add(const Box &b)
+                {
+                    add(b.low);
+                    add(b.high);
+                }
+
+                bool overlaps(const Box &b) const
+                {
+                    return low.x <= b.high.x && b.low.x <= high.x && low.y <= b.high.y && b.low.y <= high.y;
+                }
+
+                /** \brief Distance between the closest points of two boxes (zero if they overlap) */
+                double distance(const Box &b) const
+                {
+                    const double dx = std::max(0.0, std::max(low.x - b.high.x, b.low.x - high.x));
+                    const double dy = std::max(0.0, std::max(low.y - b.high.y, b.low.y - high.y));
+                    return std::sqrt(dx * dx + dy * dy);
+                }
+            };
+
+            /** \brief Twice the signed area of triangle (a, b, c); positive if counterclockwise */
+            inline double orientation(const Point &a, const Point &b, const Point &c)
+            {
+                return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+            }
+
+            /** \brief Return true if segments (a, b) and (c, d) have a point in common */
+            bool segmentsIntersect(const Point &a, const Point &b, const Point &c, const Point &d);
+
+            /** \brief Distance between segments (a, b) and (c, d) */
+            double segmentDistance(const Point &a, const Point &b, const Point &c, const Point &d);
+
+            /** \brief Return true if \e p is in the closed triangle (a, b, c) */
+            inline bool inTriangle(const Point &p, const Point &a, const Point &b, const Point &c)
+            {
+                const double d1 = orientation(a, b, p), d2 = orientation(b, c, p), d3 = orientation(c, a, p);
+                return (d1 >= 0.0 && d2 >= 0.0 && d3 >= 0.0) || (d1 <= 0.0 && d2 <= 0.0 && d3 <= 0.0);
+            }
+
+            /** \brief The projection of a triangle soup onto the xy-plane.
+                Triangles that project to (almost) nothing, such as the side
+                walls of an extruded polygon, are dropped. Edges shared by
+                triangles on both of their sides are in the interior of the
+                projection and dropped as well; the remaining edges contain
+                the boundary of the projection. */
+            class Shape
+            {
+            public:
+
+                Shape() = default;
+
+                /** \brief Project \e triangles (three consecutive points per triangle) */
+                explicit Shape(const std::vector<aiVector3D> &triangles);
+
+                /** \brief Distinct projected vertices */
+                std::vector<Point>                          points;
+
+                /** \brief Edges that may be on the boundary, as indices into points */
+                std::vector<std::array<unsigned int, 2>>    edges;
+
+                /** \brief Distinct projected triangles, as indices into points */
+                std::vector<std::array<unsigned int, 3>>    triangles;
+            };
+
+            /** \brief Bounding box hierarchy over a set of boxes, built once
+                and queried concurrently */
+            class BoxTree
+            {
+            public:
+
+                BoxTree() = default;
+
+                explicit BoxTree(const std::vector<Box> &boxes);
+
+                bool empty() const
+                {
+                    return nodes_.empty();
+                }
+
+                /** \brief Call \e f(i) for every box \e i that overlaps \e
+                    box, until \e f returns true. Returns true if \e f did. */
+                template<typename F>
+                bool query(const Box &box, const F &f) const
+                {
+                    if (nodes_.empty())
+                        return false;
+                    unsigned int stack[64];
+                    unsigned int top = 0;
+                    stack[top++] = 0;
+                    while (top > 0)
+                    {
+                        const Node &node = nodes_[stack[--top]];
+                        if (!node.box.overlaps(box))
+                            continue;
+                        if (node.count > 0)
+                        {
+                            for (unsigned int k = node.first ; k < node.first + node.count ; ++k)
+                                if (boxes_[k].overlaps(box) && f(index_[k]))
+                                    return true;
+                        }
+                        else
+                        {
+                            stack[top++] = node.first;
+                            stack[top++] = node.first + 1;
+                        }
+                    }
+                    return false;
+                }
+
+                /** \brief Call \e f(i) for the boxes \e i that may be closer
+                    to \e box than \e bound, nearest subtrees first. \e f
+                    may decrease \e bound to prune the search. */
+                template<typename F>
+                void nearest(const Box &box, double &bound, const F &f) const
+                {
+                    if (!nodes_.empty())
+                        nearest(0, box, bound, f);
+                }
+
+            private:
+
+                struct Node
+                {
+                    Box          box;
+                    /** \brief First index of a leaf, or left child of an inner node (right child is first + 1) */
+                    unsigned int first;
+                    /** \brief Number of boxes of a leaf, zero for an inner node */
+                    unsigned int count;
+                };
+
+                static const unsigned int LEAF_SIZE = 4;
+
+                void build(unsigned int node, unsigned int first, unsigned int count,
+                           const std::vector<Box> &boxes, std::vector<Point> &centers);
+
+                template<typename F>
+                void nearest(unsigned int n, const Box &box, double &bound, const F &f) const
+                {
+                    const Node &node = nodes_[n];
+                    if (node.count > 0)
+                    {
+                        for (unsigned int k = node.first ; k < node.first + node.count ; ++k)
+                            if (boxes_[k].distance(box) < bound)
+                                f(index_[k]);
+                        return;
+                    }
+                    unsigned int a = node.first, b = node.first + 1;
+                    double da = nodes_[a].box.distance(box), db = nodes_[b].box.distance(box);
+                    if (db < da)
+                    {
+                        std::swap(a, b);
+                        std::swap(da, db);
+                    }
+                    if (da < bound)
+                        nearest(a, box, bound, f);
+                    if (db < bound)
+                        nearest(b, box, bound, f);
+                }
+
+                std::vector<Node>         nodes_;
+                /** \brief Indices of the boxes, ordered by leaf */
+                std::vector<unsigned int> index_;
+                /** \brief The boxes, in the order of index_ */
+                std::vector<Box>          boxes_;
+            };
+        }
+        /// @endcond
+    }
+}
+
+#endif
@@ -0,0 +1,302 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_GEOMETRY_DETAIL_POLYGON_STATE_VALIDITY_CHECKER_
+#define OMPLAPP_GEOMETRY_DETAIL_POLYGON_STATE_VALIDITY_CHECKER_
+
+#include <ompl/base/SpaceInformation.h>
+#include <ompl/base/StateValidityChecker.h>
+#include <ompl/util/Console.h>
+#include <ompl/util/Exceptions.h>
+
+#include "omplapp/geometry/GeometrySpecification.h"
+#include "omplapp/geometry/detail/assimpUtil.h"
+#include "omplapp/geometry/detail/ParallelBatch.h"
+#include "omplapp/geometry/detail/PerThread.h"
+#include "omplapp/geometry/detail/PlanarGeometry.h"
+#include "omplapp/geometry/detail/PoseBatch.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace ompl
+{
+    namespace app
+    {
+        /** \brief A state validity checker for planar problems. At
+            construction, the robot parts and the environment are projected
+            onto the xy-plane, and the collision checks and distance
+            computations are done on the resulting polygons with 2D segment
+            tests, which is much cheaper than checking the full meshes.
+
+            The projection is exact for the extruded polygons the 2D
+            problems are made of; for other meshes it checks the shadows of
+            the meshes on the plane, which can only report more collisions.
+            The polygons are never modified, so the checker can be used
+            from many threads. */
+        class PolygonStateValidityChecker : public base::StateValidityChecker
+        {
+        public:
+
+            PolygonStateValidityChecker(const base::SpaceInformationPtr &si, const GeometrySpecification &geom,
+                                        GeometricStateExtractor se, bool selfCollision) : base::StateValidityChecker(si), extractState_(std::move(se)),
+                                                                                                 selfCollision_(selfCollision)
+            {
+                configure(geom);
+                specs_.clearanceComputationType = base::StateValidityCheckerSpecs::EXACT;
+            }
+
+            bool isValid(const base::State *state) const override
+            {
+                if (!si_->satisfiesBounds(state))
+                    return false;
+
+                std::vector<std::vector<planar::Point>> &world = transform(state);
+                if (!environmentEdges_.empty())
+                    for (std::size_t i = 0 ; i < robotParts_.size() ; ++i)
+                        if (!isPartCollisionFree(robotParts_[i], world[i]))
+                            return false;
+
+                return !selfCollision_ || isSelfCollisionFree(world);
+            }
+
+            /** \brief Check a batch of states. On return, \e valid[i] is
+                true iff \e states[i] is valid. The checks are spread over
+                \e numThreads threads; zero selects one thread per core. */
+            void isValidBatch(const std::vector<const base::State*> &states, std::vector<bool> &valid,
+                              unsigned int numThreads = 1) const
+            {
+                parallelBatch(states.size(), numThreads, valid, [this, &states](std::size_t begin, std::size_t end, char *result)
+                    {
+                        for (std::size_t k = begin ; k < end ; ++k)
+                            result[k] = isValid(states[k]) ? 1 : 0;
+                    });
+            }
+
+            /** \brief The distance between the robot and the environment in
+                the plane, or zero if they overlap */
+            double clearance(const base::State *state) const override
+            {
+                double dist = std::numeric_limits<double>::infinity();
+                if (environmentEdges_.empty())
+                    return dist;
+
+                std::vector<std::vector<planar::Point>> &world = transform(state);
+                for (std::size_t i = 0 ; i < robotParts_.size() ; ++i)
+                {
+                    if (!isPartCollisionFree(robotParts_[i], world[i]))
+                        return 0.0;
+                    partClearance(robotParts_[i], world[i], dist);
+                }
+                return dist;
+            }
+
+            /** \brief Get the projection of the environment */
+            const planar::Shape& getEnvironment() const
+            {
+                return environment_;
+            }
+
+        protected:
+
+            static planar::Box edgeBox(const planar::Point &a, const planar::Point &b)
+            {
+                planar::Box box;
+                box.add(a);
+                box.add(b);
+                return box;
+            }
+
+            /** \brief Compute the points of every robot part at \e state.
+                The result is kept in storage of the calling thread. */
+            std::vector<std::vector<planar::Point>>& transform(const base::State *state) const
+            {
+                std::vector<std::vector<planar::Point>> &world = world_.get();
+                world.resize(robotParts_.size());
+                for (std::size_t i = 0 ; i < robotParts_.size() ; ++i)
+                {
+                    double r[9], t[3];
+                    PoseBatch<Motion_2D>::pose(extractState_(state, i), r, t);
+                    const std::vector<planar::Point> &local = robotParts_[i].points;
+                    world[i].resize(local.size());
+                    for (std::size_t k = 0 ; k < local.size() ; ++k)
+                        world[i][k] = planar::Point{r[0] * local[k].x + r[1] * local[k].y + t[0],
+                                                    r[3] * local[k].x + r[4] * local[k].y + t[1]};
+                }
+                return world;
+            }
+
+            /** \brief Check whether \e part, with its points at \e points,
+                overlaps the environment: either their boundaries cross or
+                one contains a component of the other */
+            bool isPartCollisionFree(const planar::Shape &part, const std::vector<planar::Point> &points) const
+            {
+                const std::vector<planar::Point> &env = environment_.points;
+                for (const auto &e : part.edges)
+                {
+                    const planar::Point &a = points[e[0]], &b = points[e[1]];
+                    if (environmentEdges_.query(edgeBox(a, b), [&](unsigned int k)
+                        {
+                            const auto &f = environment_.edges[k];
+                            return planar::segmentsIntersect(a, b, env[f[0]], env[f[1]]);
+                        }))
+                        return false;
+
+                    // a robot boundary inside an obstacle
+                    const planar::Box box = edgeBox(a, a);
+                    if (environmentTriangles_.query(box, [&](unsigned int k)
+                        {
+                            const auto &f = environment_.triangles[k];
+                            return planar::inTriangle(a, env[f[0]], env[f[1]], env[f[2]]);
+                        }))
+                        return false;
+                }
+
+                // an obstacle boundary inside the robot
+                planar::Box box;
+                for (const auto &p : points)
+                    box.add(p);
+                return !environmentEdges_.query(box, [&](unsigned int k)
+                    {
+                        const planar::Point &p = env[environment_.edges[k][0]];
+                        for (const auto &f : part.triangles)
+                            if (planar::inTriangle(p, points[f[0]], points[f[1]], points[f[2]]))
+                                return true;
+                        return false;
+                    });
+            }
+
+            /** \brief Lower \e dist to the distance between the boundary of
+                \e part and the boundary of the environment, if it is smaller */
+            void partClearance(const planar::Shape &part, const std::vector<planar::Point> &points, double &dist) const
+            {
+                const std::vector<planar::Point> &env = environment_.points;
+                for (const auto &e : part.edges)
+                {
+                    const planar::Point &a = points[e[0]], &b = points[e[1]];
+                    environmentEdges_.nearest(edgeBox(a, b), dist, [&](unsigned int k)
+                        {
+                            const auto &f = environment_.edges[k];
+                            dist = std::min(dist, planar::segmentDistance(a, b, env[f[0]], env[f[1]]));
+                        });
+                }
+            }
+
+            /** \brief Check whether the parts of the robot overlap each other */
+            bool isSelfCollisionFree(const std::vector<std::vector<planar::Point>> &world) const
+            {
+                for (std::size_t i = 0 ; i < robotParts_.size() ; ++i)
+                    for (std::size_t j = i + 1 ; j < robotParts_.size() ; ++j)
+                    {
+                        const planar::Shape &a = robotParts_[i], &b = robotParts_[j];
+                        const std::vector<planar::Point> &pa = world[i], &pb = world[j];
+                        planar::Box ba, bb;
+                        for (const auto &p : pa)
+                            ba.add(p);
+                        for (const auto &p : pb)
+                            bb.add(p);
+                        if (!ba.overlaps(bb))
+                            continue;
+
+                        for (const auto &e : a.edges)
+                            for (const auto &f : b.edges)
+                                if (planar::segmentsIntersect(pa[e[0]], pa[e[1]], pb[f[0]], pb[f[1]]))
+                                    return false;
+                        if (contains(b, pb, pa.front()) || contains(a, pa, pb.front()))
+                            return false;
+                    }
+                return true;
+            }
+
+            /** \brief Return true if \e p is in one of the triangles of \e shape, with its points at \e points */
+            static bool contains(const planar::Shape &shape, const std::vector<planar::Point> &points, const planar::Point &p)
+            {
+                for (const auto &f : shape.triangles)
+                    if (planar::inTriangle(p, points[f[0]], points[f[1]], points[f[2]]))
+                        return true;
+                return false;
+            }
+
+            /** \brief Extract the triangles of \e scene, shifted by \e shift */
+            static void getTriangles(const aiScene *scene, const aiVector3D &shift, std::vector<aiVector3D> &triangles)
+            {
+                scene::IndexedMesh mesh;
+                scene::extractIndexedTriangles(scene, mesh);
+                for (auto &v : mesh.vertices)
+                    v -= shift;
+                triangles.reserve(triangles.size() + mesh.indices.size());
+                for (unsigned int index : mesh.indices)
+                    triangles.push_back(mesh.vertices[index]);
+            }
+
+            void configure(const GeometrySpecification &geom)
+            {
+                for (unsigned int i = 0 ; i < geom.robot.size() ; ++i)
+                {
+                    std::vector<aiVector3D> triangles;
+                    getTriangles(geom.robot[i], geom.robotShift.size() > i ? geom.robotShift[i] : aiVector3D(0.0, 0.0, 0.0), triangles);
+                    robotParts_.emplace_back(triangles);
+                    if (robotParts_.back().triangles.empty())
+                        throw Exception("Invalid robot mesh");
+                    OMPL_INFORM("Loaded robot polygon with %lu edges", (unsigned long)robotParts_.back().edges.size());
+                }
+
+                std::vector<aiVector3D> triangles;
+                for (unsigned int i = 0 ; i < geom.obstacles.size() ; ++i)
+                    if (geom.obstacles[i] != nullptr)
+                        getTriangles(geom.obstacles[i], geom.obstaclesShift.size() > i ? geom.obstaclesShift[i] : aiVector3D(0.0, 0.0, 0.0), triangles);
+                environment_ = planar::Shape(triangles);
+                if (environment_.triangles.empty())
+                {
+                    OMPL_INFORM("Empty environment loaded");
+                    return;
+                }
+
+                std::vector<planar::Box> boxes;
+                boxes.reserve(environment_.edges.size());
+                for (const auto &e : environment_.edges)
+                    boxes.push_back(edgeBox(environment_.points[e[0]], environment_.points[e[1]]));
+                environmentEdges_ = planar::BoxTree(boxes);
+
+                boxes.clear();
+                for (const auto &f : environment_.triangles)
+                {
+                    boxes.push_back(edgeBox(environment_.points[f[0]], environment_.points[f[1]]));
+                    boxes.back().add(environment_.points[f[2]]);
+                }
+                environmentTriangles_ = planar::BoxTree(boxes);
+                OMPL_INFORM("Loaded environment polygons with %lu edges", (unsigned long)environment_.edges.size());
+            }
+
+            GeometricStateExtractor                                 extractState_;
+
+            bool                                                    selfCollision_;
+
+            /** \brief Projections of the robot parts, in the frames of the parts */
+            std::vector<planar::Shape>                              robotParts_;
+
+            /** \brief Projection of the environment */
+            planar::Shape                                           environment_;
+
+            /** \brief Hierarchy over the boundary edges of the environment */
+            planar::BoxTree                                         environmentEdges_;
+
+            /** \brief Hierarchy over the triangles of the environment */
+            planar::BoxTree                                         environmentTriangles_;
+
+            /** \brief Points of the robot parts at the last state, for every thread */
+            PerThread<std::vector<std::vector<planar::Point>>>      world_;
+        };
+    }
+}
+
+#endif
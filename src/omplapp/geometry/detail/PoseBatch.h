@@ -0,0 +1,201 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_GEOMETRY_DETAIL_POSE_BATCH_
+#define OMPLAPP_GEOMETRY_DETAIL_POSE_BATCH_
+
+#include <ompl/base/spaces/SE2StateSpace.h>
+#include <ompl/base/spaces/SE3StateSpace.h>
+
+#include "omplapp/geometry/GeometrySpecification.h"
+
+#include <cmath>
+#include <vector>
+
+namespace ompl
+{
+    namespace app
+    {
+        /// @cond IGNORE
+        /** \brief Rotations and translations of many rigid body poses,
+            stored as structure of arrays. The conversion loops in
+            PoseBatch work on contiguous arrays of doubles and contain no
+            branches, so the compiler can vectorize them. */
+        class PoseArrays
+        {
+        public:
+
+            void resize(std::size_t n)
+            {
+                for (auto &t : t_)
+                    t.resize(n);
+                for (auto &r : r_)
+                    r.resize(n);
+            }
+
+            std::size_t size() const
+            {
+                return t_[0].size();
+            }
+
+            /** \brief Component \e k of the translation of pose \e i */
+            double translation(unsigned int k, std::size_t i) const
+            {
+                return t_[k][i];
+            }
+
+            /** \brief Entry (\e row, \e col) of the rotation matrix of pose \e i */
+            double rotation(unsigned int row, unsigned int col, std::size_t i) const
+            {
+                return r_[3 * row + col][i];
+            }
+
+            std::vector<double> t_[3];
+            std::vector<double> r_[9];
+        };
+
+        template<MotionModel T>
+        struct PoseBatch
+        {
+            using StateType = base::SE3StateSpace::StateType;
+
+            /** \brief Compute the rotation \e r (row major) and translation \e t of a single SE(3) state */
+            static void pose(const base::State *state, double r[9], double t[3])
+            {
+                const auto *s = static_cast<const StateType*>(state);
+                const auto &q = s->rotation();
+                t[0] = s->getX();
+                t[1] = s->getY();
+                t[2] = s->getZ();
+
+                const double sqw = q.w * q.w, sqx = q.x * q.x, sqy = q.y * q.y, sqz = q.z * q.z;
+                r[0] =  sqx - sqy - sqz + sqw;
+                r[4] = -sqx + sqy - sqz + sqw;
+                r[8] = -sqx - sqy + sqz + sqw;
+                r[3] = 2.0 * (q.x * q.y + q.z * q.w);
+                r[1] = 2.0 * (q.x * q.y - q.z * q.w);
+                r[6] = 2.0 * (q.x * q.z - q.y * q.w);
+                r[2] = 2.0 * (q.x * q.z + q.y * q.w);
+                r[7] = 2.0 * (q.y * q.z + q.x * q.w);
+                r[5] = 2.0 * (q.y * q.z - q.x * q.w);
+            }
+
+            /** \brief Convert \e states (SE(3) states) to rotations and translations */
+            void convert(const std::vector<const base::State*> &states, PoseArrays &poses)
+            {
+                const std::size_t n = states.size();
+                poses.resize(n);
+                for (auto &q : q_)
+                    q.resize(n);
+
+                // gather the state values into contiguous arrays
+                for (std::size_t i = 0 ; i < n ; ++i)
+                {
+                    const auto *s = static_cast<const StateType*>(states[i]);
+                    const auto &q = s->rotation();
+                    poses.t_[0][i] = s->getX();
+                    poses.t_[1][i] = s->getY();
+                    poses.t_[2][i] = s->getZ();
+                    q_[0][i] = q.x;
+                    q_[1][i] = q.y;
+                    q_[2][i] = q.z;
+                    q_[3][i] = q.w;
+                }
+
+                // same formulas as OMPL_StateType<Motion_3D>::quaternionToMatrix()
+                const double *qx = q_[0].data(), *qy = q_[1].data(), *qz = q_[2].data(), *qw = q_[3].data();
+                double *r[9];
+                for (unsigned int k = 0 ; k < 9 ; ++k)
+                    r[k] = poses.r_[k].data();
+                for (std::size_t i = 0 ; i < n ; ++i)
+                {
+                    const double sqw = qw[i] * qw[i], sqx = qx[i] * qx[i], sqy = qy[i] * qy[i], sqz = qz[i] * qz[i];
+                    r[0][i] =  sqx - sqy - sqz + sqw;
+                    r[4][i] = -sqx + sqy - sqz + sqw;
+                    r[8][i] = -sqx - sqy + sqz + sqw;
+                    r[3][i] = 2.0 * (qx[i] * qy[i] + qz[i] * qw[i]);
+                    r[1][i] = 2.0 * (qx[i] * qy[i] - qz[i] * qw[i]);
+                    r[6][i] = 2.0 * (qx[i] * qz[i] - qy[i] * qw[i]);
+                    r[2][i] = 2.0 * (qx[i] * qz[i] + qy[i] * qw[i]);
+                    r[7][i] = 2.0 * (qy[i] * qz[i] + qx[i] * qw[i]);
+                    r[5][i] = 2.0 * (qy[i] * qz[i] - qx[i] * qw[i]);
+                }
+            }
+
+        private:
+
+            /** \brief Quaternion components, reused across calls */
+            std::vector<double> q_[4];
+        };
+
+        template<>
+        struct PoseBatch<Motion_2D>
+        {
+            using StateType = base::SE2StateSpace::StateType;
+
+            /** \brief Compute the rotation \e r (row major) and translation \e t of a single SE(2) state */
+            static void pose(const base::State *state, double r[9], double t[3])
+            {
+                const auto *s = static_cast<const StateType*>(state);
+                t[0] = s->getX();
+                t[1] = s->getY();
+                t[2] = 0.0;
+
+                const double ca = cos(s->getYaw());
+                const double sa = sin(s->getYaw());
+                r[0] = ca;  r[1] = -sa; r[2] = 0.0;
+                r[3] = sa;  r[4] = ca;  r[5] = 0.0;
+                r[6] = 0.0; r[7] = 0.0; r[8] = 1.0;
+            }
+
+            /** \brief Convert \e states (SE(2) states) to rotations and translations */
+            void convert(const std::vector<const base::State*> &states, PoseArrays &poses)
+            {
+                const std::size_t n = states.size();
+                poses.resize(n);
+                yaw_.resize(n);
+
+                for (std::size_t i = 0 ; i < n ; ++i)
+                {
+                    const auto *s = static_cast<const StateType*>(states[i]);
+                    poses.t_[0][i] = s->getX();
+                    poses.t_[1][i] = s->getY();
+                    poses.t_[2][i] = 0.0;
+                    yaw_[i] = s->getYaw();
+                }
+
+                const double *yaw = yaw_.data();
+                double *r00 = poses.r_[0].data(), *r01 = poses.r_[1].data(), *r10 = poses.r_[3].data(), *r11 = poses.r_[4].data();
+                for (std::size_t i = 0 ; i < n ; ++i)
+                {
+                    const double ca = cos(yaw[i]);
+                    const double sa = sin(yaw[i]);
+                    r00[i] = ca;
+                    r01[i] = -sa;
+                    r10[i] = sa;
+                    r11[i] = ca;
+                }
+                for (std::size_t i = 0 ; i < n ; ++i)
+                {
+                    poses.r_[2][i] = poses.r_[5][i] = poses.r_[6][i] = poses.r_[7][i] = 0.0;
+                    poses.r_[8][i] = 1.0;
+                }
+            }
+
+        private:
+
+            /** \brief Yaw angles, reused across calls */
+            std::vector<double> yaw_;
+        };
+        /// @endcond
+    }
+}
+
+#endif
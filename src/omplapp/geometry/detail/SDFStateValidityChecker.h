@@ -0,0 +1,387 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_GEOMETRY_DETAIL_SDF_STATE_VALIDITY_CHECKER_
+#define OMPLAPP_GEOMETRY_DETAIL_SDF_STATE_VALIDITY_CHECKER_
+
+#include <ompl/base/SpaceInformation.h>
+#include <ompl/base/StateValidityChecker.h>
+#include <ompl/util/Console.h>
+#include <ompl/util/Exceptions.h>
+
+#include "omplapp/geometry/GeometrySpecification.h"
+#include "omplapp/geometry/detail/assimpUtil.h"
+#include "omplapp/geometry/detail/GeometryRegistry.h"
+#include "omplapp/geometry/detail/ParallelBatch.h"
+#include "omplapp/geometry/detail/PoseBatch.h"
+#include "omplapp/geometry/detail/SignedDistanceField.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace ompl
+{
+    namespace app
+    {
+        /** \brief A state validity checker for static environments that
+            trades memory for speed. At construction, the signed distance to
+            the environment is sampled on a regular grid, and every robot
+            part is approximated by points sampled on its surface. A state is
+            valid if every point of the robot is provably farther from the
+            environment than the spacing of the samples, so collision checks
+            and clearance computations take time linear in the number of
+            robot points and do not depend on the complexity of the
+            environment.
+
+            The check is conservative: states within about two grid cells of
+            an obstacle may be reported invalid. The distance field is shared
+            by all checkers that use the same environment and is never
+            modified, so the checker can be used from many threads. */
+        template<MotionModel T>
+        class SDFStateValidityChecker : public base::StateValidityChecker
+        {
+        public:
+
+            SDFStateValidityChecker(const base::SpaceInformationPtr &si, const GeometrySpecification &geom,
+                                    GeometricStateExtractor se, bool selfCollision) : base::StateValidityChecker(si), extractState_(std::move(se)),
+                                                                                             selfCollision_(selfCollision)
+            {
+                configure(geom);
+                specs_.clearanceComputationType = base::StateValidityCheckerSpecs::BOUNDED_APPROXIMATE;
+            }
+
+            bool isValid(const base::State *state) const override
+            {
+                if (!si_->satisfiesBounds(state))
+                    return false;
+
+                if (environment_)
+                    for (std::size_t i = 0 ; i < robotParts_.size() ; ++i)
+                    {
+                        double r[9], t[3];
+                        PoseBatch<T>::pose(extractState_(state, i), r, t);
+                        if (!isPartCollisionFree(r, t, robotParts_[i]))
+                            return false;
+                    }
+
+                return !selfCollision_ || isSelfCollisionFree(state);
+            }
+
+            /** \brief Check a batch of states. On return, \e valid[i] is
+                true iff \e states[i] is valid. The checks only read the
+                distance field and the robot points, so they are spread over
+                \e numThreads threads without any synchronization; zero
+                selects one thread per core. */
+            void isValidBatch(const std::vector<const base::State*> &states, std::vector<bool> &valid,
+                              unsigned int numThreads = 1) const
+            {
+                parallelBatch(states.size(), numThreads, valid, [this, &states](std::size_t begin, std::size_t end, char *result)
+                    {
+                        for (std::size_t k = begin ; k < end ; ++k)
+                            result[k] = isValid(states[k]) ? 1 : 0;
+                    });
+            }
+
+            /** \brief A lower bound on the distance between the robot and
+                the environment. It underestimates the distance by at most
+                about two grid cells. */
+            double clearance(const base::State *state) const override
+            {
+                double dist = std::numeric_limits<double>::infinity();
+                if (environment_)
+                    for (std::size_t i = 0 ; i < robotParts_.size() ; ++i)
+                    {
+                        double r[9], t[3];
+                        PoseBatch<T>::pose(extractState_(state, i), r, t);
+                        dist = std::min(dist, partClearance(r, t, robotParts_[i], dist));
+                    }
+                return dist;
+            }
+
+            /** \brief Return true if clearance() would be larger than \e
+                threshold. Parts whose bounding sphere is far enough from the
+                environment are accepted with a single lookup. */
+            bool clearanceExceeds(const base::State *state, double threshold) const
+            {
+                if (environment_)
+                    for (std::size_t i = 0 ; i < robotParts_.size() ; ++i)
+                    {
+                        double r[9], t[3];
+                        PoseBatch<T>::pose(extractState_(state, i), r, t);
+                        if (partClearance(r, t, robotParts_[i], threshold) <= threshold)
+                            return false;
+                    }
+                return true;
+            }
+
+            /** \brief The distance field of the environment, or nullptr if the environment is empty */
+            const std::shared_ptr<const SignedDistanceField>& getDistanceField() const
+            {
+                return environment_;
+            }
+
+        protected:
+
+            /** \brief Points sampled on the surface of a robot part */
+            struct RobotPart
+            {
+                /** \brief The coordinates of the points, in the frame of the part */
+                std::vector<double> points;
+
+                /** \brief Every point of the surface is within this distance of a sample */
+                double              spacing;
+
+                /** \brief Center of a sphere that contains the part */
+                double              center[3];
+
+                /** \brief Radius of the sphere that contains the part */
+                double              radius;
+            };
+
+            /** \brief Number of grid cells along the largest extent of the
+                environment, unless robot parts are so small that a finer grid
+                is needed */
+            static const unsigned int ENVIRONMENT_CELLS = 128;
+
+            /** \brief Number of grid cells along the radius of the smallest robot part */
+            static const unsigned int ROBOT_CELLS = 4;
+
+            /** \brief Maximum number of points of the distance grid (16MB of samples) */
+            static const std::size_t MAX_GRID_POINTS = 1 << 22;
+
+            /** \brief Transform the point \e p by rotation \e r and translation \e t */
+            static void transformPoint(const double r[9], const double t[3], const double p[3], double out[3])
+            {
+                for (int k = 0 ; k < 3 ; ++k)
+                    out[k] = r[3 * k] * p[0] + r[3 * k + 1] * p[1] + r[3 * k + 2] * p[2] + t[k];
+            }
+
+            /** \brief Return the distance from the center of the bounding
+                sphere of \e part at pose (\e r, \e t) to the environment,
+                minus the radius of the sphere and the sample spacing. No
+                point of the part is closer to the environment than this. */
+            double sphereClearance(const double r[9], const double t[3], const RobotPart &part) const
+            {
+                double c[3];
+                transformPoint(r, t, part.center, c);
+                return environment_->distance(c) - part.radius - part.spacing;
+            }
+
+            /** \brief Check whether \e part at pose (\e r, \e t) is provably collision free */
+            bool isPartCollisionFree(const double r[9], const double t[3], const RobotPart &part) const
+            {
+                if (sphereClearance(r, t, part) > 0.0)
+                    return true;
+                for (std::size_t k = 0 ; k < part.points.size() ; k += 3)
+                {
+                    double p[3];
+                    transformPoint(r, t, &part.points[k], p);
+                    if (environment_->distance(p) <= part.spacing)
+                        return false;
+                }
+                return true;
+            }
+
+            /** \brief A lower bound on the distance between \e part at pose
+                (\e r, \e t) and the environment. If the bound is known to
+                be at least \e upper, a value of at least \e upper is
+                returned without looking at the individual points. */
+            double partClearance(const double r[9], const double t[3], const RobotPart &part, double upper) const
+            {
+                const double sphere = sphereClearance(r, t, part);
+                if (sphere >= upper)
+                    return sphere;
+
+                double dist = std::numeric_limits<double>::infinity();
+                for (std::size_t k = 0 ; k < part.points.size() ; k += 3)
+                {
+                    double p[3];
+                    transformPoint(r, t, &part.points[k], p);
+                    dist = std::min(dist, environment_->distance(p));
+                }
+                return std::max(sphere, dist - part.spacing);
+            }
+
+            /** \brief Check whether the parts of the robot are farther apart than their sample spacing */
+            bool isSelfCollisionFree(const base::State *state) const
+            {
+                std::vector<std::vector<double>> points(robotParts_.size());
+                std::vector<double> centers(3 * robotParts_.size());
+                for (std::size_t i = 0 ; i < robotParts_.size() ; ++i)
+                {
+                    double r[9], t[3];
+                    PoseBatch<T>::pose(extractState_(state, i), r, t);
+                    transformPoint(r, t, robotParts_[i].center, &centers[3 * i]);
+                    points[i].resize(robotParts_[i].points.size());
+                    for (std::size_t k = 0 ; k < points[i].size() ; k += 3)
+                        transformPoint(r, t, &robotParts_[i].points[k], &points[i][k]);
+                }
+
+                for (std::size_t i = 0 ; i < robotParts_.size() ; ++i)
+                    for (std::size_t j = i + 1 ; j < robotParts_.size() ; ++j)
+                    {
+                        const RobotPart &a = robotParts_[i], &b = robotParts_[j];
+                        const double margin = a.spacing + b.spacing;
+
+                        // parts whose bounding spheres are disjoint cannot collide
+                        const double *ca = &centers[3 * i], *cb = &centers[3 * j];
+                        const double dx = ca[0] - cb[0], dy = ca[1] - cb[1], dz = ca[2] - cb[2];
+                        const double r = a.radius + b.radius + margin;
+                        if (dx * dx + dy * dy + dz * dz > r * r)
+                            continue;
+
+                        for (std::size_t k = 0 ; k < points[i].size() ; k += 3)
+                            for (std::size_t l = 0 ; l < points[j].size() ; l += 3)
+                            {
+                                const double ex = points[i][k] - points[j][l], ey = points[i][k + 1] - points[j][l + 1],
+                                    ez = points[i][k + 2] - points[j][l + 2];
+                                if (ex * ex + ey * ey + ez * ez <= margin * margin)
+                                    return false;
+                            }
+                    }
+                return true;
+            }
+
+            /** \brief Sample points on \e triangles such that every point of
+                a triangle is within \e spacing of a sample */
+            static void samplePart(const std::vector<aiVector3D> &triangles, double spacing, RobotPart &part)
+            {
+                part.points.clear();
+                part.spacing = spacing;
+                for (std::size_t t = 0 ; t + 2 < triangles.size() ; t += 3)
+                {
+                    const aiVector3D &a = triangles[t], &b = triangles[t + 1], &c = triangles[t + 2];
+                    const double edge = std::max(std::max((b - a).Length(), (c - b).Length()), (a - c).Length());
+                    // the sub-triangles between the samples have edges no longer than spacing
+                    const unsigned int n = std::max(1u, (unsigned int)std::ceil(edge / spacing));
+                    for (unsigned int i = 0 ; i <= n ; ++i)
+                        for (unsigned int j = 0 ; i + j <= n ; ++j)
+                        {
+                            const aiVector3D p = a + (b - a) * ((float)i / n) + (c - a) * ((float)j / n);
+                            part.points.insert(part.points.end(), { p.x, p.y, p.z });
+                        }
+                }
+
+                double low[3], high[3];
+                for (int k = 0 ; k < 3 ; ++k)
+                {
+                    low[k] = std::numeric_limits<double>::infinity();
+                    high[k] = -std::numeric_limits<double>::infinity();
+                }
+                for (const auto &v : triangles)
+                    for (int k = 0 ; k < 3 ; ++k)
+                    {
+                        low[k] = std::min(low[k], (double)v[k]);
+                        high[k] = std::max(high[k], (double)v[k]);
+                    }
+                for (int k = 0 ; k < 3 ; ++k)
+                    part.center[k] = (low[k] + high[k]) / 2.0;
+                double r2 = 0.0;
+                for (const auto &v : triangles)
+                {
+                    const double dx = v.x - part.center[0], dy = v.y - part.center[1], dz = v.z - part.center[2];
+                    r2 = std::max(r2, dx * dx + dy * dy + dz * dz);
+                }
+                part.radius = sqrt(r2);
+            }
+
+            /** \brief Extract the triangles of \e scene, shifted by \e shift */
+            static void getTriangles(const aiScene *scene, const aiVector3D &shift, std::vector<aiVector3D> &triangles)
+            {
+                scene::IndexedMesh mesh;
+                scene::extractIndexedTriangles(scene, mesh);
+                for (auto &v : mesh.vertices)
+                    v -= shift;
+                triangles.reserve(triangles.size() + mesh.indices.size());
+                for (unsigned int index : mesh.indices)
+                    triangles.push_back(mesh.vertices[index]);
+            }
+
+            void configure(const GeometrySpecification &geom)
+            {
+                std::vector<std::vector<aiVector3D>> parts(geom.robot.size());
+                double minRadius = std::numeric_limits<double>::infinity();
+                for (unsigned int i = 0 ; i < geom.robot.size() ; ++i)
+                {
+                    aiVector3D shift(0.0, 0.0, 0.0);
+                    if (geom.robotShift.size() > i)
+                        shift = geom.robotShift[i];
+                    getTriangles(geom.robot[i], shift, parts[i]);
+                    if (parts[i].empty())
+                        throw Exception("Invalid robot mesh");
+                    RobotPart part;
+                    samplePart(parts[i], std::numeric_limits<double>::infinity(), part);
+                    minRadius = std::min(minRadius, part.radius);
+                }
+
+                std::vector<aiVector3D> triangles;
+                for (unsigned int i = 0 ; i < geom.obstacles.size() ; ++i)
+                    if (geom.obstacles[i] != nullptr)
+                        getTriangles(geom.obstacles[i], geom.obstaclesShift.size() > i ? geom.obstaclesShift[i] : aiVector3D(0.0, 0.0, 0.0), triangles);
+
+                double cellSize = minRadius > 0.0 ? minRadius / ROBOT_CELLS : std::numeric_limits<double>::infinity();
+                if (triangles.empty())
+                {
+                    OMPL_INFORM("Empty environment loaded");
+                    if (std::isinf(cellSize))
+                        cellSize = 1.0;
+                }
+                else
+                {
+                    base::RealVectorBounds bounds(3);
+                    scene::inferBounds(bounds, triangles, 1.0, 0.0);
+                    const std::vector<double> diff = bounds.getDifference();
+                    const double extents[3] = { diff[0], diff[1], diff[2] };
+                    const double environmentCell = *std::max_element(extents, extents + 3) / ENVIRONMENT_CELLS;
+                    if (environmentCell > 0.0)
+                        cellSize = std::min(cellSize, environmentCell);
+                    if (std::isinf(cellSize))
+                        cellSize = 1.0;
+                    cellSize = SignedDistanceField::cellSizeFor(extents, 2.0 * cellSize, cellSize, MAX_GRID_POINTS);
+
+                    // environments made of identical triangles share a single distance field
+                    GeometryKey key = triangleKey(triangles);
+                    key.first = fnv1a(key.first, cellSize);
+                    environment_ = GeometryRegistry<const SignedDistanceField>::get(key,
+                        [&triangles, cellSize]
+                        {
+                            return std::make_shared<SignedDistanceField>(triangles, cellSize, 2.0 * cellSize);
+                        });
+                    OMPL_INFORM("Loaded environment distance field with %lu grid points. Cell size is %lf.",
+                                (unsigned long)environment_->getPointCount(), cellSize);
+                }
+
+                // sample the robot at half the grid spacing
+                for (const auto &part : parts)
+                {
+                    robotParts_.emplace_back();
+                    samplePart(part, cellSize / 2.0, robotParts_.back());
+                    OMPL_INFORM("Loaded robot model with %lu surface points", (unsigned long)robotParts_.back().points.size() / 3);
+                }
+            }
+
+            GeometricStateExtractor                     extractState_;
+
+            bool                                        selfCollision_;
+
+            /** \brief Points sampled on the robot parts */
+            std::vector<RobotPart>                      robotParts_;
+
+            /** \brief Signed distance field of the environment */
+            std::shared_ptr<const SignedDistanceField>  environment_;
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,146 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_GEOMETRY_DETAIL_SHARDED_LRU_CACHE_
+#define OMPLAPP_GEOMETRY_DETAIL_SHARDED_LRU_CACHE_
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace ompl
+{
+    namespace app
+    {
+        /** \brief A map from keys to values that keeps at most \e capacity
+            entries and drops the least recently used ones first. The
+            entries are split in shards by the hash of their key, with a
+            lock each, so that the cache can be used from several threads.
+            Every shard indexes its entries by hash only: a key whose hash
+            equals that of a different stored key is not found, and storing
+            it replaces the other entry. */
+        template <typename Key, typename Value, typename Hash = std::hash<Key>>
+        class ShardedLRUCache
+        {
+        public:
+            explicit ShardedLRUCache(std::size_t capacity)
+                : capacity_(capacity), shardCapacity_(std::max<std::size_t>(1, (capacity + SHARDS - 1) / SHARDS))
+            {
+            }
+
+            /** \brief Look up \e key and mark it as most recently used.
+                Returns false if it is not in the cache. */
+            bool lookup(const Key &key, Value &value) const
+            {
+                const std::size_t hash = Hash()(key);
+                Shard &shard = shards_[hash % SHARDS];
+                std::lock_guard<std::mutex> _(shard.lock);
+                auto it = shard.index.find(hash);
+                if (it == shard.index.end() || it->second->key != key)
+                    return false;
+                shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+                value = it->second->value;
+                return true;
+            }
+
+            /** \brief Store \e value for \e key, replacing an earlier value */
+            void store(Key key, const Value &value) const
+            {
+                store(std::move(key), value, [](Value &stored, const Value &v) { stored = v; });
+            }
+
+            /** \brief Store \e value for \e key. If \e key is already in
+                the cache, update(stored, value) is called instead to merge
+                \e value into the stored value. */
+            template <typename Update>
+            void store(Key key, const Value &value, const Update &update) const
+            {
+                const std::size_t hash = Hash()(key);
+                Shard &shard = shards_[hash % SHARDS];
+                std::lock_guard<std::mutex> _(shard.lock);
+                auto it = shard.index.find(hash);
+                if (it != shard.index.end())
+                {
+                    Item &item = *it->second;
+                    if (item.key == key)
+                        update(item.value, value);
+                    else
+                        item = Item{std::move(key), hash, value};
+                    shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+                    return;
+                }
+                if (shard.lru.size() >= shardCapacity_)
+                {
+                    shard.index.erase(shard.lru.back().hash);
+                    shard.lru.pop_back();
+                }
+                shard.lru.push_front(Item{std::move(key), hash, value});
+                shard.index[hash] = shard.lru.begin();
+            }
+
+            /** \brief Forget all entries */
+            void clear()
+            {
+                for (auto &shard : shards_)
+                {
+                    std::lock_guard<std::mutex> _(shard.lock);
+                    shard.lru.clear();
+                    shard.index.clear();
+                }
+            }
+
+            /** \brief Get the maximum number of entries kept */
+            std::size_t getCapacity() const
+            {
+                return capacity_;
+            }
+
+            /** \brief Get the number of entries kept */
+            std::size_t size() const
+            {
+                std::size_t count = 0;
+                for (auto &shard : shards_)
+                {
+                    std::lock_guard<std::mutex> _(shard.lock);
+                    count += shard.lru.size();
+                }
+                return count;
+            }
+
+        private:
+            static const std::size_t SHARDS = 16;
+
+            struct Item
+            {
+                Key         key;
+                std::size_t hash;
+                Value       value;
+            };
+
+            struct Shard
+            {
+                mutable std::mutex                                                  lock;
+                // the most recently used entry first
+                std::list<Item>                                                     lru;
+                std::unordered_map<std::size_t, typename std::list<Item>::iterator> index;
+            };
+
+            std::size_t   capacity_;
+            std::size_t   shardCapacity_;
+            mutable Shard shards_[SHARDS];
+        };
+    }
+}
+
+#endif
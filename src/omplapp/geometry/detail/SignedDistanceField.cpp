@@ -0,0 +1,277 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#include "omplapp/geometry/detail/SignedDistanceField.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+    struct Vec3
+    {
+        double x, y, z;
+
+        Vec3 operator+(const Vec3 &o) const { return {x + o.x, y + o.y, z + o.z}; }
+        Vec3 operator-(const Vec3 &o) const { return {x - o.x, y - o.y, z - o.z}; }
+        Vec3 operator*(double s) const { return {x * s, y * s, z * s}; }
+        double dot(const Vec3 &o) const { return x * o.x + y * o.y + z * o.z; }
+    };
+
+    Vec3 toVec3(const aiVector3D &v)
+    {
+        return {v.x, v.y, v.z};
+    }
+
+    // closest point to p on triangle abc; from C. Ericson, Real-Time Collision Detection, Section 5.1.5
+    Vec3 closestPointOnTriangle(const Vec3 &p, const Vec3 &a, const Vec3 &b, const Vec3 &c)
+    {
+        const Vec3 ab = b - a, ac = c - a, ap = p - a;
+        const double d1 = ab.dot(ap), d2 = ac.dot(ap);
+        if (d1 <= 0.0 && d2 <= 0.0)
+            return a;
+
+        const Vec3 bp = p - b;
+        const double d3 = ab.dot(bp), d4 = ac.dot(bp);
+        if (d3 >= 0.0 && d4 <= d3)
+            return b;
+
+        const double vc = d1 * d4 - d3 * d2;
+        if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+            return a + ab * (d1 / (d1 - d3));
+
+        const Vec3 cp = p - c;
+        const double d5 = ab.dot(cp), d6 = ac.dot(cp);
+        if (d6 >= 0.0 && d5 <= d6)
+            return c;
+
+        const double vb = d5 * d2 - d1 * d6;
+        if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+            return a + ac * (d2 / (d2 - d6));
+
+        const double va = d3 * d6 - d5 * d4;
+        if (va <= 0.0 && d4 - d3 >= 0.0 && d5 - d6 >= 0.0)
+            return b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+
+        const double denom = 1.0 / (va + vb + vc);
+        return a + ab * (vb * denom) + ac * (vc * denom);
+    }
+
+    // number of grid points needed to cover [0, extent] with the given spacing
+    std::size_t gridPoints(double extent, double cellSize)
+    {
+        return std::max<std::size_t>(2, (std::size_t)std::ceil(extent / cellSize) + 1);
+    }
+}
+
+double ompl::app::SignedDistanceField::cellSizeFor(const double extents[3], double padding, double preferredSize, std::size_t maxPoints)
+{
+    double cellSize = preferredSize;
+    while (true)
+    {
+        double points = 1.0;
+        for (int k = 0 ; k < 3 ; ++k)
+            points *= (double)gridPoints(extents[k] + 2.0 * padding, cellSize);
+        if (points <= (double)maxPoints)
+            return cellSize;
+        cellSize *= 1.1;
+    }
+}
+
+ompl::app::SignedDistanceField::SignedDistanceField(const std::vector<aiVector3D> &triangles, double cellSize, double padding)
+    : cellSize_(cellSize)
+{
+    const double inf = std::numeric_limits<double>::infinity();
+    double high[3] = { -inf, -inf, -inf };
+    for (int k = 0 ; k < 3 ; ++k)
+        low_[k] = inf;
+    for (const auto &v : triangles)
+        for (int k = 0 ; k < 3 ; ++k)
+        {
+            low_[k] = std::min(low_[k], (double)v[k]);
+            high[k] = std::max(high[k], (double)v[k]);
+        }
+    for (int k = 0 ; k < 3 ; ++k)
+    {
+        if (triangles.empty())
+            low_[k] = high[k] = 0.0;
+        low_[k] -= padding;
+        dims_[k] = gridPoints(high[k] + padding - low_[k], cellSize_);
+    }
+    const std::size_t n = dims_[0] * dims_[1] * dims_[2];
+
+    // the closest surface point found so far for every grid point
+    std::vector<float> dist2(n, std::numeric_limits<float>::infinity());
+    std::vector<Vec3> closest(n);
+    auto position = [this](std::size_t i, std::size_t j, std::size_t k) -> Vec3
+    {
+        return {low_[0] + cellSize_ * i, low_[1] + cellSize_ * j, low_[2] + cellSize_ * k};
+    };
+
+    // exact distances in a band of BAND grid points around every triangle
+    const int BAND = 2;
+    for (std::size_t t = 0 ; t + 2 < triangles.size() ; t += 3)
+    {
+        const Vec3 a = toVec3(triangles[t]), b = toVec3(triangles[t + 1]), c = toVec3(triangles[t + 2]);
+        std::size_t from[3], to[3];
+        for (int k = 0 ; k < 3 ; ++k)
+        {
+            const double lo = std::min(std::min(triangles[t][k], triangles[t + 1][k]), triangles[t + 2][k]);
+            const double hi = std::max(std::max(triangles[t][k], triangles[t + 1][k]), triangles[t + 2][k]);
+            from[k] = (std::size_t)std::max(0.0, std::floor((lo - low_[k]) / cellSize_) - BAND);
+            to[k] = std::min(dims_[k] - 1, (std::size_t)std::ceil((hi - low_[k]) / cellSize_) + BAND);
+        }
+        for (std::size_t k = from[2] ; k <= to[2] ; ++k)
+            for (std::size_t j = from[1] ; j <= to[1] ; ++j)
+                for (std::size_t i = from[0] ; i <= to[0] ; ++i)
+                {
+                    const Vec3 p = position(i, j, k);
+                    const Vec3 q = closestPointOnTriangle(p, a, b, c);
+                    const Vec3 d = q - p;
+                    const double d2 = d.dot(d);
+                    // skips degenerate triangles, for which q is not a number
+                    std::size_t id = index(i, j, k);
+                    if (d2 < dist2[id])
+                    {
+                        dist2[id] = d2;
+                        closest[id] = q;
+                    }
+                }
+    }
+
+    // propagate the closest points to the rest of the grid, in one forward and one backward sweep
+    auto relax = [&](std::size_t i, std::size_t j, std::size_t k, int sign)
+    {
+        const std::size_t id = index(i, j, k);
+        const Vec3 p = position(i, j, k);
+        for (int dk = -1 ; dk <= 0 ; ++dk)
+            for (int dj = -1 ; dj <= 1 ; ++dj)
+                for (int di = -1 ; di <= 1 ; ++di)
+                {
+                    // only neighbors visited earlier in the sweep
+                    if (dk == 0 && (dj > 0 || (dj == 0 && di >= 0)))
+                        continue;
+                    const long ni = (long)i + sign * di, nj = (long)j + sign * dj, nk = (long)k + sign * dk;
+                    if (ni < 0 || nj < 0 || nk < 0 || ni >= (long)dims_[0] || nj >= (long)dims_[1] || nk >= (long)dims_[2])
+                        continue;
+                    const std::size_t nid = index(ni, nj, nk);
+                    if (!(dist2[nid] < std::numeric_limits<float>::infinity()))
+                        continue;
+                    const Vec3 d = closest[nid] - p;
+                    const double d2 = d.dot(d);
+                    if (d2 < dist2[id])
+                    {
+                        dist2[id] = d2;
+                        closest[id] = closest[nid];
+                    }
+                }
+    };
+    for (std::size_t k = 0 ; k < dims_[2] ; ++k)
+        for (std::size_t j = 0 ; j < dims_[1] ; ++j)
+            for (std::size_t i = 0 ; i < dims_[0] ; ++i)
+                relax(i, j, k, 1);
+    for (std::size_t k = dims_[2] ; k-- > 0 ; )
+        for (std::size_t j = dims_[1] ; j-- > 0 ; )
+            for (std::size_t i = dims_[0] ; i-- > 0 ; )
+                relax(i, j, k, -1);
+
+    // Grid points within half a cell of a triangle block the flood fill:
+    // the surface cannot cross the edge between two grid points without
+    // passing that close to one of them. Everything the flood fill from the
+    // boundary of the grid cannot reach is inside an obstacle.
+    enum { UNKNOWN, BLOCKED, OUTSIDE };
+    std::vector<char> label(n, UNKNOWN);
+    const double blocked2 = cellSize_ * cellSize_ / 4.0;
+    for (std::size_t id = 0 ; id < n ; ++id)
+        if (dist2[id] <= blocked2)
+            label[id] = BLOCKED;
+    std::vector<std::size_t> queue;
+    for (std::size_t k = 0 ; k < dims_[2] ; ++k)
+        for (std::size_t j = 0 ; j < dims_[1] ; ++j)
+            for (std::size_t i = 0 ; i < dims_[0] ; ++i)
+                if (i == 0 || j == 0 || k == 0 || i + 1 == dims_[0] || j + 1 == dims_[1] || k + 1 == dims_[2])
+                {
+                    const std::size_t id = index(i, j, k);
+                    if (label[id] == UNKNOWN)
+                    {
+                        label[id] = OUTSIDE;
+                        queue.push_back(id);
+                    }
+                }
+    const std::size_t stride[3] = { 1, dims_[0], dims_[0] * dims_[1] };
+    while (!queue.empty())
+    {
+        const std::size_t id = queue.back();
+        queue.pop_back();
+        std::size_t c[3] = { id % dims_[0], (id / dims_[0]) % dims_[1], id / stride[2] };
+        for (int k = 0 ; k < 3 ; ++k)
+        {
+            if (c[k] > 0 && label[id - stride[k]] == UNKNOWN)
+            {
+                label[id - stride[k]] = OUTSIDE;
+                queue.push_back(id - stride[k]);
+            }
+            if (c[k] + 1 < dims_[k] && label[id + stride[k]] == UNKNOWN)
+            {
+                label[id + stride[k]] = OUTSIDE;
+                queue.push_back(id + stride[k]);
+            }
+        }
+    }
+
+    // Grid points next to the surface get distance 0, since their side of
+    // the surface is not known. This underestimates the distance there by at
+    // most half a cell. Together with the interpolation error (at most half
+    // the diagonal of a cell for a 1-Lipschitz function), this bounds how
+    // much interpolate() can overestimate the distance; the error of the
+    // propagated distances far from the surface is negligible in comparison.
+    values_.resize(n);
+    for (std::size_t id = 0 ; id < n ; ++id)
+    {
+        const double d = std::sqrt((double)dist2[id]);
+        values_[id] = label[id] == BLOCKED ? 0.0f : (float)(label[id] == OUTSIDE ? d : -d);
+    }
+    errorBound_ = cellSize_ * (std::sqrt(3.0) + 1.0) / 2.0;
+}
+
+double ompl::app::SignedDistanceField::interpolate(const double p[3]) const
+{
+    std::size_t c[3];
+    double t[3];
+    for (int k = 0 ; k < 3 ; ++k)
+    {
+        const double f = (p[k] - low_[k]) / cellSize_;
+        c[k] = std::min((std::size_t)std::max(0.0, std::floor(f)), dims_[k] - 2);
+        t[k] = f - (double)c[k];
+    }
+    const std::size_t id = index(c[0], c[1], c[2]);
+    const std::size_t dj = dims_[0], dk = dims_[0] * dims_[1];
+    const double v00 = values_[id]           * (1.0 - t[0]) + values_[id + 1]           * t[0];
+    const double v10 = values_[id + dj]      * (1.0 - t[0]) + values_[id + dj + 1]      * t[0];
+    const double v01 = values_[id + dk]      * (1.0 - t[0]) + values_[id + dk + 1]      * t[0];
+    const double v11 = values_[id + dj + dk] * (1.0 - t[0]) + values_[id + dj + dk + 1] * t[0];
+    return (v00 * (1.0 - t[1]) + v10 * t[1]) * (1.0 - t[2]) + (v01 * (1.0 - t[1]) + v11 * t[1]) * t[2];
+}
+
+double ompl::app::SignedDistanceField::distance(const double p[3]) const
+{
+    // the triangles are inside the grid, so the distance to the grid is a lower bound too
+    double q[3], out2 = 0.0;
+    for (int k = 0 ; k < 3 ; ++k)
+    {
+        q[k] = std::min(std::max(p[k], low_[k]), low_[k] + cellSize_ * (double)(dims_[k] - 1));
+        out2 += (p[k] - q[k]) * (p[k] - q[k]);
+    }
+    const double d = interpolate(q) - errorBound_;
+    if (out2 == 0.0)
+        return d;
+    const double out = std::sqrt(out2);
+    return std::max(d - out, out);
+}
@@ -0,0 +1,93 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_GEOMETRY_DETAIL_SIGNED_DISTANCE_FIELD_
+#define OMPLAPP_GEOMETRY_DETAIL_SIGNED_DISTANCE_FIELD_
+
+#include <assimp/types.h>
+#include <cstddef>
+#include <vector>
+
+namespace ompl
+{
+    namespace app
+    {
+        /// @cond IGNORE
+        /** \brief Signed distance to a triangle soup, sampled on a regular
+            grid. Distances are exact for grid points close to a triangle and
+            propagated from there to the rest of the grid. Grid points that
+            cannot be reached from the boundary of the grid without crossing
+            a triangle are inside an obstacle and have negative distance.
+
+            The field is read-only once constructed, so it can be shared by
+            any number of threads. */
+        class SignedDistanceField
+        {
+        public:
+
+            /** \brief Sample the signed distance to \e triangles (three
+                consecutive points per triangle) with grid spacing \e
+                cellSize. The grid covers the bounding box of the triangles,
+                extended by \e padding on every side. */
+            SignedDistanceField(const std::vector<aiVector3D> &triangles, double cellSize, double padding);
+
+            /** \brief Return a lower bound on the signed distance from \e p
+                to the triangles. Points outside the grid are handled too. */
+            double distance(const double p[3]) const;
+
+            /** \brief The spacing of the grid */
+            double getCellSize() const
+            {
+                return cellSize_;
+            }
+
+            /** \brief The number of grid points */
+            std::size_t getPointCount() const
+            {
+                return values_.size();
+            }
+
+            /** \brief Choose a grid spacing for triangles whose bounding box
+                has extents \e extents: the spacing is at most \e
+                preferredSize, but large enough that the grid has no more
+                than \e maxPoints points. */
+            static double cellSizeFor(const double extents[3], double padding, double preferredSize, std::size_t maxPoints);
+
+        private:
+
+            /** \brief Index of the grid point (i, j, k) */
+            std::size_t index(std::size_t i, std::size_t j, std::size_t k) const
+            {
+                return (k * dims_[1] + j) * dims_[0] + i;
+            }
+
+            /** \brief Trilinear interpolation of the samples at \e p, which must be inside the grid */
+            double interpolate(const double p[3]) const;
+
+            /** \brief Position of the grid point with index 0 */
+            double              low_[3];
+
+            /** \brief Number of grid points along each axis */
+            std::size_t         dims_[3];
+
+            /** \brief The spacing of the grid */
+            double              cellSize_;
+
+            /** \brief How much interpolate() may overestimate the signed distance */
+            double              errorBound_;
+
+            /** \brief The samples, with the x index varying fastest */
+            std::vector<float>  values_;
+        };
+        /// @endcond
+    }
+}
+
+#endif
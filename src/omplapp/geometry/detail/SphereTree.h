@@ -0,0 +1,161 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_GEOMETRY_DETAIL_SPHERE_TREE_
+#define OMPLAPP_GEOMETRY_DETAIL_SPHERE_TREE_
+
+#include <assimp/types.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+namespace ompl
+{
+    namespace app
+    {
+        /// @cond IGNORE
+        /** \brief A hierarchy of bounding spheres for the triangles of a
+            robot part. The root contains all triangles and the two children
+            of a sphere contain the triangles on either side of the median
+            along the longest axis of the parent, so the leaves fit the part
+            much more tightly than the root does.
+
+            The tree serves as a conservative first pass for collision
+            checks: if the spheres that cover the part are collision free,
+            so is the part. Only if that cannot be shown does the caller
+            need the exact mesh test. */
+        class SphereTree
+        {
+        public:
+
+            /** \brief A sphere, in the frame of the robot part */
+            struct Sphere
+            {
+                double center[3];
+                double radius;
+            };
+
+            /** \brief Default number of levels below the root */
+            static const unsigned int DEFAULT_DEPTH = 3;
+
+            SphereTree() = default;
+
+            /** \brief Build a tree with \e depth levels below the root for
+                \e triangles (three consecutive points per triangle) */
+            explicit SphereTree(const std::vector<aiVector3D> &triangles, unsigned int depth = DEFAULT_DEPTH)
+            {
+                if (triangles.size() < 3)
+                    return;
+                std::vector<std::size_t> tris(triangles.size() / 3);
+                std::iota(tris.begin(), tris.end(), 0);
+                nodes_.emplace_back();
+                build(triangles, tris, 0, 0, tris.size(), depth);
+            }
+
+            /** \brief Return true if the part is known to be collision free.
+                \e sphereFree(sphere) must return true only if \e sphere is
+                collision free. Spheres are tried from the root down; a
+                sphere that is not free is replaced by its children. */
+            template<typename F>
+            bool isFree(const F &sphereFree) const
+            {
+                return !nodes_.empty() && isFree(0, sphereFree);
+            }
+
+            /** \brief The number of spheres in the tree */
+            std::size_t size() const
+            {
+                return nodes_.size();
+            }
+
+        private:
+
+            struct Node
+            {
+                Sphere      sphere;
+
+                /** \brief Index of the first child; the second child follows it. Zero for leaves. */
+                std::size_t children{0};
+            };
+
+            template<typename F>
+            bool isFree(std::size_t n, const F &sphereFree) const
+            {
+                const Node &node = nodes_[n];
+                if (sphereFree(node.sphere))
+                    return true;
+                return node.children != 0 &&
+                    isFree(node.children, sphereFree) && isFree(node.children + 1, sphereFree);
+            }
+
+            /** \brief Fill node \e n with the sphere of triangles tris[begin, end) and build its subtree */
+            void build(const std::vector<aiVector3D> &triangles, std::vector<std::size_t> &tris,
+                       std::size_t n, std::size_t begin, std::size_t end, unsigned int depth)
+            {
+                // center the sphere at the center of the axis aligned bounding box
+                double low[3], high[3];
+                for (int k = 0 ; k < 3 ; ++k)
+                {
+                    low[k] = std::numeric_limits<double>::infinity();
+                    high[k] = -std::numeric_limits<double>::infinity();
+                }
+                for (std::size_t t = begin ; t < end ; ++t)
+                    for (std::size_t v = 3 * tris[t] ; v < 3 * tris[t] + 3 ; ++v)
+                        for (int k = 0 ; k < 3 ; ++k)
+                        {
+                            low[k] = std::min(low[k], (double)triangles[v][k]);
+                            high[k] = std::max(high[k], (double)triangles[v][k]);
+                        }
+                Sphere &sphere = nodes_[n].sphere;
+                double r2 = 0.0;
+                for (int k = 0 ; k < 3 ; ++k)
+                    sphere.center[k] = (low[k] + high[k]) / 2.0;
+                for (std::size_t t = begin ; t < end ; ++t)
+                    for (std::size_t v = 3 * tris[t] ; v < 3 * tris[t] + 3 ; ++v)
+                    {
+                        const double dx = triangles[v].x - sphere.center[0], dy = triangles[v].y - sphere.center[1],
+                            dz = triangles[v].z - sphere.center[2];
+                        r2 = std::max(r2, dx * dx + dy * dy + dz * dz);
+                    }
+                sphere.radius = sqrt(r2);
+
+                if (depth == 0 || end - begin < 2)
+                    return;
+
+                // split at the median of the triangle centroids along the longest axis
+                int axis = 0;
+                for (int k = 1 ; k < 3 ; ++k)
+                    if (high[k] - low[k] > high[axis] - low[axis])
+                        axis = k;
+                auto centroid = [&triangles, axis](std::size_t t)
+                {
+                    return triangles[3 * t][axis] + triangles[3 * t + 1][axis] + triangles[3 * t + 2][axis];
+                };
+                const std::size_t mid = begin + (end - begin) / 2;
+                std::nth_element(tris.begin() + begin, tris.begin() + mid, tris.begin() + end,
+                                 [&centroid](std::size_t a, std::size_t b) { return centroid(a) < centroid(b); });
+
+                // the two children are stored next to each other
+                const std::size_t first = nodes_.size();
+                nodes_.resize(first + 2);
+                nodes_[n].children = first;
+                build(triangles, tris, first, begin, mid, depth - 1);
+                build(triangles, tris, first + 1, mid, end, depth - 1);
+            }
+
+            std::vector<Node> nodes_;
+        };
+        /// @endcond
+    }
+}
+
+#endif
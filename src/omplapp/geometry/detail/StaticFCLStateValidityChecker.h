@@ -0,0 +1,94 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2011, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_GEOMETRY_DETAIL_STATIC_FCL_STATE_VALIDITY_CHECKER_
+#define OMPLAPP_GEOMETRY_DETAIL_STATIC_FCL_STATE_VALIDITY_CHECKER_
+
+#include "omplapp/geometry/detail/FCLStateValidityChecker.h"
+#include "omplapp/geometry/detail/Trace.h"
+
+#include <ompl/base/State.h>
+
+namespace ompl
+{
+    namespace app
+    {
+        /// @cond IGNORE
+        /// \brief The state of a robot part, for every StateLayout but Layout_Generic
+        template<StateLayout L>
+        struct StaticStateLayout;
+
+        template<>
+        struct StaticStateLayout<Layout_RigidBody>
+        {
+            static const base::State *part(const base::State *state, std::size_t /*index*/)
+            {
+                return state;
+            }
+        };
+
+        template<>
+        struct StaticStateLayout<Layout_FirstComponent>
+        {
+            static const base::State *part(const base::State *state, std::size_t /*index*/)
+            {
+                return state->as<base::CompoundState>()->components[0];
+            }
+        };
+
+        template<>
+        struct StaticStateLayout<Layout_MultiRigidBody>
+        {
+            static const base::State *part(const base::State *state, std::size_t index)
+            {
+                return state->as<base::CompoundState>()->components[index];
+            }
+        };
+        /// @endcond
+
+        /// \brief FCL checker for states of a layout known at compile time.
+        /// A plain collision query of FCLStateValidityChecker extracts the
+        /// geometric component and converts it to a pose through two
+        /// std::function callbacks per robot part, and goes through a
+        /// virtual call of FCLMethodWrapper. This checker locates the parts
+        /// with StaticStateLayout<L> and converts them with
+        /// OMPL_FCL_StateType<T> directly, so the compiler can inline both.
+        /// The layout must agree with the GeometricStateExtractor passed to
+        /// the constructor, which the caches, motion validators and
+        /// distance queries still use. Queries that use one of the caches
+        /// take the generic path.
+        template<MotionModel T, StateLayout L>
+        class StaticFCLStateValidityChecker : public FCLStateValidityChecker<T>
+        {
+        public:
+            using FCLStateValidityChecker<T>::FCLStateValidityChecker;
+
+            ~StaticFCLStateValidityChecker() override = default;
+
+            bool isValid(const ob::State *state) const override
+            {
+                if (this->clearanceCache_ || this->coherenceCache_ || this->partCache_)
+                    return FCLStateValidityChecker<T>::isValid(state);
+                ScopedTrace trace("isValid", "checker", Trace::sample());
+                if (!this->si_->satisfiesBounds(state))
+                    return false;
+                const OMPL_FCL_StateType<T> &convertor = this->stateConvertor_;
+                return this->fclWrapper_->isValidAt([state, &convertor](FCLMethodWrapper::Transform &tf, std::size_t i)
+                    {
+                        convertor.FCLPoseFromState(tf, StaticStateLayout<L>::part(state, i));
+                    });
+            }
+
+            using FCLStateValidityChecker<T>::isValid;
+        };
+    }
+}
+
+#endif
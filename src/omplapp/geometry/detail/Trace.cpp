@@ -0,0 +1,189 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#include "omplapp/geometry/detail/Trace.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+std::atomic<bool> ompl::app::Trace::enabled_(false);
+
+namespace
+{
+    struct Event
+    {
+        const char   *name;
+        const char   *category;
+        std::int64_t  begin;    // ns since the trace was enabled
+        std::int64_t  duration; // ns
+    };
+
+    // The spans of one thread. Only the owning thread writes; head is
+    // published with release semantics, so write() sees complete events.
+    struct Ring
+    {
+        Ring(std::size_t capacity, unsigned int tid, unsigned int generation)
+            : events(capacity), tid(tid), generation(generation)
+        {
+        }
+
+        std::vector<Event>         events;
+        std::atomic<std::uint64_t> head{0};
+        unsigned int               tid;
+        unsigned int               generation;
+        std::uint64_t              calls{0};
+    };
+
+    struct Registry
+    {
+        std::mutex                          lock;
+        std::vector<std::shared_ptr<Ring>>  rings;
+        std::set<std::string>               names;
+        std::size_t                         capacity{1u << 18};
+        std::atomic<unsigned int>           generation{0};
+        std::atomic<std::uint64_t>          period{1000};
+        // the time the trace was enabled, read by record() without the lock
+        std::atomic<ompl::app::Trace::Clock::rep> origin{ompl::app::Trace::Clock::now().time_since_epoch().count()};
+    };
+
+    Registry& registry()
+    {
+        static Registry r;
+        return r;
+    }
+
+    // the ring of the calling thread; threads get a new ring whenever the trace is enabled again
+    Ring& threadRing()
+    {
+        thread_local std::shared_ptr<Ring> ring;
+        Registry &r = registry();
+        const unsigned int generation = r.generation.load(std::memory_order_acquire);
+        if (!ring || ring->generation != generation)
+        {
+            std::lock_guard<std::mutex> _(r.lock);
+            ring = std::make_shared<Ring>(r.capacity, (unsigned int)r.rings.size() + 1, generation);
+            r.rings.push_back(ring);
+        }
+        return *ring;
+    }
+
+    void writeString(std::ostream &out, const char *s)
+    {
+        out << '"';
+        for (; *s != '\0'; ++s)
+        {
+            if (*s == '"' || *s == '\\')
+                out << '\\' << *s;
+            else if ((unsigned char)*s < 0x20)
+                out << ' ';
+            else
+                out << *s;
+        }
+        out << '"';
+    }
+}
+
+void ompl::app::Trace::enable(std::size_t eventsPerThread, double sampleRate)
+{
+    Registry &r = registry();
+    {
+        std::lock_guard<std::mutex> _(r.lock);
+        r.rings.clear();
+        r.capacity = std::max<std::size_t>(1, eventsPerThread);
+        r.period = sampleRate > 0.0 ? (std::uint64_t)std::max(1.0, std::round(1.0 / std::min(1.0, sampleRate))) : 0;
+        r.origin.store(Clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+        r.generation.fetch_add(1, std::memory_order_release);
+    }
+    enabled_.store(true, std::memory_order_relaxed);
+}
+
+void ompl::app::Trace::disable()
+{
+    enabled_.store(false, std::memory_order_relaxed);
+}
+
+bool ompl::app::Trace::sample()
+{
+    if (!isEnabled())
+        return false;
+    const std::uint64_t period = registry().period.load(std::memory_order_relaxed);
+    return period != 0 && ++threadRing().calls % period == 0;
+}
+
+void ompl::app::Trace::record(const char *name, const char *category, Clock::time_point begin, Clock::time_point end)
+{
+    if (!isEnabled())
+        return;
+    Ring &ring = threadRing();
+    const Clock::time_point origin{Clock::duration(registry().origin.load(std::memory_order_relaxed))};
+    const std::uint64_t head = ring.head.load(std::memory_order_relaxed);
+    Event &event = ring.events[head % ring.events.size()];
+    event.name = name;
+    event.category = category;
+    // spans that started before the trace was enabled start with it
+    event.begin = std::max<std::int64_t>(0, std::chrono::duration_cast<std::chrono::nanoseconds>(begin - origin).count());
+    event.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+    ring.head.store(head + 1, std::memory_order_release);
+}
+
+const char* ompl::app::Trace::intern(const std::string &name)
+{
+    Registry &r = registry();
+    std::lock_guard<std::mutex> _(r.lock);
+    return r.names.insert(name).first->c_str();
+}
+
+void ompl::app::Trace::write(std::ostream &out)
+{
+    Registry &r = registry();
+    std::vector<std::shared_ptr<Ring>> rings;
+    {
+        std::lock_guard<std::mutex> _(r.lock);
+        rings = r.rings;
+    }
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (const auto &ring : rings)
+    {
+        out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->tid
+            << ",\"args\":{\"name\":\"thread " << ring->tid << "\"}}";
+        first = false;
+        // the oldest events were overwritten once the ring was full
+        const std::uint64_t head = ring->head.load(std::memory_order_acquire);
+        const std::uint64_t count = std::min<std::uint64_t>(head, ring->events.size());
+        for (std::uint64_t k = head - count; k < head; ++k)
+        {
+            const Event &event = ring->events[k % ring->events.size()];
+            out << ",\n{\"name\":";
+            writeString(out, event.name);
+            out << ",\"cat\":";
+            writeString(out, event.category);
+            out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->tid
+                << ",\"ts\":" << event.begin / 1000 << '.' << (event.begin % 1000) / 100
+                << ",\"dur\":" << event.duration / 1000 << '.' << (event.duration % 1000) / 100 << '}';
+        }
+    }
+    out << "\n]}\n";
+}
+
+bool ompl::app::Trace::write(const std::string &file)
+{
+    std::ofstream out(file.c_str());
+    if (!out)
+        return false;
+    write(out);
+    return (bool)out;
+}
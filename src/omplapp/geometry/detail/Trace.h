@@ -0,0 +1,109 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_GEOMETRY_DETAIL_TRACE_
+#define OMPLAPP_GEOMETRY_DETAIL_TRACE_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+namespace ompl
+{
+    namespace app
+    {
+        /** \brief A process wide recorder of timed spans, such as loading
+            a mesh, building a BVH, setting up an app, solving, and a
+            sample of the collision checks, which can be written as a
+            Chrome trace (JSON, viewable in chrome://tracing or Perfetto).
+
+            Recording is off by default; then a span costs one relaxed
+            atomic load. When enabled, every thread records into a ring
+            buffer of its own, without locks, so that the most recent
+            spans of every thread are kept. write() reads the buffers of
+            all threads and should be called while no spans are recorded,
+            such as after planning; spans recorded meanwhile may be lost.
+            Names and categories are not copied and must outlive the
+            trace: use string literals, or intern() for other names. */
+        class Trace
+        {
+        public:
+            using Clock = std::chrono::steady_clock;
+
+            /** \brief Start recording, keeping the last \e eventsPerThread
+                spans of every thread. Spans of frequent queries (see
+                sample()) are kept with probability \e sampleRate. Spans
+                recorded before are dropped, so a program should enable
+                the trace once, before the work it wants to record. */
+            static void enable(std::size_t eventsPerThread = 1u << 18, double sampleRate = 0.001);
+
+            /** \brief Stop recording. The recorded spans are kept for write(). */
+            static void disable();
+
+            /** \brief Return true if spans are recorded */
+            static bool isEnabled()
+            {
+                return enabled_.load(std::memory_order_relaxed);
+            }
+
+            /** \brief Return true if recording is enabled and the calling
+                frequent query should be recorded, for roughly the fraction
+                of calls set by enable() */
+            static bool sample();
+
+            /** \brief Record the span \e name of \e category from \e begin to \e end, if recording is enabled */
+            static void record(const char *name, const char *category, Clock::time_point begin, Clock::time_point end);
+
+            /** \brief Return a copy of \e name that lives as long as the process */
+            static const char* intern(const std::string &name);
+
+            /** \brief Write the recorded spans of all threads in the Chrome trace event format */
+            static void write(std::ostream &out);
+
+            /** \brief Write the recorded spans to \e file. Returns false if the file cannot be written. */
+            static bool write(const std::string &file);
+
+        private:
+            static std::atomic<bool> enabled_;
+        };
+
+        /** \brief Record a span from construction to destruction. \e active
+            is usually Trace::isEnabled(), or Trace::sample() for frequent
+            queries. */
+        class ScopedTrace
+        {
+        public:
+            ScopedTrace(const char *name, const char *category, bool active = Trace::isEnabled())
+                : name_(active ? name : nullptr), category_(category)
+            {
+                if (name_ != nullptr)
+                    begin_ = Trace::Clock::now();
+            }
+
+            ~ScopedTrace()
+            {
+                if (name_ != nullptr)
+                    Trace::record(name_, category_, begin_, Trace::Clock::now());
+            }
+
+            ScopedTrace(const ScopedTrace&) = delete;
+            ScopedTrace& operator=(const ScopedTrace&) = delete;
+
+        private:
+            const char              *name_;
+            const char              *category_;
+            Trace::Clock::time_point begin_;
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,161 @@
+/*********************************************************************
+* Rice University Software Distribution License
+*
+* Copyright (c) 2010, Rice University
+* All Rights Reserved.
+*
+* For a full description see the file named LICENSE.
+*
+*********************************************************************/
+
+#ifndef OMPLAPP_GEOMETRY_DETAIL_VERTEX_CLUSTERING_
+#define OMPLAPP_GEOMETRY_DETAIL_VERTEX_CLUSTERING_
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace ompl
+{
+    namespace app
+    {
+        /** \brief Simplify the mesh \e points, \e triangles by merging all
+            vertices in a cell of a grid with spacing \e cell into their
+            mean. The triangles of the result index \e outPoints; triangles
+            whose vertices merge into one or two points are kept as
+            degenerate triangles, and duplicates are removed. Returns the
+            largest distance a vertex moved: since every point of a
+            triangle moves by at most the largest distance its vertices
+            move, every point of the mesh is at most that far from the
+            result. \e P must have a constructor from three coordinates and
+            operator[], and \e T operator[] and a constructor from three
+            indices. */
+        template<typename P, typename T>
+        double clusterVertices(const std::vector<P> &points, const std::vector<T> &triangles, double cell,
+                               std::vector<P> &outPoints, std::vector<T> &outTriangles)
+        {
+            struct CellHash
+            {
+                std::size_t operator()(const std::array<std::int64_t, 3> &c) const
+                {
+                    return (std::size_t)(c[0] * 73856093LL ^ c[1] * 19349663LL ^ c[2] * 83492791LL);
+                }
+            };
+
+            std::unordered_map<std::array<std::int64_t, 3>, std::size_t, CellHash> cells;
+            std::vector<std::size_t> cluster(points.size());
+            std::vector<std::array<double, 3>> sum;
+            std::vector<std::size_t> count;
+            for (std::size_t i = 0 ; i < points.size() ; ++i)
+            {
+                std::array<std::int64_t, 3> c;
+                for (int k = 0 ; k < 3 ; ++k)
+                    c[k] = (std::int64_t)std::floor(points[i][k] / cell);
+                auto it = cells.emplace(c, sum.size()).first;
+                if (it->second == sum.size())
+                {
+                    sum.push_back({{0.0, 0.0, 0.0}});
+                    count.push_back(0);
+                }
+                cluster[i] = it->second;
+                for (int k = 0 ; k < 3 ; ++k)
+                    sum[it->second][k] += points[i][k];
+                ++count[it->second];
+            }
+
+            outPoints.clear();
+            outPoints.reserve(sum.size());
+            for (std::size_t j = 0 ; j < sum.size() ; ++j)
+                outPoints.emplace_back(sum[j][0] / count[j], sum[j][1] / count[j], sum[j][2] / count[j]);
+
+            double moved = 0.0;
+            for (std::size_t i = 0 ; i < points.size() ; ++i)
+            {
+                double d2 = 0.0;
+                for (int k = 0 ; k < 3 ; ++k)
+                {
+                    const double d = points[i][k] - outPoints[cluster[i]][k];
+                    d2 += d * d;
+                }
+                moved = std::max(moved, d2);
+            }
+
+            std::vector<std::array<std::size_t, 3>> merged;
+            merged.reserve(triangles.size());
+            for (const T &t : triangles)
+            {
+                std::array<std::size_t, 3> m{{cluster[t[0]], cluster[t[1]], cluster[t[2]]}};
+                std::sort(m.begin(), m.end());
+                merged.push_back(m);
+            }
+            std::sort(merged.begin(), merged.end());
+            merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+            outTriangles.clear();
+            outTriangles.reserve(merged.size());
+            for (const auto &m : merged)
+                outTriangles.emplace_back(m[0], m[1], m[2]);
+
+            return std::sqrt(moved);
+        }
+
+        /** \brief Simplify a mesh with clusterVertices(), choosing the grid
+            spacing so that the result has at most about \e ratio times the
+            triangles of the mesh. Returns the largest distance a vertex
+            moved. */
+        template<typename P, typename T>
+        double clusterVerticesToRatio(const std::vector<P> &points, const std::vector<T> &triangles, double ratio,
+                                      std::vector<P> &outPoints, std::vector<T> &outTriangles)
+        {
+            if (points.empty())
+            {
+                outPoints.clear();
+                outTriangles.clear();
+                return 0.0;
+            }
+            double low[3], high[3];
+            for (int k = 0 ; k < 3 ; ++k)
+                low[k] = high[k] = points[0][k];
+            for (const P &p : points)
+                for (int k = 0 ; k < 3 ; ++k)
+                {
+                    low[k] = std::min(low[k], (double)p[k]);
+                    high[k] = std::max(high[k], (double)p[k]);
+                }
+            double diagonal = 0.0;
+            for (int k = 0 ; k < 3 ; ++k)
+                diagonal += (high[k] - low[k]) * (high[k] - low[k]);
+            diagonal = std::max(std::sqrt(diagonal), 1e-9);
+
+            // the number of triangles shrinks as the cells grow, so bisect
+            // the logarithm of the spacing for the finest grid that is
+            // coarse enough
+            const std::size_t target = std::max<std::size_t>(1, (std::size_t)(ratio * triangles.size()));
+            double fine = std::log(diagonal * 1e-5), coarse = std::log(diagonal);
+            std::vector<P> candidatePoints;
+            std::vector<T> candidateTriangles;
+            double moved = clusterVertices(points, triangles, std::exp(coarse), outPoints, outTriangles);
+            for (int iteration = 0 ; iteration < 16 ; ++iteration)
+            {
+                const double middle = 0.5 * (fine + coarse);
+                const double candidateMoved = clusterVertices(points, triangles, std::exp(middle),
+                                                              candidatePoints, candidateTriangles);
+                if (candidateTriangles.size() <= target)
+                {
+                    coarse = middle;
+                    moved = candidateMoved;
+                    outPoints.swap(candidatePoints);
+                    outTriangles.swap(candidateTriangles);
+                }
+                else
+                    fine = middle;
+            }
+            return moved;
+        }
+    }
+}
+
+#endif
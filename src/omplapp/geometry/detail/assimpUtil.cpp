@@ -12,26 +12,26 @@
 
 #include "omplapp/geometry/detail/assimpUtil.h"
 #include <ompl/util/Console.h>
+#include <algorithm>
+#include <cmath>
 #include <limits>
+#include <utility>
 
 void ompl::app::scene::inferBounds(base::RealVectorBounds &bounds, const std::vector<aiVector3D> &vertices, double multiply, double add)
 {
-    double minX = std::numeric_limits<double>::infinity();
-    double minY = minX;
-    double minZ = minX;
-    double maxX = -minX;
-    double maxY = maxX;
-    double maxZ = maxX;
+    const float inf = std::numeric_limits<float>::infinity();
+    aiVector3D low(inf, inf, inf), high(-inf, -inf, -inf);
     for (const auto & vertex : vertices)
-    {
-        if (minX > vertex.x) minX = vertex.x;
-        if (maxX < vertex.x) maxX = vertex.x;
-        if (minY > vertex.y) minY = vertex.y;
-        if (maxY < vertex.y) maxY = vertex.y;
-        if (minZ > vertex.z) minZ = vertex.z;
-        if (maxZ < vertex.z) maxZ = vertex.z;
-    }
+        for (unsigned int k = 0 ; k < 3 ; ++k)
+        {
+            if (low[k] > vertex[k]) low[k] = vertex[k];
+            if (high[k] < vertex[k]) high[k] = vertex[k];
+        }
+    inferBounds(bounds, low, high, multiply, add);
+}
 
+void ompl::app::scene::inferBounds(base::RealVectorBounds &bounds, const aiVector3D &low, const aiVector3D &high, double multiply, double add)
+{
     multiply -= 1.0;
     if (multiply < 0.0)
     {
@@ -44,11 +44,40 @@ void ompl::app::scene::inferBounds(base::RealVectorBounds &bounds, const std::ve
         OMPL_WARN("The additive factor in the bounds computation process should be larger than 0.0");
     }
 
-    double dx = (maxX - minX) * multiply + add;
-    double dy = (maxY - minY) * multiply + add;
-    double dz = (maxZ - minZ) * multiply + add;
-    bounds.low[0] = minX - dx; bounds.low[1] = minY - dy; bounds.low[2] = minZ - dz;
-    bounds.high[0] = maxX + dx; bounds.high[1] = maxY + dy; bounds.high[2] = maxZ + dz;
+    for (unsigned int k = 0 ; k < 3 ; ++k)
+    {
+        double d = ((double)high[k] - (double)low[k]) * multiply + add;
+        bounds.low[k] = low[k] - d;
+        bounds.high[k] = high[k] + d;
+    }
+}
+
+void ompl::app::scene::computeBounds(const aiScene *scene, MeshBounds &bounds)
+{
+    std::vector<aiVector3D> vertices;
+    extractVertices(scene, vertices);
+
+    const float inf = std::numeric_limits<float>::infinity();
+    bounds = MeshBounds();
+    bounds.vertices = vertices.size();
+    bounds.low.Set(inf, inf, inf);
+    bounds.high.Set(-inf, -inf, -inf);
+    double sum[3] = {0.0, 0.0, 0.0};
+    for (const auto & vertex : vertices)
+        for (unsigned int k = 0 ; k < 3 ; ++k)
+        {
+            sum[k] += vertex[k];
+            if (bounds.low[k] > vertex[k]) bounds.low[k] = vertex[k];
+            if (bounds.high[k] < vertex[k]) bounds.high[k] = vertex[k];
+        }
+    if (vertices.empty())
+        return;
+    bounds.center.Set(sum[0] / vertices.size(), sum[1] / vertices.size(), sum[2] / vertices.size());
+
+    float r2 = 0.0f;
+    for (const auto & vertex : vertices)
+        r2 = std::max(r2, (vertex - bounds.center).SquareLength());
+    bounds.radius = sqrt(r2);
 }
 
 
@@ -94,6 +123,74 @@ namespace ompl
                 for (unsigned int n = 0; n < node->mNumChildren; ++n)
                     extractTrianglesAux(scene, node->mChildren[n], transform, triangles);
             }
+
+            bool hasTriangles(const aiMesh *mesh)
+            {
+                return (mesh->mPrimitiveTypes & aiPrimitiveType_TRIANGLE) != 0;
+            }
+
+            void countTrianglesAux(const aiScene *scene, const aiNode *node, std::size_t &vertices, std::size_t &faces)
+            {
+                for (unsigned int i = 0 ; i < node->mNumMeshes; ++i)
+                {
+                    const aiMesh* a = scene->mMeshes[node->mMeshes[i]];
+                    if (hasTriangles(a))
+                    {
+                        vertices += a->mNumVertices;
+                        faces += a->mNumFaces;
+                    }
+                }
+
+                for (unsigned int n = 0; n < node->mNumChildren; ++n)
+                    countTrianglesAux(scene, node->mChildren[n], vertices, faces);
+            }
+
+            void appendIndexedTriangles(const aiMesh *a, const aiMatrix4x4 &transform, IndexedMesh &mesh)
+            {
+                const auto offset = (unsigned int)mesh.vertices.size();
+                for (unsigned int i = 0 ; i < a->mNumVertices ; ++i)
+                    mesh.vertices.push_back(transform * a->mVertices[i]);
+                for (unsigned int i = 0 ; i < a->mNumFaces ; ++i)
+                    if (a->mFaces[i].mNumIndices == 3)
+                        for (unsigned int k = 0 ; k < 3 ; ++k)
+                            mesh.indices.push_back(offset + a->mFaces[i].mIndices[k]);
+            }
+
+            void extractIndexedTrianglesAux(const aiScene *scene, const aiNode *node, aiMatrix4x4 transform,
+                                            IndexedMesh &mesh)
+            {
+                transform *= node->mTransformation;
+                for (unsigned int i = 0 ; i < node->mNumMeshes; ++i)
+                {
+                    const aiMesh* a = scene->mMeshes[node->mMeshes[i]];
+                    if (hasTriangles(a))
+                        appendIndexedTriangles(a, transform, mesh);
+                }
+
+                for (unsigned int n = 0; n < node->mNumChildren; ++n)
+                    extractIndexedTrianglesAux(scene, node->mChildren[n], transform, mesh);
+            }
+
+            void extractIndexedMeshTrianglesAux(const aiScene *scene, const aiNode *node, aiMatrix4x4 transform,
+                                                std::vector<IndexedMesh> &meshes)
+            {
+                transform *= node->mTransformation;
+                for (unsigned int i = 0 ; i < node->mNumMeshes; ++i)
+                {
+                    const aiMesh* a = scene->mMeshes[node->mMeshes[i]];
+                    if (!hasTriangles(a))
+                        continue;
+                    IndexedMesh mesh;
+                    mesh.vertices.reserve(a->mNumVertices);
+                    mesh.indices.reserve(3 * a->mNumFaces);
+                    appendIndexedTriangles(a, transform, mesh);
+                    if (!mesh.indices.empty())
+                        meshes.push_back(std::move(mesh));
+                }
+
+                for (unsigned int n = 0; n < node->mNumChildren; ++n)
+                    extractIndexedMeshTrianglesAux(scene, node->mChildren[n], transform, meshes);
+            }
         }
     }
 }
@@ -123,6 +220,64 @@ void ompl::app::scene::extractTriangles(const aiScene *scene, std::vector<aiVect
         extractTrianglesAux(scene, scene->mRootNode, aiMatrix4x4(), triangles);
 }
 
+void ompl::app::scene::extractIndexedTriangles(const aiScene *scene, IndexedMesh &mesh)
+{
+    mesh.vertices.clear();
+    mesh.indices.clear();
+    if ((scene != nullptr) && scene->HasMeshes())
+    {
+        std::size_t vertices = 0, faces = 0;
+        countTrianglesAux(scene, scene->mRootNode, vertices, faces);
+        mesh.vertices.reserve(vertices);
+        mesh.indices.reserve(3 * faces);
+        extractIndexedTrianglesAux(scene, scene->mRootNode, aiMatrix4x4(), mesh);
+    }
+}
+
+void ompl::app::scene::extractIndexedMeshTriangles(const aiScene *scene, std::vector<IndexedMesh> &meshes)
+{
+    meshes.clear();
+    if ((scene != nullptr) && scene->HasMeshes())
+        extractIndexedMeshTrianglesAux(scene, scene->mRootNode, aiMatrix4x4(), meshes);
+}
+
+aiScene* ompl::app::scene::compactScene(const aiScene *scene)
+{
+    std::vector<IndexedMesh> meshes;
+    extractIndexedMeshTriangles(scene, meshes);
+
+    auto *compact = new aiScene();
+    // every scene has a material, which the meshes refer to
+    compact->mNumMaterials = 1;
+    compact->mMaterials = new aiMaterial*[1];
+    compact->mMaterials[0] = new aiMaterial();
+    compact->mRootNode = new aiNode();
+    compact->mNumMeshes = compact->mRootNode->mNumMeshes = (unsigned int)meshes.size();
+    compact->mMeshes = new aiMesh*[meshes.size()];
+    compact->mRootNode->mMeshes = new unsigned int[meshes.size()];
+    for (std::size_t m = 0 ; m < meshes.size() ; ++m)
+    {
+        const IndexedMesh &mesh = meshes[m];
+        auto *a = new aiMesh();
+        a->mPrimitiveTypes = aiPrimitiveType_TRIANGLE;
+        a->mMaterialIndex = 0;
+        a->mNumVertices = (unsigned int)mesh.vertices.size();
+        a->mVertices = new aiVector3D[mesh.vertices.size()];
+        std::copy(mesh.vertices.begin(), mesh.vertices.end(), a->mVertices);
+        a->mNumFaces = (unsigned int)(mesh.indices.size() / 3);
+        a->mFaces = new aiFace[a->mNumFaces];
+        for (unsigned int f = 0 ; f < a->mNumFaces ; ++f)
+        {
+            a->mFaces[f].mNumIndices = 3;
+            a->mFaces[f].mIndices = new unsigned int[3];
+            std::copy(mesh.indices.begin() + 3 * f, mesh.indices.begin() + 3 * f + 3, a->mFaces[f].mIndices);
+        }
+        compact->mMeshes[m] = a;
+        compact->mRootNode->mMeshes[m] = (unsigned int)m;
+    }
+    return compact;
+}
+
 double ompl::app::scene::shortestEdge(const aiScene *scene)
 {
     std::vector<aiVector3D> triangles;
@@ -18,6 +18,7 @@
 #endif
 
 #include "omplapp/config.h"
+#include "omplapp/geometry/GeometrySpecification.h"
 #include <assimp/scene.h>
 #include <assimp/cimport.h>
 #include <assimp/postprocess.h>
@@ -34,8 +35,24 @@ namespace ompl
         namespace scene
         {
 
+            /** \brief Triangles given as vertices and three indices per triangle */
+            struct IndexedMesh
+            {
+                std::vector<aiVector3D>   vertices;
+                std::vector<unsigned int> indices;
+            };
+
             void inferBounds(base::RealVectorBounds &bounds, const std::vector<aiVector3D> &vertices, double multiply = 1.1, double add = 0.0);
+            void inferBounds(base::RealVectorBounds &bounds, const aiVector3D &low, const aiVector3D &high, double multiply = 1.1, double add = 0.0);
+            void computeBounds(const aiScene *scene, MeshBounds &bounds);
             void extractTriangles(const aiScene *scene, std::vector<aiVector3D> &triangles);
+            void extractIndexedTriangles(const aiScene *scene, IndexedMesh &mesh);
+            void extractIndexedMeshTriangles(const aiScene *scene, std::vector<IndexedMesh> &meshes);
+            /** \brief A new scene, owned by the caller, with one mesh of
+                triangles per triangle mesh of \e scene, already in world
+                coordinates. Normals, materials and the node hierarchy are
+                dropped, so the copy only serves collision checking. */
+            aiScene* compactScene(const aiScene *scene);
             void extractVertices(const aiScene *scene, std::vector<aiVector3D> &vertices);
             double shortestEdge(const aiScene *scene);
             void sceneCenter(const aiScene *scene, aiVector3D &center);
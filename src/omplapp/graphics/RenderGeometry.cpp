@@ -20,6 +20,12 @@ int ompl::app::RenderGeometry::renderEnvironment() const
     return scene::assimpRender(gs.obstacles, gs.obstaclesShift);
 }
 
+int ompl::app::RenderGeometry::renderEnvironmentLOD(unsigned int cells) const
+{
+    const GeometrySpecification &gs = rbg_.getGeometrySpecification();
+    return scene::assimpRender(gs.obstacles, gs.obstaclesShift, cells);
+}
+
 int ompl::app::RenderGeometry::renderRobot() const
 {
     const GeometrySpecification &gs = rbg_.getGeometrySpecification();
@@ -36,5 +42,6 @@ int ompl::app::RenderGeometry::renderRobotPart(unsigned int index) const
 
 int ompl::app::RenderGeometry::renderPlannerData(const base::PlannerData &pd) const
 {
-    return RenderPlannerData(pd, aiVector3D(0.0, 0.0, 0.0), rbg_.getMotionModel(), se_, rbg_.getLoadedRobotCount());
+    return RenderPlannerData(pd, aiVector3D(0.0, 0.0, 0.0), rbg_.getMotionModel(), se_, rbg_.getLoadedRobotCount(),
+                             maxPlannerDataVertices_);
 }
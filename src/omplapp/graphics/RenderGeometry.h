@@ -36,16 +36,35 @@ namespace ompl
 
             int renderEnvironment() const;
 
+            /** \brief Render a coarser version of the environment, with its
+                vertices clustered on a grid with \e cells cells along the
+                longest side of every mesh, for drawing while the camera
+                moves. */
+            int renderEnvironmentLOD(unsigned int cells = 64) const;
+
             int renderRobot() const;
 
             int renderRobotPart(unsigned int index) const;
 
             int renderPlannerData(const base::PlannerData &pd) const;
 
+            /** \brief Limit the number of vertices drawn by renderPlannerData()
+                (zero, the default, draws all). Larger graphs are decimated. */
+            void setMaxPlannerDataVertices(unsigned int maxVertices)
+            {
+                maxPlannerDataVertices_ = maxVertices;
+            }
+
+            unsigned int getMaxPlannerDataVertices() const
+            {
+                return maxPlannerDataVertices_;
+            }
+
         private:
 
             const RigidBodyGeometry &rbg_;
             GeometricStateExtractor  se_;
+            unsigned int             maxPlannerDataVertices_{0};
 
         };
 
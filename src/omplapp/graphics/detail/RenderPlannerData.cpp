@@ -13,6 +13,11 @@
 #include "omplapp/graphics/detail/RenderPlannerData.h"
 #include <ompl/base/spaces/SE2StateSpace.h>
 #include <ompl/base/spaces/SE3StateSpace.h>
+#include <ompl/util/Console.h>
+#include "omplapp/geometry/detail/ParallelBatch.h"
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
 
 #ifdef __APPLE__
 #include <OpenGL/gl.h>
@@ -25,34 +30,28 @@ namespace ompl
     namespace app
     {
 
-        static void renderState(const base::SE2StateSpace::StateType &state)
+        static void statePosition(const base::State *state, MotionModel m, float *p)
         {
-            glVertex3d(state.getX(), state.getY(), 0.0);
-        }
-
-        static void renderState(const base::SE3StateSpace::StateType &state)
-        {
-            glVertex3d(state.getX(), state.getY(), state.getZ());
-        }
-
-        static void renderEdge(const base::SE2StateSpace::StateType &state1,
-            const base::SE2StateSpace::StateType &state2)
-        {
-            renderState(state1);
-            renderState(state2);
-        }
-
-        static void renderEdge(const base::SE3StateSpace::StateType &state1,
-            const base::SE3StateSpace::StateType &state2)
-        {
-            renderState(state1);
-            renderState(state2);
+            if (m == Motion_2D)
+            {
+                const auto *se2st = static_cast<const base::SE2StateSpace::StateType*>(state);
+                p[0] = se2st->getX();
+                p[1] = se2st->getY();
+                p[2] = 0.0f;
+            }
+            else
+            {
+                const auto *se3st = static_cast<const base::SE3StateSpace::StateType*>(state);
+                p[0] = se3st->getX();
+                p[1] = se3st->getY();
+                p[2] = se3st->getZ();
+            }
         }
 
-        static void setStateColor(int tag)
+        static void stateColor(int tag, float *c)
         {
             static const int NC = 7;
-            static float colors[NC][4] =
+            static const float colors[NC][4] =
                 {
                     {1.0f, 0.0f, 0.0f, 0.6f},
                     {0.0f, 1.0f, 0.0f, 0.6f},
@@ -63,11 +62,36 @@ namespace ompl
                     {1.0f, 1.0f, 1.0f, 0.6f},
                 };
 
-            int c = abs(tag) % NC;
-            glColor4f(colors[c][0], colors[c][1], colors[c][2], colors[c][3]);
+            std::copy(colors[abs(tag) % NC], colors[abs(tag) % NC] + 4, c);
         }
 
-        int RenderPlannerData(const base::PlannerData &pd, const aiVector3D &translate, MotionModel m, const GeometricStateExtractor &gse, unsigned int count)
+        // compile a list that draws the packed positions (3 per point) and colors (4 per point)
+        static void compileArrays(int list, GLenum mode, const aiMatrix4x4 &t,
+                                  const std::vector<float> &positions, const std::vector<float> &colors)
+        {
+            glNewList(list, GL_COMPILE);
+            glPushMatrix();
+            glMultMatrixf((float*)&t);
+            glDisable(GL_LIGHTING);
+            glDisable(GL_COLOR_MATERIAL);
+            glPointSize(2.0f);
+            if (!positions.empty())
+            {
+                // the client state is set immediately; glDrawArrays copies the arrays into the list
+                glEnableClientState(GL_VERTEX_ARRAY);
+                glEnableClientState(GL_COLOR_ARRAY);
+                glVertexPointer(3, GL_FLOAT, 0, positions.data());
+                glColorPointer(4, GL_FLOAT, 0, colors.data());
+                glDrawArrays(mode, 0, positions.size() / 3);
+                glDisableClientState(GL_COLOR_ARRAY);
+                glDisableClientState(GL_VERTEX_ARRAY);
+            }
+            glPopMatrix();
+            glEndList();
+        }
+
+        int RenderPlannerData(const base::PlannerData &pd, const aiVector3D &translate, MotionModel m, const GeometricStateExtractor &gse,
+                              unsigned int count, unsigned int maxVertices)
         {
             static int result = -1;
 
@@ -79,85 +103,62 @@ namespace ompl
             aiMatrix4x4::Translation(-translate, t);
             aiTransposeMatrix4(&t);
 
+            // only every stride-th vertex, and the edges leaving it, are drawn
+            const std::size_t n = pd.numVertices();
+            const std::size_t stride = maxVertices > 0 && n > maxVertices ? (n + maxVertices - 1) / maxVertices : 1;
+            const std::size_t kept = (n + stride - 1) / stride;
+            if (stride > 1)
+                OMPL_INFORM("Rendering %lu of the %lu vertices of the planner data", kept, n);
+
             // render vertices
-            glNewList(result, GL_COMPILE);
-            glPushMatrix();
-            glMultMatrixf((float*)&t);
-            glDisable(GL_LIGHTING);
-            glDisable(GL_COLOR_MATERIAL);
-            glPointSize(2.0f);
-            glBegin(GL_POINTS);
-            if (m == Motion_2D)
-                for (std::size_t i = 0; i < pd.numVertices(); ++i)
+            std::vector<float> positions(kept * count * 3);
+            std::vector<float> colors(kept * count * 4);
+            parallelFor(kept, 0, [&](std::size_t begin, std::size_t end)
                 {
-                    const base::PlannerDataVertex& vtx = pd.getVertex(i);
-                    setStateColor(vtx.getTag());
-                    for (unsigned int r = 0 ; r < count ; ++r)
+                    for (std::size_t k = begin ; k < end ; ++k)
                     {
-                        const base::State *st = gse(vtx.getState(), r);
-                        const auto* se2st = static_cast<const base::SE2StateSpace::StateType*>(st);
-                        renderState (*se2st);
+                        const base::PlannerDataVertex &vtx = pd.getVertex(k * stride);
+                        for (unsigned int r = 0 ; r < count ; ++r)
+                        {
+                            statePosition(gse(vtx.getState(), r), m, &positions[(k * count + r) * 3]);
+                            stateColor(vtx.getTag(), &colors[(k * count + r) * 4]);
+                        }
                     }
-                }
-            else
-                for (std::size_t i = 0; i < pd.numVertices(); ++i)
-                {
-                    const base::PlannerDataVertex& vtx = pd.getVertex(i);
-                    setStateColor(vtx.getTag());
-                    for (unsigned int r = 0 ; r < count ; ++r)
-                    {
-                        const base::State *st = gse(vtx.getState(), r);
-                        const auto* se3st = static_cast<const base::SE3StateSpace::StateType*>(st);
-                        renderState (*se3st);
-                    }
-                }
-            glEnd();
-            glPopMatrix();
-            glEndList();
+                });
+            compileArrays(result, GL_POINTS, t, positions, colors);
 
-            // render edges
-            glNewList(result+1, GL_COMPILE);
-            glPushMatrix();
-            glMultMatrixf((float*)&t);
-            glDisable(GL_LIGHTING);
-            glDisable(GL_COLOR_MATERIAL);
-            glPointSize(2.0f);
-            glBegin(GL_LINES);
-            std::vector<unsigned int> edgeList;
-            unsigned int numEdges;
-            if (m == Motion_2D)
-                for (std::size_t i = 0; i < pd.numVertices(); ++i)
+            // render edges; count them first, so that every vertex knows where its edges go
+            std::vector<std::size_t> offsets(kept + 1, 0);
+            parallelFor(kept, 0, [&](std::size_t begin, std::size_t end)
                 {
-                    const base::PlannerDataVertex& vtx = pd.getVertex(i);
-                    const auto* vi =
-                        static_cast<const base::SE2StateSpace::StateType*>(gse(vtx.getState(), 0));
-                    setStateColor(vtx.getTag());
-                    numEdges = pd.getEdges(i, edgeList);
-                    for (unsigned int j = 0; j < numEdges; ++j)
-                    {
-                        const auto* vj =
-                            static_cast<const base::SE2StateSpace::StateType*>(gse(pd.getVertex(edgeList[j]).getState(), 0));
-                        renderEdge(*vi, *vj);
-                    }
-                }
-            else
-                for (std::size_t i = 0; i < pd.numVertices(); ++i)
+                    std::vector<unsigned int> edgeList;
+                    for (std::size_t k = begin ; k < end ; ++k)
+                        offsets[k + 1] = pd.getEdges(k * stride, edgeList);
+                });
+            for (std::size_t k = 0 ; k < kept ; ++k)
+                offsets[k + 1] += offsets[k];
+            positions.resize(offsets[kept] * 6);
+            colors.resize(offsets[kept] * 8);
+            parallelFor(kept, 0, [&](std::size_t begin, std::size_t end)
                 {
-                    const base::PlannerDataVertex& vtx = pd.getVertex(i);
-                    const auto* vi =
-                        static_cast<const base::SE3StateSpace::StateType*>(gse(vtx.getState(), 0));
-                    setStateColor(vtx.getTag());
-                    numEdges = pd.getEdges(i, edgeList);
-                    for (unsigned int j = 0; j < numEdges; ++j)
+                    std::vector<unsigned int> edgeList;
+                    for (std::size_t k = begin ; k < end ; ++k)
                     {
-                        const auto* vj =
-                            static_cast<const base::SE3StateSpace::StateType*>(gse(pd.getVertex(edgeList[j]).getState(), 0));
-                        renderEdge(*vi, *vj);
+                        const base::PlannerDataVertex &vtx = pd.getVertex(k * stride);
+                        float vi[3];
+                        statePosition(gse(vtx.getState(), 0), m, vi);
+                        const unsigned int numEdges = pd.getEdges(k * stride, edgeList);
+                        for (unsigned int j = 0 ; j < numEdges ; ++j)
+                        {
+                            const std::size_t e = offsets[k] + j;
+                            std::copy(vi, vi + 3, &positions[e * 6]);
+                            statePosition(gse(pd.getVertex(edgeList[j]).getState(), 0), m, &positions[e * 6 + 3]);
+                            stateColor(vtx.getTag(), &colors[e * 8]);
+                            stateColor(vtx.getTag(), &colors[e * 8 + 4]);
+                        }
                     }
-                }
-            glEnd();
-            glPopMatrix();
-            glEndList();
+                });
+            compileArrays(result + 1, GL_LINES, t, positions, colors);
 
             return result;
         }
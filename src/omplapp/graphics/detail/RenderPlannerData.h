@@ -24,9 +24,12 @@ namespace ompl
 
         /** \brief Render the planner states in \e pd, after shifting them by \e translate, using the motion model \e m.
             The SE2 (or SE3) states can be extracted from \e pd using \e gse. There are \e robotCount points to extract from each state.
-            Return a gl list. */
+            The points and edges are packed into arrays in parallel and drawn with one call each. If \e maxVertices is
+            positive and \e pd has more vertices, only every k-th vertex and the edges leaving it are drawn, so that at
+            most \e maxVertices vertices remain. Return a gl list. */
         int RenderPlannerData(const base::PlannerData &pd, const aiVector3D &translate,
-                              MotionModel m, const GeometricStateExtractor &gse, unsigned int count);
+                              MotionModel m, const GeometricStateExtractor &gse, unsigned int count,
+                              unsigned int maxVertices = 0);
     }
 }
 
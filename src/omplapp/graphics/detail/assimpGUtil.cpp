@@ -11,6 +11,11 @@
 /* Author: Mark Moll, Ioan Sucan */
 
 #include "omplapp/graphics/detail/assimpGUtil.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <tuple>
+#include <vector>
 
 #ifdef __APPLE__
 #include <OpenGL/gl.h>
@@ -19,7 +24,7 @@
 #endif
 
 
-// Most of the code below is taken from external/assimp/samples/SimpleOpenGL/Sample_SimpleOpenGL.c
+// The material code below is taken from external/assimp/samples/SimpleOpenGL/Sample_SimpleOpenGL.c
 namespace ompl
 {
     namespace app
@@ -105,70 +110,150 @@ namespace ompl
                     glDisable(GL_CULL_FACE);
             }
 
-            // Can't send color down as a pointer to aiColor4D because AI colors are ABGR.
-            void Color4f(const aiColor4D *color)
+            // Triangles, lines, or points of one material, with the vertices
+            // already transformed by the scene graph. Every vertex is stored
+            // as 4 color, 3 normal, and 3 position floats (GL_C4F_N3F_V3F).
+            struct DrawBatch
             {
-                glColor4f(color->r, color->g, color->b, color->a);
+                unsigned int       material;
+                bool               normals;
+                bool               colors;
+                GLenum             mode;
+                std::vector<float> data;
+            };
+
+            using BatchKey = std::tuple<unsigned int, bool, bool, GLenum>;
+
+            // Map a position to the center of its cell in a grid with the given cell size
+            // (vertex clustering), or leave it unchanged if the cell size is zero.
+            aiVector3D clusterVertex(const aiVector3D &v, const aiVector3D &origin, float cellSize)
+            {
+                if (cellSize <= 0.0f)
+                    return v;
+                return aiVector3D(origin.x + (std::floor((v.x - origin.x) / cellSize) + 0.5f) * cellSize,
+                                  origin.y + (std::floor((v.y - origin.y) / cellSize) + 0.5f) * cellSize,
+                                  origin.z + (std::floor((v.z - origin.z) / cellSize) + 0.5f) * cellSize);
             }
 
-            void recursive_render(const aiScene *scene, const aiNode* nd)
+            void collect_batches(const aiScene *scene, const aiNode *nd, const aiMatrix4x4 &parent,
+                                 const aiVector3D &origin, float cellSize,
+                                 std::map<BatchKey, DrawBatch> &batches)
             {
-                int i;
-                unsigned int n = 0, t;
-                aiMatrix4x4 m = nd->mTransformation;
-
-                // update transform
-                aiTransposeMatrix4(&m);
-                glPushMatrix();
-                glMultMatrixf((float*)&m);
+                const aiMatrix4x4 m = parent * nd->mTransformation;
+                aiMatrix3x3 nm(m);
+                nm.Inverse().Transpose();
 
-                // draw all meshes assigned to this node
-                for (; n < nd->mNumMeshes; ++n) {
+                // add all meshes assigned to this node
+                for (unsigned int n = 0 ; n < nd->mNumMeshes ; ++n)
+                {
                     const aiMesh* mesh = scene->mMeshes[nd->mMeshes[n]];
+                    const bool normals = mesh->mNormals != nullptr;
+                    const bool colors = mesh->mColors[0] != nullptr;
 
-                    apply_material(scene->mMaterials[mesh->mMaterialIndex]);
-                    if(mesh->mNormals == nullptr)
-                        glDisable(GL_LIGHTING);
-                    else
-                        glEnable(GL_LIGHTING);
-                    if(mesh->mColors[0] == nullptr)
-                        glDisable(GL_COLOR_MATERIAL);
-                    else
-                        glEnable(GL_COLOR_MATERIAL);
+                    std::vector<aiVector3D> vertices(mesh->mNumVertices);
+                    for (unsigned int i = 0 ; i < mesh->mNumVertices ; ++i)
+                        vertices[i] = clusterVertex(m * mesh->mVertices[i], origin, cellSize);
 
-                    for (t = 0; t < mesh->mNumFaces; ++t)
+                    for (unsigned int t = 0 ; t < mesh->mNumFaces ; ++t)
                     {
                         const aiFace* face = &mesh->mFaces[t];
-                        GLenum face_mode;
-
-                        switch(face->mNumIndices)
+                        // polygons are drawn as triangle fans
+                        GLenum mode = face->mNumIndices == 1 ? GL_POINTS : (face->mNumIndices == 2 ? GL_LINES : GL_TRIANGLES);
+                        std::vector<unsigned int> indices;
+                        if (mode == GL_TRIANGLES)
+                            for (unsigned int i = 2 ; i < face->mNumIndices ; ++i)
+                            {
+                                unsigned int tri[3] = { face->mIndices[0], face->mIndices[i - 1], face->mIndices[i] };
+                                // clustering collapses small triangles
+                                if (cellSize > 0.0f && (vertices[tri[0]] == vertices[tri[1]] ||
+                                    vertices[tri[1]] == vertices[tri[2]] || vertices[tri[0]] == vertices[tri[2]]))
+                                    continue;
+                                indices.insert(indices.end(), tri, tri + 3);
+                            }
+                        else
+                            indices.assign(face->mIndices, face->mIndices + face->mNumIndices);
+                        if (indices.empty())
+                            continue;
+
+                        DrawBatch &batch = batches[BatchKey(mesh->mMaterialIndex, normals, colors, mode)];
+                        batch.material = mesh->mMaterialIndex;
+                        batch.normals = normals;
+                        batch.colors = colors;
+                        batch.mode = mode;
+                        for (unsigned int index : indices)
                         {
-                        case 1: face_mode = GL_POINTS; break;
-                        case 2: face_mode = GL_LINES; break;
-                        case 3: face_mode = GL_TRIANGLES; break;
-                        default: face_mode = GL_POLYGON; break;
+                            const aiColor4D c = colors ? mesh->mColors[0][index] : aiColor4D(1.0f, 1.0f, 1.0f, 1.0f);
+                            aiVector3D normal = normals ? nm * mesh->mNormals[index] : aiVector3D(0.0f, 0.0f, 1.0f);
+                            normal.Normalize();
+                            const aiVector3D &v = vertices[index];
+                            const float vertex[10] = { c.r, c.g, c.b, c.a, normal.x, normal.y, normal.z, v.x, v.y, v.z };
+                            batch.data.insert(batch.data.end(), vertex, vertex + 10);
                         }
+                    }
+                }
+                // add all children
+                for (unsigned int n = 0 ; n < nd->mNumChildren ; ++n)
+                    collect_batches(scene, nd->mChildren[n], m, origin, cellSize, batches);
+            }
 
-                        glBegin(face_mode);
-                        for(i = 0; i < (int)face->mNumIndices; i++)
+            // Draw a scene from one vertex array per material and primitive type
+            void render_batches(const aiScene *scene, unsigned int lodCells)
+            {
+                // the cells of the LOD grid are cubes; the longest side of the bounds gets lodCells cells
+                aiVector3D origin(0.0f, 0.0f, 0.0f);
+                float cellSize = 0.0f;
+                if (lodCells > 0)
+                {
+                    std::vector<aiVector3D> vertices;
+                    extractVertices(scene, vertices);
+                    if (!vertices.empty())
+                    {
+                        aiVector3D upper = origin = vertices[0];
+                        for (const auto &v : vertices)
                         {
-                            int index = face->mIndices[i];
-                            if(mesh->mColors[0] != nullptr)
-                                Color4f(&mesh->mColors[0][index]);
-                            if(mesh->mNormals != nullptr)
-                                glNormal3fv(&mesh->mNormals[index].x);
-                            glVertex3fv(&mesh->mVertices[index].x);
+                            origin = aiVector3D(std::min(origin.x, v.x), std::min(origin.y, v.y), std::min(origin.z, v.z));
+                            upper = aiVector3D(std::max(upper.x, v.x), std::max(upper.y, v.y), std::max(upper.z, v.z));
                         }
-                        glEnd();
+                        const aiVector3D extents = upper - origin;
+                        cellSize = std::max(extents.x, std::max(extents.y, extents.z)) / lodCells;
                     }
                 }
-                // draw all children
-                for (n = 0; n < nd->mNumChildren; ++n)
-                    recursive_render(scene, nd->mChildren[n]);
-                glPopMatrix();
+
+                std::map<BatchKey, DrawBatch> batches;
+                collect_batches(scene, scene->mRootNode, aiMatrix4x4(), origin, cellSize, batches);
+
+                // the map is sorted by material, so every material is applied once
+                glEnableClientState(GL_VERTEX_ARRAY);
+                glEnableClientState(GL_NORMAL_ARRAY);
+                glEnableClientState(GL_COLOR_ARRAY);
+                unsigned int material = scene->mNumMaterials;
+                for (const auto &b : batches)
+                {
+                    const DrawBatch &batch = b.second;
+                    if (batch.material != material)
+                    {
+                        material = batch.material;
+                        apply_material(scene->mMaterials[material]);
+                    }
+                    if (batch.normals)
+                        glEnable(GL_LIGHTING);
+                    else
+                        glDisable(GL_LIGHTING);
+                    if (batch.colors)
+                        glEnable(GL_COLOR_MATERIAL);
+                    else
+                        glDisable(GL_COLOR_MATERIAL);
+                    // the client state is set immediately; glDrawArrays copies the array into the list
+                    glInterleavedArrays(GL_C4F_N3F_V3F, 0, batch.data.data());
+                    glDrawArrays(batch.mode, 0, batch.data.size() / 10);
+                }
+                glDisableClientState(GL_COLOR_ARRAY);
+                glDisableClientState(GL_NORMAL_ARRAY);
+                glDisableClientState(GL_VERTEX_ARRAY);
             }
 
-            int assimpRender(const std::vector<const aiScene*> &scenes, const std::vector<aiVector3D> &robotCenter)
+            int assimpRender(const std::vector<const aiScene*> &scenes, const std::vector<aiVector3D> &robotCenter,
+                             unsigned int lodCells)
             {
                 int result = glGenLists(1);
 
@@ -187,7 +272,7 @@ namespace ompl
                         glMultMatrixf((float*)&t);
                     }
 
-                    recursive_render(scenes[i], scenes[i]->mRootNode);
+                    render_batches(scenes[i], lodCells);
 
                     if (tr)
                         glPopMatrix();
@@ -199,6 +284,11 @@ namespace ompl
             }
 
 
+            int assimpRender(const std::vector<const aiScene*> &scenes, const std::vector<aiVector3D> &robotCenter)
+            {
+                return assimpRender(scenes, robotCenter, 0);
+            }
+
             int assimpRender(const aiScene* scene, const aiVector3D &robotCenter)
             {
                 std::vector<const aiScene*> scenes(1, scene);
@@ -30,6 +30,15 @@ namespace ompl
             int assimpRender(const aiScene* scene, const aiVector3D &robotCenter);
             int assimpRender(const std::vector<const aiScene*> &scenes, const std::vector<aiVector3D> &robotCenter);
 
+            /** \brief Render \e scenes into a display list. The meshes are
+                transformed by their scene graph once and drawn from one
+                vertex array per material and primitive type. If \e lodCells
+                is positive, vertices are clustered on a grid with \e lodCells
+                cells along the longest side of each scene, which gives a
+                coarser mesh (e.g., to draw while the camera moves). */
+            int assimpRender(const std::vector<const aiScene*> &scenes, const std::vector<aiVector3D> &robotCenter,
+                             unsigned int lodCells);
+
         }
         /// @endcond
     }
@@ -150,7 +150,7 @@ def save_cfg_file(name, session_id, text):
     return file_loc
 
 
-def format_solution(path, solved):
+def format_solution(ompl_setup, path, solved):
     """
     Formats the either the solution, or a failure message for delivery to the
     client.
@@ -160,21 +160,16 @@ def format_solution(path, solved):
 
     if solved:
         solution['solved'] = 'true'
-        # Format the path
-        path_matrix = path.printAsMatrix().strip().split('\n')
-
         # A list of n states, where path_list[0] is the start state and path_list[n]
         # is the goal state, and path_list[i] are the intermediary states.
         # Each state is also a list: [x, y, z,
-        path_list = []
-
-        for line in path_matrix:
-            # print "\t " + line
-            path_list.append(line.strip().split(" "))
-
+        # All states are converted in one pass.
+        path_list = ompl_setup.getStateValues(path).tolist()
         solution['path'] = path_list
 
-        solution['pathAsMatrix'] = path.printAsMatrix()
+        # the same text as path.printAsMatrix()
+        solution['pathAsMatrix'] = ''.join(
+            ' '.join('%g' % value for value in state) + ' \n' for state in path_list)
     else:
         solution['solved'] = 'false'
 
@@ -183,6 +178,8 @@ def format_solution(path, solved):
 
 def get_offset(env_mesh, robot_mesh):
     ompl_setup = oa.SE3RigidBodyPlanning()
+    # the browser renders the mesh files itself
+    ompl_setup.setHeadlessMeshImport(True)
     ompl_setup.setEnvironmentMesh(str(env_mesh))
     ompl_setup.setRobotMesh(str(robot_mesh))
 
@@ -199,19 +196,29 @@ def get_offset(env_mesh, robot_mesh):
     return offset
 
 
+# Apps with loaded meshes and collision checkers are kept across requests
+planning_server = oa.PlanningServer()
+
 def setup(problem):
     OMPL_INFORM("Robot type is: %s" % str(problem["robot.type"]))
 
-    ompl_setup = eval("oa.%s()" % problem["robot.type"])
+    # The graphical apps only add rendering to the app they derive from
+    robot_type = str(problem["robot.type"])
+    if robot_type.startswith("G") and planning_server.isRegistered(robot_type[1:]):
+        robot_type = robot_type[1:]
+    if planning_server.isRegistered(robot_type):
+        ompl_setup = planning_server.getApp(robot_type, str(problem['robot_loc']), str(problem['env_loc']))
+    else:
+        ompl_setup = eval("oa.%s()" % problem["robot.type"])
+        ompl_setup.setHeadlessMeshImport(True)
+        ompl_setup.setEnvironmentMesh(str(problem['env_loc']))
+        ompl_setup.setRobotMesh(str(problem['robot_loc']))
     problem["is3D"] = isinstance(ompl_setup.getGeometricComponentStateSpace(), ob.SE3StateSpace)
     if str(ompl_setup.getAppType()) == "GEOMETRIC":
         problem["isGeometric"] = True
     else:
         problem["isGeometric"] = False
 
-    ompl_setup.setEnvironmentMesh(str(problem['env_loc']))
-    ompl_setup.setRobotMesh(str(problem['robot_loc']))
-
     if problem["is3D"]:
         # Set the dimensions of the bounding box
         bounds = ob.RealVectorBounds(3)
@@ -281,28 +288,31 @@ def setup(problem):
     return ompl_setup
 
 
-@celery.task()
-def solve(problem):
+def make_planner(ompl_setup, problem):
     """
-    Given an instance of the Problem class, containing the problem configuration
-    data, solves the motion planning problem and returns either the solution
-    path or a failure message.
+    Allocates the planner selected in the problem configuration for the space
+    information of ompl_setup, with the parameters configured by the user.
     """
 
-    # Sets up the robot type related information
-    ompl_setup = setup(problem)
-
-    # Load the planner
     space_info = ompl_setup.getSpaceInformation()
     if problem['planner'].startswith('ompl.control.Syclop'):
         decomposition = ompl_setup.allocDecomposition()
         planner = eval('%s(space_info, decomposition)' % problem['planner'])
-        ompl_setup.setPlanner(planner)
     else:
         planner = eval("%s(space_info)" % problem['planner'])
-        ompl_setup.setPlanner(planner)
 
-    # Set the optimization objective
+    # Set each parameter that was configured by the user
+    for param in problem['planner_params']:
+        planner.params().setParam(str(param), str(problem['planner_params'][param]))
+
+    return planner
+
+
+def make_objective(space_info, problem):
+    """
+    Allocates the optimization objective selected in the problem configuration.
+    """
+
     objectives = {'length': 'PathLengthOptimizationObjective', \
         'max_min_clearance': 'MaximizeMinClearanceObjective', \
         'mechanical_work': 'MechanicalWorkOptimizationObjective'}
@@ -310,26 +320,23 @@ def solve(problem):
     obj = eval('ob.%s(space_info)' % objective)
     cost = ob.Cost(float(problem['objective.threshold']))
     obj.setCostThreshold(cost)
-    ompl_setup.setOptimizationObjective(obj)
+    return obj
 
-    # Set each parameter that was configured by the user
-    for param in problem['planner_params']:
-        planner.params().setParam(str(param), str(problem['planner_params'][param]))
 
-    # Solve the problem
-    solution = {}
-    solved = ompl_setup.solve(float(problem['solve_time']))
+def format_run(ompl_setup, problem, planner, path, simplify, solved):
+    """
+    Checks, simplifies and interpolates the solution path of one run and
+    formats it, together with the states explored by the planner, for
+    delivery to the client. simplify is called with the path when it can be
+    simplified and returns the simplified path.
+    """
 
-    # Check for validity
     if solved:
         if problem['isGeometric']:
-            path = ompl_setup.getSolutionPath()
             initialValid = path.check()
             if initialValid:
                 # If initially valid, attempt to simplify
-                ompl_setup.simplifySolution()
-                # Get the simplified path
-                simple_path = ompl_setup.getSolutionPath()
+                simple_path = simplify(path)
                 simplifyValid = simple_path.check()
                 if simplifyValid:
                     path = simple_path
@@ -338,7 +345,7 @@ def solve(problem):
             else:
                 OMPL_ERROR("Invalid solution path.")
         else:
-            path = ompl_setup.getSolutionPath().asGeometric()
+            path = path.asGeometric()
             OMPL_INFORM("Path simplification skipped due to non rigid body.")
 
         # Interpolate path
@@ -350,17 +357,17 @@ def solve(problem):
                 OMPL_WARN("Interpolation produced " + str(len(path.getStates())) + \
                     " states instead of " + str(ns) + " states.")
 
-        solution = format_solution(path, True)
+        solution = format_solution(ompl_setup, path, True)
     else:
-        solution = format_solution(None, False)
+        solution = format_solution(ompl_setup, None, False)
 
     solution['name'] = str(problem['name'])
-    solution['planner'] = ompl_setup.getPlanner().getName()
+    solution['planner'] = planner.getName()
     solution['status'] = str(solved)
 
     # Store the planner data
     pd = ob.PlannerData(ompl_setup.getSpaceInformation())
-    ompl_setup.getPlannerData(pd)
+    planner.getPlannerData(pd)
     explored_states = []
     for i in range(0, pd.numVertices()):
         coords = []
@@ -379,17 +386,142 @@ def solve(problem):
     solution["explored_states"] = explored_states
     return solution
 
-@celery.task()
-def solve_multiple(runs, problem):
+
+def stop_file(task_id):
+    """
+    The file whose existence asks the solve task task_id to stop.
+    """
+
+    return join(tempfile.gettempdir(), 'omplweb_stop_' + str(task_id))
+
+def received_file(task_id):
+    """
+    The file in which /poll records how many explored states of the solve
+    task task_id the client has received.
+    """
+
+    return join(tempfile.gettempdir(), 'omplweb_received_' + str(task_id))
+
+def read_received(task_id):
     """
+    The number of explored states of the solve task task_id that the client
+    has received, 0 if it is not known yet.
     """
+
+    try:
+        with open(received_file(task_id)) as f:
+            return int(f.read())
+    except (IOError, OSError, ValueError):
+        return 0
+
+
+@celery.task(bind=True)
+def solve(self, problem):
+    """
+    Given an instance of the Problem class, containing the problem configuration
+    data, solves the motion planning problem and returns either the solution
+    path or a failure message. While the planner runs, the explored states the
+    client has not received yet and the cost of its best solution are
+    published in the PROGRESS state of the task; the planner stops early once
+    /stop is requested.
+    """
+
+    # Sets up the robot type related information
+    ompl_setup = setup(problem)
+
+    # the explored states from number progress['first_state'] on; the states
+    # before it were received by the client and are not published again
+    explored_states = []
+    progress = {'explored_states': explored_states, 'first_state': 0}
+
+    def update_progress(snapshot):
+        # snapshots only contain the vertices added since the previous one
+        for vertex in snapshot['vertices']:
+            explored_states.append(list(vertex) if problem["is3D"] else [vertex[0], vertex[1], 0])
+        if self.request.id is not None:
+            received = min(read_received(self.request.id) - progress['first_state'], len(explored_states))
+            if received > 0:
+                del explored_states[:received]
+                progress['first_state'] += received
+        progress['time'] = snapshot['time']
+        progress['solved'] = 'true' if snapshot['hasSolution'] else 'false'
+        progress['best_cost'] = snapshot['bestCost'] if snapshot['hasSolution'] else None
+        if not snapshot['done'] and self.request.id is not None:
+            self.update_state(state='PROGRESS', meta=progress)
+            return not exists(stop_file(self.request.id))
+        return True
+
+    # Load the planner
+    planner = make_planner(ompl_setup, problem)
+    ompl_setup.setPlanner(planner)
+
+    # Set the optimization objective
+    ompl_setup.setOptimizationObjective(make_objective(ompl_setup.getSpaceInformation(), problem))
+
+    # Solve the problem
+    ompl_setup.setProgressCallback(update_progress, 0.5)
+    try:
+        solved = ompl_setup.solve(float(problem['solve_time']))
+    finally:
+        # the app is kept by the planning server for other requests
+        ompl_setup.setProgressCallback(None)
+        if self.request.id is not None:
+            for name in (stop_file(self.request.id), received_file(self.request.id)):
+                if exists(name):
+                    os.remove(name)
+
+    def simplify(path):
+        ompl_setup.simplifySolution()
+        return ompl_setup.getSolutionPath()
+
+    path = ompl_setup.getSolutionPath() if solved else None
+    return format_run(ompl_setup, problem, planner, path, simplify, solved)
+
+@celery.task(bind=True)
+def solve_multiple(self, runs, problem):
+    """
+    Solves the motion planning problem runs times. The runs share one app, so
+    the meshes and the collision checker are loaded once, and are solved
+    concurrently, each with its own planner and problem definition. The
+    solutions found so far are published in the PROGRESS state of the task.
+    """
+
+    # Sets up the robot type related information
+    ompl_setup = setup(problem)
+    ompl_setup.setup()
+    space_info = ompl_setup.getSpaceInformation()
+    app_pdef = ompl_setup.getProblemDefinition()
+
+    pdefs = []
+    planners = []
+    for i in range(0, runs):
+        pdef = ob.ProblemDefinition(space_info)
+        pdef.addStartState(app_pdef.getStartState(0))
+        pdef.setGoal(app_pdef.getGoal())
+        pdef.setOptimizationObjective(make_objective(space_info, problem))
+        planner = make_planner(ompl_setup, problem)
+        planner.setProblemDefinition(pdef)
+        pdefs.append(pdef)
+        planners.append(planner)
+
     result = {}
     result['multiple'] = "true"
     solutions = []
 
-    for i in range(0, runs):
-        OMPL_INFORM("Solving run number: {}".format(i))
-        solutions.append(solve(problem))
+    def simplify(path):
+        og.PathSimplifier(space_info).simplifyMax(path)
+        return path
+
+    def done(i):
+        # Called with the Python interpreter locked, once run i is finished
+        OMPL_INFORM("Finished run number: {}".format(i))
+        solved = bool(pdefs[i].hasSolution())
+        path = pdefs[i].getSolutionPath() if solved else None
+        solutions.append(format_run(ompl_setup, problem, planners[i], path, simplify, solved))
+        self.update_state(state='PROGRESS', meta={'multiple': "true", 'solutions': solutions, 'runs': runs})
+
+    OMPL_INFORM("Solving {} runs".format(runs))
+    oa.solvePlanners(planners, float(problem['solve_time']), 0, done)
 
     result['solutions'] = solutions
 
@@ -599,8 +731,32 @@ def poll(task_id):
 
     if result.ready():
         return json.dumps(result.get()), 200
+    if result.state == 'PROGRESS':
+        # the runs of solve_multiple that are finished already, or the
+        # progress of solve; since=n leaves out the first n explored states,
+        # and tells solve to stop publishing them
+        info = dict(result.info)
+        if 'explored_states' in info:
+            since = int(flask.request.args.get('since', 0))
+            first = info.get('first_state', 0)
+            info['explored_states'] = info['explored_states'][max(since - first, 0):]
+            info['first_state'] = max(since, first)
+            if since > first:
+                with open(received_file(task_id), 'w') as f:
+                    f.write(str(since))
+        return json.dumps(info), 202
     return "Result for task id: " + task_id + " isn't ready yet.", 202
 
+@app.route('/stop/<task_id>', methods=['POST'])
+def stop(task_id):
+    """
+    Asks the solve task corresponding to the input ID to stop planning and
+    return the best solution found so far.
+    """
+
+    open(stop_file(task_id), 'w').close()
+    return "Stop requested for task id: " + task_id, 200
+
 @app.route("/upload_models", methods=['POST'])
 def upload_models():
     """
@@ -449,11 +449,13 @@ var Solution = function() {
 Solution.prototype.poll = function(taskID) {
     var completed = false;
     var pollURL = '/poll/' + taskID;
+    // The number of explored states received while the planner runs
+    var received = 0;
 
     pollingInterval = window.setInterval(function() {
 
         $.ajax({
-            url: pollURL,
+            url: pollURL + '?since=' + received,
             type: 'POST',
             data: taskID,
             success: function (data, textStatus, jqXHR) {
@@ -463,7 +465,23 @@ Solution.prototype.poll = function(taskID) {
                     solution.store(data);
                     solution.visualize();
                 } else if (jqXHR.status == 202) {
-                    // console.log("Polled, not ready yet.");
+                    // While solving, the server reports the states explored since the last poll
+                    var progress;
+                    try {
+                        progress = JSON.parse(data);
+                    } catch (e) {
+                        // console.log("Polled, not ready yet.");
+                        return;
+                    }
+                    if (progress.explored_states && progress.first_state == received) {
+                        visualization.addExploredStates(progress.explored_states);
+                        received += progress.explored_states.length;
+                        var msg = received + " states explored";
+                        if (progress.solved === "true") {
+                            msg += ", best solution cost " + progress.best_cost.toFixed(3);
+                        }
+                        showAlert("configuration", "info", msg + ".");
+                    }
                 } else {
                     console.info(data, textStatus, jqXHR);
                 }
@@ -503,18 +503,29 @@ Visualization.prototype.drawSolutionPath = function(path) {
 
 Visualization.prototype.drawExploredStates = function() {
     var states = solution.data.explored_states;
+    exploredStates = [];
+
+    if (states.length > 10000) {
+        showAlert("configuration", "warning", "There are a large number of explored states and visualization performance may be affected. Hide the explored states to improve performance.");
+    }
+
+    this.addExploredStates(states);
+}
 
+/**
+ * Draws explored states in addition to those drawn already, such as the
+ * states reported while the planner is still running.
+ *
+ * @param {Array} states The [x, y, z] coordinates of the states
+ * @return None
+ */
+Visualization.prototype.addExploredStates = function(states) {
     // Set the radius of the explored states as a function of the robot size
     var box = new THREE.Box3().setFromObject(start_robot);
     var radius = 0.01 * ((box.max.x - box.min.x)+(box.max.y - box.min.y)+(box.max.z - box.min.z));
     var geometry = new THREE.SphereGeometry(radius, 16, 16);
     var material = new THREE.MeshBasicMaterial( {color: 0xff0000} );
     var sphere = new THREE.Mesh( geometry, material );
-    exploredStates = [];
-
-    if (states.length > 10000) {
-        showAlert("configuration", "warning", "There are a large number of explored states and visualization performance may be affected. Hide the explored states to improve performance.");
-    }
 
     for (var i = 0; i < states.length; i++) {
         var point = sphere.clone();